@@ -1,5 +1,7 @@
 #include <eosiolib/eosio.hpp>
 
+#include "../../common/job_queue.hpp"
+
 using namespace eosio;
 
 class [[eosio::contract]] contracta : public eosio::contract {
@@ -12,7 +14,24 @@ class [[eosio::contract]] contracta : public eosio::contract {
     void callme(name user, std::string type) {
         eosio::print("contracta::callme called");
     }
-};
 
-EOSIO_DISPATCH( contracta, (callme));
+    [[eosio::action]]
+    void enqueue(name caller, name method, name callback, std::vector<char> payload) {
+        // a job that cannot run would block the queue, so reject it here
+        eosio_assert( method == "callme"_n, "method cannot be queued" );
+        unpack<std::tuple<name, std::string>>( payload );
+
+        ampersand::job_queue( get_self() ).push( caller, method, callback, payload );
+    }
+
+    [[eosio::action]]
+    void drain(uint32_t max_jobs) {
+        ampersand::job_queue( get_self() ).drain( max_jobs, [&]( const ampersand::job& j ) {
+            auto [user, type] = unpack<std::tuple<name, std::string>>( j.payload );
+            callme( user, type );
+            return pack( std::string("contracta::callme called") );
+        });
+    }
+};
 
+EOSIO_DISPATCH( contracta, (callme)(enqueue)(drain));
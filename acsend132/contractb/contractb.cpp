@@ -1,5 +1,7 @@
 #include <eosiolib/eosio.hpp>
 
+#include "../../common/job_queue.hpp"
+
 using namespace eosio;
 
 class [[eosio::contract]] contractb : public eosio::contract {
@@ -10,19 +12,15 @@ class [[eosio::contract]] contractb : public eosio::contract {
 
     [[eosio::action]]
     void callb(name user, std::string type) {
-        //eosio::print("contracta::callme called");
- 
-        action(
-            permission_level{get_self(),"active"_n},
-            "contracta"_n,
-            "callme"_n,
-            std::make_tuple(user, type)
-    ).send();
-
-
+        // queued at contracta; the result comes back through jobdone
+        ampersand::enqueue_job( get_self(), "contracta"_n, "callme"_n, "jobdone"_n, user, type );
+    }
 
+    [[eosio::action]]
+    void jobdone(uint64_t id, name method, std::vector<char> result) {
+        require_auth( "contracta"_n );
+        eosio::print( "job ", id, " ", method, ": ", unpack<std::string>( result ) );
     }
 };
 
-EOSIO_DISPATCH( contractb, (callb));
-
+EOSIO_DISPATCH( contractb, (callb)(jobdone));
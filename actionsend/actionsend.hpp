@@ -3,6 +3,8 @@
 #include <eosiolib/asset.hpp>
 #include <eosiolib/eosio.hpp>
 
+#include "../common/inline_action.hpp"
+
 using namespace eosio;
 
 class actionsend: public contract {
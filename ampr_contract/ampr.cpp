@@ -2,85 +2,201 @@
 #include <eosiolib/print.hpp>
 #include <eosiolib/dispatcher.hpp>
 #include <eosiolib/multi_index.hpp>
+#include <algorithm>
 #include "ampr.hpp"
 
 using namespace eosio;
 using namespace ampr;
 
 /**
- * internal method to check to see if the given account has holder data
+ * internal method to sort batch items by account and merge items for the same
+ * account, so that each account's row is touched once
  *
- * @param account the account to check
- * @return true if the account has a holder
+ * @param items the items to merge
+ * @return the total quantity of all items
+ * @assert items must not be empty
+ * @assert each quantity must be greater than zero
  */
-auto ampr_contract :: has_holder(const account_name account) {
-  eosio_assert(is_account(account), "account does not exist");
+static uint64_t merge_items(std::vector<batchitem>& items) {
+  eosio_assert(!items.empty(), "items must not be empty");
 
-  holdertable holder_data(_self, _self);
-  
-  return (holder_data.find(account) != holder_data.end());
+  std::sort(items.begin(), items.end(), [](const batchitem& a, const batchitem& b) {
+      return a.account < b.account;
+  });
+
+  uint64_t total = 0;
+  auto merged = items.begin();
+  for (auto item = items.begin(); item != items.end(); ++item) {
+    eosio_assert(item->quantity > 0, "quantity must be greater than zero");
+    total = checked_add(total, item->quantity);
+    if (item != items.begin() && item->account == merged->account) {
+      merged->quantity = checked_add(merged->quantity, item->quantity);
+    } else {
+      if (item != items.begin()) {
+	++merged;
+      }
+      *merged = *item;
+    }
+  }
+  items.erase(merged + 1, items.end());
+  return total;
 }
 
 /**
- * internal method to check to fetch the holder data for the given account,
- * creating it if necessary.  The CPU/RAM cost for this operation is staked
- * by the contract owner.
+ * internal method to find the holder data for the given account, migrating it from
+ * the legacy table if necessary.  Nothing is created, and no account check is made
+ * as a holder row can only exist for an account that exists.
  *
- * @param account the account for which to fetch the holder data
- * @return the holder data
+ * @param holder_data the holder table to search
+ * @param account the account to find
+ * @return an iterator to the holder data, or the end iterator if there is none
  */
-auto ampr_contract :: get_holder(const account_name account) {
-  eosio_assert(is_account(account), "account does not exist");
-
-  holdertable holder_data(_self, _self);
-  
+ampr_contract::holdertable::const_iterator ampr_contract :: find_holder(holdertable& holder_data, const account_name account) {
   auto iterator = holder_data.find(account);
+  if (iterator == holder_data.end() && migrate_holder(holder_data, account)) {
+    iterator = holder_data.find(account);
+  }
+  return iterator;
+}
+
+/**
+ * internal method to fetch the holder data for the given account, creating it if
+ * necessary.  The CPU/RAM cost for this operation is staked by the contract owner.
+ *
+ * @param holder_data the holder table to search
+ * @param account the account for which to fetch the holder data
+ * @return an iterator to the holder data
+ * @assert account must exist if its holder data has to be created
+ */
+ampr_contract::holdertable::const_iterator ampr_contract :: get_holder(holdertable& holder_data, const account_name account) {
+  auto iterator = find_holder(holder_data, account);
   if (iterator == holder_data.end()) {
-    holder_data.emplace(_self, [&](auto& holder) {
+    eosio_assert(is_account(account), "account does not exist");
+    iterator = holder_data.emplace(_self, [&](auto& holder) {
 	holder.owner = account;
 	holder.rights_balance = 0;
 	holder.token_balance = 0;
+	holder.roles = 0;
     });
   }
-  return holder_data.get(account);
+  return iterator;
 }
 
 /**
- * internal method to check to see if the given account has storage data
+ * internal method to find the storage data for the given account, migrating it from
+ * the legacy table if necessary.  Nothing is created.
  *
- * @param account the account to check
- * @return true if the account has a storage
+ * @param storage_data the storage table to search
+ * @param account the account to find
+ * @return an iterator to the storage data, or the end iterator if there is none
  */
-auto ampr_contract :: has_storage(const account_name account) {
-  eosio_assert(is_account(account), "account does not exist");
-
-  storagetable storage_data(_self, _self);
-  
-  return (storage_data.find(account) != storage_data.end());
+ampr_contract::storagetable::const_iterator ampr_contract :: find_storage(storagetable& storage_data, const account_name account) {
+  auto iterator = storage_data.find(account);
+  if (iterator == storage_data.end() && migrate_storage(storage_data, account)) {
+    iterator = storage_data.find(account);
+  }
+  return iterator;
 }
 
 /**
- * internal method to check to fetch the storage data for the given account,
- * creating it if necessary.  The CPU/RAM cost for this operation is staked
- * by the contract owner.
+ * internal method to fetch the storage data for the given account, creating it if
+ * necessary.  The CPU/RAM cost for this operation is staked by the contract owner.
  *
+ * @param storage_data the storage table to search
  * @param account the account for which to fetch the storage data
- * @return the storage data
+ * @return an iterator to the storage data
+ * @assert account must exist if its storage data has to be created
  */
-auto ampr_contract :: get_storage(const account_name account) {
-  eosio_assert(is_account(account), "account does not exist");
-
-  storagetable storage_data(_self, _self);
-  
-  auto iterator = storage_data.find(account);
+ampr_contract::storagetable::const_iterator ampr_contract :: get_storage(storagetable& storage_data, const account_name account) {
+  auto iterator = find_storage(storage_data, account);
   if (iterator == storage_data.end()) {
-    storage_data.emplace(_self, [&](auto& storage) {
+    eosio_assert(is_account(account), "account does not exist");
+    iterator = storage_data.emplace(_self, [&](auto& storage) {
 	storage.owner = account;
 	storage.total_assets = 0;
 	storage.coupled_assets = 0;
     });
   }
-  return storage_data.get(account);
+  return iterator;
+}
+
+/**
+ * internal method to move the given account's holder data from the legacy 128 bit
+ * table into the 64 bit table.  The RAM for the new row is staked by the contract
+ * owner, and the legacy row is released.
+ *
+ * @param holder_data the holder table receiving the row
+ * @param account the account whose holder data should be migrated
+ * @return true if a legacy row was found and migrated
+ * @assert legacy balances must fit in 64 bits
+ */
+bool ampr_contract :: migrate_holder(holdertable& holder_data, const account_name account) {
+  legacy_holdertable legacy_data(_self, _self);
+
+  auto legacy = legacy_data.find(account);
+  if (legacy == legacy_data.end()) {
+    return false;
+  }
+
+  holder_data.emplace(_self, [&](auto& holder) {
+      holder.owner = legacy->owner;
+      holder.rights_balance = checked_narrow(legacy->rights_balance);
+      holder.token_balance = checked_narrow(legacy->token_balance);
+      holder.roles = legacy_roles(legacy->rolenum);
+  });
+  legacy_data.erase(legacy);
+  return true;
+}
+
+/**
+ * internal method to move the given account's storage data from the legacy 128 bit
+ * table into the 64 bit table.  The RAM for the new row is staked by the contract
+ * owner, and the legacy row is released.
+ *
+ * @param storage_data the storage table receiving the row
+ * @param account the account whose storage data should be migrated
+ * @return true if a legacy row was found and migrated
+ * @assert legacy assets must fit in 64 bits
+ */
+bool ampr_contract :: migrate_storage(storagetable& storage_data, const account_name account) {
+  legacy_storagetable legacy_data(_self, _self);
+
+  auto legacy = legacy_data.find(account);
+  if (legacy == legacy_data.end()) {
+    return false;
+  }
+
+  storage_data.emplace(_self, [&](auto& storage) {
+      storage.owner = legacy->owner;
+      storage.total_assets = checked_narrow(legacy->total_assets);
+      storage.coupled_assets = checked_narrow(legacy->coupled_assets);
+  });
+  legacy_data.erase(legacy);
+  return true;
+}
+
+/**
+ * internal method to read the role mask of the given account.  This is a read-only
+ * lookup: legacy rows are read in place and nothing is created.
+ *
+ * @param account the account to check
+ * @return the role mask of the account, or zero if it has no holder data
+ */
+uint8_t ampr_contract :: get_roles(const account_name account) {
+  holdertable holder_data(_self, _self);
+
+  auto iterator = holder_data.find(account);
+  if (iterator != holder_data.end()) {
+    return iterator->roles;
+  }
+
+  legacy_holdertable legacy_data(_self, _self);
+
+  auto legacy = legacy_data.find(account);
+  if (legacy != legacy_data.end()) {
+    return legacy_roles(legacy->rolenum);
+  }
+  return 0;
 }
 
 /**
@@ -88,13 +204,10 @@ auto ampr_contract :: get_storage(const account_name account) {
  *
  * @param account the account to check
  * @param role the role required
- * @assert the given account must be the given role type
+ * @assert the given account must have the given role
  */
 void ampr_contract :: require_role(account_name account, Role role) {
-  eosio_assert(is_account(account), "account does not exist");
-
-  auto holder = get_holder(account);
-  eosio_assert((holder.rolenum == (char) role), "account is not the proper role");
+  eosio_assert((get_roles(account) & ROLEBIT(role)) != 0, "account is not the proper role");
 }
 
 /**
@@ -110,9 +223,12 @@ void ampr_contract :: createholder(account_name created_by, account_name account
   if (created_by != _self) {
     require_role(created_by, Role::COUPLER);
   }
-  auto holder = get_holder(account);
-  print("Holder has ", holder.rights_balance, " rights and ",
-	holder.token_balance, " tokens");
+
+  holdertable holder_data(_self, _self);
+
+  auto holder = get_holder(holder_data, account);
+  print("Holder has ", holder->rights_balance, " rights and ",
+	holder->token_balance, " tokens");
 }
 
 /**
@@ -120,7 +236,7 @@ void ampr_contract :: createholder(account_name created_by, account_name account
  * the contents of that holder if found
  *
  * @param account the account to check
- * @print the role and rights and token balance of the holder, or a not found message
+ * @print the roles and rights and token balance of the holder, or a not found message
  */
 void ampr_contract :: checkholder(account_name account) {
   holdertable holder_data(_self, _self);
@@ -128,13 +244,20 @@ void ampr_contract :: checkholder(account_name account) {
   auto iterator = holder_data.find(account);
 
   if (iterator == holder_data.end()) {
-    print("Holder ", account, " not found.");
+    legacy_holdertable legacy_data(_self, _self);
+    auto legacy = legacy_data.find(account);
+    if (legacy == legacy_data.end()) {
+      print("Holder ", account, " not found.");
+      return;
+    }
+    print("Legacy holder ", account, " is role ", ROLENAME(legacy->rolenum), " and has ",
+	  legacy->rights_balance, " rights and ", legacy->token_balance, " tokens");
     return;
   }
-  
-  auto holder = holder_data.get(account);
-  print("Holder ", account, " is role ", ROLENAME(holder.rolenum), " and has ",
-	holder.rights_balance, " rights and ", holder.token_balance, " tokens");
+
+  print("Holder ", account, " is role ");
+  print_roles(iterator->roles);
+  print(" and has ", iterator->rights_balance, " rights and ", iterator->token_balance, " tokens");
 }
 
 /**
@@ -150,13 +273,88 @@ void ampr_contract :: checkstorage(account_name account) {
   auto iterator = storage_data.find(account);
 
   if (iterator == storage_data.end()) {
-    print("Storage ", account, " not found.");
+    legacy_storagetable legacy_data(_self, _self);
+    auto legacy = legacy_data.find(account);
+    if (legacy == legacy_data.end()) {
+      print("Storage ", account, " not found.");
+      return;
+    }
+    print("Legacy storage ", account, " has ", legacy->total_assets, " total and ",
+	  legacy->coupled_assets, " coupled assets.");
     return;
   }
-  
-  auto storage = storage_data.get(account);
-  print("Storage ", account, " has ", storage.total_assets, " total and ",
-	storage.coupled_assets, " coupled assets.");
+
+  print("Storage ", account, " has ", iterator->total_assets, " total and ",
+	iterator->coupled_assets, " coupled assets.");
+}
+
+/**
+ * public method to read the holder and storage data of a number of accounts.  The
+ * result is a packed queryresult written to the console as a single hex string, so
+ * that it can be decoded with the contract ABI instead of parsed from text.  Legacy
+ * rows are read in place and nothing is created or migrated.
+ *
+ * @param accounts the accounts to read
+ * @print the packed queryresult as hex
+ */
+void ampr_contract :: queryaccts(std::vector<account_name> accounts) {
+  holdertable holder_data(_self, _self);
+  storagetable storage_data(_self, _self);
+  legacy_holdertable legacy_holders(_self, _self);
+  legacy_storagetable legacy_storages(_self, _self);
+
+  queryresult result;
+  result.unknown.resize((accounts.size() + 7) / 8);
+  result.overflow.resize((accounts.size() + 7) / 8);
+  result.records.reserve(accounts.size());
+
+  for (size_t i = 0; i < accounts.size(); i++) {
+    accountrecord record{ accounts[i], 0, 0, 0, 0, 0 };
+    bool found = false;
+    bool fits = true;
+
+    auto holder = holder_data.find(accounts[i]);
+    if (holder != holder_data.end()) {
+      record.roles = holder->roles;
+      record.rights_balance = holder->rights_balance;
+      record.token_balance = holder->token_balance;
+      found = true;
+    } else {
+      auto legacy = legacy_holders.find(accounts[i]);
+      if (legacy != legacy_holders.end()) {
+	record.roles = legacy_roles(legacy->rolenum);
+	record.rights_balance = saturating_narrow(legacy->rights_balance, fits);
+	record.token_balance = saturating_narrow(legacy->token_balance, fits);
+	found = true;
+      }
+    }
+
+    auto storage = storage_data.find(accounts[i]);
+    if (storage != storage_data.end()) {
+      record.total_assets = storage->total_assets;
+      record.coupled_assets = storage->coupled_assets;
+      found = true;
+    } else {
+      auto legacy = legacy_storages.find(accounts[i]);
+      if (legacy != legacy_storages.end()) {
+	record.total_assets = saturating_narrow(legacy->total_assets, fits);
+	record.coupled_assets = saturating_narrow(legacy->coupled_assets, fits);
+	found = true;
+      }
+    }
+
+    if (found) {
+      result.records.push_back(record);
+    } else {
+      result.unknown[i / 8] |= (uint8_t) (1 << (i % 8));
+    }
+    if (!fits) {
+      result.overflow[i / 8] |= (uint8_t) (1 << (i % 8));
+    }
+  }
+
+  auto packed = pack(result);
+  printhex(packed.data(), packed.size());
 }
 
 /**
@@ -167,14 +365,14 @@ void ampr_contract :: checkstorage(account_name account) {
  * @param rights the number of rights to create
  * @assert account must be a coupler
  */
-void ampr_contract :: createrights(account_name account, uint128_t rights) {
+void ampr_contract :: createrights(account_name account, uint64_t rights) {
   require_role(account, Role::COUPLER);
 
   holdertable holder_data(_self, _self);
-  
-  auto iterator = holder_data.find(account);
+
+  auto iterator = find_holder(holder_data, account);
   holder_data.modify(iterator, _self, [&](auto& account) {
-      account.rights_balance += rights;
+      account.rights_balance = checked_add(account.rights_balance, rights);
   });
 
   print("Rights created");
@@ -193,27 +391,24 @@ void ampr_contract :: createrights(account_name account, uint128_t rights) {
  * @assert from account must have a holder with sufficient balance
  * @assert to account must be a valid account
  */
-void ampr_contract :: sendrights(account_name from, account_name to, uint128_t rights) {
+void ampr_contract :: sendrights(account_name from, account_name to, uint64_t rights) {
   eosio_assert(from != to, "cannot send to self");
   require_auth(from);
-  eosio_assert(has_holder(from), "from account does not have holder");
-  eosio_assert(is_account(to), "to account does not exist");
 
   holdertable holder_data(_self, _self);
-  
-  auto from_holder = get_holder(from);
-  auto to_holder = get_holder(to);
 
-  eosio_assert(from_holder.rights_balance >= rights, "insufficient balance");
+  auto from_holder = find_holder(holder_data, from);
+  eosio_assert(from_holder != holder_data.end(), "from account does not have holder");
+  eosio_assert(from_holder->rights_balance >= rights, "insufficient balance");
 
-  auto iterator = holder_data.find(from);
-  holder_data.modify(iterator, from, [&](auto& holder) {
+  auto to_holder = get_holder(holder_data, to);
+
+  holder_data.modify(from_holder, from, [&](auto& holder) {
       holder.rights_balance -= rights;
   });
-  
-  iterator = holder_data.find(to);
-  holder_data.modify(iterator, from, [&](auto& holder) {
-      holder.rights_balance += rights;
+
+  holder_data.modify(to_holder, from, [&](auto& holder) {
+      holder.rights_balance = checked_add(holder.rights_balance, rights);
   });
 }
 
@@ -230,68 +425,98 @@ void ampr_contract :: sendrights(account_name from, account_name to, uint128_t r
  * @assert from account must have a holder with sufficient balance
  * @assert to account must be a valid account
  */
-void ampr_contract :: sendtokens(account_name from, account_name to, uint128_t tokens) {
+void ampr_contract :: sendtokens(account_name from, account_name to, uint64_t tokens) {
   eosio_assert(from != to, "cannot send to self");
   require_auth(from);
-  eosio_assert(is_account(to), "to account does not exist");
 
   holdertable holder_data(_self, _self);
-  
-  auto from_holder = get_holder(from);
-  auto to_holder = get_holder(to);
 
-  eosio_assert(from_holder.token_balance >= tokens, "insufficient balance");
+  auto from_holder = find_holder(holder_data, from);
+  eosio_assert(from_holder != holder_data.end() && from_holder->token_balance >= tokens, "insufficient balance");
+
+  auto to_holder = get_holder(holder_data, to);
 
-  auto iterator = holder_data.find(from);
-  holder_data.modify(iterator, from, [&](auto& holder) {
+  holder_data.modify(from_holder, from, [&](auto& holder) {
       holder.token_balance -= tokens;
   });
-  
-  iterator = holder_data.find(to);
-  holder_data.modify(iterator, from, [&](auto& holder) {
-      holder.token_balance += tokens;
+
+  holder_data.modify(to_holder, from, [&](auto& holder) {
+      holder.token_balance = checked_add(holder.token_balance, tokens);
   });
 }
 
 /**
- * sets the role of the given account.  contract owner's stake will be used to
- * create this holder, if necessary, and to set the role number.
+ * adds a role to the given account.  setting the HOLDER role clears all other
+ * roles.  contract owner's stake will be used to create this holder, if necessary,
+ * and to set the role.
  *
  * @param set_by the account setting the role
  * @param account the account whose role should be set
  * @param rolenum the role to be set
+ * @assert rolenum must be a role
  * @assert account cannot set its own role
  * @assert set_by account must be a signer
  * @assert account must exist
  */
 void ampr_contract :: setrole(account_name set_by, account_name account, char rolenum) {
+  eosio_assert(is_role(rolenum), "invalid role");
   eosio_assert(set_by != account, "cannot set own role");
   require_auth(set_by);
-  eosio_assert(is_account(account), "account does not exist");
-  
+
   if (set_by != _self) {
     require_role(set_by, Role::COUPLER);
   }
 
-  get_holder(account);
+  holdertable holder_data(_self, _self);
+
+  auto iterator = get_holder(holder_data, account);
 
   if (rolenum == (char) Role::STORAGE) {
     print("Creating storage... ");
-    get_storage(account);
+    storagetable storage_data(_self, _self);
+    get_storage(storage_data, account);
   }
-  
-  holdertable holder_data(_self, _self);
 
-  auto iterator = holder_data.find(account);
-  if (iterator == holder_data.end()) {
-    eosio_assert(false, "account does not have holder data");
+  holder_data.modify(iterator, _self, [&](auto& holder) {
+      holder.roles = (rolenum == (char) Role::HOLDER) ? 0 : (holder.roles | ROLEBIT((Role) rolenum));
+  });
+
+  print("Roles set to ");
+  print_roles(iterator->roles);
+}
+
+/**
+ * removes a role from the given account.  the account's storage data, if any, is
+ * kept so that its assets remain accounted for.
+ *
+ * @param set_by the account clearing the role
+ * @param account the account whose role should be cleared
+ * @param rolenum the role to be cleared
+ * @assert rolenum must be a role
+ * @assert account cannot clear its own role
+ * @assert set_by account must be a signer
+ * @assert account must have holder data
+ */
+void ampr_contract :: clearrole(account_name set_by, account_name account, char rolenum) {
+  eosio_assert(is_role(rolenum), "invalid role");
+  eosio_assert(set_by != account, "cannot clear own role");
+  require_auth(set_by);
+
+  if (set_by != _self) {
+    require_role(set_by, Role::COUPLER);
   }
 
+  holdertable holder_data(_self, _self);
+
+  auto iterator = find_holder(holder_data, account);
+  eosio_assert(iterator != holder_data.end(), "account does not have holder data");
+
   holder_data.modify(iterator, _self, [&](auto& holder) {
-      holder.rolenum = rolenum;
+      holder.roles &= ~ROLEBIT((Role) rolenum);
   });
 
-  print("Role set to ", ROLENAME(rolenum));
+  print("Roles set to ");
+  print_roles(iterator->roles);
 }
 
 /**
@@ -308,7 +533,7 @@ void ampr_contract :: setrole(account_name set_by, account_name account, char ro
  * @assert deposit_by must be a coupler
  * @assert account must be a storage location
  */
-void ampr_contract :: deposit(account_name deposit_by, account_name account, uint128_t quantity) {
+void ampr_contract :: deposit(account_name deposit_by, account_name account, uint64_t quantity) {
   eosio_assert(deposit_by != account, "cannot deposit into own account");
   require_auth(deposit_by);
   require_auth(account);
@@ -320,53 +545,299 @@ void ampr_contract :: deposit(account_name deposit_by, account_name account, uin
 
   storagetable storage_data(_self, _self);
 
-  auto iterator = storage_data.find(account);
-  if (iterator == storage_data.end()) {
-    eosio_assert(false, "account does not have storage data");
-  }
+  auto iterator = find_storage(storage_data, account);
+  eosio_assert(iterator != storage_data.end(), "account does not have storage data");
 
   storage_data.modify(iterator, _self, [&](auto& storage) {
-      storage.total_assets += quantity;
+      storage.total_assets = checked_add(storage.total_assets, quantity);
   });
 }
 
 /**
  * couples a given amount of deposited silver, consuming digital rights and creating silver tokens.
  */
-void ampr_contract :: couple(account_name coupler, account_name storage, account_name account, uint128_t quantity) {
+void ampr_contract :: couple(account_name coupler, account_name storage, account_name account, uint64_t quantity) {
   require_auth(coupler);
   require_auth(account);
   require_role(coupler, Role::COUPLER);
   require_role(storage, Role::STORAGE);
   eosio_assert(quantity > 0, "quantity must be greater than zero");
-  eosio_assert(has_holder(account), "account does not have holder data");
 
-  auto storage_record = get_storage(storage);
-  auto holder_record = get_holder(account);
+  holdertable holder_data(_self, _self);
+  storagetable storage_data(_self, _self);
+
+  auto holder_iterator = find_holder(holder_data, account);
+  eosio_assert(holder_iterator != holder_data.end(), "account does not have holder data");
+
+  auto storage_iterator = find_storage(storage_data, storage);
+  eosio_assert(storage_iterator != storage_data.end(), "could not find storage data for storage");
+
+  eosio_assert(storage_iterator->total_assets - storage_iterator->coupled_assets >= quantity, "storage does not have enough uncoupled quantity");
+  eosio_assert(holder_iterator->rights_balance >= quantity, "account does not have enough rights to couple the quantity");
+
+  holder_data.modify(holder_iterator, _self, [&](auto& holder) {
+      holder.rights_balance -= quantity;
+      holder.token_balance = checked_add(holder.token_balance, quantity);
+  });
+
+  storage_data.modify(storage_iterator, _self, [&](auto& storage) {
+      storage.coupled_assets = checked_add(storage.coupled_assets, quantity);
+  });
+}
+
+/**
+ * couples a given amount of deposited silver without naming a storage location.  The
+ * storage location with the most uncoupled capacity is found through the capacity
+ * index; when split is set and that location cannot cover the whole quantity, the
+ * remainder is taken from the next locations in order of capacity.  Each location is
+ * visited at most once, so a call costs a lookup per location used or skipped.
+ * Storage rows of accounts that no longer have the storage role are skipped.
+ *
+ * Storage rows still in the legacy storagedata table are not in the capacity index
+ * and are not used; run migrate to move them first.
+ *
+ * @param coupler the coupler performing the coupling
+ * @param account the holder whose rights are coupled
+ * @param quantity the amount to couple
+ * @param split whether the quantity may be split across storage locations
+ * @assert coupler and account must be signers
+ * @assert coupler must be a coupler
+ * @assert quantity must be greater than zero
+ * @assert account must have enough rights to couple the quantity
+ * @assert storage must have enough uncoupled quantity, in one location unless split is set
+ * @print the storage locations used and the quantity coupled from each
+ */
+void ampr_contract :: autocouple(account_name coupler, account_name account, uint64_t quantity, bool split) {
+  require_auth(coupler);
+  require_auth(account);
+  require_role(coupler, Role::COUPLER);
+  eosio_assert(quantity > 0, "quantity must be greater than zero");
 
-  eosio_assert(storage_record.total_assets - storage_record.coupled_assets >= quantity, "storage does not have enough uncoupled quantity");
-  eosio_assert(holder_record.rights_balance >= quantity, "account does not have enough rights to couple the quantity");
-  
   holdertable holder_data(_self, _self);
+
+  auto holder_iterator = find_holder(holder_data, account);
+  eosio_assert(holder_iterator != holder_data.end(), "account does not have holder data");
+  eosio_assert(holder_iterator->rights_balance >= quantity, "account does not have enough rights to couple the quantity");
+
   storagetable storage_data(_self, _self);
+  auto capacity = storage_data.get_index<N(capacity)>();
+
+  uint64_t remaining = quantity;
+  auto storage_iterator = capacity.begin();
+  while (remaining > 0 && storage_iterator != capacity.end()) {
+    const uint64_t available = storage_iterator->total_assets - storage_iterator->coupled_assets;
+    if (available == 0) {
+      // full locations sort last, so there is no capacity left
+      break;
+    }
+
+    auto next = storage_iterator;
+    ++next;
+    if ((get_roles(storage_iterator->owner) & ROLEBIT(Role::STORAGE)) == 0) {
+      storage_iterator = next;
+      continue;
+    }
+    eosio_assert(split || available >= quantity, "storage does not have enough uncoupled quantity");
+
+    const uint64_t coupled = (available < remaining) ? available : remaining;
+    capacity.modify(storage_iterator, _self, [&](auto& storage) {
+	storage.coupled_assets += coupled;
+    });
+    print("Coupled ", coupled, " from storage ", name{storage_iterator->owner}, ". ");
+    remaining -= coupled;
 
-  auto holder_iterator = holder_data.find(account);
-  if (holder_iterator == holder_data.end()) {
-    eosio_assert(false, "could not find holder data for account");
+    // a location keeps capacity only when it covers the rest of the quantity, so one
+    // that is coupled from again has been filled and moved behind the others
+    storage_iterator = next;
   }
+  eosio_assert(remaining == 0, "storage does not have enough uncoupled quantity");
+
   holder_data.modify(holder_iterator, _self, [&](auto& holder) {
       holder.rights_balance -= quantity;
-      holder.token_balance += quantity;
+      holder.token_balance = checked_add(holder.token_balance, quantity);
   });
+}
+
+/**
+ * deposits assets into a number of storage locations.  items for the same storage
+ * location are merged, so that each storage row is checked and modified once.
+ *
+ * @param deposit_by the account depositing the silver
+ * @param items the storage locations getting deposits, and the amount deposited in each
+ * @assert deposit_by must be a signer
+ * @assert deposit_by must be a coupler or contract owner
+ * @assert items must not be empty, and each quantity must be greater than zero
+ * @assert each storage location must be a signer, and cannot be deposit_by
+ * @assert each storage location must have the storage role
+ */
+void ampr_contract :: depositbatch(account_name deposit_by, std::vector<batchitem> items) {
+  require_auth(deposit_by);
+  if (deposit_by != _self) {
+    require_role(deposit_by, Role::COUPLER);
+  }
+  merge_items(items);
+
+  storagetable storage_data(_self, _self);
+
+  for (const auto& item : items) {
+    eosio_assert(item.account != deposit_by, "cannot deposit into own account");
+    require_auth(item.account);
+    require_role(item.account, Role::STORAGE);
 
-  auto storage_iterator = storage_data.find(storage);
-  if (storage_iterator == storage_data.end()) {
-    eosio_assert(false, "could not find storage data for storage");
+    auto iterator = find_storage(storage_data, item.account);
+    eosio_assert(iterator != storage_data.end(), "account does not have storage data");
+
+    storage_data.modify(iterator, _self, [&](auto& storage) {
+	storage.total_assets = checked_add(storage.total_assets, item.quantity);
+    });
   }
+}
+
+/**
+ * couples deposited silver from a single storage location for a number of holders.
+ * items for the same holder are merged, so that each holder row is modified once,
+ * and the storage row is checked and modified once for the whole batch.
+ *
+ * @param coupler the coupler performing the coupling
+ * @param storage the storage location holding the deposited silver
+ * @param items the holders, and the quantity to couple for each
+ * @assert coupler must be a signer and a coupler
+ * @assert storage must be a storage location with enough uncoupled quantity for all items
+ * @assert items must not be empty, and each quantity must be greater than zero
+ * @assert each holder must be a signer with enough rights to couple its quantity
+ */
+void ampr_contract :: couplebatch(account_name coupler, account_name storage, std::vector<batchitem> items) {
+  require_auth(coupler);
+  require_role(coupler, Role::COUPLER);
+  require_role(storage, Role::STORAGE);
+  const uint64_t total = merge_items(items);
+
+  holdertable holder_data(_self, _self);
+  storagetable storage_data(_self, _self);
+
+  auto storage_iterator = find_storage(storage_data, storage);
+  eosio_assert(storage_iterator != storage_data.end(), "could not find storage data for storage");
+  eosio_assert(storage_iterator->total_assets - storage_iterator->coupled_assets >= total, "storage does not have enough uncoupled quantity");
+
+  for (const auto& item : items) {
+    require_auth(item.account);
+
+    auto holder_iterator = find_holder(holder_data, item.account);
+    eosio_assert(holder_iterator != holder_data.end(), "account does not have holder data");
+    eosio_assert(holder_iterator->rights_balance >= item.quantity, "account does not have enough rights to couple the quantity");
+
+    holder_data.modify(holder_iterator, _self, [&](auto& holder) {
+	holder.rights_balance -= item.quantity;
+	holder.token_balance = checked_add(holder.token_balance, item.quantity);
+    });
+  }
+
   storage_data.modify(storage_iterator, _self, [&](auto& storage) {
-      storage.coupled_assets += quantity;
+      storage.coupled_assets = checked_add(storage.coupled_assets, total);
   });
 }
 
-EOSIO_ABI(ampr_contract, (createholder) (checkholder) (checkstorage) (createrights) (sendrights) (sendtokens) (setrole) (deposit) (couple))
+/**
+ * moves up to max_rows rows from the legacy 128 bit holder and storage tables into
+ * the 64 bit tables.  Holders are migrated first.  Rows touched by other actions are
+ * migrated as they are accessed, so this may be run in batches while the contract
+ * remains in use.  Rows with a balance that does not fit in 64 bits are skipped and
+ * stay in the legacy tables.  Skipped rows count towards max_rows, and each call
+ * resumes after the last row the previous call visited, so a call never reads more
+ * than max_rows legacy rows and skipped rows are not walked again.
+ *
+ * @param max_rows the maximum number of legacy rows to visit in this action
+ * @assert contract owner must be a signer
+ * @assert max_rows must be greater than zero
+ * @print the number of rows migrated, the RAM saved per row, the accounts skipped,
+ * and whether rows remain
+ */
+void ampr_contract :: migrate(uint32_t max_rows) {
+  require_auth(_self);
+  eosio_assert(max_rows > 0, "max_rows must be greater than zero");
+
+  holdertable holder_data(_self, _self);
+  storagetable storage_data(_self, _self);
+  legacy_holdertable legacy_holders(_self, _self);
+  legacy_storagetable legacy_storages(_self, _self);
+  migrationtable migration(_self, _self);
+
+  migrationdata cursor;
+  auto cursor_iterator = migration.find(0);
+  if (cursor_iterator != migration.end()) {
+    cursor = *cursor_iterator;
+  }
+
+  uint32_t holders = 0;
+  uint32_t storages = 0;
+  uint32_t skipped = 0;
+
+  auto holder_iterator = cursor.holders_done ? legacy_holders.end() : legacy_holders.lower_bound(cursor.next_holder);
+  while (holder_iterator != legacy_holders.end() && holders + storages + skipped < max_rows) {
+    if (!holder_iterator->fits()) {
+      print("Skipped holder ", name{holder_iterator->owner}, ", its balances do not fit in 64 bits. ");
+      skipped++;
+      holder_iterator++;
+      continue;
+    }
+    holder_data.emplace(_self, [&](auto& holder) {
+	holder.owner = holder_iterator->owner;
+	holder.rights_balance = checked_narrow(holder_iterator->rights_balance);
+	holder.token_balance = checked_narrow(holder_iterator->token_balance);
+	holder.roles = legacy_roles(holder_iterator->rolenum);
+    });
+    holder_iterator = legacy_holders.erase(holder_iterator);
+    holders++;
+  }
+  if (holder_iterator == legacy_holders.end()) {
+    cursor.holders_done = true;
+  } else {
+    cursor.next_holder = holder_iterator->owner;
+  }
+
+  auto storage_iterator = legacy_storages.end();
+  if (cursor.holders_done) {
+    storage_iterator = legacy_storages.lower_bound(cursor.next_storage);
+    while (storage_iterator != legacy_storages.end() && holders + storages + skipped < max_rows) {
+      if (!storage_iterator->fits()) {
+	print("Skipped storage ", name{storage_iterator->owner}, ", its assets do not fit in 64 bits. ");
+	skipped++;
+	storage_iterator++;
+	continue;
+      }
+      storage_data.emplace(_self, [&](auto& storage) {
+	  storage.owner = storage_iterator->owner;
+	  storage.total_assets = checked_narrow(storage_iterator->total_assets);
+	  storage.coupled_assets = checked_narrow(storage_iterator->coupled_assets);
+      });
+      storage_iterator = legacy_storages.erase(storage_iterator);
+      storages++;
+    }
+    cursor.next_storage = storage_iterator == legacy_storages.end() ? UINT64_MAX : storage_iterator->owner;
+  }
+
+  if (cursor_iterator == migration.end()) {
+    migration.emplace(_self, [&](auto& row) { row = cursor; });
+  } else {
+    migration.modify(cursor_iterator, _self, [&](auto& row) { row = cursor; });
+  }
+
+  const auto holder_saved = pack_size(holderdata_v1{}) - pack_size(holderdata{});
+  const auto storage_saved = pack_size(storagedata_v1{}) - pack_size(storagedata{});
+
+  print("Migrated ", holders, " holders saving ", holder_saved, " bytes per row and ",
+	storages, " storages saving ", storage_saved, " bytes per row, ",
+	holders * holder_saved + storages * storage_saved, " bytes total. ");
+
+  if (cursor.holders_done && storage_iterator == legacy_storages.end()) {
+    if (legacy_holders.begin() != legacy_holders.end() || legacy_storages.begin() != legacy_storages.end()) {
+      print("Migration complete except for rows skipped because they do not fit in 64 bits.");
+    } else {
+      print("Migration complete.");
+    }
+  } else {
+    print("Rows remain to be migrated.");
+  }
+}
 
+EOSIO_ABI(ampr_contract, (createholder) (checkholder) (checkstorage) (queryaccts) (createrights) (sendrights) (sendtokens) (setrole) (clearrole) (deposit) (couple) (autocouple) (depositbatch) (couplebatch) (migrate))
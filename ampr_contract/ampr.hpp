@@ -14,11 +14,74 @@ namespace ampr {
     STORAGE = 3,
   };
 
-  //@abi table
+  /**
+   * bit for the given role in a holder's role mask.  HOLDER has no bit, as every
+   * account with holder data is a holder.
+   */
+  uint8_t ROLEBIT(Role role) {
+    return (role == HOLDER) ? 0 : (uint8_t) (1 << role);
+  }
+
+  /**
+   * true if rolenum names one of the roles
+   */
+  inline bool is_role(char rolenum) {
+    return rolenum >= HOLDER && rolenum <= STORAGE;
+  }
+
+  /**
+   * role mask of a legacy row's rolenum.  the legacy contract stored whatever rolenum
+   * it was given, and a value that is not a role matched no role check, so it becomes
+   * a plain holder.
+   */
+  inline uint8_t legacy_roles(char rolenum) {
+    return is_role(rolenum) ? ROLEBIT((Role) rolenum) : 0;
+  }
+
+  //@abi table holders i64
   struct [[eosio::table]] holderdata {
 
     account_name owner;
 
+    uint64_t rights_balance;
+    
+    uint64_t token_balance;
+
+    uint8_t roles;
+
+    uint64_t primary_key() const { return owner; }
+    
+    EOSLIB_SERIALIZE(holderdata, (owner)(rights_balance)(token_balance)(roles))
+  };
+
+  //@abi table storages i64
+  struct storagedata {
+
+    account_name owner;
+
+    uint64_t total_assets;
+
+    uint64_t coupled_assets;
+
+    uint64_t primary_key() const { return owner; }
+
+    /**
+     * secondary key ordering storage by uncoupled capacity, most free capacity first
+     */
+    uint64_t by_capacity() const { return UINT64_MAX - (total_assets - coupled_assets); }
+
+    EOSLIB_SERIALIZE(storagedata, (owner)(total_assets)(coupled_assets))
+  };
+
+  /**
+   * holder layout used before balances were narrowed to 64 bits.  rows are
+   * moved to holderdata by the migrate action or when they are next touched.
+   */
+  //@abi table holderdata i64
+  struct holderdata_v1 {
+
+    account_name owner;
+
     uint128_t rights_balance;
     
     uint128_t token_balance;
@@ -26,12 +89,20 @@ namespace ampr {
     char rolenum;
 
     uint64_t primary_key() const { return owner; }
+
+    /**
+     * true if the balances fit in 64 bits, so the row can be migrated
+     */
+    bool fits() const { return rights_balance <= UINT64_MAX && token_balance <= UINT64_MAX; }
     
-    EOSLIB_SERIALIZE(holderdata, (owner)(rights_balance)(token_balance)(rolenum))
+    EOSLIB_SERIALIZE(holderdata_v1, (owner)(rights_balance)(token_balance)(rolenum))
   };
 
-  //@abi table
-  struct storagedata {
+  /**
+   * storage layout used before balances were narrowed to 64 bits
+   */
+  //@abi table storagedata i64
+  struct storagedata_v1 {
 
     account_name owner;
 
@@ -41,9 +112,112 @@ namespace ampr {
 
     uint64_t primary_key() const { return owner; }
 
-    EOSLIB_SERIALIZE(storagedata, (owner)(total_assets)(coupled_assets))
+    /**
+     * true if the assets fit in 64 bits, so the row can be migrated
+     */
+    bool fits() const { return total_assets <= UINT64_MAX && coupled_assets <= UINT64_MAX; }
+
+    EOSLIB_SERIALIZE(storagedata_v1, (owner)(total_assets)(coupled_assets))
   };
 
+  /**
+   * where the migrate action resumes in the legacy tables.  the table holds a
+   * single row with id 0.
+   */
+  //@abi table migration i64
+  struct migrationdata {
+
+    uint64_t id = 0;
+
+    account_name next_holder = 0;
+
+    account_name next_storage = 0;
+
+    bool holders_done = false;
+
+    uint64_t primary_key() const { return id; }
+
+    EOSLIB_SERIALIZE(migrationdata, (id)(next_holder)(next_storage)(holders_done))
+  };
+
+  /**
+   * a single account and quantity in a batched deposit or couple
+   */
+  struct batchitem {
+
+    account_name account;
+
+    uint64_t quantity;
+
+    EOSLIB_SERIALIZE(batchitem, (account)(quantity))
+  };
+
+  /**
+   * packed record written by queryaccts for each account with holder or storage data
+   */
+  struct accountrecord {
+
+    account_name owner;
+
+    uint8_t roles;
+
+    uint64_t rights_balance;
+
+    uint64_t token_balance;
+
+    uint64_t total_assets;
+
+    uint64_t coupled_assets;
+
+    EOSLIB_SERIALIZE(accountrecord, (owner)(roles)(rights_balance)(token_balance)(total_assets)(coupled_assets))
+  };
+
+  /**
+   * result written by queryaccts.  bit i of unknown (least significant bit first) is
+   * set when the i-th queried account has neither holder nor storage data, and
+   * records holds one entry for every other account, in query order.  bit i of
+   * overflow is set when the i-th account is a legacy row with a balance that does not
+   * fit in 64 bits; such balances are reported as UINT64_MAX.
+   */
+  struct queryresult {
+
+    std::vector<uint8_t> unknown;
+
+    std::vector<uint8_t> overflow;
+
+    std::vector<accountrecord> records;
+
+    EOSLIB_SERIALIZE(queryresult, (unknown)(overflow)(records))
+  };
+
+  /**
+   * adds quantity to balance, asserting that the result fits in 64 bits
+   */
+  inline uint64_t checked_add(uint64_t balance, uint64_t quantity) {
+    eosio_assert(balance + quantity >= balance, "balance overflow");
+    return balance + quantity;
+  }
+
+  /**
+   * narrows a legacy 128 bit balance, asserting that it fits in 64 bits
+   */
+  inline uint64_t checked_narrow(uint128_t balance) {
+    eosio_assert(balance <= UINT64_MAX, "legacy balance does not fit in 64 bits");
+    return (uint64_t) balance;
+  }
+
+  /**
+   * narrows a legacy 128 bit balance for reading, saturating at UINT64_MAX and
+   * clearing fits if it does not fit in 64 bits
+   */
+  inline uint64_t saturating_narrow(uint128_t balance, bool& fits) {
+    if (balance > UINT64_MAX) {
+      fits = false;
+      return UINT64_MAX;
+    }
+    return (uint64_t) balance;
+  }
+
   const char * ROLENAME(Role role) {
     const char * return_val = "ERROR";
     switch (role) {
@@ -68,6 +242,21 @@ namespace ampr {
   const char * ROLENAME(char rolenum) {
     return ROLENAME((Role) rolenum);
   }
+
+  void print_roles(uint8_t roles) {
+    if (roles == 0) {
+      eosio::print("HOLDER");
+      return;
+    }
+
+    const char * separator = "";
+    for (Role role : { COUPLER, PRODUCER, STORAGE }) {
+      if (roles & ROLEBIT(role)) {
+	eosio::print(separator, ROLENAME(role));
+	separator = "|";
+      }
+    }
+  }
   
   class ampr_contract : public eosio::contract {
   public:
@@ -84,37 +273,69 @@ namespace ampr {
     void checkstorage(account_name account);
     
     //@abi action
-    void createrights(account_name account, uint128_t rights);
+    void queryaccts(std::vector<account_name> accounts);
+    
+    //@abi action
+    void createrights(account_name account, uint64_t rights);
     
     //@abi action
-    void sendrights(account_name from, account_name to, uint128_t rights);
+    void sendrights(account_name from, account_name to, uint64_t rights);
 
     //@abi action
-    void sendtokens(account_name from, account_name to, uint128_t tokens);
+    void sendtokens(account_name from, account_name to, uint64_t tokens);
 
     //@abi action
     void setrole(account_name set_by, account_name account, char rolenum);
 
     //@abi action
-    void deposit(account_name deposit_by, account_name account, uint128_t quantity);
+    void clearrole(account_name set_by, account_name account, char rolenum);
+
+    //@abi action
+    void deposit(account_name deposit_by, account_name account, uint64_t quantity);
+
+    //@abi action
+    void couple(account_name coupler, account_name storage, account_name account, uint64_t quantity);
+
+    //@abi action
+    void autocouple(account_name coupler, account_name account, uint64_t quantity, bool split);
 
     //@abi action
-    void couple(account_name coupler, account_name storage, account_name account, uint128_t quantity);
+    void depositbatch(account_name deposit_by, std::vector<batchitem> items);
+
+    //@abi action
+    void couplebatch(account_name coupler, account_name storage, std::vector<batchitem> items);
+
+    //@abi action
+    void migrate(uint32_t max_rows);
     
   private:
-    auto has_holder(const account_name account);
+    typedef eosio::multi_index<N(holders), holderdata> holdertable;
+
+    typedef eosio::multi_index<N(storages), storagedata,
+      eosio::indexed_by<N(capacity), eosio::const_mem_fun<storagedata, uint64_t, &storagedata::by_capacity>>
+      > storagetable;
+
+    typedef eosio::multi_index<N(holderdata), holderdata_v1> legacy_holdertable;
+
+    typedef eosio::multi_index<N(storagedata), storagedata_v1> legacy_storagetable;
+
+    typedef eosio::multi_index<N(migration), migrationdata> migrationtable;
+
+    holdertable::const_iterator find_holder(holdertable& holder_data, const account_name account);
     
-    auto get_holder(const account_name account);
+    holdertable::const_iterator get_holder(holdertable& holder_data, const account_name account);
 
-    auto has_storage(const account_name account);
+    storagetable::const_iterator find_storage(storagetable& storage_data, const account_name account);
 
-    auto get_storage(const account_name account);
+    storagetable::const_iterator get_storage(storagetable& storage_data, const account_name account);
+
+    uint8_t get_roles(const account_name account);
     
     void require_role(account_name account, Role role);
-    
-    typedef eosio::multi_index<N(holderdata), holderdata> holdertable;
 
-    typedef eosio::multi_index<N(storagedata), storagedata> storagetable;
+    bool migrate_holder(holdertable& holder_data, const account_name account);
+
+    bool migrate_storage(storagetable& storage_data, const account_name account);
     
     //    static holdertable _holders;
   };
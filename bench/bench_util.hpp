@@ -0,0 +1,103 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Helpers shared by the host benchmarks and profilers.
+ */
+#pragma once
+
+#include <eosiolib/name.hpp>
+
+#include <sys/resource.h>
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+   /// holder i as an account name: "h" followed by i in base 26, for up to 26^6 holders
+   inline eosio::name holder( uint64_t i ) {
+      char buf[8] = "h";
+      for( int k = 6; k >= 1; --k ) {
+         buf[k] = char( 'a' + i % 26 );
+         i /= 26;
+      }
+      buf[7] = '\0';
+      return eosio::name( std::string(buf) );
+   }
+
+   inline uint64_t now_ns() {
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+         std::chrono::steady_clock::now().time_since_epoch() ).count();
+   }
+
+   /// peak resident set size of this process, in kilobytes
+   inline long peak_rss_kb() {
+      rusage ru;
+      getrusage( RUSAGE_SELF, &ru );
+      return ru.ru_maxrss;
+   }
+
+   /// the q-quantile of sorted values
+   template<typename T>
+   T quantile( const std::vector<T>& sorted, double q ) {
+      return sorted.empty() ? T() : sorted[ size_t( q * ( sorted.size() - 1 ) ) ];
+   }
+
+   /// db_* calls made so far by a native::chain; 0 unless eosio_native counts them (NATIVE_DB_STATS)
+   template<typename Chain>
+   uint64_t db_calls( const Chain& c ) {
+#ifdef NATIVE_DB_STATS
+      return c.db_calls();
+#else
+      (void)c;
+      return 0;
+#endif
+   }
+
+   /// `,"key":value` for a report line when the db_* calls are counted, otherwise nothing
+   inline std::string db_calls_json( const char* key, double value, int precision = 0 ) {
+#ifdef NATIVE_DB_STATS
+      char buf[64];
+      std::snprintf( buf, sizeof(buf), ",\"%s\":%.*f", key, precision, value );
+      return buf;
+#else
+      (void)key; (void)value; (void)precision;
+      return {};
+#endif
+   }
+
+   /// the value of "--option=value" when arg is that option, otherwise nullptr
+   inline const char* option( const std::string& arg, const char* prefix ) {
+      size_t n = std::strlen( prefix );
+      return arg.compare( 0, n, prefix ) == 0 ? arg.c_str() + n : nullptr;
+   }
+
+   /// the non-empty items of a comma separated list
+   inline std::vector<std::string> split( const std::string& s ) {
+      std::vector<std::string> parts;
+      size_t start = 0;
+      while( start <= s.size() ) {
+         size_t end = s.find( ',', start );
+         if( end == std::string::npos )
+            end = s.size();
+         if( end > start )
+            parts.push_back( s.substr( start, end - start ) );
+         start = end + 1;
+      }
+      return parts;
+   }
+
+   inline std::vector<uint64_t> split_numbers( const std::string& s ) {
+      std::vector<uint64_t> numbers;
+      for( const auto& part : split(s) )
+         numbers.push_back( std::strtoull( part.c_str(), nullptr, 10 ) );
+      return numbers;
+   }
+
+} /// namespace bench
@@ -0,0 +1,564 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Columnar files of contract rows, as written by columnar_export, for analytics that
+ *  read a few columns of many rows.
+ *
+ *  A file is the 8 byte magic "AMPCOLMN", a little endian uint32 version, the chunks,
+ *  the directory, then the directory's size as a little endian uint64 and the magic
+ *  again.  A dataset is a set of named columns, stored in row groups; each column of
+ *  a row group is one chunk, compressed on its own, so a reader inflates only the
+ *  columns it needs.  The column encodings are
+ *
+ *     delta   integers, each the zigzag varint of its difference from the one before
+ *             it in the chunk
+ *     name    account names, as varint indices into the file's dictionary
+ *     flag    booleans, one byte each
+ *
+ *  The dictionary holds each name once, in order of first use, as little endian
+ *  uint64s, in chunks of its own.  In the directory all integers are varints and a
+ *  string is its size and bytes:
+ *
+ *     names in the dictionary, dictionary chunk count, chunks...
+ *     dataset count, then per dataset
+ *        name, rows, column count, (name, encoding)..., row group count, then per group
+ *           rows, one chunk per column
+ *
+ *  where a chunk is its offset, stored size, raw size and codec, 0 stored or 1 zlib.
+ *  Varints are LEB128.  zlib is used when the tools are built with BENCH_ZLIB.
+ */
+#pragma once
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef BENCH_ZLIB
+#include <zlib.h>
+#endif
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace bench {
+
+   constexpr char columnar_magic[8] = { 'A', 'M', 'P', 'C', 'O', 'L', 'M', 'N' };
+   constexpr uint32_t columnar_version = 1;
+
+   enum class column_encoding : uint8_t { delta = 0, name = 1, flag = 2 };
+   enum class chunk_codec : uint8_t { stored = 0, zlib = 1 };
+
+   struct column_chunk {
+      uint64_t offset = 0;
+      uint64_t stored_size = 0;
+      uint64_t raw_size = 0;
+      chunk_codec codec = chunk_codec::stored;
+   };
+
+   struct column_info {
+      std::string name;
+      column_encoding encoding;
+   };
+
+   struct row_group {
+      uint64_t rows = 0;
+      std::vector<column_chunk> chunks;   ///< one per column
+   };
+
+   struct dataset_info {
+      std::string name;
+      uint64_t rows = 0;
+      std::vector<column_info> columns;
+      std::vector<row_group> groups;
+
+      /// the index of a column, or -1
+      int column( const std::string& column_name )const {
+         for( size_t i = 0; i < columns.size(); ++i ) {
+            if( columns[i].name == column_name )
+               return i;
+         }
+         return -1;
+      }
+   };
+
+   namespace columnar_detail {
+
+      inline void put_varint( std::string& out, uint64_t v ) {
+         do {
+            uint8_t b = v & 0x7f;
+            v >>= 7;
+            out += char( b | ( v ? 0x80 : 0 ) );
+         } while( v );
+      }
+
+      inline void put_string( std::string& out, const std::string& s ) {
+         put_varint( out, s.size() );
+         out += s;
+      }
+
+      inline void put_fixed( std::string& out, uint64_t v, int bytes ) {
+         for( int i = 0; i < bytes; ++i )
+            out += char( v >> ( 8 * i ) );
+      }
+
+      inline uint64_t zigzag( int64_t v ) { return ( uint64_t(v) << 1 ) ^ uint64_t( v >> 63 ); }
+      inline int64_t unzigzag( uint64_t v ) { return int64_t( v >> 1 ) ^ -int64_t( v & 1 ); }
+
+      /// reads from a byte range, throwing at its end
+      struct cursor {
+         const char* pos;
+         const char* end;
+
+         uint64_t varint() {
+            uint64_t v = 0;
+            for( int shift = 0; shift < 64; shift += 7 ) {
+               if( pos == end )
+                  throw std::runtime_error( "columnar file is truncated" );
+               uint8_t b = uint8_t( *pos++ );
+               v |= uint64_t( b & 0x7f ) << shift;
+               if( !( b & 0x80 ) )
+                  return v;
+            }
+            throw std::runtime_error( "varint too long in columnar file" );
+         }
+
+         std::string string() {
+            uint64_t size = varint();
+            if( uint64_t( end - pos ) < size )
+               throw std::runtime_error( "columnar file is truncated" );
+            std::string s( pos, size );
+            pos += size;
+            return s;
+         }
+      };
+
+   } /// namespace columnar_detail
+
+   /**
+    * Writes a columnar file.  Datasets are declared up front and filled a row at a
+    * time, in any interleaving; each keeps one row group in memory until it is full.
+    * close writes what is left and the directory.
+    */
+   class columnar_writer {
+   public:
+      columnar_writer( const std::string& path, int level = 6, uint64_t group_rows = 1 << 16 )
+         : _path(path), _file( std::fopen( path.c_str(), "wb" ) ), _level(level), _group_rows(group_rows)
+      {
+         if( !_file )
+            throw std::runtime_error( "cannot create " + path );
+#ifndef BENCH_ZLIB
+         _level = 0;
+#endif
+         std::string header( columnar_magic, sizeof(columnar_magic) );
+         columnar_detail::put_fixed( header, columnar_version, 4 );
+         write( header );
+      }
+
+      ~columnar_writer() {
+         if( _file )
+            std::fclose( _file );
+      }
+
+      columnar_writer( const columnar_writer& ) = delete;
+      columnar_writer& operator=( const columnar_writer& ) = delete;
+
+      /// declares a dataset, returns its handle for add
+      size_t dataset( const std::string& name, std::vector<column_info> columns ) {
+         _sets.emplace_back();
+         auto& s = _sets.back();
+         s.info.name = name;
+         s.info.columns = std::move(columns);
+         s.buffers.resize( s.info.columns.size() );
+         s.previous.resize( s.info.columns.size() );
+         return _sets.size() - 1;
+      }
+
+      /**
+       * Adds a row, one value per column: an integer's bits for delta, a name's value
+       * for name, 0 or 1 for flag.
+       */
+      void add( size_t handle, const uint64_t* values ) {
+         auto& s = _sets[handle];
+         for( size_t c = 0; c < s.info.columns.size(); ++c ) {
+            auto& out = s.buffers[c];
+            switch( s.info.columns[c].encoding ) {
+            case column_encoding::delta:
+               columnar_detail::put_varint( out, columnar_detail::zigzag( int64_t( values[c] - s.previous[c] ) ) );
+               s.previous[c] = values[c];
+               break;
+            case column_encoding::name:
+               columnar_detail::put_varint( out, name_index( values[c] ) );
+               break;
+            case column_encoding::flag:
+               out += char( values[c] != 0 );
+               break;
+            }
+         }
+         ++s.info.rows;
+         if( ++s.group_rows == _group_rows )
+            flush_group( s );
+      }
+
+      void close() {
+         for( auto& s : _sets )
+            flush_group( s );
+         flush_names();
+
+         using namespace columnar_detail;
+         std::string dir;
+         put_varint( dir, _name_count );
+         put_varint( dir, _name_chunks.size() );
+         for( const auto& c : _name_chunks )
+            put_chunk( dir, c );
+         put_varint( dir, _sets.size() );
+         for( const auto& s : _sets ) {
+            put_string( dir, s.info.name );
+            put_varint( dir, s.info.rows );
+            put_varint( dir, s.info.columns.size() );
+            for( const auto& c : s.info.columns ) {
+               put_string( dir, c.name );
+               put_varint( dir, uint8_t( c.encoding ) );
+            }
+            put_varint( dir, s.info.groups.size() );
+            for( const auto& g : s.info.groups ) {
+               put_varint( dir, g.rows );
+               for( const auto& c : g.chunks )
+                  put_chunk( dir, c );
+            }
+         }
+         uint64_t size = dir.size();
+         put_fixed( dir, size, 8 );
+         dir.append( columnar_magic, sizeof(columnar_magic) );
+         write( dir );
+
+         bool ok = std::fflush( _file ) == 0;
+         ok = std::fclose( _file ) == 0 && ok;
+         _file = nullptr;
+         if( !ok || _failed )
+            throw std::runtime_error( "cannot write " + _path );
+      }
+
+      std::vector<dataset_info> datasets()const {
+         std::vector<dataset_info> out;
+         for( const auto& s : _sets )
+            out.push_back( s.info );
+         return out;
+      }
+
+      uint64_t names()const { return _name_count; }
+      uint64_t size()const { return _offset; }
+
+   private:
+      struct open_set {
+         dataset_info info;
+         std::vector<std::string> buffers;
+         std::vector<uint64_t> previous;
+         uint64_t group_rows = 0;
+      };
+
+      uint64_t name_index( uint64_t value ) {
+         auto found = _name_index.find( value );
+         if( found != _name_index.end() )
+            return found->second;
+         _name_index.emplace( value, _name_count );
+         columnar_detail::put_fixed( _names, value, 8 );
+         if( _names.size() >= _group_rows * 8 )
+            flush_names();
+         return _name_count++;
+      }
+
+      void flush_names() {
+         if( _names.empty() )
+            return;
+         _name_chunks.push_back( write_chunk( _names ) );
+         _names.clear();
+      }
+
+      void flush_group( open_set& s ) {
+         if( s.group_rows == 0 )
+            return;
+         row_group g;
+         g.rows = s.group_rows;
+         for( size_t c = 0; c < s.buffers.size(); ++c ) {
+            g.chunks.push_back( write_chunk( s.buffers[c] ) );
+            s.buffers[c].clear();
+            s.previous[c] = 0;
+         }
+         s.info.groups.push_back( std::move(g) );
+         s.group_rows = 0;
+      }
+
+      column_chunk write_chunk( const std::string& raw ) {
+         column_chunk c;
+         c.offset = _offset;
+         c.raw_size = raw.size();
+#ifdef BENCH_ZLIB
+         if( _level > 0 ) {
+            uLongf size = compressBound( raw.size() );
+            _deflated.resize( size );
+            if( compress2( reinterpret_cast<Bytef*>( &_deflated[0] ), &size,
+                           reinterpret_cast<const Bytef*>( raw.data() ), raw.size(), _level ) != Z_OK )
+               throw std::runtime_error( "cannot compress a chunk of " + _path );
+            if( size < raw.size() ) {
+               _deflated.resize( size );
+               c.codec = chunk_codec::zlib;
+               c.stored_size = size;
+               write( _deflated );
+               return c;
+            }
+         }
+#endif
+         c.stored_size = raw.size();
+         write( raw );
+         return c;
+      }
+
+      static void put_chunk( std::string& out, const column_chunk& c ) {
+         columnar_detail::put_varint( out, c.offset );
+         columnar_detail::put_varint( out, c.stored_size );
+         columnar_detail::put_varint( out, c.raw_size );
+         columnar_detail::put_varint( out, uint8_t( c.codec ) );
+      }
+
+      void write( const std::string& bytes ) {
+         if( std::fwrite( bytes.data(), 1, bytes.size(), _file ) != bytes.size() )
+            _failed = true;
+         _offset += bytes.size();
+      }
+
+      std::string _path;
+      std::FILE* _file;
+      int _level;
+      uint64_t _group_rows;
+      uint64_t _offset = 0;
+      bool _failed = false;
+
+      std::vector<open_set> _sets;
+      std::unordered_map<uint64_t, uint64_t> _name_index;
+      std::string _names;
+      uint64_t _name_count = 0;
+      std::vector<column_chunk> _name_chunks;
+      std::string _deflated;
+   };
+
+   /**
+    * Reads a columnar file through a read-only mapping.  Only the chunks of the
+    * columns read are touched, and the dictionary only when a name column is read.
+    * Throws on a file that is truncated or not a columnar file.
+    */
+   class columnar_reader {
+   public:
+      explicit columnar_reader( const std::string& path ) : _path(path) {
+         int fd = ::open( path.c_str(), O_RDONLY );
+         if( fd < 0 )
+            throw std::runtime_error( "cannot open " + path );
+         struct stat st;
+         if( ::fstat( fd, &st ) != 0 ) {
+            ::close( fd );
+            throw std::runtime_error( "cannot stat " + path );
+         }
+         _size = st.st_size;
+         if( _size ) {
+            void* p = ::mmap( nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            ::close( fd );
+            if( p == MAP_FAILED )
+               throw std::runtime_error( "cannot map " + path );
+            _data = static_cast<const char*>(p);
+         }
+         else {
+            ::close( fd );
+         }
+
+         try {
+            read_directory();
+         } catch( ... ) {
+            unmap();
+            throw;
+         }
+      }
+
+      ~columnar_reader() { unmap(); }
+
+      columnar_reader( const columnar_reader& ) = delete;
+      columnar_reader& operator=( const columnar_reader& ) = delete;
+
+      const std::vector<dataset_info>& datasets()const { return _sets; }
+
+      const dataset_info* find( const std::string& dataset )const {
+         for( const auto& s : _sets ) {
+            if( s.name == dataset )
+               return &s;
+         }
+         return nullptr;
+      }
+
+      /**
+       * Decodes a column over all row groups: integers as their bits, names as their
+       * values, flags as 0 or 1.  Throws if there is no such column.
+       */
+      std::vector<uint64_t> read( const std::string& dataset, const std::string& column ) {
+         const auto* s = find( dataset );
+         int c = s ? s->column( column ) : -1;
+         if( c < 0 )
+            throw std::runtime_error( _path + " has no column " + dataset + "." + column );
+
+         auto encoding = s->columns[c].encoding;
+         if( encoding == column_encoding::name )
+            load_names();
+
+         std::vector<uint64_t> values;
+         values.reserve( s->rows );
+         for( const auto& g : s->groups ) {
+            const std::string& raw = inflate( g.chunks[c] );
+            columnar_detail::cursor in{ raw.data(), raw.data() + raw.size() };
+            uint64_t previous = 0;
+            for( uint64_t r = 0; r < g.rows; ++r ) {
+               switch( encoding ) {
+               case column_encoding::delta:
+                  previous += uint64_t( columnar_detail::unzigzag( in.varint() ) );
+                  values.push_back( previous );
+                  break;
+               case column_encoding::name: {
+                  uint64_t index = in.varint();
+                  if( index >= _names.size() )
+                     throw std::runtime_error( _path + " has a name outside its dictionary" );
+                  values.push_back( _names[index] );
+                  break;
+               }
+               case column_encoding::flag:
+                  if( in.pos == in.end )
+                     throw std::runtime_error( "columnar file is truncated" );
+                  values.push_back( uint8_t( *in.pos++ ) );
+                  break;
+               }
+            }
+         }
+         return values;
+      }
+
+      uint64_t size()const { return _size; }
+
+      /// stored bytes of the chunks read so far
+      uint64_t bytes_read()const { return _bytes_read; }
+
+   private:
+      void read_directory() {
+         using columnar_detail::cursor;
+         constexpr size_t trailer = 8 + sizeof(columnar_magic);
+         if( _size < 12 + trailer || std::memcmp( _data, columnar_magic, sizeof(columnar_magic) ) != 0
+             || std::memcmp( _data + _size - sizeof(columnar_magic), columnar_magic, sizeof(columnar_magic) ) != 0 )
+            throw std::runtime_error( _path + " is not a columnar file" );
+         uint32_t version = 0;
+         for( int i = 0; i < 4; ++i )
+            version |= uint32_t( uint8_t( _data[8 + i] ) ) << ( 8 * i );
+         if( version != columnar_version )
+            throw std::runtime_error( _path + " has columnar version " + std::to_string( version ) );
+
+         uint64_t dir_size = 0;
+         for( int i = 0; i < 8; ++i )
+            dir_size |= uint64_t( uint8_t( _data[_size - trailer + i] ) ) << ( 8 * i );
+         if( dir_size > _size - 12 - trailer )
+            throw std::runtime_error( _path + " is truncated" );
+         cursor in{ _data + _size - trailer - dir_size, _data + _size - trailer };
+
+         _name_count = in.varint();
+         _name_chunks.resize( in.varint() );
+         for( auto& c : _name_chunks )
+            c = chunk( in );
+         _sets.resize( in.varint() );
+         for( auto& s : _sets ) {
+            s.name = in.string();
+            s.rows = in.varint();
+            s.columns.resize( in.varint() );
+            for( auto& c : s.columns ) {
+               c.name = in.string();
+               c.encoding = column_encoding( in.varint() );
+               if( c.encoding > column_encoding::flag )
+                  throw std::runtime_error( _path + " has an unknown column encoding" );
+            }
+            s.groups.resize( in.varint() );
+            for( auto& g : s.groups ) {
+               g.rows = in.varint();
+               g.chunks.resize( s.columns.size() );
+               for( auto& c : g.chunks )
+                  c = chunk( in );
+            }
+         }
+      }
+
+      column_chunk chunk( columnar_detail::cursor& in )const {
+         column_chunk c;
+         c.offset = in.varint();
+         c.stored_size = in.varint();
+         c.raw_size = in.varint();
+         c.codec = chunk_codec( in.varint() );
+         if( c.offset > _size || c.stored_size > _size - c.offset )
+            throw std::runtime_error( _path + " has a chunk beyond its end" );
+         return c;
+      }
+
+      void load_names() {
+         if( _names.size() == _name_count )
+            return;
+         _names.clear();
+         _names.reserve( _name_count );
+         for( const auto& c : _name_chunks ) {
+            const std::string& raw = inflate( c );
+            for( size_t i = 0; i + 8 <= raw.size(); i += 8 ) {
+               uint64_t v = 0;
+               for( int k = 0; k < 8; ++k )
+                  v |= uint64_t( uint8_t( raw[i + k] ) ) << ( 8 * k );
+               _names.push_back( v );
+            }
+         }
+         if( _names.size() != _name_count )
+            throw std::runtime_error( _path + " has a truncated dictionary" );
+      }
+
+      const std::string& inflate( const column_chunk& c ) {
+         _bytes_read += c.stored_size;
+         const char* stored = _data + c.offset;
+         if( c.codec == chunk_codec::stored ) {
+            _raw.assign( stored, c.stored_size );
+            return _raw;
+         }
+#ifdef BENCH_ZLIB
+         if( c.codec == chunk_codec::zlib ) {
+            _raw.resize( c.raw_size );
+            uLongf size = c.raw_size;
+            if( uncompress( reinterpret_cast<Bytef*>( &_raw[0] ), &size,
+                            reinterpret_cast<const Bytef*>( stored ), c.stored_size ) != Z_OK || size != c.raw_size )
+               throw std::runtime_error( _path + " has a corrupt chunk" );
+            return _raw;
+         }
+#endif
+         throw std::runtime_error( _path + " has a chunk this build cannot inflate" );
+      }
+
+      void unmap() {
+         if( _data )
+            ::munmap( const_cast<char*>( _data ), _size );
+         _data = nullptr;
+      }
+
+      std::string _path;
+      const char* _data = nullptr;
+      uint64_t _size = 0;
+      uint64_t _bytes_read = 0;
+
+      std::vector<dataset_info> _sets;
+      uint64_t _name_count = 0;
+      std::vector<column_chunk> _name_chunks;
+      std::vector<uint64_t> _names;
+      std::string _raw;
+   };
+
+} /// namespace bench
@@ -0,0 +1,247 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Exports the token state in a table dump (see table_dump.hpp) to a columnar file
+ *  (see columnar.hpp), for analytics that read a few columns of many rows.
+ *
+ *  Each contract table becomes a dataset, one column per field, with the table's
+ *  code and scope as columns where they are not implied:
+ *
+ *     accounts    contract, holder, symbol, balance, payer             slvrtoken, drtoken
+ *     stats       contract, symbol, supply, max_supply, issuer,
+ *                 slvr_per_token_mg, contract_locked, transfer_locked  slvrtoken, drtoken
+ *     issues      contract, round, symbol, supply, total_supply, issuer,
+ *                 slvr_per_token_mg, transfer_locked, redeem_locked, open
+ *     customers   contract, key, holder, round, balance
+ *     holders     contract, owner, rights_balance, token_balance, roles, legacy
+ *     storages    contract, owner, total_assets, coupled_assets, legacy
+ *
+ *  holders and storages take the ampr rows of both layouts: rows still in the 128 bit
+ *  holderdata and storagedata tables are converted as the migrate action would, and
+ *  flagged legacy.  Amounts are raw units in the row's symbol; symbols are their raw
+ *  values.  The JSON lines printed give the raw and stored bytes of every column.
+ */
+#include "../ampr_contract/ampr.hpp"
+#include "../custom_token/drtoken/drtoken.hpp"
+#include "../custom_token/slvrtoken/slvrtoken.hpp"
+#include "bench_util.hpp"
+#include "columnar.hpp"
+#include "table_dump.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+using namespace bench;
+
+namespace {
+
+   typedef ampersand::slvrtoken slvrtoken;
+   typedef ampersand::drtoken drtoken;
+
+   constexpr auto delta = column_encoding::delta;
+   constexpr auto named = column_encoding::name;
+   constexpr auto flag = column_encoding::flag;
+
+   struct options {
+      std::string dump;
+      std::string out;
+      name slvr = name("ampervstoken");
+      name dr = name("amperdrtoken");
+      name ampr;                ///< the ampr contract; any code's ampr tables if unset
+      int level = 6;
+      uint64_t row_group = 1 << 16;
+      bool check = false;
+   };
+
+   struct exporter {
+      const options& opt;
+      columnar_writer& out;
+      size_t accounts, stats, issues, customers, holders, storages;
+      uint64_t rows = 0, exported = 0;
+
+      exporter( const options& o, columnar_writer& w ) : opt(o), out(w) {
+         accounts = out.dataset( "accounts", { { "contract", named }, { "holder", named }, { "symbol", delta },
+                                               { "balance", delta }, { "payer", named } } );
+         stats = out.dataset( "stats", { { "contract", named }, { "symbol", delta }, { "supply", delta },
+                                         { "max_supply", delta }, { "issuer", named }, { "slvr_per_token_mg", delta },
+                                         { "contract_locked", flag }, { "transfer_locked", flag } } );
+         issues = out.dataset( "issues", { { "contract", named }, { "round", delta }, { "symbol", delta },
+                                           { "supply", delta }, { "total_supply", delta }, { "issuer", named },
+                                           { "slvr_per_token_mg", delta }, { "transfer_locked", flag },
+                                           { "redeem_locked", flag }, { "open", flag } } );
+         customers = out.dataset( "customers", { { "contract", named }, { "key", delta }, { "holder", named },
+                                                 { "round", delta }, { "balance", delta } } );
+         holders = out.dataset( "holders", { { "contract", named }, { "owner", named }, { "rights_balance", delta },
+                                             { "token_balance", delta }, { "roles", delta }, { "legacy", flag } } );
+         storages = out.dataset( "storages", { { "contract", named }, { "owner", named }, { "total_assets", delta },
+                                               { "coupled_assets", delta }, { "legacy", flag } } );
+      }
+
+      void run( table_dump_reader& dump ) {
+         dump_table t;
+         dump_row r;
+         while( dump.next_table(t) ) {
+            bool slvr = t.code == opt.slvr, dr = t.code == opt.dr;
+            bool ampr_tables = opt.ampr == name() || t.code == opt.ampr;
+            uint64_t code = t.code.value;
+            while( dump.next_row(r) ) {
+               ++rows;
+               if( t.table == name("accounts") && ( slvr || dr ) ) {
+                  auto b = slvr ? r.as<slvrtoken::account>().balance : r.as<drtoken::account>().balance;
+                  add( accounts, { code, t.scope.value, b.symbol.raw(), uint64_t( b.amount ), r.payer.value } );
+               }
+               else if( t.table == name("supplies") && slvr ) {
+                  auto st = r.as<slvrtoken::currency_stats>();
+                  add( stats, { code, st.supply.symbol.raw(), uint64_t( st.supply.amount ),
+                                uint64_t( st.total_supply.amount ), st.issuer.value, st.slvr_per_token_mg,
+                                st.contract_locked, 0 } );
+               }
+               else if( t.table == name("supplies") && dr ) {
+                  auto st = r.as<drtoken::currency_stats>();
+                  add( stats, { code, st.supply.symbol.raw(), uint64_t( st.supply.amount ),
+                                uint64_t( st.total_supply.amount ), st.issuer.value, 0, 0, st.transfer_locked } );
+               }
+               else if( t.table == name("rounds") && slvr ) {
+                  auto is = r.as<slvrtoken::issuestats>();
+                  add( issues, { code, is.round, is.supply.symbol.raw(), uint64_t( is.supply.amount ),
+                                 uint64_t( is.total_supply.amount ), is.issuer.value, is.slvr_per_token_mg,
+                                 is.transfer_locked, is.redeem_locked, is.open_status } );
+               }
+               else if( t.table == name("lots") && slvr ) {
+                  auto c = r.as<slvrtoken::custinfo>();
+                  add( customers, { code, c.key, c.account_name.value, c.issue_round, uint64_t( c.issue_balance ) } );
+               }
+               else if( t.table == name("holders") && ampr_tables ) {
+                  auto h = r.as<ampr::holderdata>();
+                  add( holders, { code, h.owner, h.rights_balance, h.token_balance, h.roles, 0 } );
+               }
+               else if( t.table == name("holderdata") && ampr_tables ) {
+                  auto h = r.as<ampr::holderdata_v1>();
+                  add( holders, { code, h.owner, ampr::checked_narrow( h.rights_balance ),
+                                  ampr::checked_narrow( h.token_balance ), ampr::legacy_roles( h.rolenum ), 1 } );
+               }
+               else if( t.table == name("storages") && ampr_tables ) {
+                  auto s = r.as<ampr::storagedata>();
+                  add( storages, { code, s.owner, s.total_assets, s.coupled_assets, 0 } );
+               }
+               else if( t.table == name("storagedata") && ampr_tables ) {
+                  auto s = r.as<ampr::storagedata_v1>();
+                  add( storages, { code, s.owner, ampr::checked_narrow( s.total_assets ),
+                                   ampr::checked_narrow( s.coupled_assets ), 1 } );
+               }
+            }
+         }
+      }
+
+      void add( size_t dataset, std::initializer_list<uint64_t> values ) {
+         out.add( dataset, values.begin() );
+         ++exported;
+      }
+   };
+
+   /// reads every column back, checking its size; returns the nanoseconds taken
+   uint64_t check( const std::string& path ) {
+      columnar_reader in( path );
+      uint64_t start = now_ns();
+      for( const auto& s : in.datasets() ) {
+         uint64_t column_start = now_ns();
+         for( const auto& c : s.columns ) {
+            auto values = in.read( s.name, c.name );
+            if( values.size() != s.rows )
+               throw std::runtime_error( path + ": " + s.name + "." + c.name + " has " +
+                                         std::to_string( values.size() ) + " rows, not " + std::to_string( s.rows ) );
+         }
+         std::printf( "{\"kind\":\"check\",\"dataset\":\"%s\",\"rows\":%llu,\"columns\":%zu,\"read_us\":%llu}\n",
+                      s.name.c_str(), (unsigned long long)s.rows, s.columns.size(),
+                      (unsigned long long)( ( now_ns() - column_start ) / 1000 ) );
+      }
+      return now_ns() - start;
+   }
+
+   void usage( const char* argv0 ) {
+      std::fprintf( stderr,
+         "usage: %s [options] DUMP OUT\n"
+         "  --slvr=ACCOUNT     slvrtoken account, default ampervstoken\n"
+         "  --dr=ACCOUNT       drtoken account, default amperdrtoken\n"
+         "  --ampr=ACCOUNT     ampr account, default any account with ampr tables\n"
+         "  --level=N          zlib level, 0 to store the columns uncompressed, default 6\n"
+         "  --row-group=N      rows per row group, default 65536\n"
+         "  --check            read every column of OUT back and time it\n",
+         argv0 );
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opt;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( auto v = option( arg, "--slvr=" ) )            opt.slvr = name(v);
+      else if( auto v = option( arg, "--dr=" ) )         opt.dr = name(v);
+      else if( auto v = option( arg, "--ampr=" ) )       opt.ampr = name(v);
+      else if( auto v = option( arg, "--level=" ) )      opt.level = std::atoi(v);
+      else if( auto v = option( arg, "--row-group=" ) )  opt.row_group = std::strtoull( v, nullptr, 10 );
+      else if( arg == "--check" )                        opt.check = true;
+      else if( arg.compare( 0, 2, "--" ) != 0 && opt.dump.empty() ) opt.dump = arg;
+      else if( arg.compare( 0, 2, "--" ) != 0 && opt.out.empty() )  opt.out = arg;
+      else {
+         usage( argv[0] );
+         return arg == "--help" ? 0 : 2;
+      }
+   }
+   if( opt.dump.empty() || opt.out.empty() || opt.row_group == 0 || opt.level < 0 || opt.level > 9 ) {
+      usage( argv[0] );
+      return 2;
+   }
+
+   try {
+      uint64_t start = now_ns();
+      table_dump_reader dump( opt.dump );
+      columnar_writer out( opt.out, opt.level, opt.row_group );
+      exporter ex( opt, out );
+      ex.run( dump );
+      out.close();
+      uint64_t ns = now_ns() - start;
+
+      uint64_t raw_total = 0, stored_total = 0;
+      for( const auto& s : out.datasets() ) {
+         for( size_t c = 0; c < s.columns.size(); ++c ) {
+            uint64_t raw = 0, stored = 0;
+            for( const auto& g : s.groups ) {
+               raw += g.chunks[c].raw_size;
+               stored += g.chunks[c].stored_size;
+            }
+            raw_total += raw;
+            stored_total += stored;
+            std::printf( "{\"kind\":\"column\",\"dataset\":\"%s\",\"column\":\"%s\",\"rows\":%llu,"
+                         "\"raw_bytes\":%llu,\"stored_bytes\":%llu}\n",
+                         s.name.c_str(), s.columns[c].name.c_str(), (unsigned long long)s.rows,
+                         (unsigned long long)raw, (unsigned long long)stored );
+         }
+      }
+
+      uint64_t check_ns = opt.check ? check( opt.out ) : 0;
+      std::printf( "{\"kind\":\"summary\",\"dump\":\"%s\",\"dump_bytes\":%llu,\"out\":\"%s\",\"out_bytes\":%llu,"
+                   "\"rows\":%llu,\"exported_rows\":%llu,\"names\":%llu,\"column_raw_bytes\":%llu,"
+                   "\"column_stored_bytes\":%llu,\"zlib\":%s,\"elapsed_us\":%llu,\"check_us\":%llu,"
+                   "\"peak_rss_kb\":%llu}\n",
+                   opt.dump.c_str(), (unsigned long long)dump.size(), opt.out.c_str(), (unsigned long long)out.size(),
+                   (unsigned long long)ex.rows, (unsigned long long)ex.exported, (unsigned long long)out.names(),
+                   (unsigned long long)raw_total, (unsigned long long)stored_total,
+#ifdef BENCH_ZLIB
+                   opt.level > 0 ? "true" : "false",
+#else
+                   "false",
+#endif
+                   (unsigned long long)( ns / 1000 ), (unsigned long long)( check_ns / 1000 ),
+                   (unsigned long long)peak_rss_kb() );
+   } catch( const std::exception& e ) {
+      std::fflush( stdout );
+      std::fprintf( stderr, "%s\n", e.what() );
+      return 1;
+   }
+   return 0;
+}
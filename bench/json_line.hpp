@@ -0,0 +1,120 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Builds JSON lines, as printed by the report tools and sent by ledger_indexer.
+ */
+#pragma once
+
+#include <eosiolib/symbol.hpp>
+
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+
+namespace bench {
+
+   /**
+    * Builds JSON lines in a buffer.  Given a file, the buffer is written to it in large
+    * blocks as lines end; otherwise the caller takes the text from str().
+    */
+   class json_line {
+   public:
+      explicit json_line( std::FILE* out = stdout ) : _out(out) {}
+
+      json_line& field( const char* key ) {
+         _s += _s.size() > _start + 1 ? ",\"" : "\"";
+         _s += key;
+         _s += "\":";
+         return *this;
+      }
+
+      json_line& str( const char* key, const std::string& v ) {
+         field( key );
+         _s += '"';
+         for( char ch : v ) {
+            if( ch == '"' || ch == '\\' ) {
+               _s += '\\';
+               _s += ch;
+            }
+            else if( uint8_t(ch) < 0x20 ) {
+               char esc[8];
+               std::snprintf( esc, sizeof(esc), "\\u%04x", ch );
+               _s += esc;
+            }
+            else {
+               _s += ch;
+            }
+         }
+         _s += '"';
+         return *this;
+      }
+
+      json_line& num( const char* key, uint64_t v ) {
+         field( key );
+         append( v );
+         return *this;
+      }
+
+      json_line& flag( const char* key, bool v ) {
+         field( key );
+         _s += v ? "true" : "false";
+         return *this;
+      }
+
+      /// an asset as "amount SYMBOL", e.g. "12.5000 SLVR"
+      json_line& amount( const char* key, int64_t amount, eosio::symbol sym ) {
+         uint64_t p10 = 1;
+         for( uint8_t i = 0; i < sym.precision(); ++i )
+            p10 *= 10;
+         uint64_t a = amount < 0 ? -uint64_t(amount) : uint64_t(amount);
+         field( key );
+         _s += amount < 0 ? "\"-" : "\"";
+         append( a / p10 );
+         if( sym.precision() ) {
+            char digits[24];
+            auto end = std::to_chars( digits, digits + sizeof(digits), a % p10 ).ptr;
+            _s += '.';
+            _s.append( sym.precision() - ( end - digits ), '0' );
+            _s.append( digits, end );
+         }
+         _s += ' ';
+         _s += sym.code().to_string();
+         _s += '"';
+         return *this;
+      }
+
+      void begin( const char* kind ) {
+         _start = _s.size();
+         _s += '{';
+         str( "kind", kind );
+      }
+
+      void end() {
+         _s += "}\n";
+         if( _out && _s.size() >= ( 1 << 16 ) )
+            flush();
+      }
+
+      void flush() {
+         if( _out )
+            std::fwrite( _s.data(), 1, _s.size(), _out );
+         _s.clear();
+      }
+
+      const std::string& str()const { return _s; }
+      void clear() { _s.clear(); }
+
+   private:
+      void append( uint64_t v ) {
+         char digits[24];
+         _s.append( digits, std::to_chars( digits, digits + sizeof(digits), v ).ptr );
+      }
+
+      std::FILE* _out;
+      std::string _s;
+      size_t _start = 0;
+   };
+
+} /// namespace bench
@@ -0,0 +1,713 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Indexes the slvrtoken and drtoken state of an action trace as the trace grows, and
+ *  answers balance, lock and lot queries over a Unix socket.
+ *
+ *  The trace (see trace.hpp) stands in for a node's history feed: records appended to
+ *  it are picked up as they are written.  Each action runs through the contracts on
+ *  the in-memory chain, so the state follows their own rules, and every row it
+ *  changes goes to a row journal (see row_journal.hpp) and, once the batch commits,
+ *  to the indices.  On restart the journal is replayed into the chain and the
+ *  indices, and the trace is read on from where the journal stopped; a journal must
+ *  be kept with the trace it was built from.
+ *
+ *  Queries are lines of text on the socket:
+ *
+ *     holder NAME    the holder's balances, with the amounts its locked lots hold
+ *     lots NAME      the holder's lots, with their round's locks
+ *     round N        an issue round; rounds for all of them
+ *     stats          the token stats
+ *     status         what has been indexed
+ *
+ *  Each answer is JSON lines, as table_report prints them, followed by an empty line.
+ *  Queries read the indices under a shared lock, which a batch of actions takes only
+ *  to apply its row changes; the contracts run outside it.
+ */
+#include <native/chain.hpp>
+
+#include "../custom_token/drtoken/drtoken.hpp"
+#include "../custom_token/slvrtoken/slvrtoken.hpp"
+#include "bench_util.hpp"
+#include "json_line.hpp"
+#include "row_journal.hpp"
+#include "trace.hpp"
+
+#include <poll.h>
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace bench;
+
+namespace {
+
+   typedef ampersand::slvrtoken slvrtoken;
+   typedef ampersand::drtoken drtoken;
+   using eosio::asset;
+   using eosio::symbol;
+
+   struct options {
+      std::string trace;
+      std::string journal;
+      std::string socket = "ledger_indexer.sock";
+      name slvr = name("ampervstoken");
+      name dr = name("amperdrtoken");
+      uint64_t batch = 1024;
+      uint64_t poll_ms = 10;
+      bool sync = false;
+   };
+
+   std::atomic<bool> stopping{false};
+
+   void stop( int ) { stopping = true; }
+
+   /**
+    * The token state by holder, kept from the rows the contracts write.  Balances are
+    * the accounts rows, lots the customers rows; the locks come from the issue rounds
+    * and the drtoken stats.
+    */
+   class ledger_index {
+   public:
+      ledger_index( name slvr, name dr ) : _slvr(slvr), _dr(dr) {}
+
+      /// applies a row as it now stands, or its removal if r is null; rows of other tables are ignored
+      void apply( const native::table_id& id, uint64_t primary, const native::row* r ) {
+         bool slvr = id.code == _slvr.value, dr = id.code == _dr.value;
+         if( !slvr && !dr )
+            return;
+         if( id.table == name("accounts").value ) {
+            auto& balances = _balances[id.scope];
+            auto it = balances.begin();
+            while( it != balances.end() && !( it->contract.value == id.code && it->sym.raw() == primary ) )
+               ++it;
+            if( !r ) {
+               if( it != balances.end() )
+                  balances.erase( it );
+               if( balances.empty() )
+                  _balances.erase( id.scope );
+               return;
+            }
+            auto b = slvr ? decode<slvrtoken::account>( r ).balance : decode<drtoken::account>( r ).balance;
+            if( it == balances.end() )
+               balances.push_back( { name(id.code), b.symbol, b.amount } );
+            else
+               it->amount = b.amount;
+         }
+         else if( id.table == name("lots").value && slvr ) {
+            auto found = _lots.find( primary );
+            if( found != _lots.end() && ( !r || found->second.account_name != decode<slvrtoken::custinfo>( r ).account_name ) ) {
+               unlink_lot( found->second.account_name.value, primary );
+               _lots.erase( found );
+               found = _lots.end();
+            }
+            if( !r )
+               return;
+            auto c = decode<slvrtoken::custinfo>( r );
+            if( found == _lots.end() )
+               _holder_lots[c.account_name.value].push_back( primary );
+            _lots[primary] = c;
+         }
+         else if( id.table == name("rounds").value && slvr ) {
+            if( r )
+               _rounds[primary] = decode<slvrtoken::issuestats>( r );
+            else
+               _rounds.erase( primary );
+         }
+         else if( id.table == name("supplies").value ) {
+            auto key = std::make_pair( id.code, primary );
+            if( !r ) {
+               _tokens.erase( key );
+               return;
+            }
+            token t{ name(id.code) };
+            if( slvr ) {
+               auto st = decode<slvrtoken::currency_stats>( r );
+               t.supply = st.supply;
+               t.total_supply = st.total_supply;
+               t.issuer = st.issuer;
+               t.slvr_per_token_mg = st.slvr_per_token_mg;
+               t.contract_locked = st.contract_locked;
+            }
+            else {
+               auto st = decode<drtoken::currency_stats>( r );
+               t.supply = st.supply;
+               t.total_supply = st.total_supply;
+               t.issuer = st.issuer;
+               t.transfer_locked = st.transfer_locked;
+            }
+            _tokens[key] = t;
+         }
+      }
+
+      /**
+       * The holder's balances.  A slvrtoken balance carries what its lots in locked
+       * rounds hold, as the contract counts it on transfer and redeem; a drtoken
+       * balance is all locked while its token is.
+       */
+      void holder( json_line& out, name h )const {
+         auto found = _balances.find( h.value );
+         if( found == _balances.end() )
+            return;
+         for( const auto& b : found->second ) {
+            out.begin( "balance" );
+            out.str( "contract", b.contract.to_string() ).str( "holder", h.to_string() )
+               .amount( "balance", b.amount, b.sym );
+            if( b.contract == _slvr ) {
+               int64_t transfer_locked = 0, redeem_locked = 0;
+               for( uint64_t key : lot_keys( h ) ) {
+                  const auto& c = _lots.at( key );
+                  auto round = _rounds.find( c.issue_round );
+                  if( round == _rounds.end() || round->second.supply.symbol != b.sym )
+                     continue;
+                  if( round->second.transfer_locked )
+                     transfer_locked += c.issue_balance;
+                  if( round->second.redeem_locked )
+                     redeem_locked += c.issue_balance;
+               }
+               out.amount( "transfer_locked", transfer_locked, b.sym ).amount( "redeem_locked", redeem_locked, b.sym )
+                  .amount( "transferable", b.amount - transfer_locked, b.sym );
+            }
+            else {
+               auto t = _tokens.find( std::make_pair( b.contract.value, b.sym.raw() ) );
+               bool locked = t != _tokens.end() && t->second.transfer_locked;
+               out.amount( "transfer_locked", locked ? b.amount : 0, b.sym )
+                  .amount( "transferable", locked ? 0 : b.amount, b.sym );
+            }
+            out.end();
+         }
+      }
+
+      /// the holder's lots, in key order
+      void lots( json_line& out, name h )const {
+         std::vector<uint64_t> keys = lot_keys( h );
+         std::sort( keys.begin(), keys.end() );
+         for( uint64_t key : keys ) {
+            const auto& c = _lots.at( key );
+            auto round = _rounds.find( c.issue_round );
+            out.begin( "lot" );
+            out.str( "holder", h.to_string() ).num( "key", key ).num( "round", c.issue_round );
+            if( round != _rounds.end() ) {
+               out.amount( "balance", c.issue_balance, round->second.supply.symbol )
+                  .flag( "transfer_locked", round->second.transfer_locked )
+                  .flag( "redeem_locked", round->second.redeem_locked );
+            }
+            else {
+               out.num( "units", uint64_t( c.issue_balance ) ).flag( "orphan", true );
+            }
+            out.end();
+         }
+      }
+
+      /// one issue round, or all of them
+      void rounds( json_line& out, const uint64_t* only )const {
+         for( const auto& [n, is] : _rounds ) {
+            if( only && n != *only )
+               continue;
+            out.begin( "round" );
+            out.str( "contract", _slvr.to_string() ).num( "round", is.round )
+               .amount( "supply", is.supply.amount, is.supply.symbol )
+               .amount( "total_supply", is.total_supply.amount, is.total_supply.symbol )
+               .str( "issuer", is.issuer.to_string() ).num( "slvr_per_token_mg", is.slvr_per_token_mg )
+               .flag( "transfer_locked", is.transfer_locked ).flag( "redeem_locked", is.redeem_locked )
+               .flag( "open", is.open_status ).end();
+         }
+      }
+
+      void stats( json_line& out )const {
+         for( const auto& [key, t] : _tokens ) {
+            out.begin( "stats" );
+            out.str( "contract", t.contract.to_string() )
+               .amount( "supply", t.supply.amount, t.supply.symbol )
+               .amount( "total_supply", t.total_supply.amount, t.total_supply.symbol )
+               .str( "issuer", t.issuer.to_string() );
+            if( t.contract == _slvr )
+               out.num( "slvr_per_token_mg", t.slvr_per_token_mg ).flag( "contract_locked", t.contract_locked );
+            else
+               out.flag( "transfer_locked", t.transfer_locked );
+            out.end();
+         }
+      }
+
+      uint64_t holders()const { return _balances.size(); }
+      uint64_t lot_count()const { return _lots.size(); }
+      uint64_t round_count()const { return _rounds.size(); }
+
+   private:
+      struct balance {
+         name contract;
+         symbol sym;
+         int64_t amount;
+      };
+
+      struct token {
+         name contract;
+         asset supply{};
+         asset total_supply{};
+         name issuer{};
+         uint16_t slvr_per_token_mg = 0;
+         bool contract_locked = false;
+         bool transfer_locked = false;
+      };
+
+      template<typename T>
+      static T decode( const native::row* r ) {
+         T value;
+         eosio::datastream<const char*> ds( r->data.data(), r->data.size() );
+         ds >> value;
+         return value;
+      }
+
+      const std::vector<uint64_t>& lot_keys( name h )const {
+         static const std::vector<uint64_t> none;
+         auto found = _holder_lots.find( h.value );
+         return found == _holder_lots.end() ? none : found->second;
+      }
+
+      void unlink_lot( uint64_t holder, uint64_t key ) {
+         auto& keys = _holder_lots[holder];
+         auto it = std::find( keys.begin(), keys.end(), key );
+         if( it != keys.end() ) {
+            *it = keys.back();
+            keys.pop_back();
+         }
+         if( keys.empty() )
+            _holder_lots.erase( holder );
+      }
+
+      name _slvr;
+      name _dr;
+      std::unordered_map<uint64_t, std::vector<balance>> _balances;           ///< by holder
+      std::unordered_map<uint64_t, slvrtoken::custinfo> _lots;                ///< by key
+      std::unordered_map<uint64_t, std::vector<uint64_t>> _holder_lots;       ///< lot keys by holder
+      std::map<uint64_t, slvrtoken::issuestats> _rounds;
+      std::map<std::pair<uint64_t, uint64_t>, token> _tokens;                 ///< by contract and symbol
+   };
+
+   /// what status reports; written under the index lock
+   struct progress {
+      uint64_t trace_offset = 0;
+      uint64_t actions = 0;
+      uint64_t failed = 0;
+      uint64_t batches = 0;
+      uint64_t journal_bytes = 0;
+      uint64_t recovered_actions = 0;
+   };
+
+   /// serves queries on a Unix socket from one thread, polling its clients
+   class query_server {
+   public:
+      query_server( const options& opt, const ledger_index& index, const progress& p, std::shared_mutex& mutex )
+         : _opt(opt), _index(index), _progress(p), _mutex(mutex) {
+         if( opt.socket.size() >= sizeof(sockaddr_un::sun_path) )
+            throw std::runtime_error( "socket path too long: " + opt.socket );
+         sockaddr_un addr{};
+         addr.sun_family = AF_UNIX;
+         std::strcpy( addr.sun_path, opt.socket.c_str() );
+
+         // a socket file left by a daemon that is gone is replaced, a live one is not
+         int probe = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+         bool live = probe >= 0 && ::connect( probe, (sockaddr*)&addr, sizeof(addr) ) == 0;
+         if( probe >= 0 )
+            ::close( probe );
+         if( live )
+            throw std::runtime_error( opt.socket + " is served by another indexer" );
+         ::unlink( opt.socket.c_str() );
+
+         _listen = ::socket( AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK, 0 );
+         if( _listen < 0 || ::bind( _listen, (sockaddr*)&addr, sizeof(addr) ) != 0 || ::listen( _listen, 64 ) != 0 ) {
+            if( _listen >= 0 )
+               ::close( _listen );
+            throw std::runtime_error( "cannot listen on " + opt.socket );
+         }
+      }
+
+      ~query_server() {
+         for( auto& c : _clients )
+            ::close( c.fd );
+         ::close( _listen );
+         ::unlink( _opt.socket.c_str() );
+      }
+
+      query_server( const query_server& ) = delete;
+      query_server& operator=( const query_server& ) = delete;
+
+      /// serves until stopping is set
+      void run() {
+         std::vector<pollfd> fds;
+         while( !stopping ) {
+            fds.clear();
+            fds.push_back( { _listen, POLLIN, 0 } );
+            for( const auto& c : _clients )
+               fds.push_back( { c.fd, short( c.out.empty() ? POLLIN : POLLIN | POLLOUT ), 0 } );
+            if( ::poll( fds.data(), fds.size(), 100 ) <= 0 )
+               continue;
+
+            for( size_t i = _clients.size(); i > 0; --i ) {
+               auto& c = _clients[i - 1];
+               short events = fds[i].revents;
+               bool open = !( events & ( POLLERR | POLLNVAL ) );
+               if( open && ( events & ( POLLIN | POLLHUP ) ) )
+                  open = receive( c );
+               if( open && !c.out.empty() )
+                  open = send( c );
+               if( !open ) {
+                  ::close( c.fd );
+                  _clients.erase( _clients.begin() + ( i - 1 ) );
+               }
+            }
+            if( fds[0].revents & POLLIN ) {
+               int fd;
+               while( ( fd = ::accept4( _listen, nullptr, nullptr, SOCK_NONBLOCK ) ) >= 0 )
+                  _clients.push_back( { fd } );
+            }
+         }
+      }
+
+      uint64_t queries()const { return _queries; }
+
+   private:
+      struct client {
+         int fd;
+         std::string in{};
+         std::string out{};
+      };
+
+      /// reads what the client sent and answers its complete lines; false once it is gone
+      bool receive( client& c ) {
+         char buf[4096];
+         ssize_t n;
+         while( ( n = ::recv( c.fd, buf, sizeof(buf), 0 ) ) > 0 )
+            c.in.append( buf, n );
+         bool open = n < 0 && ( errno == EAGAIN || errno == EWOULDBLOCK );
+
+         size_t start = 0, end;
+         while( ( end = c.in.find( '\n', start ) ) != std::string::npos ) {
+            answer( c.in.substr( start, end - start ), c.out );
+            start = end + 1;
+         }
+         c.in.erase( 0, start );
+         if( c.in.size() > max_request )
+            return false;
+         return open || !c.out.empty();
+      }
+
+      bool send( client& c ) {
+         while( !c.out.empty() ) {
+            ssize_t n = ::send( c.fd, c.out.data(), c.out.size(), MSG_NOSIGNAL );
+            if( n < 0 )
+               return errno == EAGAIN || errno == EWOULDBLOCK;
+            c.out.erase( 0, n );
+         }
+         return true;
+      }
+
+      void answer( std::string request, std::string& out ) {
+         if( !request.empty() && request.back() == '\r' )
+            request.pop_back();
+         size_t space = request.find( ' ' );
+         std::string verb = request.substr( 0, space );
+         std::string arg = space == std::string::npos ? std::string() : request.substr( space + 1 );
+
+         json_line line( nullptr );
+         {
+            std::shared_lock<std::shared_mutex> lock( _mutex );
+            if( verb == "holder" && !arg.empty() )      _index.holder( line, name(arg) );
+            else if( verb == "lots" && !arg.empty() )   _index.lots( line, name(arg) );
+            else if( verb == "rounds" )                 _index.rounds( line, nullptr );
+            else if( verb == "round" && !arg.empty() ) {
+               uint64_t n = std::strtoull( arg.c_str(), nullptr, 10 );
+               _index.rounds( line, &n );
+            }
+            else if( verb == "stats" )                  _index.stats( line );
+            else if( verb == "status" ) {
+               line.begin( "status" );
+               line.str( "trace", _opt.trace ).num( "trace_offset", _progress.trace_offset )
+                  .num( "actions", _progress.actions ).num( "failed", _progress.failed )
+                  .num( "recovered_actions", _progress.recovered_actions ).num( "batches", _progress.batches )
+                  .num( "journal_bytes", _progress.journal_bytes ).num( "holders", _index.holders() )
+                  .num( "lots", _index.lot_count() ).num( "rounds", _index.round_count() )
+                  .num( "queries", _queries ).end();
+            }
+            else {
+               line.begin( "error" );
+               line.str( "message", "unknown query: " + request ).end();
+            }
+         }
+         ++_queries;
+         out += line.str();
+         out += '\n';
+      }
+
+      static constexpr size_t max_request = 1 << 16;
+
+      const options& _opt;
+      const ledger_index& _index;
+      const progress& _progress;
+      std::shared_mutex& _mutex;
+      int _listen = -1;
+      std::vector<client> _clients;
+      uint64_t _queries = 0;
+   };
+
+   /// follows a trace file as it grows, decoding its complete records
+   class trace_tail {
+   public:
+      explicit trace_tail( const std::string& path ) : _path(path), _file( std::fopen( path.c_str(), "rb" ) ) {
+         if( !_file )
+            throw std::runtime_error( "cannot open " + path );
+      }
+
+      ~trace_tail() { std::fclose( _file ); }
+
+      trace_tail( const trace_tail& ) = delete;
+      trace_tail& operator=( const trace_tail& ) = delete;
+
+      /**
+       * Reads what has been appended; false if there was nothing new.  Throws if the
+       * trace is not one or has shrunk below what was read.
+       */
+      bool read() {
+         struct stat st;
+         if( ::fstat( ::fileno( _file ), &st ) != 0 )
+            throw std::runtime_error( "cannot stat " + _path );
+         if( uint64_t( st.st_size ) < _read )
+            throw std::runtime_error( _path + " was truncated below what was indexed" );
+         if( uint64_t( st.st_size ) == _read )
+            return false;
+
+         compact();
+         size_t have = _buf.size();
+         _buf.resize( have + ( st.st_size - _read ) );
+         std::clearerr( _file );
+         std::fseek( _file, _read, SEEK_SET );
+         size_t n = std::fread( _buf.data() + have, 1, _buf.size() - have, _file );
+         _buf.resize( have + n );
+         _read += n;
+
+         if( !_header ) {
+            if( _buf.size() < trace_header_size )
+               return n > 0;
+            if( !trace_decoder::check_header( _buf.data(), _buf.size() ) )
+               throw std::runtime_error( _path + " is not an action trace" );
+            _pos = trace_header_size;
+            _header = true;
+         }
+         return n > 0;
+      }
+
+      /// the next complete record; false if the rest is not yet written
+      bool next( trace_record& r ) {
+         if( !_header )
+            return false;
+         const char* pos = _buf.data() + _pos;
+         if( !_decoder.decode( pos, _buf.data() + _buf.size(), r ) )
+            return false;
+         _pos = pos - _buf.data();
+         return true;
+      }
+
+      /// the trace offset after the last record decoded
+      uint64_t offset()const { return _base + _pos; }
+
+   private:
+      void compact() {
+         if( _pos > ( 1 << 20 ) && _pos * 2 > _buf.size() ) {
+            _buf.erase( _buf.begin(), _buf.begin() + _pos );
+            _base += _pos;
+            _pos = 0;
+         }
+      }
+
+      std::string _path;
+      std::FILE* _file;
+      trace_decoder _decoder;
+      std::vector<char> _buf;
+      uint64_t _base = 0;      ///< trace offset of _buf[0]
+      uint64_t _pos = 0;       ///< next record in _buf
+      uint64_t _read = 0;      ///< trace bytes read
+      bool _header = false;
+   };
+
+   struct row_change {
+      native::table_id id;
+      uint64_t primary;
+      bool removed;
+      native::row r;
+   };
+
+   void usage( const char* argv0 ) {
+      std::fprintf( stderr,
+         "usage: %s [options] TRACE\n"
+         "  --journal=FILE   row journal, default TRACE.journal; created if missing\n"
+         "  --socket=PATH    Unix socket to serve queries on, default ledger_indexer.sock\n"
+         "  --slvr=ACCOUNT   slvrtoken account, default ampervstoken\n"
+         "  --dr=ACCOUNT     drtoken account, default amperdrtoken\n"
+         "  --batch=N        actions per journal commit at most, default 1024\n"
+         "  --poll-ms=N      how often to look for new trace records when idle, default 10\n"
+         "  --sync           flush each commit to the disk before queries see it\n",
+         argv0 );
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opt;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( auto v = option( arg, "--journal=" ) )       opt.journal = v;
+      else if( auto v = option( arg, "--socket=" ) )   opt.socket = v;
+      else if( auto v = option( arg, "--slvr=" ) )     opt.slvr = name(v);
+      else if( auto v = option( arg, "--dr=" ) )       opt.dr = name(v);
+      else if( auto v = option( arg, "--batch=" ) )    opt.batch = std::strtoull( v, nullptr, 10 );
+      else if( auto v = option( arg, "--poll-ms=" ) )  opt.poll_ms = std::strtoull( v, nullptr, 10 );
+      else if( arg == "--sync" )                       opt.sync = true;
+      else if( arg.compare( 0, 2, "--" ) != 0 && opt.trace.empty() ) opt.trace = arg;
+      else {
+         usage( argv[0] );
+         return arg == "--help" ? 0 : 2;
+      }
+   }
+   if( opt.trace.empty() || opt.batch == 0 ) {
+      usage( argv[0] );
+      return 2;
+   }
+   if( opt.journal.empty() )
+      opt.journal = opt.trace + ".journal";
+
+   struct sigaction sa{};
+   sa.sa_handler = stop;
+   ::sigaction( SIGINT, &sa, nullptr );
+   ::sigaction( SIGTERM, &sa, nullptr );
+
+   try {
+      native::chain c;
+      ledger_index index( opt.slvr, opt.dr );
+      progress prog;
+      std::shared_mutex mutex;
+
+      // restore the chain and the indices, then skip the trace records already applied
+      uint64_t start = now_ns(), rows = 0;
+      row_journal journal( opt.journal, opt.sync );
+      auto last = journal.recover(
+         [&]( const native::table_id& id, uint64_t primary, const native::row* r ) {
+            c.load_row( id, primary, r );
+            index.apply( id, primary, r );
+            ++rows;
+         },
+         [&]( name account, const std::string& type ) {
+            if( type.empty() )
+               c.create_account( account );
+            else
+               c.set_code( account, type );
+         } );
+      if( last.trace_offset )
+         c.set_time( last.time );
+
+      trace_tail tail( opt.trace );
+      trace_record r;
+      while( tail.offset() < last.trace_offset ) {
+         if( tail.next(r) )
+            continue;
+         if( !tail.read() )
+            throw std::runtime_error( opt.journal + " is ahead of " + opt.trace );
+      }
+      if( tail.offset() != last.trace_offset )
+         throw std::runtime_error( opt.journal + " does not match " + opt.trace );
+      prog = { last.trace_offset, last.actions, 0, 0, journal.size(), last.actions };
+      std::printf( "{\"kind\":\"recover\",\"journal\":\"%s\",\"journal_bytes\":%llu,\"rows\":%llu,\"actions\":%llu,"
+                   "\"trace_offset\":%llu,\"recover_ms\":%.1f}\n",
+                   opt.journal.c_str(), (unsigned long long)journal.size(), (unsigned long long)rows,
+                   (unsigned long long)last.actions, (unsigned long long)last.trace_offset, ( now_ns() - start ) / 1e6 );
+      std::fflush( stdout );
+
+      query_server server( opt, index, prog, mutex );
+      std::thread serving( [&] { server.run(); } );
+
+      std::vector<row_change> changes;
+      c.set_row_observer( [&]( const native::table& t, uint64_t primary, const native::row* row ) {
+         journal.add_row( t.id, primary, row );
+         changes.push_back( { t.id, primary, !row, row ? *row : native::row() } );
+      } );
+
+      std::vector<native::action_data> trx(1);
+      uint64_t actions = last.actions, failed = 0, batches = 0;
+      try {
+         while( !stopping ) {
+            uint64_t batch = 0;
+            while( batch < opt.batch && tail.next(r) ) {
+               switch( r.kind ) {
+               case trace_record::set_code:
+                  c.set_code( r.act.account, r.code_type );
+                  journal.add_account( r.act.account, r.code_type );
+                  break;
+               case trace_record::create_account:
+                  c.create_account( r.act.account );
+                  journal.add_account( r.act.account, "" );
+                  break;
+               case trace_record::action:
+                  c.advance_time( r.delay_us );
+                  c.run_deferred();
+                  trx[0] = std::move( r.act );
+                  if( !c.push_transaction( trx ).succeeded )
+                     ++failed;
+                  ++actions;
+                  ++batch;
+                  break;
+               }
+            }
+            if( batch == 0 && changes.empty() && tail.offset() == prog.trace_offset ) {
+               if( !tail.read() )
+                  std::this_thread::sleep_for( std::chrono::milliseconds( opt.poll_ms ) );
+               continue;
+            }
+
+            journal.add_commit( { tail.offset(), c.time(), actions } );
+            ++batches;
+            std::unique_lock<std::shared_mutex> lock( mutex );
+            for( const auto& ch : changes )
+               index.apply( ch.id, ch.primary, ch.removed ? nullptr : &ch.r );
+            prog.trace_offset = tail.offset();
+            prog.actions = actions;
+            prog.failed = failed;
+            prog.batches = batches;
+            prog.journal_bytes = journal.size();
+            lock.unlock();
+            changes.clear();
+         }
+      } catch( ... ) {
+         stopping = true;
+         serving.join();
+         throw;
+      }
+      serving.join();
+
+      std::printf( "{\"kind\":\"summary\",\"trace\":\"%s\",\"trace_offset\":%llu,\"actions\":%llu,\"failed\":%llu,"
+                   "\"batches\":%llu,\"journal_bytes\":%llu,\"holders\":%llu,\"lots\":%llu,\"queries\":%llu,"
+                   "\"peak_rss_kb\":%ld}\n",
+                   opt.trace.c_str(), (unsigned long long)prog.trace_offset, (unsigned long long)actions,
+                   (unsigned long long)failed, (unsigned long long)batches, (unsigned long long)journal.size(),
+                   (unsigned long long)index.holders(), (unsigned long long)index.lot_count(),
+                   (unsigned long long)server.queries(), peak_rss_kb() );
+   } catch( const std::exception& e ) {
+      std::fflush( stdout );
+      std::fprintf( stderr, "%s\n", e.what() );
+      return 1;
+   }
+   return 0;
+}
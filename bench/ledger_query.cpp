@@ -0,0 +1,167 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Sends queries to ledger_indexer and prints the answers, or with --repeat, times
+ *  the round trips.
+ *
+ *  Each argument is one query, e.g. "holder haaaaab".  With --holders=N, "holder"
+ *  and "lots" queries are also sent for N holders drawn from bench::holder, as a
+ *  wallet service would send them.  With --repeat the answers are not printed; the
+ *  report is a JSON line with the latency percentiles of the round trips.
+ */
+#include "bench_util.hpp"
+
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+using namespace bench;
+
+namespace {
+
+   struct options {
+      std::string socket = "ledger_indexer.sock";
+      std::vector<std::string> queries;
+      uint64_t holders = 0;
+      uint64_t repeat = 0;
+      uint64_t seed = 1;
+   };
+
+   class connection {
+   public:
+      explicit connection( const std::string& path ) {
+         sockaddr_un addr{};
+         if( path.size() >= sizeof(addr.sun_path) )
+            throw std::runtime_error( "socket path too long: " + path );
+         addr.sun_family = AF_UNIX;
+         std::strcpy( addr.sun_path, path.c_str() );
+         _fd = ::socket( AF_UNIX, SOCK_STREAM, 0 );
+         if( _fd < 0 || ::connect( _fd, (sockaddr*)&addr, sizeof(addr) ) != 0 ) {
+            if( _fd >= 0 )
+               ::close( _fd );
+            throw std::runtime_error( "cannot connect to " + path );
+         }
+      }
+
+      ~connection() { ::close( _fd ); }
+
+      connection( const connection& ) = delete;
+      connection& operator=( const connection& ) = delete;
+
+      /// sends a query and returns its answer, without the empty line that ends it
+      std::string ask( const std::string& query ) {
+         std::string request = query + "\n";
+         for( size_t sent = 0; sent < request.size(); ) {
+            ssize_t n = ::send( _fd, request.data() + sent, request.size() - sent, MSG_NOSIGNAL );
+            if( n <= 0 )
+               throw std::runtime_error( "the indexer closed the connection" );
+            sent += n;
+         }
+
+         size_t end;
+         while( ( end = answer_end() ) == std::string::npos ) {
+            char buf[1 << 16];
+            ssize_t n = ::recv( _fd, buf, sizeof(buf), 0 );
+            if( n <= 0 )
+               throw std::runtime_error( "the indexer closed the connection" );
+            _in.append( buf, n );
+         }
+         std::string answer = _in.substr( 0, end );
+         _in.erase( 0, end + 1 );
+         return answer;
+      }
+
+   private:
+      /// where the empty line ending the first answer is, or npos
+      size_t answer_end()const {
+         if( !_in.empty() && _in[0] == '\n' )
+            return 0;
+         size_t found = _in.find( "\n\n" );
+         return found == std::string::npos ? found : found + 1;
+      }
+
+      int _fd;
+      std::string _in;
+   };
+
+   void usage( const char* argv0 ) {
+      std::fprintf( stderr,
+         "usage: %s [options] QUERY...\n"
+         "  --socket=PATH   the indexer's socket, default ledger_indexer.sock\n"
+         "  --holders=N     also query the holders and lots of N random holders\n"
+         "  --seed=N        seed for the holders drawn, default 1\n"
+         "  --repeat=N      send the queries N times and report the latency instead of the answers\n",
+         argv0 );
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opt;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( auto v = option( arg, "--socket=" ) )        opt.socket = v;
+      else if( auto v = option( arg, "--holders=" ) )  opt.holders = std::strtoull( v, nullptr, 10 );
+      else if( auto v = option( arg, "--seed=" ) )     opt.seed = std::strtoull( v, nullptr, 10 );
+      else if( auto v = option( arg, "--repeat=" ) )   opt.repeat = std::strtoull( v, nullptr, 10 );
+      else if( arg.compare( 0, 2, "--" ) != 0 )        opt.queries.push_back( arg );
+      else {
+         usage( argv[0] );
+         return arg == "--help" ? 0 : 2;
+      }
+   }
+
+   std::mt19937_64 rng( opt.seed );
+   for( uint64_t i = 0; i < opt.holders; ++i ) {
+      auto h = holder( rng() % opt.holders ).to_string();
+      opt.queries.push_back( "holder " + h );
+      opt.queries.push_back( "lots " + h );
+   }
+   if( opt.queries.empty() ) {
+      usage( argv[0] );
+      return 2;
+   }
+
+   try {
+      connection conn( opt.socket );
+      if( opt.repeat == 0 ) {
+         for( const auto& q : opt.queries ) {
+            auto answer = conn.ask( q );
+            std::fwrite( answer.data(), 1, answer.size(), stdout );
+         }
+         return 0;
+      }
+
+      std::vector<uint64_t> ns;
+      ns.reserve( opt.repeat * opt.queries.size() );
+      uint64_t bytes = 0, start = now_ns();
+      for( uint64_t k = 0; k < opt.repeat; ++k ) {
+         for( const auto& q : opt.queries ) {
+            uint64_t begin = now_ns();
+            bytes += conn.ask( q ).size();
+            ns.push_back( now_ns() - begin );
+         }
+      }
+      uint64_t wall_ns = now_ns() - start;
+      std::sort( ns.begin(), ns.end() );
+      std::printf( "{\"kind\":\"latency\",\"queries\":%zu,\"answer_bytes\":%llu,\"queries_per_sec\":%.0f,"
+                   "\"latency_us\":{\"p50\":%.1f,\"p90\":%.1f,\"p99\":%.1f,\"max\":%.1f}}\n",
+                   ns.size(), (unsigned long long)bytes, wall_ns ? ns.size() * 1e9 / wall_ns : 0.0,
+                   quantile( ns, 0.5 ) / 1e3, quantile( ns, 0.9 ) / 1e3, quantile( ns, 0.99 ) / 1e3,
+                   quantile( ns, 1 ) / 1e3 );
+   } catch( const std::exception& e ) {
+      std::fflush( stdout );
+      std::fprintf( stderr, "%s\n", e.what() );
+      return 1;
+   }
+   return 0;
+}
@@ -0,0 +1,484 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Replays an action trace from trace_gen on several threads, to rebuild the contract
+ *  tables faster than trace_replay does one action at a time.
+ *
+ *  Each action gets a footprint, the scopes it reads and writes, from a model of the
+ *  contract it calls:
+ *
+ *     drtoken::transfer      writes the accounts scopes of from and to, and reads the
+ *                            rest of drtoken
+ *     other drtoken actions  write all of drtoken
+ *     slvrtoken actions      write all of slvrtoken: its rounds and lots tables
+ *                            are in one scope, which every action reads and changes
+ *     slvrtoken::redeem,     write everything, as they act on drtoken inline; so does
+ *     slvrtoken::create      any action when the chain has a contract with no model
+ *
+ *  Every action reads everything, so an action that writes everything runs alone,
+ *  and so do the accounts and contracts set in the trace.  The footprints give a
+ *  graph where each action follows the last writer of the scopes it reads, and the
+ *  readers and last writer of the scopes it writes.  The graph runs on a work-stealing
+ *  pool, one chain per thread over a shared database; actions on disjoint scopes run
+ *  at the same time and the rest run in trace order.  Deferred transactions, which
+ *  the token contracts do not send, are not run.
+ *
+ *  The report is JSON lines: one per thread, then a summary with the size of the
+ *  graph and the throughput.  The summary also gives the work, the time the tasks took,
+ *  and the span, the time of the slowest chain of the graph; their ratio bounds the
+ *  speedup on any number of cores.  The speedup it reports is the work over the replay
+ *  time, what the threads gained over running the same tasks one at a time.  A trace
+ *  of mostly slvrtoken actions has a parallelism near 1 and gains nothing, which is
+ *  noted on stderr.  --verify replays the trace sequentially as well and checks that
+ *  both give the same results, tables and RAM.
+ */
+#include <native/chain.hpp>
+
+#include "bench_util.hpp"
+#include "table_dump.hpp"
+#include "trace.hpp"
+#include "work_stealing.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+using namespace bench;
+
+namespace {
+
+   struct options {
+      std::string trace;
+      std::string dump;
+      unsigned threads = std::max( 1u, std::thread::hardware_concurrency() );
+      uint64_t limit = 0;
+      bool verify = false;
+   };
+
+   /// the contracts whose actions have a footprint model
+   enum class model : uint8_t { none, slvrtoken, drtoken };
+
+   model model_of( const std::string& type ) {
+      if( type == "ampersand::slvrtoken" ) return model::slvrtoken;
+      if( type == "ampersand::drtoken" )   return model::drtoken;
+      return model::none;
+   }
+
+   /// a scope of a contract; all_scopes stands for those of its scopes no footprint names
+   constexpr uint64_t all_scopes = ~uint64_t(0);
+
+   struct scope_key {
+      uint64_t code;
+      uint64_t scope;
+
+      friend bool operator == ( const scope_key& a, const scope_key& b ) {
+         return a.code == b.code && a.scope == b.scope;
+      }
+   };
+
+   struct scope_key_hash {
+      size_t operator()( const scope_key& k )const {
+         return std::hash<uint64_t>()( k.code ^ ( k.scope * 0x9e3779b97f4a7c15ull ) );
+      }
+   };
+
+   const scope_key everything{ 0, all_scopes };
+
+   struct access {
+      scope_key key;
+      bool write;
+   };
+
+   /// the contracts set so far and whether all of them have a model
+   struct contract_set {
+      std::unordered_map<uint64_t, model> models;
+      bool modelled = true;
+
+      void set_code( name account, const std::string& type ) {
+         models[account.value] = model_of( type );
+         modelled = std::all_of( models.begin(), models.end(), []( const auto& m ) {
+            return m.second != model::none;
+         } );
+      }
+   };
+
+   /// the accounts an action names first, e.g. from and to of a transfer
+   bool leading_names( const native::action_data& act, uint64_t* names, size_t count ) {
+      if( act.data.size() < count * 8 )
+         return false;
+      std::memcpy( names, act.data.data(), count * 8 );
+      return true;
+   }
+
+   void footprint( const native::action_data& act, const contract_set& contracts, std::vector<access>& out ) {
+      out.clear();
+      out.push_back( { everything, false } );
+
+      auto found = contracts.models.find( act.account.value );
+      model m = found == contracts.models.end() ? model::none : found->second;
+      uint64_t code = act.account.value;
+      if( !contracts.modelled || m == model::none ) {
+         out[0].write = true;
+         return;
+      }
+
+      if( m == model::drtoken ) {
+         uint64_t from_to[2];
+         if( act.action == name("transfer") && leading_names( act, from_to, 2 ) && from_to[0] != from_to[1] ) {
+            out.push_back( { { code, all_scopes }, false } );
+            out.push_back( { { code, from_to[0] }, true } );
+            out.push_back( { { code, from_to[1] }, true } );
+         }
+         else {
+            out.push_back( { { code, all_scopes }, true } );
+         }
+         return;
+      }
+
+      if( act.action == name("redeem") || act.action == name("create") )
+         out[0].write = true;
+      else
+         out.push_back( { { code, all_scopes }, true } );
+   }
+
+   /// one task of the replay: an action, or a run of account and contract records
+   struct task {
+      uint32_t first;         ///< record
+      uint32_t count;         ///< records, 1 for an action
+      uint32_t action;        ///< index among the actions
+      bool setup;
+      uint64_t time_us;       ///< the action's time, from the start of the trace
+   };
+
+   struct plan {
+      std::vector<task> tasks;
+      std::vector<uint32_t> pending;        ///< tasks each task waits for
+      std::vector<uint32_t> next_begin;     ///< tasks[i]'s successors are next[next_begin[i], next_begin[i+1])
+      std::vector<uint32_t> next;
+      uint64_t actions = 0;
+      uint64_t critical_path = 0;           ///< tasks on the longest chain of the graph
+   };
+
+   plan make_plan( const std::vector<trace_record>& records, uint64_t limit ) {
+      plan p;
+      uint64_t elapsed = 0;
+
+      for( size_t i = 0; i < records.size(); ++i ) {
+         const auto& r = records[i];
+         if( r.kind == trace_record::action ) {
+            if( limit && p.actions == limit )
+               break;
+            elapsed += r.delay_us;
+            p.tasks.push_back( { uint32_t(i), 1, uint32_t( p.actions++ ), false, elapsed } );
+            continue;
+         }
+         if( !p.tasks.empty() && p.tasks.back().setup )
+            ++p.tasks.back().count;
+         else
+            p.tasks.push_back( { uint32_t(i), 1, 0, true, elapsed } );
+      }
+
+      struct key_state {
+         int64_t writer = -1;
+         std::vector<uint32_t> readers;
+      };
+      std::unordered_map<scope_key, key_state, scope_key_hash> keys;
+      std::vector<std::pair<uint32_t, uint32_t>> edges;
+      std::vector<uint32_t> depth( p.tasks.size() );
+      std::vector<uint32_t> preds;
+      std::vector<access> fp;
+      contract_set contracts;
+
+      p.pending.assign( p.tasks.size(), 0 );
+      for( uint32_t t = 0; t < p.tasks.size(); ++t ) {
+         const auto& tk = p.tasks[t];
+         if( tk.setup ) {
+            fp.assign( 1, { everything, true } );
+            for( uint32_t i = tk.first; i < tk.first + tk.count; ++i ) {
+               if( records[i].kind == trace_record::set_code )
+                  contracts.set_code( records[i].act.account, records[i].code_type );
+            }
+         }
+         else {
+            footprint( records[tk.first].act, contracts, fp );
+         }
+
+         preds.clear();
+         for( const auto& a : fp ) {
+            auto& ks = keys[a.key];
+            if( ks.writer >= 0 )
+               preds.push_back( ks.writer );
+            if( a.write ) {
+               preds.insert( preds.end(), ks.readers.begin(), ks.readers.end() );
+               ks.readers.clear();
+               ks.writer = t;
+            }
+            else {
+               ks.readers.push_back( t );
+            }
+         }
+         std::sort( preds.begin(), preds.end() );
+         preds.erase( std::unique( preds.begin(), preds.end() ), preds.end() );
+
+         uint32_t d = 0;
+         for( auto pred : preds ) {
+            edges.emplace_back( pred, t );
+            d = std::max( d, depth[pred] );
+         }
+         depth[t] = d + 1;
+         p.pending[t] = preds.size();
+         p.critical_path = std::max<uint64_t>( p.critical_path, depth[t] );
+      }
+
+      p.next_begin.assign( p.tasks.size() + 1, 0 );
+      for( const auto& e : edges )
+         ++p.next_begin[e.first + 1];
+      for( size_t i = 1; i < p.next_begin.size(); ++i )
+         p.next_begin[i] += p.next_begin[i - 1];
+      p.next.resize( edges.size() );
+      auto fill = p.next_begin;
+      for( const auto& e : edges )
+         p.next[ fill[e.first]++ ] = e.second;
+      return p;
+   }
+
+   struct alignas(64) worker_result {
+      uint64_t actions = 0;
+      uint64_t failed = 0;
+   };
+
+   /// the first difference between the non-empty tables of two chains, or "" if none
+   std::string compare_tables( const native::chain& a, const native::chain& b ) {
+      auto next = []( auto it, auto end ) {
+         while( it != end && it->second.rows.empty() )
+            ++it;
+         return it;
+      };
+      auto describe = []( const native::table_id& id ) {
+         return name(id.code).to_string() + ":" + name(id.table).to_string() + "@" + name(id.scope).to_string();
+      };
+
+      auto ia = next( a.tables().begin(), a.tables().end() );
+      auto ib = next( b.tables().begin(), b.tables().end() );
+      while( ia != a.tables().end() || ib != b.tables().end() ) {
+         if( ia == a.tables().end() )
+            return "only sequential has " + describe( ib->first );
+         if( ib == b.tables().end() || ia->first < ib->first )
+            return "only parallel has " + describe( ia->first );
+         if( ib->first < ia->first )
+            return "only sequential has " + describe( ib->first );
+
+         const auto& ra = ia->second.rows;
+         const auto& rb = ib->second.rows;
+         if( ia->second.payer != ib->second.payer )
+            return describe( ia->first ) + " payer";
+         if( ra.size() != rb.size() )
+            return describe( ia->first ) + " row count";
+         for( auto x = ra.begin(), y = rb.begin(); x != ra.end(); ++x, ++y ) {
+            if( x->first != y->first || x->second.payer != y->second.payer || x->second.data != y->second.data )
+               return describe( ia->first ) + " row " + std::to_string( x->first );
+         }
+         ia = next( ++ia, a.tables().end() );
+         ib = next( ++ib, b.tables().end() );
+      }
+      return "";
+   }
+
+   std::unordered_map<uint64_t, int64_t> nonzero( const std::unordered_map<uint64_t, int64_t>& ram ) {
+      std::unordered_map<uint64_t, int64_t> out;
+      for( const auto& [payer, bytes] : ram ) {
+         if( bytes )
+            out.emplace( payer, bytes );
+      }
+      return out;
+   }
+
+   void usage( const char* argv0 ) {
+      std::fprintf( stderr,
+         "usage: %s [options] TRACE\n"
+         "  --threads=N  threads, default the number of cores\n"
+         "  --limit=N    replay at most N actions\n"
+         "  --dump=FILE  write the tables after the replay to FILE\n"
+         "  --verify     replay sequentially too and compare the results, tables and RAM\n", argv0 );
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opt;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( auto v = option( arg, "--threads=" ) )     opt.threads = std::strtoul( v, nullptr, 10 );
+      else if( auto v = option( arg, "--limit=" ) )  opt.limit = std::strtoull( v, nullptr, 10 );
+      else if( auto v = option( arg, "--dump=" ) )   opt.dump = v;
+      else if( arg == "--verify" )                   opt.verify = true;
+      else if( arg.compare( 0, 2, "--" ) != 0 && opt.trace.empty() ) opt.trace = arg;
+      else {
+         usage( argv[0] );
+         return arg == "--help" ? 0 : 2;
+      }
+   }
+   if( opt.trace.empty() || opt.threads == 0 ) {
+      usage( argv[0] );
+      return 2;
+   }
+
+   uint64_t t0 = now_ns();
+   auto records = load_trace( opt.trace );
+   uint64_t load_ns = now_ns() - t0;
+
+   t0 = now_ns();
+   plan p = make_plan( records, opt.limit );
+   uint64_t plan_ns = now_ns() - t0;
+
+   std::vector<std::unique_ptr<native::chain>> chains;
+   chains.push_back( std::make_unique<native::chain>() );
+   for( unsigned w = 1; w < opt.threads; ++w )
+      chains.push_back( std::make_unique<native::chain>( chains[0]->shared_database() ) );
+   const uint64_t start_time = chains[0]->time();
+
+   std::vector<uint8_t> succeeded( p.actions );
+   std::vector<uint64_t> task_ns( p.tasks.size() );
+   std::vector<worker_result> results( opt.threads );
+   std::vector<std::vector<native::action_data>> trx( opt.threads, std::vector<native::action_data>(1) );
+   std::unique_ptr<std::atomic<uint32_t>[]> pending( new std::atomic<uint32_t>[ p.tasks.size() ] );
+   std::vector<uint32_t> ready;
+   for( uint32_t t = 0; t < p.tasks.size(); ++t ) {
+      pending[t].store( p.pending[t], std::memory_order_relaxed );
+      if( p.pending[t] == 0 )
+         ready.push_back( t );
+   }
+   // in trace order, so the first tasks are taken first
+   std::reverse( ready.begin(), ready.end() );
+
+   t0 = now_ns();
+   auto workers = run_work_stealing( opt.threads, ready, p.tasks.size(), [&]( unsigned w, uint32_t t, auto&& push ) {
+      const auto& tk = p.tasks[t];
+      uint64_t begin = now_ns();
+      if( tk.setup ) {
+         // runs alone, so every chain can be changed
+         for( auto& c : chains ) {
+            for( uint32_t i = tk.first; i < tk.first + tk.count; ++i ) {
+               const auto& r = records[i];
+               if( r.kind == trace_record::set_code )
+                  c->set_code( r.act.account, r.code_type );
+               else
+                  c->create_account( r.act.account );
+            }
+         }
+      }
+      else {
+         auto& c = *chains[w];
+         c.set_time( start_time + tk.time_us );
+         trx[w][0] = std::move( records[tk.first].act );
+         auto result = c.push_transaction( trx[w] );
+         succeeded[tk.action] = result.succeeded;
+         ++results[w].actions;
+         results[w].failed += !result.succeeded;
+      }
+      task_ns[t] = now_ns() - begin;
+      for( uint32_t i = p.next_begin[t]; i < p.next_begin[t + 1]; ++i ) {
+         if( pending[ p.next[i] ].fetch_sub( 1, std::memory_order_acq_rel ) == 1 )
+            push( p.next[i] );
+      }
+   } );
+   uint64_t wall_ns = now_ns() - t0;
+
+   uint64_t failed = 0, calls = 0, steals = 0;
+   std::unordered_map<uint64_t, int64_t> ram;
+   for( unsigned w = 0; w < opt.threads; ++w ) {
+      const auto& s = workers[w];
+      std::printf( "{\"kind\":\"worker\",\"worker\":%u,\"tasks\":%llu,\"actions\":%llu,\"failed\":%llu,"
+                   "\"steals\":%llu,\"busy_ms\":%.1f}\n",
+                   w, (unsigned long long)s.tasks, (unsigned long long)results[w].actions,
+                   (unsigned long long)results[w].failed, (unsigned long long)s.steals, s.busy_ns / 1e6 );
+      failed += results[w].failed;
+      steals += s.steals;
+      calls += db_calls( *chains[w] );
+      for( const auto& [payer, bytes] : chains[w]->ram_usage() )
+         ram[payer] += bytes;
+   }
+   long long ram_bytes = 0;
+   for( const auto& r : ram )
+      ram_bytes += r.second;
+
+   // tasks are numbered in an order of the graph, so one pass gives each its earliest finish
+   uint64_t work_ns = 0, span_ns = 0;
+   std::vector<uint64_t> finish( p.tasks.size() );
+   for( uint32_t t = 0; t < p.tasks.size(); ++t ) {
+      finish[t] += task_ns[t];
+      work_ns += task_ns[t];
+      span_ns = std::max( span_ns, finish[t] );
+      for( uint32_t i = p.next_begin[t]; i < p.next_begin[t + 1]; ++i )
+         finish[ p.next[i] ] = std::max( finish[ p.next[i] ], finish[t] );
+   }
+
+   double parallelism = span_ns ? double( work_ns ) / span_ns : 0.0;
+   std::printf( "{\"kind\":\"summary\",\"trace\":\"%s\",\"threads\":%u,\"actions\":%llu,\"failed\":%llu,"
+                "\"tasks\":%zu,\"edges\":%zu,\"critical_path\":%llu,\"steals\":%llu,\"load_ms\":%.1f,\"plan_ms\":%.1f,"
+                "\"work_ms\":%.1f,\"span_ms\":%.1f,\"parallelism\":%.2f,\"replay_ms\":%.1f,\"speedup\":%.2f,\"actions_per_sec\":%.0f%s,"
+                "\"ram_bytes\":%lld,\"peak_rss_kb\":%ld}\n",
+                opt.trace.c_str(), opt.threads, (unsigned long long)p.actions, (unsigned long long)failed,
+                p.tasks.size(), p.next.size(), (unsigned long long)p.critical_path, (unsigned long long)steals,
+                load_ns / 1e6, plan_ns / 1e6, work_ns / 1e6, span_ns / 1e6, parallelism,
+                wall_ns / 1e6, wall_ns ? double( work_ns ) / wall_ns : 0.0, wall_ns ? p.actions * 1e9 / wall_ns : 0.0,
+                db_calls_json( "db_calls", calls ).c_str(), ram_bytes, peak_rss_kb() );
+   if( opt.threads > 1 && parallelism < 1.5 )
+      std::fprintf( stderr, "parallelism %.2f: most actions share a scope and replay in order, so threads "
+                    "cannot speed this trace up; slvrtoken keeps its rounds and lots in one scope\n", parallelism );
+
+   if( !opt.dump.empty() ) {
+      uint64_t bytes = write_table_dump( *chains[0], opt.dump );
+      std::fprintf( stderr, "wrote %s: %llu bytes\n", opt.dump.c_str(), (unsigned long long)bytes );
+   }
+
+   if( !opt.verify )
+      return 0;
+
+   // the loop of trace_replay
+   records = load_trace( opt.trace );
+   native::chain c;
+   std::vector<uint8_t> expected;
+   std::vector<native::action_data> one(1);
+   t0 = now_ns();
+   for( auto& r : records ) {
+      if( r.kind == trace_record::set_code ) {
+         c.set_code( r.act.account, r.code_type );
+         continue;
+      }
+      if( r.kind == trace_record::create_account ) {
+         c.create_account( r.act.account );
+         continue;
+      }
+      if( opt.limit && expected.size() == opt.limit )
+         break;
+      c.advance_time( r.delay_us );
+      c.run_deferred();
+      one[0] = std::move( r.act );
+      expected.push_back( c.push_transaction( one ).succeeded );
+   }
+   uint64_t sequential_ns = now_ns() - t0;
+
+   auto mismatch = std::mismatch( expected.begin(), expected.end(), succeeded.begin(), succeeded.end() );
+   bool results_match = mismatch.first == expected.end() && mismatch.second == succeeded.end();
+   std::string difference = compare_tables( *chains[0], c );
+   bool tables_match = difference.empty();
+   bool ram_match = nonzero( ram ) == nonzero( c.ram_usage() );
+   if( !results_match )
+      difference = "result of action " + std::to_string( mismatch.first - expected.begin() );
+
+   std::printf( "{\"kind\":\"verify\",\"sequential_ms\":%.1f,\"speedup\":%.2f,\"results_match\":%s,"
+                "\"tables_match\":%s,\"ram_match\":%s%s%s%s}\n",
+                sequential_ns / 1e6, wall_ns ? double( sequential_ns ) / wall_ns : 0.0,
+                results_match ? "true" : "false", tables_match ? "true" : "false",
+                ram_match ? "true" : "false", difference.empty() ? "" : ",\"first_difference\":\"",
+                difference.c_str(), difference.empty() ? "" : "\"" );
+   return results_match && tables_match && ram_match ? 0 : 1;
+}
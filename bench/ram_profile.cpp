@@ -0,0 +1,384 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  RAM footprint profiler for the slvrtoken and drtoken contracts.
+ *
+ *  Replays a seeded workload against the contracts on the in-memory chain: issue
+ *  rounds opened at a fixed pace, each unlocked half way to the next, with issues,
+ *  transfers, redemptions, burns and notification filters in between.  Every
+ *  --interval actions it reports the RAM billed per table and its growth per 1000
+ *  actions; at the end it breaks the RAM down by table, scope and payer and gives
+ *  the distribution of rows per scope, per payer and, for the customers table, per
+ *  holder.  One JSON object is written per line, its "kind" telling which report it is.
+ */
+#include <native/chain.hpp>
+
+#include "../custom_token/slvrtoken/slvrtoken.hpp"
+#include "bench_util.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+using ampersand::slvrtoken;
+using namespace bench;
+
+namespace {
+
+   const name slvr_account   = name("ampervstoken");
+   const name dr_account     = name("amperdrtoken");
+   const name issuer_account = name("amprissuer");
+   const symbol slvr_symbol  = symbol("SLVR", 4);
+
+   struct options {
+      uint64_t holders = 10000;
+      uint64_t actions = 100000;
+      uint64_t round_every = 5000;
+      uint64_t interval = 1000;
+      uint64_t seed = 1;
+      uint64_t top = 10;
+   };
+
+   std::string table_name( const native::table_id& id, bool secondary ) {
+      return native::db_table{ id.code, id.table, secondary }.to_string();
+   }
+
+   /// min, quantiles and max of a set of counts
+   std::string distribution_json( std::vector<uint64_t> values ) {
+      std::sort( values.begin(), values.end() );
+      char buf[200];
+      std::snprintf( buf, sizeof(buf), "\"count\":%zu,\"min\":%llu,\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"max\":%llu",
+                     values.size(), (unsigned long long)quantile( values, 0 ),
+                     (unsigned long long)quantile( values, 0.5 ), (unsigned long long)quantile( values, 0.9 ),
+                     (unsigned long long)quantile( values, 0.99 ), (unsigned long long)quantile( values, 1 ) );
+      return buf;
+   }
+
+   /// drives the workload and keeps the balances it needs to pick valid actions
+   class workload {
+   public:
+      workload( native::chain& c, const options& opt )
+         : _c(c), _opt(opt), _rng(opt.seed), _balance(opt.holders, 0)
+      {
+         _c.set_code( slvr_account, "ampersand::slvrtoken" );
+         _c.set_code( dr_account, "ampersand::drtoken" );
+         _c.create_account( issuer_account );
+         for( uint64_t h = 0; h < opt.holders; ++h )
+            _c.create_account( holder(h) );
+      }
+
+      /// runs action number i of the workload, returns its name
+      const char* step( uint64_t i ) {
+         if( i % _opt.round_every == 0 ) {
+            open_round();
+            return "issueopen";
+         }
+         if( i % _opt.round_every == _opt.round_every / 2 ) {
+            unlock_round();
+            return "unlock";
+         }
+
+         uint32_t pick = _rng() % 100;
+         if( pick < 25 ) {
+            issue();
+            return "issue";
+         }
+         if( pick < 75 ) {
+            transfer();
+            return "transfer";
+         }
+         if( pick < 90 ) {
+            redeem( "redeem" );
+            return "redeem";
+         }
+         if( pick < 95 ) {
+            redeem( "burn" );
+            return "burn";
+         }
+         setnotify();
+         return "setnotify";
+      }
+
+      uint64_t failed()const { return _failed; }
+
+   private:
+      asset amount( int64_t units ) { return asset( units * 10000, slvr_symbol ); }
+
+      uint64_t random_holder() { return _rng() % _opt.holders; }
+
+      /// a holder with a balance, or none after a few tries
+      bool funded_holder( uint64_t& h ) {
+         for( int tries = 0; tries < 8; ++tries ) {
+            h = random_holder();
+            if( _balance[h] > 0 )
+               return true;
+         }
+         return false;
+      }
+
+      bool push( const native::transaction_result& r ) {
+         if( !r.succeeded )
+            ++_failed;
+         return r.succeeded;
+      }
+
+      void open_round() {
+         ++_round;
+         push( _c.push_action( slvr_account, name("issueopen"), slvr_account,
+                               amount(0), issuer_account, _round ) );
+         push( _c.push_action( slvr_account, name("create"), slvr_account,
+                               issuer_account, amount( 1000000000 ), uint16_t(1000), _round, true, true, false ) );
+      }
+
+      void unlock_round() {
+         push( _c.push_action( slvr_account, name("unlock"), slvr_account, amount(0), _round ) );
+         push( _c.push_action( slvr_account, name("redeemunlock"), slvr_account, amount(0), _round ) );
+      }
+
+      void issue() {
+         uint64_t h = random_holder();
+         int64_t units = 1 + _rng() % 1000;
+         if( push( _c.push_action( slvr_account, name("issue"), issuer_account,
+                                   holder(h), amount(units), std::string("issue"), _round ) ) )
+            _balance[h] += units;
+      }
+
+      void transfer() {
+         uint64_t from;
+         if( !funded_holder( from ) )
+            return issue();
+         uint64_t to = random_holder();
+         if( to == from )
+            to = ( to + 1 ) % _opt.holders;
+         int64_t units = 1 + _rng() % std::max<int64_t>( 1, _balance[from] / 2 );
+         if( push( _c.push_action( slvr_account, name("transfer"), holder(from),
+                                   holder(from), holder(to), amount(units), std::string("transfer") ) ) ) {
+            _balance[from] -= units;
+            _balance[to] += units;
+         }
+      }
+
+      void redeem( const char* action ) {
+         uint64_t owner;
+         if( !funded_holder( owner ) )
+            return issue();
+         int64_t units = 1 + _rng() % std::max<int64_t>( 1, _balance[owner] / 4 );
+         if( push( _c.push_action( slvr_account, name(action), holder(owner), holder(owner), amount(units) ) ) )
+            _balance[owner] -= units;
+      }
+
+      void setnotify() {
+         uint64_t h = random_holder();
+         std::vector<symbol_code> muted{ slvr_symbol.code() };
+         push( _c.push_action( slvr_account, name("setnotify"), holder(h), holder(h), false, muted ) );
+      }
+
+      native::chain& _c;
+      const options& _opt;
+      std::mt19937_64 _rng;
+      std::vector<int64_t> _balance;
+      uint64_t _round = 0;
+      uint64_t _failed = 0;
+   };
+
+   /// bytes per table, over all scopes and payers
+   std::map<std::string, int64_t> bytes_per_table( const std::vector<native::ram_charge>& charges ) {
+      std::map<std::string, int64_t> tables;
+      for( const auto& ch : charges )
+         tables[ table_name( ch.id, ch.secondary ) ] += ch.bytes;
+      return tables;
+   }
+
+   void report_growth( uint64_t actions, int64_t bytes, int64_t previous, uint64_t interval,
+                       const std::map<std::string, int64_t>& tables ) {
+      std::printf( "{\"kind\":\"growth\",\"actions\":%llu,\"ram_bytes\":%lld,\"growth_per_1k_actions\":%.1f,\"tables\":{",
+                   (unsigned long long)actions, (long long)bytes, double( bytes - previous ) * 1000 / interval );
+      const char* separator = "";
+      for( const auto& [t, b] : tables ) {
+         std::printf( "%s\"%s\":%lld", separator, t.c_str(), (long long)b );
+         separator = ",";
+      }
+      std::printf( "},\"peak_rss_kb\":%ld}\n", peak_rss_kb() );
+      std::fflush( stdout );
+   }
+
+   void report_tables( const std::vector<native::ram_charge>& charges, uint64_t top ) {
+      struct table_usage {
+         std::map<uint64_t, std::pair<uint64_t, int64_t>> scopes; ///< rows and bytes per scope
+         std::map<uint64_t, uint64_t> payer_rows;
+         uint64_t rows = 0;
+         int64_t bytes = 0;
+      };
+      std::map<std::string, table_usage> tables;
+      for( const auto& ch : charges ) {
+         auto& t = tables[ table_name( ch.id, ch.secondary ) ];
+         auto& scope = t.scopes[ch.id.scope];
+         scope.first += ch.objects;
+         scope.second += ch.bytes;
+         t.payer_rows[ch.payer] += ch.objects;
+         t.rows += ch.objects;
+         t.bytes += ch.bytes;
+      }
+
+      for( const auto& [tname, t] : tables ) {
+         std::printf( "{\"kind\":\"table\",\"table\":\"%s\",\"scopes\":%zu,\"payers\":%zu,\"rows\":%llu,\"bytes\":%lld,"
+                      "\"bytes_per_row\":%.1f}\n",
+                      tname.c_str(), t.scopes.size(), t.payer_rows.size(), (unsigned long long)t.rows,
+                      (long long)t.bytes, t.rows ? double(t.bytes) / t.rows : 0.0 );
+
+         std::vector<uint64_t> per_scope, per_payer;
+         for( const auto& s : t.scopes )
+            per_scope.push_back( s.second.first );
+         for( const auto& p : t.payer_rows )
+            per_payer.push_back( p.second );
+         std::printf( "{\"kind\":\"rows_per_scope\",\"table\":\"%s\",%s}\n", tname.c_str(), distribution_json( per_scope ).c_str() );
+         std::printf( "{\"kind\":\"rows_per_payer\",\"table\":\"%s\",%s}\n", tname.c_str(), distribution_json( per_payer ).c_str() );
+
+         std::vector<std::pair<uint64_t, std::pair<uint64_t, int64_t>>> largest( t.scopes.begin(), t.scopes.end() );
+         std::sort( largest.begin(), largest.end(), []( const auto& a, const auto& b ) {
+            return a.second.second > b.second.second;
+         } );
+         largest.resize( std::min<size_t>( largest.size(), top ) );
+         for( const auto& [scope, usage] : largest ) {
+            std::printf( "{\"kind\":\"scope\",\"table\":\"%s\",\"scope\":\"%s\",\"rows\":%llu,\"bytes\":%lld}\n",
+                         tname.c_str(), name(scope).to_string().c_str(),
+                         (unsigned long long)usage.first, (long long)usage.second );
+         }
+      }
+   }
+
+   void report_payers( const std::vector<native::ram_charge>& charges, uint64_t top ) {
+      struct payer_usage {
+         std::map<std::string, int64_t> tables;
+         uint64_t rows = 0;
+         int64_t bytes = 0;
+      };
+      std::map<uint64_t, payer_usage> payers;
+      for( const auto& ch : charges ) {
+         auto& p = payers[ch.payer];
+         p.tables[ table_name( ch.id, ch.secondary ) ] += ch.bytes;
+         p.rows += ch.objects;
+         p.bytes += ch.bytes;
+      }
+
+      std::vector<std::pair<uint64_t, const payer_usage*>> largest;
+      std::vector<uint64_t> bytes;
+      for( const auto& [payer, usage] : payers ) {
+         largest.emplace_back( payer, &usage );
+         bytes.push_back( usage.bytes );
+      }
+      std::sort( largest.begin(), largest.end(), []( const auto& a, const auto& b ) {
+         return a.second->bytes > b.second->bytes;
+      } );
+      largest.resize( std::min<size_t>( largest.size(), top ) );
+
+      for( const auto& [payer, usage] : largest ) {
+         std::printf( "{\"kind\":\"payer\",\"payer\":\"%s\",\"rows\":%llu,\"bytes\":%lld,\"tables\":{",
+                      name(payer).to_string().c_str(), (unsigned long long)usage->rows, (long long)usage->bytes );
+         const char* separator = "";
+         for( const auto& [t, b] : usage->tables ) {
+            std::printf( "%s\"%s\":%lld", separator, t.c_str(), (long long)b );
+            separator = ",";
+         }
+         std::printf( "}}\n" );
+      }
+      std::printf( "{\"kind\":\"bytes_per_payer\",%s}\n", distribution_json( bytes ).c_str() );
+   }
+
+   /// lots per holder in the customers table, all of which slvrtoken pays for
+   void report_customers( native::chain& c ) {
+      std::map<uint64_t, uint64_t> lots;
+      c.run_as( slvr_account, [&] {
+         slvrtoken::customers customers( slvr_account, slvr_account.value );
+         for( const auto& cust : customers )
+            ++lots[cust.account_name.value];
+      } );
+
+      std::vector<uint64_t> per_holder;
+      for( const auto& l : lots )
+         per_holder.push_back( l.second );
+      std::printf( "{\"kind\":\"rows_per_account\",\"table\":\"%s:lots\",%s}\n",
+                   slvr_account.to_string().c_str(), distribution_json( per_holder ).c_str() );
+   }
+
+   void usage( const char* argv0 ) {
+      std::fprintf( stderr,
+         "usage: %s [options]\n"
+         "  --holders=N       accounts the workload spreads over, default 10000\n"
+         "  --actions=N       actions to run, default 100000\n"
+         "  --round-every=N   actions between issue rounds, default 5000\n"
+         "  --interval=N      actions between growth reports, default 1000\n"
+         "  --seed=N          workload seed, default 1\n"
+         "  --top=N           scopes and payers listed, default 10\n", argv0 );
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opt;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      auto value = [&]( const char* prefix ) { return option( arg, prefix ); };
+      if( auto v = value( "--holders=" ) )          opt.holders = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--actions=" ) )     opt.actions = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--round-every=" ) ) opt.round_every = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--interval=" ) )    opt.interval = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--seed=" ) )        opt.seed = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--top=" ) )         opt.top = std::strtoull( v, nullptr, 10 );
+      else {
+         usage( argv[0] );
+         return arg == "--help" ? 0 : 2;
+      }
+   }
+   if( opt.holders < 2 || opt.round_every < 2 || opt.interval == 0 ) {
+      usage( argv[0] );
+      return 2;
+   }
+
+   native::chain c;
+   workload w( c, opt );
+
+   std::map<std::string, std::pair<uint64_t, uint64_t>> mix; ///< runs and failures per action
+   int64_t previous = 0;
+   for( uint64_t i = 0; i < opt.actions; ++i ) {
+      uint64_t failed = w.failed();
+      auto& m = mix[ w.step(i) ];
+      ++m.first;
+      m.second += w.failed() - failed;
+      if( ( i + 1 ) % opt.interval == 0 ) {
+         auto charges = c.ram_charges();
+         int64_t bytes = 0;
+         for( const auto& ch : charges )
+            bytes += ch.bytes;
+         report_growth( i + 1, bytes, previous, opt.interval, bytes_per_table( charges ) );
+         previous = bytes;
+      }
+   }
+
+   auto charges = c.ram_charges();
+   report_tables( charges, opt.top );
+   report_payers( charges, opt.top );
+   report_customers( c );
+
+   int64_t accounted = 0, billed = 0;
+   for( const auto& ch : charges )
+      accounted += ch.bytes;
+   for( const auto& r : c.ram_usage() )
+      billed += r.second;
+
+   std::printf( "{\"kind\":\"summary\",\"actions\":%llu,\"failed\":%llu,\"ram_bytes\":%lld,\"accounted_bytes\":%lld,\"mix\":{",
+                (unsigned long long)opt.actions, (unsigned long long)w.failed(), (long long)billed, (long long)accounted );
+   const char* separator = "";
+   for( const auto& [action, m] : mix ) {
+      std::printf( "%s\"%s\":{\"runs\":%llu,\"failed\":%llu}", separator, action.c_str(),
+                   (unsigned long long)m.first, (unsigned long long)m.second );
+      separator = ",";
+   }
+   std::printf( "},\"peak_rss_kb\":%ld}\n", peak_rss_kb() );
+   return accounted == billed ? 0 : 1;
+}
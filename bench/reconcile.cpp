@@ -0,0 +1,532 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Checks the ledger invariants of a table dump (see table_dump.hpp), as is done after
+ *  every contract upgrade:
+ *
+ *     supply      per token, the accounts balances sum to the stats supply
+ *     rounds      per issue round, the lots sum to the round's supply.  While a round
+ *                 is neither transfer nor redeem locked the contract purges its lots as
+ *                 their holders move tokens, and a lock wave can lock it again after;
+ *                 a dump does not tell whether that happened, so lots that fall short
+ *                 are reported as possibly purged, a warning rather than a failure
+ *     coupling    ampr's coupled_assets, over all storages, sum to the token_balance
+ *                 of all holders; legacy 128 bit rows are counted with the others
+ *
+ *  The dump is read once into flat columns of amounts, one per token, round and ampr
+ *  table, so that every sum is of a plain array.  The columns are then summed in blocks
+ *  on all cores, with the compiler's vector extensions, which become whatever SIMD the
+ *  target has.  Each amount is summed as its high and low 32 bits, which cannot
+ *  overflow within a block, so the totals are exact 128 bit sums whatever the amounts.
+ *
+ *  A token, round or side of the coupling whose total is off is pinned down to its
+ *  first row that cannot be right: a negative amount, or the row at which its running
+ *  total first passes what it should come to.  When the total falls short, no row is
+ *  to blame and the shortfall is reported instead.  The report is JSON lines, one per
+ *  invariant checked, then a summary; the exit status is 1 if any invariant fails, and
+ *  warnings alone leave it 0.
+ */
+#include "../ampr_contract/ampr.hpp"
+#include "../custom_token/drtoken/drtoken.hpp"
+#include "../custom_token/slvrtoken/slvrtoken.hpp"
+#include "bench_util.hpp"
+#include "json_line.hpp"
+#include "table_dump.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace bench;
+
+namespace {
+
+   typedef ampersand::slvrtoken slvrtoken;
+   typedef ampersand::drtoken drtoken;
+   typedef __int128 int128;
+
+   typedef int64_t i64x2 __attribute__(( vector_size(16) ));
+
+   /// rows per block; a block's 32 bit halves cannot overflow 64 bit sums
+   constexpr size_t block_rows = 1 << 16;
+
+   struct options {
+      std::string dump;
+      name slvr = name("ampervstoken");
+      name dr = name("amperdrtoken");
+      name ampr;                ///< the ampr contract; any code's ampr tables if unset
+      unsigned threads = std::thread::hardware_concurrency();
+      bool scalar = false;
+   };
+
+   /// the split sums of some rows, whose total is ( hi << 32 ) + lo
+   struct split_sum {
+      int64_t lo = 0;
+      int64_t hi = 0;
+
+      int128 total()const { return ( int128(hi) << 32 ) + lo; }
+   };
+
+   /// a flat column of amounts in dump order, with the sum of each block
+   struct column {
+      std::vector<int64_t> amounts;
+      int64_t first_negative = -1;
+      std::vector<split_sum> block_sums;
+
+      void add( int64_t amount ) {
+         if( amount < 0 && first_negative < 0 )
+            first_negative = amounts.size();
+         amounts.push_back( amount );
+      }
+
+      size_t blocks()const { return ( amounts.size() + block_rows - 1 ) / block_rows; }
+
+      int128 total()const {
+         int128 sum = 0;
+         for( const auto& b : block_sums )
+            sum += b.total();
+         return sum;
+      }
+   };
+
+   // ---- kernels ----------------------------------------------------------------
+
+   /// sums rows two vectors at a time, which keeps two adds in flight on 2 lane SIMD
+   split_sum sum_vector( const int64_t* a, size_t n ) {
+      const i64x2 low_mask = { 0xffffffff, 0xffffffff };
+      i64x2 lo0 = {}, hi0 = {}, lo1 = {}, hi1 = {};
+      size_t i = 0;
+      for( ; i + 4 <= n; i += 4 ) {
+         i64x2 v0, v1;
+         std::memcpy( &v0, a + i, sizeof(v0) );
+         std::memcpy( &v1, a + i + 2, sizeof(v1) );
+         lo0 += v0 & low_mask;
+         hi0 += v0 >> 32;
+         lo1 += v1 & low_mask;
+         hi1 += v1 >> 32;
+      }
+      lo0 += lo1;
+      hi0 += hi1;
+      split_sum out{ lo0[0] + lo0[1], hi0[0] + hi0[1] };
+      for( ; i < n; ++i ) {
+         out.lo += a[i] & 0xffffffff;
+         out.hi += a[i] >> 32;
+      }
+      return out;
+   }
+
+   /// sums rows one at a time, as the reference
+   split_sum sum_scalar( const int64_t* a, size_t n ) {
+      split_sum out;
+      for( size_t i = 0; i < n; ++i ) {
+         out.lo += a[i] & 0xffffffff;
+         out.hi += a[i] >> 32;
+      }
+      return out;
+   }
+
+   /// fills the block sums of the columns, spreading the blocks of all of them over the threads
+   void sum_blocks( const std::vector<column*>& columns, unsigned threads, bool scalar ) {
+      std::vector<std::pair<column*, size_t>> work;
+      for( auto* c : columns ) {
+         c->block_sums.assign( c->blocks(), split_sum() );
+         for( size_t b = 0; b < c->blocks(); ++b )
+            work.emplace_back( c, b );
+      }
+
+      auto run = [&]( unsigned t ) {
+         for( size_t w = t; w < work.size(); w += threads ) {
+            auto [c, b] = work[w];
+            size_t begin = b * block_rows, n = std::min( c->amounts.size() - begin, block_rows );
+            const int64_t* a = c->amounts.data() + begin;
+            c->block_sums[b] = scalar ? sum_scalar( a, n ) : sum_vector( a, n );
+         }
+      };
+
+      threads = std::max( 1u, std::min<unsigned>( threads, work.size() ) );
+      std::vector<std::thread> pool;
+      for( unsigned t = 1; t < threads; ++t )
+         pool.emplace_back( run, t );
+      run( 0 );
+      for( auto& t : pool )
+         t.join();
+   }
+
+   /**
+    * The first row of a column that cannot be right when its total should be expected:
+    * its first negative amount, or else the row at which its running total first
+    * passes expected.  -1 if there is none, as when the total falls short.
+    */
+   int64_t first_mismatch( const column& c, int128 expected ) {
+      if( c.first_negative >= 0 )
+         return c.first_negative;
+      int128 running = 0;
+      for( size_t b = 0; b < c.blocks(); ++b ) {
+         int128 block = c.block_sums[b].total();
+         if( running + block <= expected ) {
+            running += block;
+            continue;
+         }
+         size_t end = std::min( c.amounts.size(), ( b + 1 ) * block_rows );
+         for( size_t i = b * block_rows; i < end; ++i ) {
+            running += c.amounts[i];
+            if( running > expected )
+               return i;
+         }
+      }
+      return -1;
+   }
+
+   std::string to_string( int128 v ) {
+      bool negative = v < 0;
+      unsigned __int128 u = negative ? -(unsigned __int128)(v) : (unsigned __int128)(v);
+      std::string s;
+      do {
+         s += char( '0' + int( u % 10 ) );
+         u /= 10;
+      } while( u );
+      if( negative )
+         s += '-';
+      return std::string( s.rbegin(), s.rend() );
+   }
+
+   /// units of a symbol as "amount SYMBOL", e.g. "12.5000 SLVR", or bare units without one
+   std::string format( int128 units, eosio::symbol sym ) {
+      if( !sym.raw() )
+         return to_string( units );
+      std::string digits = to_string( units < 0 ? -units : units );
+      size_t p = sym.precision();
+      if( digits.size() <= p )
+         digits.insert( 0, p + 1 - digits.size(), '0' );
+      if( p )
+         digits.insert( digits.size() - p, "." );
+      return ( units < 0 ? "-" : "" ) + digits + " " + sym.code().to_string();
+   }
+
+   // ---- loading ----------------------------------------------------------------
+
+   enum class source { none, accounts, customers, holders, storages };
+
+   struct token {
+      name contract;
+      eosio::symbol sym{};
+      int64_t supply = 0;
+      bool has_stats = false;
+      column balances{};
+   };
+
+   struct issue_round {
+      uint64_t round = 0;
+      eosio::symbol sym{};
+      int64_t supply = 0;
+      bool has_issue = false;
+      bool locked = false;       ///< transfer or redeem locked in the dump, not necessarily all along
+      column lots{};
+   };
+
+   struct ledger {
+      const options& opt;
+      std::vector<token> tokens;
+      std::vector<issue_round> rounds;
+      column holders, storages;
+      std::map<std::pair<uint64_t, uint64_t>, size_t> token_index;
+      std::map<uint64_t, size_t> round_index;
+      std::vector<std::pair<uint64_t, int128>> legacy_too_large; ///< owner, value
+      uint64_t rows = 0;
+
+      explicit ledger( const options& o ) : opt(o) {}
+
+      source classify( const dump_table& t )const {
+         bool slvr = t.code == opt.slvr, dr = t.code == opt.dr;
+         bool ampr = opt.ampr == name() || t.code == opt.ampr;
+         if( t.table == name("accounts") && ( slvr || dr ) )    return source::accounts;
+         if( t.table == name("lots") && slvr )             return source::customers;
+         if( ( t.table == name("holders") || t.table == name("holderdata") ) && ampr )     return source::holders;
+         if( ( t.table == name("storages") || t.table == name("storagedata") ) && ampr )   return source::storages;
+         return source::none;
+      }
+
+      token& token_of( name contract, eosio::symbol sym ) {
+         auto key = std::make_pair( contract.value, sym.raw() );
+         auto found = token_index.find( key );
+         if( found != token_index.end() )
+            return tokens[found->second];
+         token_index.emplace( key, tokens.size() );
+         tokens.push_back( { contract, sym } );
+         return tokens.back();
+      }
+
+      issue_round& round_of( uint64_t n ) {
+         auto found = round_index.find( n );
+         if( found != round_index.end() )
+            return rounds[found->second];
+         round_index.emplace( n, rounds.size() );
+         rounds.push_back( { n } );
+         return rounds.back();
+      }
+
+      std::vector<column*> columns() {
+         std::vector<column*> all{ &holders, &storages };
+         for( auto& tk : tokens )
+            all.push_back( &tk.balances );
+         for( auto& rd : rounds )
+            all.push_back( &rd.lots );
+         return all;
+      }
+
+      /// a legacy ampr amount, which should fit in 64 bits as the migration requires
+      int64_t legacy( uint64_t owner, uint128_t v ) {
+         if( v > uint128_t( INT64_MAX ) ) {
+            legacy_too_large.emplace_back( owner, int128(v) );
+            return -1;
+         }
+         return int64_t(v);
+      }
+
+      void load( table_dump_reader& dump ) {
+         dump_table t;
+         dump_row r;
+         issue_round* last = nullptr;
+         while( dump.next_table(t) ) {
+            bool slvr = t.code == opt.slvr, dr = t.code == opt.dr;
+            auto src = classify(t);
+            while( dump.next_row(r) ) {
+               ++rows;
+               switch( src ) {
+               case source::accounts: {
+                  auto b = slvr ? r.as<slvrtoken::account>().balance : r.as<drtoken::account>().balance;
+                  token_of( t.code, b.symbol ).balances.add( b.amount );
+                  break;
+               }
+               case source::customers: {
+                  auto c = r.as<slvrtoken::custinfo>();
+                  if( !last || last->round != c.issue_round )
+                     last = &round_of( c.issue_round );
+                  last->lots.add( c.issue_balance );
+                  break;
+               }
+               case source::holders:
+                  if( t.table == name("holders") ) {
+                     holders.add( int64_t( r.as<ampr::holderdata>().token_balance ) );
+                  }
+                  else {
+                     auto h = r.as<ampr::holderdata_v1>();
+                     holders.add( legacy( h.owner, h.token_balance ) );
+                  }
+                  break;
+               case source::storages:
+                  if( t.table == name("storages") ) {
+                     storages.add( int64_t( r.as<ampr::storagedata>().coupled_assets ) );
+                  }
+                  else {
+                     auto s = r.as<ampr::storagedata_v1>();
+                     storages.add( legacy( s.owner, s.coupled_assets ) );
+                  }
+                  break;
+               case source::none:
+                  if( t.table == name("supplies") && ( slvr || dr ) ) {
+                     auto supply = slvr ? r.as<slvrtoken::currency_stats>().supply : r.as<drtoken::currency_stats>().supply;
+                     auto& tk = token_of( t.code, supply.symbol );
+                     tk.supply = supply.amount;
+                     tk.has_stats = true;
+                  }
+                  else if( t.table == name("rounds") && slvr ) {
+                     auto is = r.as<slvrtoken::issuestats>();
+                     auto& rd = round_of( is.round );
+                     last = nullptr;
+                     rd.sym = is.supply.symbol;
+                     rd.supply = is.supply.amount;
+                     rd.has_issue = true;
+                     rd.locked = is.transfer_locked || is.redeem_locked;
+                  }
+                  break;
+               }
+            }
+         }
+      }
+
+      /// the column a row of a source table was loaded into
+      const column* column_of( source src, const dump_table& t, const dump_row& r )const {
+         if( src == source::holders )
+            return &holders;
+         if( src == source::storages )
+            return &storages;
+         if( src == source::accounts ) {
+            auto b = t.code == opt.slvr ? r.as<slvrtoken::account>().balance : r.as<drtoken::account>().balance;
+            return &tokens[token_index.at( std::make_pair( t.code.value, b.symbol.raw() ) )].balances;
+         }
+         return &rounds[round_index.at( r.as<slvrtoken::custinfo>().issue_round )].lots;
+      }
+
+      /// the table and row of the index-th row of a column, walking the dump again
+      bool locate( table_dump_reader& dump, source src, const column& c, uint64_t index, dump_table& t, dump_row& r )const {
+         bool whole_tables = src == source::holders || src == source::storages;
+         dump.rewind();
+         while( dump.next_table(t) ) {
+            if( classify(t) != src )
+               continue;
+            if( whole_tables && index >= t.rows ) {
+               index -= t.rows;
+               continue;
+            }
+            while( dump.next_row(r) ) {
+               if( column_of( src, t, r ) == &c && index-- == 0 )
+                  return true;
+            }
+         }
+         return false;
+      }
+   };
+
+   void usage( const char* argv0 ) {
+      std::fprintf( stderr,
+         "usage: %s [options] DUMP\n"
+         "  --slvr=ACCOUNT     slvrtoken account, default ampervstoken\n"
+         "  --dr=ACCOUNT       drtoken account, default amperdrtoken\n"
+         "  --ampr=ACCOUNT     ampr account, default any account with ampr tables\n"
+         "  --threads=N        threads summing, default one per core\n"
+         "  --scalar           sum one row at a time, for comparison with the vector kernels\n",
+         argv0 );
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opt;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( auto v = option( arg, "--slvr=" ) )          opt.slvr = name(v);
+      else if( auto v = option( arg, "--dr=" ) )       opt.dr = name(v);
+      else if( auto v = option( arg, "--ampr=" ) )     opt.ampr = name(v);
+      else if( auto v = option( arg, "--threads=" ) )  opt.threads = std::strtoul( v, nullptr, 10 );
+      else if( arg == "--scalar" )                     opt.scalar = true;
+      else if( arg.compare( 0, 2, "--" ) != 0 && opt.dump.empty() ) opt.dump = arg;
+      else {
+         usage( argv[0] );
+         return arg == "--help" ? 0 : 2;
+      }
+   }
+   if( opt.dump.empty() ) {
+      usage( argv[0] );
+      return 2;
+   }
+   if( opt.threads == 0 )
+      opt.threads = 1;
+
+   json_line out;
+   uint64_t failed = 0, warnings = 0, checked = 0;
+   try {
+      uint64_t start = now_ns();
+      table_dump_reader dump( opt.dump );
+      ledger l( opt );
+      l.load( dump );
+      uint64_t load_ns = now_ns() - start;
+
+      auto columns = l.columns();
+      start = now_ns();
+      sum_blocks( columns, opt.threads, opt.scalar );
+      uint64_t sum_ns = now_ns() - start;
+
+      // the first row to blame in a column, with where it is in the dump
+      auto blame = [&]( source src, const column& c, int128 expected, eosio::symbol sym ) {
+         int64_t row = first_mismatch( c, expected );
+         dump_table t;
+         dump_row r;
+         if( row < 0 || !l.locate( dump, src, c, row, t, r ) )
+            return;
+         out.num( "first_mismatch_row", row ).str( "first_mismatch_table", t.table.to_string() )
+            .str( "first_mismatch_scope", t.scope.to_string() ).num( "first_mismatch_key", r.primary )
+            .str( "first_mismatch_payer", r.payer.to_string() );
+         if( src == source::customers )
+            out.str( "first_mismatch_holder", r.as<slvrtoken::custinfo>().account_name.to_string() );
+         else if( src == source::holders || src == source::storages )
+            out.str( "first_mismatch_owner", name( r.primary ).to_string() );
+         out.str( "first_mismatch_amount", format( c.amounts[row], sym ) );
+      };
+
+      for( const auto& tk : l.tokens ) {
+         int128 actual = tk.balances.total();
+         bool ok = tk.has_stats && actual == tk.supply && tk.balances.first_negative < 0;
+         out.begin( "invariant" );
+         out.str( "invariant", "supply" ).str( "contract", tk.contract.to_string() )
+            .str( "expected", format( tk.supply, tk.sym ) ).str( "actual", format( actual, tk.sym ) )
+            .flag( "has_stats", tk.has_stats ).flag( "ok", ok );
+         if( !ok ) {
+            if( actual < tk.supply && tk.balances.first_negative < 0 )
+               out.str( "short_by", format( tk.supply - actual, tk.sym ) );
+            blame( source::accounts, tk.balances, tk.supply, tk.sym );
+         }
+         out.end();
+         ++checked;
+         failed += !ok;
+      }
+
+      for( const auto& rd : l.rounds ) {
+         int128 actual = rd.lots.total();
+         // a shortfall may be lots purged while the round was unlocked, whatever its locks now
+         bool purged = rd.has_issue && actual < rd.supply;
+         bool ok = rd.has_issue && ( actual == rd.supply || purged ) && rd.lots.first_negative < 0;
+         out.begin( "invariant" );
+         out.str( "invariant", "rounds" ).num( "round", rd.round )
+            .str( "expected", format( rd.supply, rd.sym ) ).str( "actual", format( actual, rd.sym ) )
+            .flag( "has_issue", rd.has_issue ).flag( "locked", rd.locked ).flag( "ok", ok );
+         if( ok && purged ) {
+            out.str( "warning", "possibly_purged" ).str( "purged", format( rd.supply - actual, rd.sym ) );
+            ++warnings;
+         }
+         if( !ok ) {
+            if( actual < rd.supply && rd.lots.first_negative < 0 )
+               out.str( "short_by", format( rd.supply - actual, rd.sym ) );
+            blame( source::customers, rd.lots, rd.supply, rd.sym );
+         }
+         out.end();
+         ++checked;
+         failed += !ok;
+      }
+
+      if( !l.holders.amounts.empty() || !l.storages.amounts.empty() ) {
+         int128 coupled = l.storages.total(), tokens = l.holders.total();
+         bool ok = coupled == tokens && l.holders.first_negative < 0 && l.storages.first_negative < 0;
+         out.begin( "invariant" );
+         out.str( "invariant", "coupling" ).str( "coupled_assets", to_string( coupled ) )
+            .str( "token_balance", to_string( tokens ) ).num( "storages", l.storages.amounts.size() )
+            .num( "holders", l.holders.amounts.size() ).flag( "ok", ok );
+         // the side that comes to more holds the row to blame
+         if( !ok && ( l.storages.first_negative >= 0 || ( l.holders.first_negative < 0 && coupled > tokens ) ) )
+            blame( source::storages, l.storages, tokens, eosio::symbol() );
+         else if( !ok )
+            blame( source::holders, l.holders, coupled, eosio::symbol() );
+         out.end();
+         ++checked;
+         failed += !ok;
+
+         for( const auto& [owner, v] : l.legacy_too_large ) {
+            out.begin( "legacy_overflow" );
+            out.str( "owner", name(owner).to_string() ).str( "amount", to_string(v) ).end();
+         }
+      }
+
+      uint64_t summed = 0;
+      for( auto* c : columns )
+         summed += c->amounts.size();
+      out.begin( "summary" );
+      out.str( "dump", opt.dump ).num( "bytes", dump.size() ).num( "rows", l.rows ).num( "summed_rows", summed )
+         .num( "invariants", checked ).num( "failed", failed ).num( "warnings", warnings ).num( "threads", opt.threads )
+         .str( "kernel", opt.scalar ? "scalar" : "vector" ).num( "load_us", load_ns / 1000 )
+         .num( "sum_us", sum_ns / 1000 ).num( "sum_rows_per_sec", sum_ns ? uint64_t( summed * 1e9 / sum_ns ) : 0 )
+         .num( "peak_rss_kb", peak_rss_kb() );
+      out.end();
+      out.flush();
+   } catch( const std::exception& e ) {
+      out.flush();
+      std::fflush( stdout );
+      std::fprintf( stderr, "%s\n", e.what() );
+      return 2;
+   }
+   return failed ? 1 : 0;
+}
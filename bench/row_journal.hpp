@@ -0,0 +1,316 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Append-only journals of the rows a chain's transactions change, as kept by
+ *  ledger_indexer so it can restart where it stopped.
+ *
+ *  A journal is the 8 byte magic "AMPJOURN", a little endian uint32 version, then
+ *  records, each a kind byte and its fields, all little endian:
+ *
+ *     row       uint64 code, scope, table, primary key, payer, uint32 size, data;
+ *               a size of 0xffffffff marks a removed row, with no data
+ *     account   uint64 account, uint32 size, the contract type name bound to it,
+ *               empty for an account without code
+ *     commit    uint64 trace offset, chain time, actions, checksum
+ *
+ *  A commit makes the records since the one before it part of the state, with the
+ *  trace read up to the offset.  Its checksum is the 64 bit FNV-1a hash of the bytes
+ *  from the end of the previous commit up to the checksum.  The file is mapped and
+ *  grown ahead of the records, so the journal ends at a zero kind byte; on recovery
+ *  whatever follows the last commit that checks out is discarded.
+ */
+#pragma once
+
+#include <native/chain.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace bench {
+
+   constexpr char journal_magic[8] = { 'A', 'M', 'P', 'J', 'O', 'U', 'R', 'N' };
+   constexpr uint32_t journal_version = 1;
+   constexpr size_t journal_header_size = sizeof(journal_magic) + sizeof(uint32_t);
+
+   /// the position of a journal's state in the trace it was built from
+   struct journal_commit {
+      uint64_t trace_offset = 0;
+      uint64_t time = 0;         ///< the chain clock
+      uint64_t actions = 0;      ///< trace actions applied
+   };
+
+   /**
+    * A journal in a shared, writable mapping.  Records are copied into the mapping, so
+    * they survive the process once written; with sync, each commit is also flushed to
+    * the disk before it returns.  recover must be called once, before the first write.
+    */
+   class row_journal {
+   public:
+      static constexpr uint64_t grow_by = 64 << 20;
+
+      enum kind_t : uint8_t { end = 0, row = 1, account = 2, commit = 3 };
+
+      row_journal( const std::string& path, bool sync ) : _path(path), _sync(sync) {
+         _fd = ::open( path.c_str(), O_RDWR | O_CREAT, 0644 );
+         if( _fd < 0 )
+            throw std::runtime_error( "cannot open " + path );
+         struct stat st;
+         if( ::fstat( _fd, &st ) != 0 ) {
+            ::close( _fd );
+            throw std::runtime_error( "cannot stat " + path );
+         }
+         try {
+            bool created = st.st_size == 0;
+            map( created ? grow_by : st.st_size );
+            if( created ) {
+               std::memcpy( _data, journal_magic, sizeof(journal_magic) );
+               put_fixed( sizeof(journal_magic), journal_version, 4 );
+            }
+            else if( st.st_size < off_t( journal_header_size )
+                     || std::memcmp( _data, journal_magic, sizeof(journal_magic) ) != 0
+                     || get( sizeof(journal_magic), 4 ) != journal_version ) {
+               throw std::runtime_error( path + " is not a row journal" );
+            }
+         } catch( ... ) {
+            unmap();
+            ::close( _fd );
+            throw;
+         }
+         _pos = journal_header_size;
+      }
+
+      ~row_journal() {
+         unmap();
+         ::close( _fd );
+      }
+
+      row_journal( const row_journal& ) = delete;
+      row_journal& operator=( const row_journal& ) = delete;
+
+      /**
+       * Replays the committed records, calling on_row( table_id, primary, const row* )
+       * and on_account( name, type ), discards what follows the last commit and returns
+       * it, or a zero commit for an empty journal.
+       */
+      template<typename OnRow, typename OnAccount>
+      journal_commit recover( OnRow&& on_row, OnAccount&& on_account ) {
+         // find the last commit that checks out; a torn tail is left behind it
+         journal_commit last;
+         uint64_t pos = journal_header_size, last_end = pos, stop = pos;
+         uint64_t hash = fnv_basis;
+         for( ;; ) {
+            uint64_t start = pos;
+            uint8_t kind;
+            if( !skip( pos, kind ) )
+               break;
+            if( kind == commit ) {
+               hash = fnv( hash, _data + start, pos - start - 8 );
+               if( hash != get( pos - 8, 8 ) )
+                  break;
+               last = { get( start + 1, 8 ), get( start + 9, 8 ), get( start + 17, 8 ) };
+               last_end = pos;
+               hash = fnv_basis;
+            }
+            else {
+               hash = fnv( hash, _data + start, pos - start );
+            }
+            stop = pos;
+         }
+
+         native::row r;
+         for( pos = journal_header_size; pos < last_end; ) {
+            uint8_t kind = _data[pos];
+            if( kind == row ) {
+               native::table_id id{ get( pos + 1, 8 ), get( pos + 9, 8 ), get( pos + 17, 8 ) };
+               uint64_t primary = get( pos + 25, 8 );
+               r.payer = get( pos + 33, 8 );
+               uint32_t size = get( pos + 41, 4 );
+               pos += row_header_size;
+               if( size == removed ) {
+                  on_row( id, primary, nullptr );
+                  continue;
+               }
+               r.data.assign( _data + pos, _data + pos + size );
+               pos += size;
+               on_row( id, primary, &r );
+            }
+            else if( kind == account ) {
+               eosio::name a( get( pos + 1, 8 ) );
+               uint32_t size = get( pos + 9, 4 );
+               on_account( a, std::string( _data + pos + 13, size ) );
+               pos += 13 + size;
+            }
+            else {
+               pos += commit_size;
+            }
+         }
+
+         std::memset( _data + last_end, 0, std::max( stop, last_end + 1 ) - last_end );
+         _pos = _synced = last_end;
+         _hash = fnv_basis;
+         _recovered = true;
+         return last;
+      }
+
+      /// adds a row as it now stands, or its removal if r is null
+      void add_row( const native::table_id& id, uint64_t primary, const native::row* r ) {
+         uint64_t size = r ? r->data.size() : 0;
+         uint64_t at = reserve( row_header_size + size );
+         _data[at] = char( row );
+         put_fixed( at + 1, id.code, 8 );
+         put_fixed( at + 9, id.scope, 8 );
+         put_fixed( at + 17, id.table, 8 );
+         put_fixed( at + 25, primary, 8 );
+         put_fixed( at + 33, r ? r->payer : 0, 8 );
+         put_fixed( at + 41, r ? uint32_t( size ) : removed, 4 );
+         if( size )
+            std::memcpy( _data + at + row_header_size, r->data.data(), size );
+         written( at, row_header_size + size );
+      }
+
+      /// adds an account, and the contract type bound to it if any
+      void add_account( eosio::name a, const std::string& type ) {
+         uint64_t at = reserve( 13 + type.size() );
+         _data[at] = char( account );
+         put_fixed( at + 1, a.value, 8 );
+         put_fixed( at + 9, type.size(), 4 );
+         std::memcpy( _data + at + 13, type.data(), type.size() );
+         written( at, 13 + type.size() );
+      }
+
+      /// commits the records added since the last commit
+      void add_commit( const journal_commit& c ) {
+         uint64_t at = reserve( commit_size );
+         _data[at] = char( commit );
+         put_fixed( at + 1, c.trace_offset, 8 );
+         put_fixed( at + 9, c.time, 8 );
+         put_fixed( at + 17, c.actions, 8 );
+         _hash = fnv( _hash, _data + at, 25 );
+         put_fixed( at + 25, _hash, 8 );
+         _pos = at + commit_size;
+         _hash = fnv_basis;
+
+         if( _sync ) {
+            uint64_t page = ::sysconf( _SC_PAGESIZE );
+            uint64_t from = _synced / page * page;
+            if( ::msync( _data + from, _pos - from, MS_SYNC ) != 0 )
+               throw std::runtime_error( "cannot sync " + _path );
+            _synced = _pos;
+         }
+      }
+
+      /// bytes in use, up to the end of the last record
+      uint64_t size()const { return _pos; }
+      uint64_t capacity()const { return _capacity; }
+
+   private:
+      static constexpr uint32_t removed = 0xffffffff;
+      static constexpr size_t row_header_size = 1 + 5 * 8 + 4;
+      static constexpr size_t commit_size = 1 + 4 * 8;
+      static constexpr uint64_t fnv_basis = 0xcbf29ce484222325ull;
+
+      static uint64_t fnv( uint64_t hash, const char* p, uint64_t size ) {
+         for( uint64_t i = 0; i < size; ++i ) {
+            hash ^= uint8_t( p[i] );
+            hash *= 0x100000001b3ull;
+         }
+         return hash;
+      }
+
+      /// moves pos past a complete record whose kind is not end; false if there is none
+      bool skip( uint64_t& pos, uint8_t& kind )const {
+         if( pos >= _capacity )
+            return false;
+         kind = _data[pos];
+         uint64_t size;
+         switch( kind ) {
+         case row:
+            if( _capacity - pos < row_header_size )
+               return false;
+            size = get( pos + 41, 4 );
+            size = row_header_size + ( size == removed ? 0 : size );
+            break;
+         case account:
+            if( _capacity - pos < 13 )
+               return false;
+            size = 13 + get( pos + 9, 4 );
+            break;
+         case commit:
+            size = commit_size;
+            break;
+         default:
+            return false;
+         }
+         if( _capacity - pos < size )
+            return false;
+         pos += size;
+         return true;
+      }
+
+      /// makes room for a record of size bytes and the end byte after it, returns where it goes
+      uint64_t reserve( uint64_t size ) {
+         if( !_recovered )
+            throw std::runtime_error( _path + " is written before it is recovered" );
+         if( _capacity - _pos <= size ) {
+            uint64_t capacity = _capacity + std::max<uint64_t>( grow_by, size + 1 );
+            unmap();
+            map( capacity );
+         }
+         return _pos;
+      }
+
+      void written( uint64_t at, uint64_t size ) {
+         _hash = fnv( _hash, _data + at, size );
+         _pos = at + size;
+      }
+
+      void map( uint64_t capacity ) {
+         struct stat st;
+         if( ::fstat( _fd, &st ) != 0 || ( uint64_t( st.st_size ) < capacity && ::ftruncate( _fd, capacity ) != 0 ) )
+            throw std::runtime_error( "cannot grow " + _path );
+         void* p = ::mmap( nullptr, capacity, PROT_READ | PROT_WRITE, MAP_SHARED, _fd, 0 );
+         if( p == MAP_FAILED )
+            throw std::runtime_error( "cannot map " + _path );
+         _data = static_cast<char*>(p);
+         _capacity = capacity;
+      }
+
+      void unmap() {
+         if( _data )
+            ::munmap( _data, _capacity );
+         _data = nullptr;
+      }
+
+      uint64_t get( uint64_t at, int bytes )const {
+         uint64_t v = 0;
+         for( int i = 0; i < bytes; ++i )
+            v |= uint64_t( uint8_t( _data[at + i] ) ) << ( 8 * i );
+         return v;
+      }
+
+      void put_fixed( uint64_t at, uint64_t v, int bytes ) {
+         for( int i = 0; i < bytes; ++i )
+            _data[at + i] = char( v >> ( 8 * i ) );
+      }
+
+      std::string _path;
+      bool _sync;
+      int _fd = -1;
+      char* _data = nullptr;
+      uint64_t _capacity = 0;
+      uint64_t _pos = 0;
+      uint64_t _synced = 0;
+      uint64_t _hash = fnv_basis;
+      bool _recovered = false;
+   };
+
+} /// namespace bench
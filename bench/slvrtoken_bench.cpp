@@ -0,0 +1,329 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Scaling benchmark of the slvrtoken contract on the in-memory chain.
+ *
+ *  Sweeps the number of customer rows, the number of issue rounds and the number of
+ *  lots (customer rows) per holder, and for each point times the contract's actions.
+ *  Every point runs in its own process, so its peak memory is its own.  One JSON
+ *  object is written per line:
+ *
+ *     {"customers":..,"rounds":..,"lots":..,"holders":..,"action":"transfer","ops":..,
+ *      "failed":..,"wall_ns":{"min":..,"p50":..,"p90":..,"max":..,"mean":..},
+ *      "db_calls_per_op":..,"ram_bytes":..,"peak_rss_kb":..}
+ *
+ *  db_calls_per_op is only reported when eosio_native is built with NATIVE_DB_STATS.
+ *
+ *  The "setup" line reports the seeding of the point.  Odd rounds (counting from 0)
+ *  are transfer and redeem locked.  Points where rounds * customers exceeds the work
+ *  limit are skipped unless --full is given; the actions scan the customers table once
+ *  per round, so such points take minutes per action.
+ */
+#include <native/chain.hpp>
+
+#include "../custom_token/slvrtoken/slvrtoken.hpp"
+#include "bench_util.hpp"
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+using ampersand::slvrtoken;
+using namespace bench;
+
+namespace {
+
+   const name slvr_account   = name("ampervstoken");
+   const name dr_account     = name("amperdrtoken");
+   const name issuer_account = name("amprissuer");
+   const symbol slvr_symbol  = symbol("SLVR", 4);
+
+   /// amount held in each lot
+   const int64_t lot_amount = 1000000;
+   /// rows written per seeding transaction, bounding the undo log
+   const uint64_t seed_chunk = 20000;
+
+   struct options {
+      std::vector<uint64_t> customers = { 1000, 10000, 100000, 1000000 };
+      std::vector<uint64_t> rounds = { 1, 10, 100, 500 };
+      std::vector<uint64_t> lots = { 1, 4, 16 };
+      std::vector<std::string> actions = { "transfer", "issue", "redeem", "burn",
+                                           "lock", "redeemlock", "tokenlock" };
+      uint32_t max_ops = 200;
+      uint64_t budget_ms = 2000;
+      uint64_t work_limit = 50000000;
+      bool full = false;
+   };
+
+   struct point {
+      uint64_t customers;
+      uint64_t rounds;
+      uint64_t lots;
+      uint64_t holders;
+   };
+
+   /// the issue round of a holder's lot; rounds are numbered from 1
+   uint64_t lot_round( const point& p, uint64_t h, uint64_t l ) {
+      return 1 + ( h + l ) % p.rounds;
+   }
+
+   bool locked_round( uint64_t round ) {
+      return ( round - 1 ) % 2 == 1;
+   }
+
+   /// the i-th holder whose first lot is in an unlocked round, so it can transfer and redeem
+   uint64_t free_holder( const point& p, uint64_t i ) {
+      uint64_t unlocked_per_cycle = ( p.rounds + 1 ) / 2;
+      uint64_t cycles = p.holders / p.rounds;
+      uint64_t available = cycles * unlocked_per_cycle
+                         + ( p.holders % p.rounds + 1 ) / 2;
+      i %= std::max<uint64_t>( available, 1 );
+      return ( i / unlocked_per_cycle ) * p.rounds + ( i % unlocked_per_cycle ) * 2;
+   }
+
+   void expect( const native::transaction_result& r, const char* what ) {
+      if( !r.succeeded ) {
+         std::fprintf( stderr, "%s failed: %s\n", what, r.error.c_str() );
+         std::exit( 1 );
+      }
+   }
+
+   std::string point_json( const point& p ) {
+      char buf[160];
+      std::snprintf( buf, sizeof(buf), "\"customers\":%llu,\"rounds\":%llu,\"lots\":%llu,\"holders\":%llu",
+                     (unsigned long long)p.customers, (unsigned long long)p.rounds,
+                     (unsigned long long)p.lots, (unsigned long long)p.holders );
+      return buf;
+   }
+
+   /// opens the rounds and seeds the holders' balances and lots directly into the tables
+   void setup( native::chain& c, const point& p ) {
+      c.set_code( slvr_account, "ampersand::slvrtoken" );
+      c.set_code( dr_account, "ampersand::drtoken" );
+      c.create_account( issuer_account );
+      for( uint64_t h = 0; h < p.holders; ++h )
+         c.create_account( holder(h) );
+
+      // the seeded lots plus room for the issue action
+      int64_t round_supply = int64_t( ( p.holders * p.lots / p.rounds + 1 ) * lot_amount * 2 );
+      for( uint64_t r = 1; r <= p.rounds; ++r ) {
+         expect( c.push_action( slvr_account, name("issueopen"), slvr_account,
+                                asset( 0, slvr_symbol ), issuer_account, r ), "issueopen" );
+         expect( c.push_action( slvr_account, name("create"), slvr_account,
+                                issuer_account, asset( round_supply, slvr_symbol ), uint16_t(1000), r,
+                                locked_round(r), locked_round(r), false ), "create" );
+      }
+
+      std::vector<int64_t> round_amount( p.rounds + 1, 0 );
+      for( uint64_t first = 0; first < p.holders; first += seed_chunk ) {
+         uint64_t last = std::min( p.holders, first + seed_chunk );
+         c.run_as( slvr_account, [&] {
+            slvrtoken::customers customers( slvr_account, slvr_account.value );
+            for( uint64_t h = first; h < last; ++h ) {
+               slvrtoken::accounts accounts( slvr_account, holder(h).value );
+               accounts.emplace( slvr_account, [&]( auto& a ) {
+                  a.balance = asset( lot_amount * int64_t(p.lots), slvr_symbol );
+               } );
+               for( uint64_t l = 0; l < p.lots; ++l ) {
+                  uint64_t r = lot_round( p, h, l );
+                  round_amount[r] += lot_amount;
+                  customers.emplace( slvr_account, [&]( auto& cust ) {
+                     cust.key = h * p.lots + l;
+                     cust.account_name = holder(h);
+                     cust.issue_round = r;
+                     cust.issue_balance = lot_amount;
+                  } );
+               }
+            }
+         } );
+      }
+
+      c.run_as( slvr_account, [&] {
+         slvrtoken::issues issues( slvr_account, slvr_account.value );
+         int64_t total = 0;
+         for( uint64_t r = 1; r <= p.rounds; ++r ) {
+            issues.modify( issues.get(r), same_payer, [&]( auto& i ) {
+               i.supply.amount += round_amount[r];
+            } );
+            total += round_amount[r];
+         }
+         slvrtoken::stats stats( slvr_account, slvr_symbol.raw() );
+         stats.modify( stats.get( slvr_symbol.raw() ), same_payer, [&]( auto& s ) {
+            s.supply.amount += total;
+         } );
+      } );
+   }
+
+   struct measurement {
+      std::vector<uint64_t> wall_ns;
+      uint32_t failed = 0;
+      uint64_t db_calls = 0;
+   };
+
+   /**
+    * Runs op( i ) until max_ops ops or the time budget is spent, at least once.  An op
+    * is one or more transactions; it returns false if one of them failed.
+    */
+   measurement measure( native::chain& c, const options& opt,
+                        const std::function<bool( uint64_t )>& op ) {
+      measurement m;
+      uint64_t start = now_ns();
+      uint64_t calls = db_calls(c);
+      for( uint64_t i = 0; i < opt.max_ops; ++i ) {
+         uint64_t t0 = now_ns();
+         if( !op(i) )
+            ++m.failed;
+         uint64_t t1 = now_ns();
+         m.wall_ns.push_back( t1 - t0 );
+         if( t1 - start >= opt.budget_ms * 1000000 )
+            break;
+      }
+      m.db_calls = db_calls(c) - calls;
+      return m;
+   }
+
+   void report( native::chain& c, const point& p, const char* action, measurement m ) {
+      auto& w = m.wall_ns;
+      std::sort( w.begin(), w.end() );
+      uint64_t sum = 0;
+      for( auto ns : w )
+         sum += ns;
+      auto at = [&]( double q ) { return (unsigned long long)quantile( w, q ); };
+
+      std::printf( "{%s,\"action\":\"%s\",\"ops\":%zu,\"failed\":%u,"
+                   "\"wall_ns\":{\"min\":%llu,\"p50\":%llu,\"p90\":%llu,\"max\":%llu,\"mean\":%llu}"
+                   "%s,\"ram_bytes\":%lld,\"peak_rss_kb\":%ld}\n",
+                   point_json(p).c_str(), action, w.size(), m.failed,
+                   at(0), at(0.5), at(0.9), at(1), (unsigned long long)( sum / w.size() ),
+                   db_calls_json( "db_calls_per_op", double(m.db_calls) / w.size(), 1 ).c_str(),
+                   (long long)c.ram_usage( slvr_account ), peak_rss_kb() );
+      std::fflush( stdout );
+   }
+
+   void run_point( const options& opt, const point& p ) {
+      native::chain c;
+
+      uint64_t t0 = now_ns();
+      setup( c, p );
+      std::printf( "{%s,\"action\":\"setup\",\"wall_ns\":%llu,\"ram_bytes\":%lld,\"peak_rss_kb\":%ld}\n",
+                   point_json(p).c_str(), (unsigned long long)( now_ns() - t0 ),
+                   (long long)c.ram_usage( slvr_account ), peak_rss_kb() );
+      std::fflush( stdout );
+
+      const asset unit( 1, slvr_symbol );
+      // a round in which locking and unlocking are both possible
+      const uint64_t open_round = 1;
+
+      for( const auto& action : opt.actions ) {
+         measurement m;
+         if( action == "transfer" ) {
+            m = measure( c, opt, [&]( uint64_t i ) {
+               name from = holder( free_holder( p, i ) );
+               name to = holder( ( free_holder( p, i ) + 1 ) % p.holders );
+               return c.push_action( slvr_account, name("transfer"), from,
+                                     from, to, unit, std::string("bench") ).succeeded;
+            } );
+         } else if( action == "issue" ) {
+            m = measure( c, opt, [&]( uint64_t i ) {
+               return c.push_action( slvr_account, name("issue"), issuer_account,
+                                     holder( i % p.holders ), unit, std::string("bench"),
+                                     lot_round( p, i % p.holders, 0 ) ).succeeded;
+            } );
+         } else if( action == "redeem" || action == "burn" ) {
+            m = measure( c, opt, [&]( uint64_t i ) {
+               name owner = holder( free_holder( p, i ) );
+               return c.push_action( slvr_account, name(action), owner, owner, unit ).succeeded;
+            } );
+         } else if( action == "lock" || action == "redeemlock" || action == "tokenlock" ) {
+            // each op locks and unlocks again, so the state is unchanged between ops
+            std::string unlock = action == "lock" ? "unlock" : action == "redeemlock" ? "redeemunlock"
+                                                                                      : "tokenunlock";
+            m = measure( c, opt, [&]( uint64_t ) {
+               if( action == "tokenlock" ) {
+                  return c.push_action( slvr_account, name(action), slvr_account, unit ).succeeded
+                      && c.push_action( slvr_account, name(unlock), slvr_account, unit ).succeeded;
+               }
+               return c.push_action( slvr_account, name(action), slvr_account, unit, open_round ).succeeded
+                   && c.push_action( slvr_account, name(unlock), slvr_account, unit, open_round ).succeeded;
+            } );
+         } else {
+            std::fprintf( stderr, "unknown action %s\n", action.c_str() );
+            std::exit( 2 );
+         }
+         report( c, p, action.c_str(), std::move(m) );
+      }
+   }
+
+   void usage( const char* argv0 ) {
+      std::fprintf( stderr,
+         "usage: %s [options]\n"
+         "  --customers=N,...   customer rows (holders * lots), default 1000,10000,100000,1000000\n"
+         "  --rounds=N,...      issue rounds, default 1,10,100,500\n"
+         "  --lots=N,...        lots per holder, default 1,4,16\n"
+         "  --actions=A,...     transfer,issue,redeem,burn,lock,redeemlock,tokenlock\n"
+         "  --ops=N             most ops per action, default 200\n"
+         "  --budget-ms=N       time per action after which no new op starts, default 2000\n"
+         "  --work-limit=N      skip points with rounds * customers above N, default 50000000\n"
+         "  --full              run every point\n", argv0 );
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opt;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      auto value = [&]( const char* prefix ) { return option( arg, prefix ); };
+      if( auto v = value( "--customers=" ) )       opt.customers = split_numbers( v );
+      else if( auto v = value( "--rounds=" ) )     opt.rounds = split_numbers( v );
+      else if( auto v = value( "--lots=" ) )       opt.lots = split_numbers( v );
+      else if( auto v = value( "--actions=" ) )    opt.actions = split( v );
+      else if( auto v = value( "--ops=" ) )        opt.max_ops = std::max( 1ul, std::strtoul( v, nullptr, 10 ) );
+      else if( auto v = value( "--budget-ms=" ) )  opt.budget_ms = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--work-limit=" ) ) opt.work_limit = std::strtoull( v, nullptr, 10 );
+      else if( arg == "--full" )                   opt.full = true;
+      else {
+         usage( argv[0] );
+         return arg == "--help" ? 0 : 2;
+      }
+   }
+
+   int status = 0;
+   for( auto customers : opt.customers ) {
+      for( auto rounds : opt.rounds ) {
+         for( auto lots : opt.lots ) {
+            point p{ customers, rounds, lots, lots ? customers / lots : 0 };
+            if( rounds == 0 || p.holders < 2 || lots > rounds )
+               continue;
+            if( !opt.full && rounds * customers > opt.work_limit ) {
+               std::printf( "{%s,\"skipped\":\"work limit\"}\n", point_json(p).c_str() );
+               continue;
+            }
+
+            std::fflush( stdout );
+            pid_t pid = fork();
+            if( pid == 0 ) {
+               run_point( opt, p );
+               std::fflush( stdout );
+               _exit( 0 );
+            }
+            int child = 0;
+            waitpid( pid, &child, 0 );
+            if( !WIFEXITED(child) || WEXITSTATUS(child) != 0 ) {
+               std::printf( "{%s,\"error\":\"point did not complete\"}\n", point_json(p).c_str() );
+               status = 1;
+            }
+         }
+      }
+   }
+   return status;
+}
@@ -0,0 +1,258 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Binary dumps of contract tables, as written by trace_replay --dump and read by
+ *  table_report.
+ *
+ *  A dump is the 8 byte magic "AMPTDUMP", a little endian uint32 version, then the
+ *  tables, each a header of six little endian uint64s
+ *
+ *     code, scope, table, payer, row count, bytes of the rows that follow
+ *
+ *  and its rows, each
+ *
+ *     primary key, payer     little endian uint64s
+ *     size                   little endian uint32
+ *     data                   the row as the contract serialized it
+ *
+ *  Tables are in (code, scope, table) order and rows in primary key order, as a
+ *  node keeps them, so an exporter from a node snapshot can write the same format.
+ *  Rows are decoded by the contracts' own types, where they lie in the mapping.
+ */
+#pragma once
+
+#include <native/chain.hpp>
+
+#include <eosiolib/datastream.hpp>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+   using eosio::name;
+
+   constexpr char dump_magic[8] = { 'A', 'M', 'P', 'T', 'D', 'U', 'M', 'P' };
+   constexpr uint32_t dump_version = 1;
+   constexpr size_t dump_header_size = sizeof(dump_magic) + sizeof(uint32_t);
+   constexpr size_t dump_table_header_size = 6 * sizeof(uint64_t);
+   constexpr size_t dump_row_header_size = 2 * sizeof(uint64_t) + sizeof(uint32_t);
+
+   /// writes the tables of the given contracts, or of all of them; returns the bytes written
+   inline uint64_t write_table_dump( const native::chain& c, const std::string& path,
+                                     const std::vector<name>& codes = {} ) {
+      std::FILE* f = std::fopen( path.c_str(), "wb" );
+      if( !f )
+         throw std::runtime_error( "cannot create " + path );
+      std::vector<char> buf( 1 << 20 );
+      std::setvbuf( f, buf.data(), _IOFBF, buf.size() );
+
+      auto put = [&]( uint64_t v, int bytes ) {
+         char le[8];
+         for( int i = 0; i < bytes; ++i )
+            le[i] = char( v >> ( 8 * i ) );
+         std::fwrite( le, 1, bytes, f );
+      };
+      std::fwrite( dump_magic, 1, sizeof(dump_magic), f );
+      put( dump_version, 4 );
+
+      uint64_t written = dump_header_size;
+      for( const auto& [id, t] : c.tables() ) {
+         if( !codes.empty() && std::find( codes.begin(), codes.end(), name(id.code) ) == codes.end() )
+            continue;
+         uint64_t bytes = 0;
+         for( const auto& [pk, r] : t.rows )
+            bytes += dump_row_header_size + r.data.size();
+         for( uint64_t v : { id.code, id.scope, id.table, t.payer, uint64_t( t.rows.size() ), bytes } )
+            put( v, 8 );
+         for( const auto& [pk, r] : t.rows ) {
+            put( pk, 8 );
+            put( r.payer, 8 );
+            put( r.data.size(), 4 );
+            std::fwrite( r.data.data(), 1, r.data.size(), f );
+         }
+         written += dump_table_header_size + bytes;
+      }
+      bool ok = std::fflush( f ) == 0;
+      ok = std::fclose( f ) == 0 && ok;
+      if( !ok )
+         throw std::runtime_error( "cannot write " + path );
+      return written;
+   }
+
+   struct dump_table {
+      name code;
+      name scope;
+      name table;
+      name payer;
+      uint64_t rows;
+      uint64_t bytes;
+   };
+
+   /// a row in the mapping; valid until the reader moves past it
+   struct dump_row {
+      uint64_t primary;
+      name payer;
+      const char* data;
+      uint32_t size;
+
+      /// decodes the row with a contract's table type
+      template<typename T>
+      T as()const {
+         T value;
+         eosio::datastream<const char*> ds( data, size );
+         ds >> value;
+         return value;
+      }
+   };
+
+   /**
+    * Reads a table dump through a read-only mapping, front to back.  Pages already read
+    * are dropped from the process every release_every bytes, so memory stays bounded
+    * whatever the size of the dump.  Throws on a dump that is truncated or not a dump.
+    */
+   class table_dump_reader {
+   public:
+      static constexpr uint64_t release_every = 64 << 20;
+
+      explicit table_dump_reader( const std::string& path ) : _path(path) {
+         int fd = ::open( path.c_str(), O_RDONLY );
+         if( fd < 0 )
+            throw std::runtime_error( "cannot open " + path );
+         struct stat st;
+         if( ::fstat( fd, &st ) != 0 ) {
+            ::close( fd );
+            throw std::runtime_error( "cannot stat " + path );
+         }
+         _size = st.st_size;
+         if( _size ) {
+            void* p = ::mmap( nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0 );
+            ::close( fd );
+            if( p == MAP_FAILED )
+               throw std::runtime_error( "cannot map " + path );
+            _data = static_cast<const char*>(p);
+            ::madvise( p, _size, MADV_SEQUENTIAL );
+         }
+         else {
+            ::close( fd );
+         }
+
+         if( _size < dump_header_size || std::memcmp( _data, dump_magic, sizeof(dump_magic) ) != 0
+             || get( sizeof(dump_magic), 4 ) != dump_version ) {
+            unmap();
+            throw std::runtime_error( path + " is not a table dump" );
+         }
+         _pos = dump_header_size;
+      }
+
+      ~table_dump_reader() { unmap(); }
+
+      table_dump_reader( const table_dump_reader& ) = delete;
+      table_dump_reader& operator=( const table_dump_reader& ) = delete;
+
+      /// goes back to the first table
+      void rewind() {
+         _pos = dump_header_size;
+         _rows_left = 0;
+         _table_end = _pos;
+      }
+
+      /// moves to the next table, skipping what is left of the current one; false at the end
+      bool next_table( dump_table& t ) {
+         _pos = _table_end;
+         release();
+         if( _pos == _size )
+            return false;
+         need( dump_table_header_size );
+         t.code    = name( get( _pos, 8 ) );
+         t.scope   = name( get( _pos + 8, 8 ) );
+         t.table   = name( get( _pos + 16, 8 ) );
+         t.payer   = name( get( _pos + 24, 8 ) );
+         t.rows    = get( _pos + 32, 8 );
+         t.bytes   = get( _pos + 40, 8 );
+         _pos += dump_table_header_size;
+         need( t.bytes );
+         _table_end = _pos + t.bytes;
+         _rows_left = t.rows;
+         return true;
+      }
+
+      /// the next row of the current table; false when its rows are done
+      bool next_row( dump_row& r ) {
+         if( _rows_left == 0 )
+            return false;
+         --_rows_left;
+         release();
+         if( _table_end - _pos < dump_row_header_size )
+            corrupt();
+         r.primary = get( _pos, 8 );
+         r.payer   = name( get( _pos + 8, 8 ) );
+         r.size    = get( _pos + 16, 4 );
+         _pos += dump_row_header_size;
+         if( _table_end - _pos < r.size )
+            corrupt();
+         r.data = _data + _pos;
+         _pos += r.size;
+         return true;
+      }
+
+      uint64_t size()const { return _size; }
+      uint64_t position()const { return _pos; }
+
+   private:
+      uint64_t get( uint64_t at, int bytes )const {
+         uint64_t v = 0;
+         for( int i = 0; i < bytes; ++i )
+            v |= uint64_t( uint8_t( _data[at + i] ) ) << ( 8 * i );
+         return v;
+      }
+
+      void need( uint64_t bytes )const {
+         if( _size - _pos < bytes )
+            throw std::runtime_error( _path + " is truncated" );
+      }
+
+      [[noreturn]] void corrupt()const {
+         throw std::runtime_error( _path + " has a table whose rows do not match its size" );
+      }
+
+      /// drops the pages before the current position from memory; they are read back if needed
+      void release() {
+         uint64_t end = _pos / _page * _page;
+         if( end >= _released + release_every ) {
+            ::madvise( const_cast<char*>( _data ) + _released, end - _released, MADV_DONTNEED );
+            _released = end;
+         }
+         else if( end < _released ) {
+            _released = 0;   // rewound
+         }
+      }
+
+      void unmap() {
+         if( _data )
+            ::munmap( const_cast<char*>( _data ), _size );
+         _data = nullptr;
+      }
+
+      std::string _path;
+      const char* _data = nullptr;
+      uint64_t _size = 0;
+      uint64_t _pos = 0;
+      uint64_t _table_end = dump_header_size;
+      uint64_t _rows_left = 0;
+      uint64_t _released = 0;
+      uint64_t _page = ::sysconf( _SC_PAGESIZE );
+   };
+
+} /// namespace bench
@@ -0,0 +1,307 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Binary action traces, as written by trace_gen and read by the replay tools.
+ *
+ *  A trace is the 8 byte magic "AMPTRACE", a little endian uint32 version, then
+ *  records, each a kind byte and its fields:
+ *
+ *     set_code        name account, varint size, contract type name
+ *     create_account  name account
+ *     action          varint microseconds since the previous action, name account,
+ *                     name action, varint auth count, (name actor, name permission)...,
+ *                     varint size, packed action data
+ *
+ *  Varints are LEB128.  A name is a varint reference into the names seen so far:
+ *  0 is followed by a new name as a little endian uint64, which takes the next
+ *  reference, k > 0 is the k-th name.  Records can be appended to a trace while it
+ *  is read; decode reports a partial record at the end as incomplete.
+ *
+ *  With trace_gen's defaults an action takes about 53 bytes and the setup 10 bytes per
+ *  holder, so short traces average more: 10,000 actions over 100,000 holders come to
+ *  about 150 bytes an action, a million actions to about 54.
+ */
+#pragma once
+
+#include <native/chain.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace bench {
+
+   using eosio::name;
+
+   constexpr char trace_magic[8] = { 'A', 'M', 'P', 'T', 'R', 'A', 'C', 'E' };
+   constexpr uint32_t trace_version = 1;
+   constexpr size_t trace_header_size = sizeof(trace_magic) + sizeof(uint32_t);
+
+   struct trace_record {
+      enum kind_t : uint8_t { set_code = 0, create_account = 1, action = 2 };
+
+      kind_t kind = action;
+      uint64_t delay_us = 0;          ///< action: time since the previous action
+      native::action_data act;        ///< set_code, create_account: only act.account
+      std::string code_type;          ///< set_code: the type name the contract registered
+   };
+
+   class trace_writer {
+   public:
+      explicit trace_writer( const std::string& path ) : _file( std::fopen( path.c_str(), "wb" ) ) {
+         if( !_file )
+            throw std::runtime_error( "cannot create " + path );
+         std::fwrite( trace_magic, 1, sizeof(trace_magic), _file );
+         put_fixed( trace_version, 4 );
+      }
+
+      ~trace_writer() { close(); }
+
+      trace_writer( const trace_writer& ) = delete;
+      trace_writer& operator=( const trace_writer& ) = delete;
+
+      void set_code( name account, const std::string& type ) {
+         put_byte( trace_record::set_code );
+         put_name( account );
+         put_varint( type.size() );
+         _buf.insert( _buf.end(), type.begin(), type.end() );
+         flush_if_full();
+      }
+
+      void create_account( name account ) {
+         put_byte( trace_record::create_account );
+         put_name( account );
+         flush_if_full();
+      }
+
+      void action( uint64_t delay_us, const native::action_data& act ) {
+         put_byte( trace_record::action );
+         put_varint( delay_us );
+         put_name( act.account );
+         put_name( act.action );
+         put_varint( act.authorization.size() );
+         for( const auto& level : act.authorization ) {
+            put_name( level.actor );
+            put_name( level.permission );
+         }
+         put_varint( act.data.size() );
+         _buf.insert( _buf.end(), act.data.begin(), act.data.end() );
+         flush_if_full();
+      }
+
+      /// bytes written so far, including buffered ones
+      uint64_t size()const { return _written + _buf.size() + trace_header_size; }
+
+      void flush() {
+         if( !_buf.empty() )
+            std::fwrite( _buf.data(), 1, _buf.size(), _file );
+         _written += _buf.size();
+         _buf.clear();
+         std::fflush( _file );
+      }
+
+      void close() {
+         if( _file ) {
+            flush();
+            std::fclose( _file );
+            _file = nullptr;
+         }
+      }
+
+   private:
+      void put_byte( uint8_t b ) { _buf.push_back( char(b) ); }
+
+      void put_fixed( uint64_t v, int bytes ) {
+         for( int i = 0; i < bytes; ++i )
+            std::fputc( int( ( v >> ( 8 * i ) ) & 0xff ), _file );
+      }
+
+      void put_varint( uint64_t v ) {
+         do {
+            uint8_t b = v & 0x7f;
+            v >>= 7;
+            put_byte( b | ( v ? 0x80 : 0 ) );
+         } while( v );
+      }
+
+      void put_name( name n ) {
+         auto found = _refs.find( n.value );
+         if( found != _refs.end() ) {
+            put_varint( found->second );
+            return;
+         }
+         _refs.emplace( n.value, _refs.size() + 1 );
+         put_varint( 0 );
+         for( int i = 0; i < 8; ++i )
+            put_byte( uint8_t( n.value >> ( 8 * i ) ) );
+      }
+
+      void flush_if_full() {
+         if( _buf.size() >= ( 1 << 20 ) )
+            flush();
+      }
+
+      std::FILE* _file;
+      std::vector<char> _buf;
+      uint64_t _written = 0;
+      std::unordered_map<uint64_t, uint64_t> _refs;
+   };
+
+   /// decodes records from trace bytes, keeping the names seen so far
+   class trace_decoder {
+   public:
+      /// checks the header at the start of a trace, returns false if it is not one
+      static bool check_header( const char* data, size_t size ) {
+         if( size < trace_header_size || std::memcmp( data, trace_magic, sizeof(trace_magic) ) != 0 )
+            return false;
+         uint32_t version = 0;
+         for( int i = 0; i < 4; ++i )
+            version |= uint32_t( uint8_t( data[sizeof(trace_magic) + i] ) ) << ( 8 * i );
+         return version == trace_version;
+      }
+
+      /**
+       * Decodes the record at pos and advances pos past it.  Returns false, leaving pos
+       * and the decoder unchanged, when the record is cut off by end.  Throws on data
+       * that is not a record.
+       */
+      bool decode( const char*& pos, const char* end, trace_record& r ) {
+         cursor c{ pos, end, _names.size() };
+         if( !decode( c, r ) )
+            return false;
+         _names.insert( _names.end(), c.added.begin(), c.added.end() );
+         pos = c.pos;
+         return true;
+      }
+
+   private:
+      struct cursor {
+         const char* pos;
+         const char* end;
+         size_t known;
+         std::vector<uint64_t> added{};
+      };
+
+      bool decode( cursor& c, trace_record& r ) {
+         uint8_t kind;
+         if( !get_byte( c, kind ) )
+            return false;
+         r = trace_record();
+         r.kind = trace_record::kind_t(kind);
+
+         uint64_t size, count;
+         switch( r.kind ) {
+         case trace_record::set_code:
+            if( !get_name( c, r.act.account ) || !get_varint( c, size ) || !get_bytes( c, size ) )
+               return false;
+            r.code_type.assign( c.pos - size, size );
+            return true;
+         case trace_record::create_account:
+            return get_name( c, r.act.account );
+         case trace_record::action:
+            if( !get_varint( c, r.delay_us ) || !get_name( c, r.act.account ) || !get_name( c, r.act.action )
+                || !get_varint( c, count ) )
+               return false;
+            r.act.authorization.resize( count );
+            for( auto& level : r.act.authorization ) {
+               if( !get_name( c, level.actor ) || !get_name( c, level.permission ) )
+                  return false;
+            }
+            if( !get_varint( c, size ) || !get_bytes( c, size ) )
+               return false;
+            r.act.data.assign( c.pos - size, c.pos );
+            return true;
+         }
+         throw std::runtime_error( "unknown trace record kind " + std::to_string( kind ) );
+      }
+
+      static bool get_byte( cursor& c, uint8_t& b ) {
+         if( c.pos == c.end )
+            return false;
+         b = uint8_t( *c.pos++ );
+         return true;
+      }
+
+      static bool get_bytes( cursor& c, uint64_t size ) {
+         if( uint64_t( c.end - c.pos ) < size )
+            return false;
+         c.pos += size;
+         return true;
+      }
+
+      static bool get_varint( cursor& c, uint64_t& v ) {
+         v = 0;
+         for( int shift = 0; shift < 64; shift += 7 ) {
+            uint8_t b;
+            if( !get_byte( c, b ) )
+               return false;
+            v |= uint64_t( b & 0x7f ) << shift;
+            if( !( b & 0x80 ) )
+               return true;
+         }
+         throw std::runtime_error( "varint too long in trace" );
+      }
+
+      bool get_name( cursor& c, name& n ) {
+         uint64_t ref;
+         if( !get_varint( c, ref ) )
+            return false;
+         if( ref == 0 ) {
+            if( !get_bytes( c, 8 ) )
+               return false;
+            uint64_t v = 0;
+            for( int i = 0; i < 8; ++i )
+               v |= uint64_t( uint8_t( c.pos[i - 8] ) ) << ( 8 * i );
+            c.added.push_back( v );
+            n = name(v);
+            return true;
+         }
+         if( ref <= c.known ) {
+            n = name( _names[ref - 1] );
+            return true;
+         }
+         if( ref - c.known > c.added.size() )
+            throw std::runtime_error( "unknown name reference in trace" );
+         n = name( c.added[ref - c.known - 1] );
+         return true;
+      }
+
+      std::vector<uint64_t> _names;
+   };
+
+   /// reads a whole trace file; throws if it is not a trace
+   inline std::vector<char> read_trace_file( const std::string& path ) {
+      std::FILE* f = std::fopen( path.c_str(), "rb" );
+      if( !f )
+         throw std::runtime_error( "cannot open " + path );
+      std::vector<char> data;
+      char buf[1 << 16];
+      size_t n;
+      while( ( n = std::fread( buf, 1, sizeof(buf), f ) ) > 0 )
+         data.insert( data.end(), buf, buf + n );
+      std::fclose( f );
+
+      if( !trace_decoder::check_header( data.data(), data.size() ) )
+         throw std::runtime_error( path + " is not an action trace" );
+      return data;
+   }
+
+   /// decodes every complete record of a trace file
+   inline std::vector<trace_record> load_trace( const std::string& path ) {
+      auto data = read_trace_file( path );
+      std::vector<trace_record> records;
+      trace_decoder decoder;
+      const char* pos = data.data() + trace_header_size;
+      const char* end = data.data() + data.size();
+      trace_record r;
+      while( decoder.decode( pos, end, r ) )
+         records.push_back( std::move(r) );
+      return records;
+   }
+
+} /// namespace bench
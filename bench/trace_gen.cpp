@@ -0,0 +1,375 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Seeded generator of slvrtoken/drtoken action traces shaped like production.
+ *
+ *  Holder activity follows a Zipf distribution.  Issue rounds open at a fixed pace,
+ *  transfer and redeem locked, and are unlocked a while later.  Lock waves transfer
+ *  lock an older round for a while, and redemption bursts send a run of
+ *  slvrtoken::redeem, each of which credits drtoken through drcredit.  Between these
+ *  the mix is transfers, issues, redemptions and burns, and optionally a share of
+ *  drtoken transfers, in which the redeemed tokens change hands.
+ *
+ *  The generator keeps each holder's balance and issue lots as slvrtoken does, with the
+ *  lock state of every round, and only emits transfers and redemptions the contract
+ *  accepts; a holder whose tokens are all locked issues instead, so the mix is all
+ *  issues until the first round unlocks.  The model changes only with the actions it
+ *  emits, which all succeed on replay.  The same seed gives the same trace.
+ */
+#include "bench_util.hpp"
+#include "trace.hpp"
+
+#include <eosiolib/asset.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+using namespace bench;
+
+namespace {
+
+   const name slvr_account   = name("ampervstoken");
+   const name dr_account     = name("amperdrtoken");
+   const name issuer_account = name("amprissuer");
+   const symbol slvr_symbol  = symbol("SLVR", 4);
+   const symbol dr_symbol    = symbol("ANDS", 4);
+
+   struct options {
+      std::string out = "slvrtoken.trace";
+      uint64_t holders = 100000;
+      uint64_t actions = 1000000;
+      uint64_t seed = 1;
+      double zipf = 1.1;
+      uint64_t round_every = 20000;
+      uint64_t round_locked = 2000;
+      uint64_t wave_every = 7000;
+      uint64_t wave_length = 2000;
+      uint64_t burst_every = 10000;
+      uint64_t burst_size = 200;
+      uint64_t mean_delay_us = 500000;
+      uint64_t dr_transfers = 0;    ///< percent of the mix that are drtoken transfers
+   };
+
+   /// samples ranks 0..n-1 with probability proportional to 1 / (rank + 1)^s
+   class zipf_distribution {
+   public:
+      zipf_distribution( uint64_t n, double s ) : _cdf(n) {
+         double sum = 0;
+         for( uint64_t i = 0; i < n; ++i ) {
+            sum += 1.0 / std::pow( double( i + 1 ), s );
+            _cdf[i] = sum;
+         }
+         for( auto& c : _cdf )
+            c /= sum;
+      }
+
+      template<typename Rng>
+      uint64_t operator()( Rng& rng ) {
+         double u = std::uniform_real_distribution<double>( 0, 1 )( rng );
+         return std::min<uint64_t>( std::lower_bound( _cdf.begin(), _cdf.end(), u ) - _cdf.begin(), _cdf.size() - 1 );
+      }
+
+   private:
+      std::vector<double> _cdf;
+   };
+
+   /// a holder's tokens as the contracts keep them
+   struct holder_state {
+      int64_t balance = 0;                              ///< slvrtoken accounts row
+      std::vector<std::pair<uint64_t, int64_t>> lots;   ///< slvrtoken lots rows as (round, units), by round
+      int64_t dr_balance = 0;                           ///< drtoken accounts row
+   };
+
+   struct round_state {
+      bool transfer_locked = true;
+      bool redeem_locked = true;
+   };
+
+   class generator {
+   public:
+      generator( const options& opt, trace_writer& out )
+         : _opt(opt), _out(out), _rng(opt.seed), _zipf(opt.holders, opt.zipf), _holders(opt.holders),
+           _rounds(1),
+           _delay( 1.0 / std::max<uint64_t>( opt.mean_delay_us, 1 ) )
+      {
+         // ranks map to holders through a seeded permutation, so the active holders are spread out
+         _rank_holder.resize( opt.holders );
+         for( uint64_t i = 0; i < opt.holders; ++i )
+            _rank_holder[i] = i;
+         std::shuffle( _rank_holder.begin(), _rank_holder.end(), _rng );
+      }
+
+      /// writes the trace, returns the number of actions
+      uint64_t run() {
+         _out.set_code( slvr_account, "ampersand::slvrtoken" );
+         _out.set_code( dr_account, "ampersand::drtoken" );
+         _out.create_account( issuer_account );
+         for( uint64_t h = 0; h < _opt.holders; ++h )
+            _out.create_account( holder(h) );
+
+         uint64_t burst_left = 0;
+         uint64_t wave_round = 0, wave_end = 0;
+         // i counts steps, which schedule the rounds, waves and bursts; a step emits one or two actions
+         uint64_t emitted = 0;
+         for( uint64_t i = 0; emitted < _opt.actions; ++i ) {
+            if( i % _opt.round_every == 0 ) {
+               emitted += open_round();
+               continue;
+            }
+            if( i % _opt.round_every == _opt.round_locked ) {
+               emitted += round_action( "unlock", _round ) + round_action( "redeemunlock", _round );
+               continue;
+            }
+            if( _opt.wave_every && i % _opt.wave_every == 0 && _round > 1 && !wave_round ) {
+               // rounds before the current one are unlocked, as no other wave is running
+               wave_round = 1 + _rng() % ( _round - 1 );
+               wave_end = i + _opt.wave_length;
+               emitted += round_action( "lock", wave_round );
+               continue;
+            }
+            if( wave_round && i >= wave_end ) {
+               emitted += round_action( "unlock", wave_round );
+               wave_round = 0;
+               continue;
+            }
+            if( _opt.burst_every && i % _opt.burst_every == _opt.burst_every - 1 )
+               burst_left = _opt.burst_size;
+
+            if( burst_left ) {
+               --burst_left;
+               emitted += redeem( "redeem" );
+               continue;
+            }
+
+            if( _opt.dr_transfers && _rng() % 100 < _opt.dr_transfers ) {
+               emitted += dr_transfer();
+               continue;
+            }
+
+            uint32_t pick = _rng() % 100;
+            if( pick < 60 )
+               emitted += transfer();
+            else if( pick < 85 )
+               emitted += issue();
+            else if( pick < 95 )
+               emitted += redeem( "redeem" );
+            else
+               emitted += redeem( "burn" );
+         }
+         return emitted;
+      }
+
+   private:
+      asset amount( int64_t units ) { return asset( units * 10000, slvr_symbol ); }
+
+      uint64_t active_holder() { return _rank_holder[ _zipf( _rng ) ]; }
+
+      template<typename... Args>
+      uint64_t emit( name actor, const char* action, const Args&... args ) {
+         return emit_to( slvr_account, actor, action, args... );
+      }
+
+      template<typename... Args>
+      uint64_t emit_to( name contract, name actor, const char* action, const Args&... args ) {
+         native::action_data act{ contract, name(action), { {actor, name("active")} },
+                                  pack( std::make_tuple( args... ) ) };
+         _out.action( uint64_t( _delay( _rng ) ), act );
+         return 1;
+      }
+
+      uint64_t open_round() {
+         ++_round;
+         _rounds.emplace_back();
+         uint64_t emitted = emit( slvr_account, "issueopen", amount(0), issuer_account, _round )
+                          + emit( slvr_account, "create", issuer_account, amount( 1000000000 ), uint16_t(1000), _round,
+                                  true, true, false );
+         // create transfer locks the redeemed tokens again; slvrtoken is their issuer
+         if( _opt.dr_transfers )
+            emitted += emit_to( dr_account, slvr_account, "unlock", asset( 0, dr_symbol ) );
+         return emitted;
+      }
+
+      /// lock, unlock, redeemlock or redeemunlock of a round, which flips its flag
+      uint64_t round_action( const char* action, uint64_t round ) {
+         auto& r = _rounds[round];
+         if( std::strcmp( action, "lock" ) == 0 || std::strcmp( action, "unlock" ) == 0 )
+            r.transfer_locked = !r.transfer_locked;
+         else
+            r.redeem_locked = !r.redeem_locked;
+         return emit( slvr_account, action, amount(0), round );
+      }
+
+      bool locked( uint64_t round, bool transfer )const {
+         return transfer ? _rounds[round].transfer_locked : _rounds[round].redeem_locked;
+      }
+
+      /// what a holder can transfer or redeem: the balance less the lots of locked rounds
+      int64_t available( const holder_state& h, bool transfer )const {
+         int64_t free = h.balance;
+         for( const auto& lot : h.lots )
+            if( locked( lot.first, transfer ) )
+               free -= lot.second;
+         return free;
+      }
+
+      void add_lot( holder_state& h, uint64_t round, int64_t units ) {
+         auto lot = std::lower_bound( h.lots.begin(), h.lots.end(), std::make_pair( round, int64_t(0) ) );
+         if( lot != h.lots.end() && lot->first == round )
+            lot->second += units;
+         else
+            h.lots.insert( lot, { round, units } );
+      }
+
+      /**
+       * Takes units out of a holder's lots as a transfer or a burn does: drops the lots
+       * of fully unlocked rounds, then draws on the lots of rounds unlocked for the
+       * operation, oldest first.  Returns what each round gave; what is left came from
+       * the balance outside any lot.
+       */
+      std::vector<std::pair<uint64_t, int64_t>> take_lots( holder_state& h, int64_t units, bool transfer ) {
+         h.lots.erase( std::remove_if( h.lots.begin(), h.lots.end(), [&]( const auto& lot ) {
+                          return !locked( lot.first, true ) && !locked( lot.first, false );
+                       } ), h.lots.end() );
+
+         std::vector<std::pair<uint64_t, int64_t>> taken;
+         for( auto& lot : h.lots ) {
+            if( units == 0 )
+               break;
+            if( locked( lot.first, transfer ) )
+               continue;
+            int64_t part = std::min( units, lot.second );
+            lot.second -= part;
+            units -= part;
+            taken.emplace_back( lot.first, part );
+         }
+         h.lots.erase( std::remove_if( h.lots.begin(), h.lots.end(), []( const auto& lot ) { return lot.second == 0; } ),
+                       h.lots.end() );
+         return taken;
+      }
+
+      uint64_t issue() {
+         uint64_t h = active_holder();
+         int64_t units = 1 + _rng() % 1000;
+         _holders[h].balance += units;
+         add_lot( _holders[h], _round, units );
+         return emit( issuer_account, "issue", holder(h), amount(units), std::string("issue"), _round );
+      }
+
+      uint64_t transfer() {
+         uint64_t from = active_holder();
+         int64_t free = available( _holders[from], true );
+         if( free <= 0 )
+            return issue();
+         uint64_t to = active_holder();
+         if( to == from )
+            to = ( from + 1 ) % _opt.holders;
+         int64_t units = 1 + _rng() % std::max<int64_t>( 1, free / 2 );
+         for( const auto& [round, part] : take_lots( _holders[from], units, true ) )
+            add_lot( _holders[to], round, part );
+         _holders[from].balance -= units;
+         _holders[to].balance += units;
+         return emit( holder(from), "transfer", holder(from), holder(to), amount(units), std::string("transfer") );
+      }
+
+      uint64_t redeem( const char* action ) {
+         uint64_t owner = active_holder();
+         int64_t free = available( _holders[owner], false );
+         if( free <= 0 )
+            return issue();
+         int64_t units = 1 + _rng() % std::max<int64_t>( 1, free / 4 );
+         take_lots( _holders[owner], units, false );
+         _holders[owner].balance -= units;
+         if( std::strcmp( action, "redeem" ) == 0 )
+            _holders[owner].dr_balance += units;
+         return emit( holder(owner), action, holder(owner), amount(units) );
+      }
+
+      /// a transfer of redeemed tokens; a holder who has none redeems first
+      uint64_t dr_transfer() {
+         uint64_t from = active_holder();
+         if( _holders[from].dr_balance == 0 )
+            return redeem( "redeem" );
+         uint64_t to = active_holder();
+         if( to == from )
+            to = ( from + 1 ) % _opt.holders;
+         int64_t units = 1 + _rng() % std::max<int64_t>( 1, _holders[from].dr_balance / 2 );
+         _holders[from].dr_balance -= units;
+         _holders[to].dr_balance += units;
+         return emit_to( dr_account, holder(from), "transfer", holder(from), holder(to),
+                         asset( units * 10000, dr_symbol ), std::string("transfer") );
+      }
+
+      const options& _opt;
+      trace_writer& _out;
+      std::mt19937_64 _rng;
+      zipf_distribution _zipf;
+      std::vector<uint64_t> _rank_holder;
+      std::vector<holder_state> _holders;
+      std::vector<round_state> _rounds;       ///< by round; round 0 is never opened
+      std::exponential_distribution<double> _delay;
+      uint64_t _round = 0;
+   };
+
+   void usage( const char* argv0 ) {
+      std::fprintf( stderr,
+         "usage: %s [options]\n"
+         "  --out=FILE          trace to write, default slvrtoken.trace\n"
+         "  --holders=N         holders, default 100000\n"
+         "  --actions=N         actions, default 1000000\n"
+         "  --seed=N            seed, default 1\n"
+         "  --zipf=S            Zipf exponent of holder activity, default 1.1\n"
+         "  --round-every=N     actions between issue rounds, default 20000\n"
+         "  --round-locked=N    actions a new round stays locked, default 2000\n"
+         "  --wave-every=N      actions between lock waves, 0 for none, default 7000\n"
+         "  --wave-length=N     actions a lock wave lasts, default 2000\n"
+         "  --burst-every=N     actions between redemption bursts, 0 for none, default 10000\n"
+         "  --burst-size=N      redemptions per burst, default 200\n"
+         "  --mean-delay-us=N   mean time between actions, default 500000\n"
+         "  --dr-transfers=P    percent of the mix that are drtoken transfers, default 0\n", argv0 );
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opt;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      auto value = [&]( const char* prefix ) { return option( arg, prefix ); };
+      if( auto v = value( "--out=" ) )                opt.out = v;
+      else if( auto v = value( "--holders=" ) )       opt.holders = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--actions=" ) )       opt.actions = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--seed=" ) )          opt.seed = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--zipf=" ) )          opt.zipf = std::strtod( v, nullptr );
+      else if( auto v = value( "--round-every=" ) )   opt.round_every = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--round-locked=" ) )  opt.round_locked = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--wave-every=" ) )    opt.wave_every = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--wave-length=" ) )   opt.wave_length = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--burst-every=" ) )   opt.burst_every = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--burst-size=" ) )    opt.burst_size = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--mean-delay-us=" ) ) opt.mean_delay_us = std::strtoull( v, nullptr, 10 );
+      else if( auto v = value( "--dr-transfers=" ) )  opt.dr_transfers = std::strtoull( v, nullptr, 10 );
+      else {
+         usage( argv[0] );
+         return arg == "--help" ? 0 : 2;
+      }
+   }
+   if( opt.holders < 2 || opt.round_every < 4 || opt.round_locked == 0 || opt.round_locked >= opt.round_every
+       || opt.dr_transfers > 100 ) {
+      usage( argv[0] );
+      return 2;
+   }
+
+   trace_writer out( opt.out );
+   uint64_t actions = generator( opt, out ).run();
+   out.close();
+   std::fprintf( stderr, "wrote %s: %llu actions, %llu bytes\n", opt.out.c_str(),
+                 (unsigned long long)actions, (unsigned long long)out.size() );
+   return 0;
+}
@@ -0,0 +1,152 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Replays an action trace from trace_gen into the contracts on the in-memory chain
+ *  as fast as they run.
+ *
+ *  The trace is decoded into memory first, so only the transactions are timed.  Each
+ *  action is pushed as one transaction after advancing the chain clock by its delay.
+ *  The report is JSON lines: one per contract action with its count, failures and
+ *  latency percentiles, then a summary with the throughput.  --dump writes the tables
+ *  as they stand after the replay, for table_report and the other offline tools.
+ */
+#include <native/chain.hpp>
+
+#include "bench_util.hpp"
+#include "table_dump.hpp"
+#include "trace.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace bench;
+
+namespace {
+
+   struct options {
+      std::string trace;
+      std::string dump;
+      uint64_t limit = 0;
+      bool console = false;
+   };
+
+   struct action_stats {
+      std::vector<uint64_t> latency_ns;
+      uint64_t failed = 0;
+      uint64_t executed = 0;   ///< including notifications and inline actions
+   };
+
+   std::string latency_json( std::vector<uint64_t>& ns ) {
+      std::sort( ns.begin(), ns.end() );
+      uint64_t sum = 0;
+      for( auto v : ns )
+         sum += v;
+      char buf[200];
+      std::snprintf( buf, sizeof(buf), "\"latency_ns\":{\"p50\":%llu,\"p90\":%llu,\"p99\":%llu,\"p999\":%llu,\"max\":%llu,\"mean\":%llu}",
+                     (unsigned long long)quantile( ns, 0.5 ), (unsigned long long)quantile( ns, 0.9 ),
+                     (unsigned long long)quantile( ns, 0.99 ), (unsigned long long)quantile( ns, 0.999 ),
+                     (unsigned long long)quantile( ns, 1 ), (unsigned long long)( ns.empty() ? 0 : sum / ns.size() ) );
+      return buf;
+   }
+
+   void usage( const char* argv0 ) {
+      std::fprintf( stderr,
+         "usage: %s [options] TRACE\n"
+         "  --limit=N    replay at most N actions\n"
+         "  --dump=FILE  write the tables after the replay to FILE\n"
+         "  --console    echo the contracts' console output\n", argv0 );
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opt;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( auto v = option( arg, "--limit=" ) )     opt.limit = std::strtoull( v, nullptr, 10 );
+      else if( auto v = option( arg, "--dump=" ) ) opt.dump = v;
+      else if( arg == "--console" )                opt.console = true;
+      else if( arg.compare( 0, 2, "--" ) != 0 && opt.trace.empty() ) opt.trace = arg;
+      else {
+         usage( argv[0] );
+         return arg == "--help" ? 0 : 2;
+      }
+   }
+   if( opt.trace.empty() ) {
+      usage( argv[0] );
+      return 2;
+   }
+
+   uint64_t t0 = now_ns();
+   auto records = load_trace( opt.trace );
+   uint64_t load_ns = now_ns() - t0;
+
+   native::chain c;
+   c.set_console_echo( opt.console );
+
+   std::map<std::string, action_stats> stats;
+   std::vector<uint64_t> all_ns;
+   std::vector<native::action_data> trx(1);
+   uint64_t actions = 0, failed = 0;
+
+   uint64_t start = now_ns();
+   for( auto& r : records ) {
+      switch( r.kind ) {
+      case trace_record::set_code:
+         c.set_code( r.act.account, r.code_type );
+         continue;
+      case trace_record::create_account:
+         c.create_account( r.act.account );
+         continue;
+      case trace_record::action:
+         break;
+      }
+      if( opt.limit && actions == opt.limit )
+         break;
+
+      c.advance_time( r.delay_us );
+      c.run_deferred();
+
+      auto& s = stats[ r.act.account.to_string() + "::" + r.act.action.to_string() ];
+      trx[0] = std::move( r.act );
+      uint64_t begin = now_ns();
+      auto result = c.push_transaction( trx );
+      uint64_t ns = now_ns() - begin;
+
+      s.latency_ns.push_back( ns );
+      s.executed += result.actions;
+      all_ns.push_back( ns );
+      ++actions;
+      if( !result.succeeded ) {
+         ++s.failed;
+         ++failed;
+      }
+   }
+   uint64_t wall_ns = now_ns() - start;
+
+   for( auto& [action, s] : stats ) {
+      std::printf( "{\"kind\":\"action\",\"action\":\"%s\",\"count\":%zu,\"failed\":%llu,\"executed\":%llu,%s}\n",
+                   action.c_str(), s.latency_ns.size(), (unsigned long long)s.failed,
+                   (unsigned long long)s.executed, latency_json( s.latency_ns ).c_str() );
+   }
+   std::printf( "{\"kind\":\"summary\",\"trace\":\"%s\",\"actions\":%llu,\"failed\":%llu,\"load_ms\":%.1f,"
+                "\"replay_ms\":%.1f,\"actions_per_sec\":%.0f,%s%s,\"ram_bytes\":%lld,\"peak_rss_kb\":%ld}\n",
+                opt.trace.c_str(), (unsigned long long)actions, (unsigned long long)failed, load_ns / 1e6,
+                wall_ns / 1e6, wall_ns ? actions * 1e9 / wall_ns : 0.0, latency_json( all_ns ).c_str(),
+                db_calls_json( "db_calls", db_calls(c) ).c_str(), [&] {
+                   long long total = 0;
+                   for( const auto& r : c.ram_usage() )
+                      total += r.second;
+                   return total;
+                }(), peak_rss_kb() );
+
+   if( !opt.dump.empty() ) {
+      uint64_t bytes = write_table_dump( c, opt.dump );
+      std::fprintf( stderr, "wrote %s: %llu bytes\n", opt.dump.c_str(), (unsigned long long)bytes );
+   }
+   return 0;
+}
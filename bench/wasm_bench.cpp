@@ -0,0 +1,245 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Runs the committed token, hello and permissions .wasm builds on the in-memory
+ *  chain through the embedded interpreter, to measure what the compiled code costs
+ *  without nodeos.  When the wasm builds are configured (WASM_CXX), --built runs the
+ *  modules built from the current sources in the build tree instead, for comparison.
+ *
+ *  Each module runs on a fresh chain.  The report is JSON lines: per module its
+ *  size, decode time and mean instantiation time, which nodeos pays on every
+ *  action; per action the wasm instructions and host calls it executed and the
+ *  wall time of its transactions, including instantiation.
+ */
+#include <native/chain.hpp>
+#include <native/wasm.hpp>
+
+#include "bench_util.hpp"
+
+#include <eosiolib/asset.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+using namespace eosio;
+using namespace bench;
+
+namespace {
+
+   struct options {
+      std::string dir = WASM_BENCH_SOURCE_DIR;
+      uint64_t iterations = 2000;
+      uint64_t decodes = 200;
+      std::vector<std::string> modules = { "token", "hello", "permissions" };
+      bool console = false;
+   };
+
+   struct bench_action {
+      const char* name;
+      std::function<native::action_data( uint64_t i )> make;
+   };
+
+   struct module_bench {
+      const char* module;
+      const char* path;
+      name account;
+      std::function<void( native::chain& )> setup;
+      std::vector<bench_action> actions;
+   };
+
+   template<typename... Args>
+   native::action_data make_action( name account, const char* action, std::vector<permission_level> auth,
+                                    const Args&... args ) {
+      return { account, name(action), std::move(auth), pack( std::make_tuple( args... ) ) };
+   }
+
+   /// a distinct token symbol per i, none of them SYS
+   symbol bench_symbol( uint64_t i ) {
+      std::string code = "T";
+      do {
+         code += char( 'A' + i % 26 );
+         i /= 26;
+      } while( i );
+      return symbol( code, 4 );
+   }
+
+   std::vector<module_bench> module_benches() {
+      const name token = name("eosio.token"), alice = name("alice"), bob = name("bob");
+      const name hello = name("hello");
+      const name test = name("test");
+      const symbol sys = symbol( "SYS", 4 );
+      const permission_level token_active{ token, name("active") };
+      const permission_level alice_active{ alice, name("active") };
+      const permission_level test_active{ test, name("active") };
+
+      return {
+         { "token", "token/token.wasm", token,
+           [=]( native::chain& c ) {
+              c.create_account( alice );
+              c.create_account( bob );
+              c.push_transaction( { make_action( token, "create", { token_active }, alice,
+                                                 asset( 1000000000000000, sys ) ) } );
+              c.push_transaction( { make_action( token, "issue", { alice_active }, alice, asset( 10000000000000, sys ),
+                                                 std::string("setup") ) } );
+           },
+           {
+              { "create", [=]( uint64_t i ) {
+                   return make_action( token, "create", { token_active }, alice, asset( 1000000000000, bench_symbol(i) ) );
+                } },
+              { "issue", [=]( uint64_t ) {
+                   return make_action( token, "issue", { alice_active }, alice, asset( 10000, sys ), std::string("bench") );
+                } },
+              { "transfer", [=]( uint64_t ) {
+                   return make_action( token, "transfer", { alice_active }, alice, bob, asset( 1, sys ),
+                                       std::string("bench") );
+                } },
+           } },
+         { "hello", "hello/hello.wasm", hello,
+           [=]( native::chain& ) {},
+           {
+              // the first 100 calls add a visitor, the rest count visits
+              { "hi", [=]( uint64_t i ) {
+                   return make_action( hello, "hi", { { hello, name("active") } }, holder( i % 100 ) );
+                } },
+           } },
+         { "permissions", "permissions/permissions.wasm", test,
+           [=]( native::chain& ) {},
+           {
+              { "hasauth", [=]( uint64_t ) { return make_action( test, "hasauth", { test_active }, test ); } },
+              { "reqauth", [=]( uint64_t ) { return make_action( test, "reqauth", { test_active }, test ); } },
+              { "reqauth2", [=]( uint64_t ) {
+                   return make_action( test, "reqauth2", { { test, name("subactive") } }, test, name("active") );
+                } },
+              // sends reqauth inline to itself
+              { "send", [=]( uint64_t ) {
+                   return make_action( test, "send", { test_active }, test, name("active"), test );
+                } },
+           } },
+      };
+   }
+
+   void run( const module_bench& mb, const options& opt ) {
+      auto code = native::read_wasm_file( opt.dir + "/" + mb.path );
+
+      uint64_t begin = now_ns();
+      for( uint64_t i = 0; i < opt.decodes; ++i )
+         native::wasm_module m( code );
+      double decode_us = opt.decodes ? ( now_ns() - begin ) / 1e3 / opt.decodes : 0;
+
+      auto module = std::make_shared<const native::wasm_module>( code );
+      auto stats = std::make_shared<native::wasm_stats>();
+      native::chain c;
+      c.set_console_echo( opt.console );
+      c.set_apply( mb.account, native::wasm_apply( module, stats ) );
+      mb.setup( c );
+
+      std::vector<std::string> lines;
+      std::vector<native::action_data> trx(1);
+      for( const auto& a : mb.actions ) {
+         native::wasm_stats before = *stats;
+         std::vector<uint64_t> ns;
+         uint64_t failed = 0;
+         std::string error;
+         for( uint64_t i = 0; i < opt.iterations; ++i ) {
+            trx[0] = a.make(i);
+            uint64_t t0 = now_ns();
+            auto result = c.push_transaction( trx );
+            ns.push_back( now_ns() - t0 );
+            if( !result.succeeded ) {
+               ++failed;
+               if( error.empty() )
+                  error = result.error;
+            }
+         }
+         std::sort( ns.begin(), ns.end() );
+         uint64_t sum = 0;
+         for( auto v : ns )
+            sum += v;
+
+         double n = opt.iterations ? double( opt.iterations ) : 1;
+         uint64_t calls = stats->calls - before.calls;
+         char buf[600];
+         std::snprintf( buf, sizeof(buf),
+                        "{\"kind\":\"action\",\"module\":\"%s\",\"action\":\"%s\",\"count\":%llu,\"failed\":%llu,"
+                        "\"applies\":%.2f,\"instructions\":%.0f,\"host_calls\":%.1f,\"instantiate_ns\":%.0f,"
+                        "\"latency_ns\":{\"p50\":%llu,\"p99\":%llu,\"mean\":%llu}%s%s%s}",
+                        mb.module, a.name, (unsigned long long)opt.iterations, (unsigned long long)failed,
+                        calls / n, ( stats->instructions - before.instructions ) / n,
+                        ( stats->host_calls - before.host_calls ) / n,
+                        calls ? double( stats->instantiate_ns - before.instantiate_ns ) / calls : 0.0,
+                        (unsigned long long)quantile( ns, 0.5 ), (unsigned long long)quantile( ns, 0.99 ),
+                        (unsigned long long)( ns.empty() ? 0 : sum / ns.size() ),
+                        error.empty() ? "" : ",\"error\":\"", error.c_str(), error.empty() ? "" : "\"" );
+         lines.push_back( buf );
+      }
+
+      std::printf( "{\"kind\":\"module\",\"module\":\"%s\",\"path\":\"%s\",\"bytes\":%zu,\"functions\":%u,"
+                   "\"imports\":%zu,\"decoded_instructions\":%llu,\"decode_us\":%.1f,\"instantiate_us\":%.2f}\n",
+                   mb.module, ( opt.dir + "/" + mb.path ).c_str(), module->code_size(), module->function_count(),
+                   module->imports().size(),
+                   (unsigned long long)module->instruction_count(), decode_us,
+                   stats->calls ? stats->instantiate_ns / 1e3 / stats->calls : 0.0 );
+      for( const auto& line : lines )
+         std::printf( "%s\n", line.c_str() );
+   }
+
+   void usage( const char* argv0 ) {
+      std::fprintf( stderr,
+         "usage: %s [options] [MODULE...]\n"
+         "  MODULE            token, hello or permissions, default all\n"
+         "  --dir=DIR         tree holding the .wasm files, default the source tree\n"
+         "  --built           run the modules built into the build tree, when the wasm\n"
+         "                    builds are on\n"
+         "  --iterations=N    transactions per action, default 2000\n"
+         "  --decodes=N       times each module is decoded for its decode time, default 200\n"
+         "  --console         echo the contracts' console output\n", argv0 );
+   }
+
+} /// namespace
+
+int main( int argc, char** argv ) {
+   options opt;
+   std::vector<std::string> selected;
+   for( int i = 1; i < argc; ++i ) {
+      std::string arg = argv[i];
+      if( auto v = option( arg, "--dir=" ) )              opt.dir = v;
+      else if( arg == "--built" ) {
+#ifdef WASM_BENCH_BUILD_DIR
+         opt.dir = WASM_BENCH_BUILD_DIR;
+#else
+         std::fprintf( stderr, "--built needs the wasm builds, configure with WASM_CXX and WASM_LD\n" );
+         return 2;
+#endif
+      }
+      else if( auto v = option( arg, "--iterations=" ) )  opt.iterations = std::strtoull( v, nullptr, 10 );
+      else if( auto v = option( arg, "--decodes=" ) )     opt.decodes = std::strtoull( v, nullptr, 10 );
+      else if( arg == "--console" )                       opt.console = true;
+      else if( arg.compare( 0, 2, "--" ) != 0 )           selected.push_back( arg );
+      else {
+         usage( argv[0] );
+         return arg == "--help" ? 0 : 2;
+      }
+   }
+   if( !selected.empty() )
+      opt.modules = selected;
+
+   auto benches = module_benches();
+   for( const auto& module : opt.modules ) {
+      auto found = std::find_if( benches.begin(), benches.end(), [&]( const auto& b ) { return module == b.module; } );
+      if( found == benches.end() ) {
+         usage( argv[0] );
+         return 2;
+      }
+      try {
+         run( *found, opt );
+      } catch( const native::wasm_error& e ) {
+         std::fprintf( stderr, "%s: %s\n", module.c_str(), e.what() );
+         return 1;
+      }
+   }
+   return 0;
+}
@@ -0,0 +1,124 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  A work-stealing thread pool for task graphs, where finishing a task can make
+ *  others ready.
+ */
+#pragma once
+
+#include "bench_util.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace bench {
+
+   struct worker_stats {
+      uint64_t tasks = 0;
+      uint64_t steals = 0;     ///< tasks taken from other workers
+      uint64_t busy_ns = 0;    ///< time spent running tasks
+   };
+
+   /**
+    * Runs total tasks, numbered by the caller, on threads workers, the calling thread
+    * being worker 0.  ready holds the tasks that can run at once; run( worker, task,
+    * push ) runs one and calls push( t ) for each task it makes ready.
+    *
+    * Each worker keeps its ready tasks in a deque.  It takes the newest of its own, so
+    * the tasks a task releases run next on the same thread, while their inputs are
+    * still in its cache; an idle worker steals the oldest task of another.  If a task
+    * throws, the workers stop and the first exception is rethrown.
+    */
+   template<typename Run>
+   std::vector<worker_stats> run_work_stealing( unsigned threads, const std::vector<uint32_t>& ready,
+                                                uint64_t total, Run&& run ) {
+      struct alignas(64) queue {
+         std::mutex mutex;
+         std::deque<uint32_t> tasks;
+      };
+
+      if( threads == 0 )
+         threads = 1;
+      std::vector<queue> queues( threads );
+      for( size_t i = 0; i < ready.size(); ++i )
+         queues[i % threads].tasks.push_back( ready[i] );
+
+      std::vector<worker_stats> stats( threads );
+      std::atomic<uint64_t> done{0};
+      std::atomic<bool> stop{false};
+      std::exception_ptr error;
+      std::mutex error_mutex;
+
+      auto work = [&]( unsigned w ) {
+         auto& own = queues[w];
+         auto push = [&]( uint32_t t ) {
+            std::lock_guard<std::mutex> lock( own.mutex );
+            own.tasks.push_back( t );
+         };
+         uint64_t rng = w * 0x9e3779b97f4a7c15ull + 1;
+
+         while( done.load( std::memory_order_acquire ) < total && !stop.load( std::memory_order_relaxed ) ) {
+            uint32_t task = 0;
+            bool found = false;
+            {
+               std::lock_guard<std::mutex> lock( own.mutex );
+               if( !own.tasks.empty() ) {
+                  task = own.tasks.back();
+                  own.tasks.pop_back();
+                  found = true;
+               }
+            }
+            if( !found && threads > 1 ) {
+               rng ^= rng << 13;
+               rng ^= rng >> 7;
+               rng ^= rng << 17;
+               for( unsigned k = 0; k < threads - 1 && !found; ++k ) {
+                  auto& victim = queues[ ( w + 1 + ( rng + k ) % ( threads - 1 ) ) % threads ];
+                  std::lock_guard<std::mutex> lock( victim.mutex );
+                  if( !victim.tasks.empty() ) {
+                     task = victim.tasks.front();
+                     victim.tasks.pop_front();
+                     found = true;
+                     ++stats[w].steals;
+                  }
+               }
+            }
+            if( !found ) {
+               std::this_thread::yield();
+               continue;
+            }
+
+            uint64_t begin = now_ns();
+            try {
+               run( w, task, push );
+            } catch( ... ) {
+               std::lock_guard<std::mutex> lock( error_mutex );
+               if( !error )
+                  error = std::current_exception();
+               stop = true;
+            }
+            stats[w].busy_ns += now_ns() - begin;
+            ++stats[w].tasks;
+            done.fetch_add( 1, std::memory_order_release );
+         }
+      };
+
+      std::vector<std::thread> pool;
+      for( unsigned w = 1; w < threads; ++w )
+         pool.emplace_back( work, w );
+      work( 0 );
+      for( auto& t : pool )
+         t.join();
+
+      if( error )
+         std::rethrow_exception( error );
+      return stats;
+   }
+
+} /// namespace bench
@@ -0,0 +1,192 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/asset.hpp>
+#include <eosiolib/datastream.hpp>
+
+#include <cstdint>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+namespace ampersand { namespace compact {
+
+    using namespace eosio;
+
+    /// LEB128 for unsigned values, zigzag LEB128 for signed ones
+    template<typename T>
+    struct varint_ref {
+        T& value;
+
+        template<typename DataStream>
+        void write( DataStream& ds )const {
+            uint64_t v;
+            if constexpr ( std::is_signed<T>::value ) {
+                v = ( uint64_t(value) << 1 ) ^ uint64_t( int64_t(value) >> 63 );
+            } else {
+                v = value;
+            }
+            do {
+                uint8_t b = v & 0x7f;
+                v >>= 7;
+                b |= uint8_t( v > 0 ) << 7;
+                ds.write( reinterpret_cast<const char*>(&b), 1 );
+            } while ( v );
+        }
+
+        template<typename DataStream>
+        void read( DataStream& ds ) {
+            uint64_t v = 0;
+            uint8_t b;
+            int shift = 0;
+            do {
+                eosio_assert( shift < 64, "varint is longer than 64 bits" );
+                ds.read( reinterpret_cast<char*>(&b), 1 );
+                v |= uint64_t( b & 0x7f ) << shift;
+                shift += 7;
+            } while ( b & 0x80 );
+
+            if constexpr ( std::is_signed<T>::value ) {
+                value = T( int64_t( v >> 1 ) ^ -int64_t( v & 1 ) );
+            } else {
+                value = T(v);
+            }
+        }
+    };
+
+    /// assets sharing one symbol: the symbol once, then each amount as a varint
+    template<typename... Assets>
+    struct assets_ref {
+        std::tuple<Assets&...> assets;
+
+        template<typename DataStream>
+        void write( DataStream& ds )const {
+            const auto& first = std::get<0>( assets );
+            ds << first.symbol;
+            std::apply( [&]( auto&... a ) {
+                ( ..., ( eosio_assert( a.symbol == first.symbol, "compact assets must share a symbol" ),
+                         varint_ref<const int64_t>{ a.amount }.write( ds ) ) );
+            }, assets );
+        }
+
+        template<typename DataStream>
+        void read( DataStream& ds ) {
+            symbol sym;
+            ds >> sym;
+            std::apply( [&]( auto&... a ) {
+                ( ..., ( a.symbol = sym, varint_ref<int64_t>{ a.amount }.read( ds ) ) );
+            }, assets );
+        }
+    };
+
+    /// up to eight bools in one byte, the first in the lowest bit
+    template<typename... Bools>
+    struct flags_ref {
+        static_assert( sizeof...(Bools) <= 8, "no more than eight flags fit in a byte" );
+
+        std::tuple<Bools&...> flags;
+
+        template<typename DataStream>
+        void write( DataStream& ds )const {
+            uint8_t bits = 0;
+            int i = 0;
+            std::apply( [&]( auto&... f ) { ( ..., ( bits |= uint8_t( f ? 1 : 0 ) << i++ ) ); }, flags );
+            ds << bits;
+        }
+
+        template<typename DataStream>
+        void read( DataStream& ds ) {
+            uint8_t bits;
+            ds >> bits;
+            int i = 0;
+            std::apply( [&]( auto&... f ) { ( ..., ( f = ( bits >> i++ ) & 1 ) ); }, flags );
+        }
+    };
+
+    template<typename T>
+    varint_ref<T> varint( T& value ) { return { value }; }
+
+    template<typename... Assets>
+    assets_ref<Assets...> assets( Assets&... a ) { return { std::tie( a... ) }; }
+
+    template<typename... Bools>
+    flags_ref<Bools...> flags( Bools&... f ) { return { std::tie( f... ) }; }
+
+    /// a field: references are kept, field codecs are held by value
+    template<typename... Fields>
+    std::tuple<Fields...> fields( Fields&&... f ) { return std::tuple<Fields...>( std::forward<Fields>(f)... ); }
+
+    template<typename T, typename = void>
+    struct is_codec : std::false_type {};
+
+    template<typename T>
+    struct is_codec<T, std::void_t<decltype( &T::template read<datastream<const char*>> )>> : std::true_type {};
+
+    template<typename DataStream, typename Field>
+    void write_field( DataStream& ds, const Field& f ) {
+        if constexpr ( is_codec<std::decay_t<Field>>::value ) {
+            f.write( ds );
+        } else {
+            ds << f;
+        }
+    }
+
+    template<typename DataStream, typename Field>
+    void read_field( DataStream& ds, Field&& f ) {
+        if constexpr ( is_codec<std::decay_t<Field>>::value ) {
+            f.read( ds );
+        } else {
+            ds >> f;
+        }
+    }
+
+    template<typename DataStream, typename Tuple>
+    DataStream& write( DataStream& ds, const Tuple& t ) {
+        std::apply( [&]( const auto&... f ) { ( ..., write_field( ds, f ) ); }, t );
+        return ds;
+    }
+
+    template<typename DataStream, typename Tuple>
+    DataStream& read( DataStream& ds, Tuple&& t ) {
+        std::apply( [&]( auto&&... f ) { ( ..., read_field( ds, f ) ); }, t );
+        return ds;
+    }
+
+} } /// namespace ampersand::compact
+
+/**
+ * Serializes a table row in the compact layout instead of field by field, e.g.
+ *
+ *    COMPACT_SERIALIZE( currency_stats, compact::assets( supply, total_supply ), issuer,
+ *                       compact::varint( slvr_per_token_mg ), compact::flags( contract_locked ) )
+ *
+ * Plain fields keep their usual encoding.  The layout cannot be described in an ABI,
+ * so rows are only readable through the contract's own types.  Rows already stored
+ * field by field cannot be read in the compact layout: give the compact rows a new
+ * table and move the old rows over, as slvrtoken::migrate does.
+ *
+ * Varint rows change size with their values, and a modify that grows a row bills its
+ * payer, which needs the payer's authority unless it is the contract.  Use the compact
+ * layout only for rows the contract pays for.
+ */
+#define COMPACT_SERIALIZE( TYPE, ... ) \
+   typedef void eoslib_serialize_tag; \
+   auto compact_fields() { \
+      using namespace ::ampersand; \
+      return compact::fields( __VA_ARGS__ ); \
+   } \
+   auto compact_fields()const { \
+      using namespace ::ampersand; \
+      return compact::fields( __VA_ARGS__ ); \
+   } \
+   template<typename DataStream> \
+   friend DataStream& operator << ( DataStream& ds, const TYPE& t ) { \
+      return ::ampersand::compact::write( ds, t.compact_fields() ); \
+   } \
+   template<typename DataStream> \
+   friend DataStream& operator >> ( DataStream& ds, TYPE& t ) { \
+      return ::ampersand::compact::read( ds, t.compact_fields() ); \
+   }
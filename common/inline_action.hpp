@@ -0,0 +1,137 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/action.hpp>
+#include <eosiolib/asset.hpp>
+#include <eosiolib/datastream.hpp>
+#include <eosiolib/varint.hpp>
+
+#include <array>
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace ampersand {
+
+    /**
+     * Packed size of T when it is the same for every value, 0 otherwise.
+     */
+    template<typename T, typename = void>
+    struct fixed_pack_size : std::integral_constant<size_t, 0> {};
+
+    template<typename T>
+    struct fixed_pack_size<T, std::enable_if_t<std::is_arithmetic<T>::value || std::is_enum<T>::value>>
+        : std::integral_constant<size_t, sizeof(T)> {};
+
+    template<> struct fixed_pack_size<eosio::name> : std::integral_constant<size_t, 8> {};
+    template<> struct fixed_pack_size<eosio::asset> : std::integral_constant<size_t, 16> {};
+    template<> struct fixed_pack_size<eosio::permission_level> : std::integral_constant<size_t, 16> {};
+
+    /**
+     * An inline action serialized once into its own buffer and handed to send_inline
+     * as is.  When every argument type has a fixed packed size the buffer is a
+     * std::array sized at compile time; otherwise it is a vector whose capacity is
+     * kept across sends.
+     *
+     * An action can be sent again with new arguments, or with only the arguments at
+     * a fixed offset patched in place through set<I>:
+     *
+     *    inline_action credit( permission_level{get_self(), "active"_n},
+     *                          "amperdrtoken"_n, "drcredit"_n, owner, quantity );
+     *    credit.send();
+     *    credit.set<1>( change ).send();
+     */
+    template<typename... Args>
+    class inline_action {
+        static constexpr size_t npos = size_t(-1);
+
+        static constexpr bool fixed = ( (fixed_pack_size<Args>::value > 0) && ... );
+        static constexpr size_t data_size = ( fixed_pack_size<Args>::value + ... + 0 );
+
+        /// account, name and a single authorization
+        static constexpr size_t header_size = 8 + 8 + 1 + 16;
+
+        static constexpr size_t varint_size( size_t v ) {
+            size_t n = 1;
+            while ( v >>= 7 ) ++n;
+            return n;
+        }
+
+        static constexpr size_t capacity = header_size + varint_size(data_size) + data_size;
+
+        template<size_t I>
+        static constexpr size_t offset() {
+            constexpr size_t sizes[] = { fixed_pack_size<Args>::value..., 0 };
+            size_t o = 0;
+            for ( size_t i = 0; i < I; ++i ) {
+                if ( sizes[i] == 0 ) return npos;
+                o += sizes[i];
+            }
+            return o;
+        }
+
+    public:
+        template<size_t I>
+        using arg_type = std::tuple_element_t<I, std::tuple<Args...>>;
+
+        inline_action( const eosio::permission_level& auth, eosio::name account, eosio::name act,
+                       const Args&... args )
+        {
+            if constexpr ( !fixed ) {
+                _buffer.resize( header_size );
+            }
+            eosio::datastream<char*> ds( _buffer.data(), header_size );
+            ds << account.value << act.value << eosio::unsigned_int(1) << auth;
+            pack( args... );
+        }
+
+        /// patches the argument at index I, which must be at a fixed offset
+        template<size_t I>
+        inline_action& set( const arg_type<I>& value ) {
+            static_assert( offset<I>() != npos && fixed_pack_size<arg_type<I>>::value > 0,
+                           "only arguments at a fixed offset can be patched" );
+
+            eosio::datastream<char*> ds( _buffer.data() + _data_offset + offset<I>(),
+                                         fixed_pack_size<arg_type<I>>::value );
+            ds << value;
+            return *this;
+        }
+
+        /// packs new arguments over the previous ones and sends the action
+        void send( const Args&... args ) {
+            pack( args... );
+            send();
+        }
+
+        void send()const {
+            send_inline( const_cast<char*>(_buffer.data()), _size );
+        }
+
+    private:
+        void pack( const Args&... args ) {
+            size_t size = data_size;
+            if constexpr ( !fixed ) {
+                eosio::datastream<size_t> ps;
+                ( ps << ... << args );
+                size = ps.tellp();
+                _buffer.resize( header_size + varint_size(size) + size );
+            }
+
+            _data_offset = header_size + varint_size(size);
+            _size = _data_offset + size;
+
+            eosio::datastream<char*> ds( _buffer.data() + header_size, _size - header_size );
+            ds << eosio::unsigned_int(size);
+            ( ds << ... << args );
+        }
+
+        std::conditional_t<fixed, std::array<char, capacity>, std::vector<char>> _buffer;
+        size_t _data_offset = 0;
+        size_t _size = 0;
+    };
+
+} /// namespace ampersand
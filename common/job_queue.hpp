@@ -0,0 +1,151 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/eosio.hpp>
+#include <eosiolib/transaction.hpp>
+
+#include <vector>
+
+#include "inline_action.hpp"
+
+namespace ampersand {
+
+    using namespace eosio;
+
+    /**
+     * Work queued at a target contract for a caller.  payload holds the packed
+     * arguments of method; the result is sent back to the caller's callback action as
+     * callback( id, method, result ), in a deferred transaction of its own.
+     */
+    struct [[eosio::table]] job {
+        uint64_t id;
+        name caller;
+        name method;
+        name callback;
+        std::vector<char> payload;
+        uint32_t queued;
+
+        uint64_t primary_key()const { return id; }
+
+        EOSLIB_SERIALIZE( job, (id)(caller)(method)(callback)(payload)(queued) )
+    };
+
+    typedef eosio::multi_index<"jobs"_n, job> jobs;
+
+    /**
+     * Queues method( args... ) at target from the calling contract self.  The target's
+     * enqueue action stores the job, billed to self, and returns at once; the work
+     * runs when the target drains its queue.
+     */
+    template<typename... Args>
+    void enqueue_job( name self, name target, name method, name callback, const Args&... args )
+    {
+        inline_action( permission_level{self, "active"_n},
+                       target, "enqueue"_n,
+                       self, method, callback, pack( std::make_tuple(args...) )
+        ).send();
+    }
+
+    /**
+     * The queue of the contract self.  A target contract exposes
+     *
+     *    enqueue( name caller, name method, name callback, std::vector<char> payload )
+     *    drain( uint32_t max_jobs )
+     *
+     * forwarding to push and drain.  Jobs run oldest first.
+     *
+     * A job whose handler asserts rolls back its drain and stays at the head of the
+     * queue, so the target must reject at enqueue any job its handler cannot run.
+     * A callback that fails only loses its own result: each is sent separately.
+     */
+    class job_queue {
+    public:
+        explicit job_queue( name self ) : _self(self), _jobs(self, self.value) {}
+
+        /**
+         * Stores a job; the caller must have validated method and payload.  A drain is
+         * scheduled when the queue was empty, or when its oldest job has waited
+         * stale_after seconds, which means the pending drain failed.
+         */
+        void push( name caller, name method, name callback, const std::vector<char>& payload )
+        {
+            require_auth( caller );
+
+            auto oldest = _jobs.begin();
+            bool idle = oldest == _jobs.end();
+            bool stale = !idle && oldest->queued + stale_after <= now();
+
+            _jobs.emplace( caller, [&]( auto& j ) {
+                j.id       = _jobs.available_primary_key();
+                j.caller   = caller;
+                j.method   = method;
+                j.callback = callback;
+                j.payload  = payload;
+                j.queued   = now();
+            });
+
+            if ( idle || stale ) {
+                schedule_drain( default_batch );
+            }
+        }
+
+        /**
+         * Runs up to max_jobs jobs through handler( job ), which returns the packed
+         * result.  Each job is freed before its handler runs, and its result is sent to
+         * its caller in a deferred transaction.  While jobs remain, another drain is
+         * scheduled.  Only self may drain.  Returns the number run.
+         */
+        template<typename Handler>
+        uint32_t drain( uint32_t max_jobs, Handler&& handler )
+        {
+            require_auth( _self );
+            eosio_assert( max_jobs > 0, "max_jobs must be positive" );
+
+            uint32_t count = 0;
+            for ( auto it = _jobs.begin(); it != _jobs.end() && count < max_jobs; ++count ) {
+                job j = *it;
+                it = _jobs.erase( it );
+
+                send_result( j, handler( j ) );
+            }
+
+            if ( _jobs.begin() != _jobs.end() ) {
+                schedule_drain( max_jobs );
+            }
+            return count;
+        }
+
+        static constexpr uint32_t default_batch = 16;
+        static constexpr uint32_t stale_after = 60;
+
+    private:
+        /// ids restart once the queue empties, so the sender id adds the drain's time
+        void send_result( const job& j, const std::vector<char>& result )
+        {
+            transaction t;
+            t.actions.emplace_back( permission_level{_self, "active"_n},
+                                    j.caller, j.callback,
+                                    std::make_tuple(j.id, j.method, result) );
+            t.delay_sec = 0;
+            t.send( (uint128_t(current_time()) << 64) | j.id, _self );
+        }
+
+        /// at most one drain is pending per contract; a newer one replaces it
+        void schedule_drain( uint32_t max_jobs )
+        {
+            transaction t;
+            t.actions.emplace_back( permission_level{_self, "active"_n},
+                                    _self, "drain"_n,
+                                    std::make_tuple(max_jobs) );
+            t.delay_sec = 0;
+            t.send( _self.value, _self, true );
+        }
+
+        name _self;
+        jobs _jobs;
+    };
+
+} /// namespace ampersand
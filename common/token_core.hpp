@@ -0,0 +1,332 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/eosio.hpp>
+#include <eosiolib/asset.hpp>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "inline_action.hpp"
+
+namespace ampersand {
+
+    using std::string;
+    using namespace eosio;
+
+    /**
+     * Default token policy.  A contract's policy derives from this and overrides only
+     * what differs; the token core checks the policy at compile time, so each contract
+     * is built with only the checks and table accesses it needs.
+     *
+     * contract_lock   stats rows carry contract_locked; transfers of locked tokens are refused
+     * transfer_lock   stats rows carry transfer_locked; locked transfers need the issuer's auth
+     * issue_lots      balances are split into issue round lots, tracked by the contract via
+     *                 get_transfer_locked_issues_balance, get_redeem_locked_issues_balance,
+     *                 transfer_update_issue_customer_tables and redeem_update_issue_customer_tables
+     * reissue         create on an existing symbol adds to its maximum supply instead of failing
+     * issuer_auth     issue requires the token issuer's auth; a contract that authorizes issue
+     *                 itself, e.g. against an issue round's issuer, turns it off
+     * notify_filter   transfer notifications follow the recipients' notify_filter rows
+     * key             the primary key of account and stats rows, and the stats scope
+     * max_supply      the stats field holding the maximum supply
+     */
+    struct token_policy {
+        static constexpr bool contract_lock = false;
+        static constexpr bool transfer_lock = false;
+        static constexpr bool issue_lots = false;
+        static constexpr bool reissue = false;
+        static constexpr bool issuer_auth = true;
+        static constexpr bool notify_filter = false;
+
+        static uint64_t key( const symbol& sym ) { return sym.code().raw(); }
+
+        template<typename Stats>
+        static asset& max_supply( Stats& st ) { return st.max_supply; }
+
+        template<typename Stats>
+        static const asset& max_supply( const Stats& st ) { return st.max_supply; }
+    };
+
+    /**
+     * Which transfer notifications an account receives, scoped by the token contract.
+     * With allow set only the listed symbols notify; otherwise the listed symbols are
+     * muted, and an empty list mutes all of them.
+     */
+    struct [[eosio::table]] notify_filter {
+        name account;
+        bool allow;
+        std::vector<symbol_code> symbols;
+
+        uint64_t primary_key()const { return account.value; }
+
+        bool notifies( symbol_code code )const {
+            bool listed = std::find( symbols.begin(), symbols.end(), code ) != symbols.end();
+            return allow ? listed : !listed && !symbols.empty();
+        }
+
+        EOSLIB_SERIALIZE( notify_filter, (account)(allow)(symbols) )
+    };
+
+    typedef eosio::multi_index<"notifyopts"_n, notify_filter> notify_filters;
+
+    /**
+     * Token logic shared by the token contracts.  Contract is the contract class, which
+     * derives from token_core and declares the accounts and stats tables; Policy is its
+     * token_policy.
+     */
+    template<typename Contract, typename Policy>
+    class token_core : public eosio::contract {
+    public:
+        token_core( name receiver, name code, datastream<const char*> ds ):
+            contract(receiver, code, ds)
+        {}
+
+        asset get_supply( symbol sym )const
+        {
+            typename Contract::stats statstable( _self, Policy::key(sym) );
+            const auto& st = statstable.get( Policy::key(sym) );
+            return st.supply;
+        }
+
+        asset get_balance( name owner, symbol sym )const
+        {
+            typename Contract::accounts accountstable( _self, owner.value );
+            const auto& ac = accountstable.get( Policy::key(sym) );
+            return ac.balance;
+        }
+
+    protected:
+        Contract& self() { return static_cast<Contract&>(*this); }
+
+        /**
+         * Creates a token, or adds to its maximum supply when the policy allows reissue.
+         * update( stats_row, created ) sets the contract's own stats fields.
+         */
+        template<typename Update>
+        void create_token( asset new_supply, Update&& update )
+        {
+            auto sym = new_supply.symbol;
+            eosio_assert( sym.is_valid(), "invalid symbol name" );
+            eosio_assert( new_supply.is_valid(), "invalid supply" );
+            eosio_assert( new_supply.amount > 0, "max-supply must be positive" );
+
+            typename Contract::stats statstable( _self, Policy::key(sym) );
+            auto existing = statstable.find( Policy::key(sym) );
+
+            if ( existing == statstable.end() ) {
+                statstable.emplace( _self, [&]( auto& s ) {
+                    s.supply.symbol = sym;
+                    Policy::max_supply(s) = new_supply;
+                    update( s, true );
+                } );
+            } else {
+                eosio_assert( Policy::reissue, "token with symbol already exists" );
+                eosio_assert( sym == existing->supply.symbol, "symbol precision mismatch" );
+
+                statstable.modify( existing, same_payer, [&]( auto& s ) {
+                    Policy::max_supply(s) += new_supply;
+                    update( s, false );
+                } );
+            }
+        }
+
+        /**
+         * Issues quantity to the issuer, then transfers it on to the recipient inline.
+         * Returns the issuer.
+         */
+        name issue_token( name to, asset quantity, const string& memo )
+        {
+            auto sym = quantity.symbol;
+            eosio_assert( sym.is_valid(), "invalid symbol name" );
+            eosio_assert( memo.size() <= 256, "memo has more than 256 bytes" );
+
+            typename Contract::stats statstable( _self, Policy::key(sym) );
+            auto existing = statstable.find( Policy::key(sym) );
+            eosio_assert( existing != statstable.end(),
+                          "token with symbol does not exist, create token before issue" );
+            const auto& st = *existing;
+
+            if constexpr ( Policy::issuer_auth ) {
+                require_auth( st.issuer );
+            }
+            eosio_assert( quantity.is_valid(), "invalid quantity" );
+            eosio_assert( quantity.amount > 0, "must issue positive quantity" );
+            eosio_assert( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
+            eosio_assert( quantity.amount <= Policy::max_supply(st).amount - st.supply.amount,
+                          "quantity exceeds available supply" );
+
+            statstable.modify( st, same_payer, [&]( auto& s ) {
+                s.supply += quantity;
+            } );
+
+            add_balance( st.issuer, quantity, st.issuer );
+
+            if ( to != st.issuer ) {
+                inline_action( permission_level{st.issuer, "active"_n},
+                               _self, "transfer"_n,
+                               st.issuer, to, quantity, memo
+                ).send();
+            }
+            return st.issuer;
+        }
+
+        void transfer_token( name from, name to, asset quantity, const string& memo )
+        {
+            eosio_assert( from != to, "cannot transfer to self" );
+            require_auth( from );
+            eosio_assert( is_account(to), "to account does not exist" );
+
+            auto sym = quantity.symbol;
+            typename Contract::stats statstable( _self, Policy::key(sym) );
+            const auto& st = statstable.get( Policy::key(sym), "token with the symbol doesn't exist" );
+
+            if constexpr ( Policy::contract_lock ) {
+                eosio_assert( st.contract_locked == false, "contract is locked" );
+            }
+            if constexpr ( Policy::transfer_lock ) {
+                if ( st.transfer_locked ) {
+                    require_auth( st.issuer );
+                }
+            }
+
+            notify( from, sym );
+            notify( to, sym );
+
+            eosio_assert( quantity.is_valid(), "invalid quantity" );
+            eosio_assert( quantity.amount > 0, "must transfer positive quantity" );
+            eosio_assert( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
+            eosio_assert( memo.size() <= 256, "memo has more than 256 bytes" );
+
+            int64_t locked_balance = 0;
+            if constexpr ( Policy::issue_lots ) {
+                locked_balance = self().get_transfer_locked_issues_balance( from );
+            }
+
+            sub_balance( from, quantity, locked_balance );
+            add_balance( to, quantity, from );
+
+            if constexpr ( Policy::issue_lots ) {
+                self().transfer_update_issue_customer_tables( from, to, quantity );
+            }
+        }
+
+        /**
+         * Removes quantity from the owner's balance and from both the supply and the
+         * maximum supply.
+         */
+        void burn_token( name owner, asset quantity )
+        {
+            require_auth( owner );
+
+            auto sym = quantity.symbol;
+            typename Contract::stats statstable( _self, Policy::key(sym) );
+            const auto& st = statstable.get( Policy::key(sym), "token with the symbol doesn't exist" );
+
+            require_recipient( owner );
+
+            eosio_assert( quantity.is_valid(), "invalid quantity" );
+            eosio_assert( quantity.amount > 0, "must burn positive quantity" );
+            eosio_assert( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
+
+            statstable.modify( st, same_payer, [&]( auto& s ) {
+                s.supply -= quantity;
+                Policy::max_supply(s) -= quantity;
+            } );
+
+            int64_t locked_balance = 0;
+            if constexpr ( Policy::issue_lots ) {
+                locked_balance = self().get_redeem_locked_issues_balance( owner );
+            }
+
+            sub_balance( owner, quantity, locked_balance );
+
+            if constexpr ( Policy::issue_lots ) {
+                self().redeem_update_issue_customer_tables( owner, quantity );
+            }
+        }
+
+        void set_notify_filter( name account, bool allow, const std::vector<symbol_code>& symbols )
+        {
+            static_assert( Policy::notify_filter, "the token policy does not filter notifications" );
+            require_auth( account );
+            eosio_assert( symbols.size() <= 16, "no more than 16 symbols can be listed" );
+
+            notify_filters filters( _self, _self.value );
+            auto existing = filters.find( account.value );
+            auto update = [&]( auto& f ) {
+                f.account = account;
+                f.allow   = allow;
+                f.symbols = symbols;
+            };
+
+            if ( existing == filters.end() ) {
+                filters.emplace( account, update );
+            } else {
+                filters.modify( existing, account, update );
+            }
+        }
+
+        void clear_notify_filter( name account )
+        {
+            static_assert( Policy::notify_filter, "the token policy does not filter notifications" );
+            require_auth( account );
+
+            notify_filters filters( _self, _self.value );
+            const auto& existing = filters.get( account.value, "account has no notification filter" );
+            filters.erase( existing );
+        }
+
+        /// notifies the account of a transfer of sym unless its filter mutes it
+        void notify( name account, const symbol& sym )
+        {
+            if constexpr ( Policy::notify_filter ) {
+                notify_filters filters( _self, _self.value );
+                auto filter = filters.find( account.value );
+                if ( filter != filters.end() && !filter->notifies( sym.code() ) ) {
+                    return;
+                }
+            }
+            require_recipient( account );
+        }
+
+        void sub_balance( name owner, asset value, int64_t locked_balance = 0 )
+        {
+            typename Contract::accounts from_acnts( _self, owner.value );
+
+            const auto& from = from_acnts.get( Policy::key(value.symbol), "no balance object found" );
+            eosio_assert( from.balance.amount - locked_balance >= value.amount,
+                          Policy::issue_lots ? "overdrawn balance or transfer/redeem locked tokens"
+                                             : "overdrawn balance" );
+
+            if ( from.balance.amount == value.amount ) {
+                from_acnts.erase( from );
+            } else {
+                from_acnts.modify( from, owner, [&]( auto& a ) {
+                    a.balance -= value;
+                } );
+            }
+        }
+
+        void add_balance( name owner, asset value, name ram_payer )
+        {
+            typename Contract::accounts to_acnts( _self, owner.value );
+
+            auto to = to_acnts.find( Policy::key(value.symbol) );
+            if ( to == to_acnts.end() ) {
+                to_acnts.emplace( ram_payer, [&]( auto& a ) {
+                    a.balance = value;
+                } );
+            } else {
+                to_acnts.modify( to, same_payer, [&]( auto& a ) {
+                    a.balance += value;
+                } );
+            }
+        }
+    };
+
+} /// namespace ampersand
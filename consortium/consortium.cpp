@@ -1,118 +1,270 @@
-#include "token.hpp"
+#include "consortium.hpp"
 
 namespace ampr{
 
-void token::create( account_name issuer,
-                    asset maximum_supply )
+void consortium::create( name  issuer,
+                         asset maximum_supply )
 {
     require_auth( _self );
 
-    auto sym = maximum_supply.symbol;
+    create_token( maximum_supply, [&]( auto& s, bool ) {
+       s.issuer        = issuer;
+    });
+}
 
-    eosio_assert( sym.is_valid(), "invalid symbol name" );
-    eosio_assert( maximum_supply.is_valid(), "invalid supply");
-    eosio_assert( maximum_supply.amount > 0, "max-supply must be positive");
+void consortium::issue( name   to, 
+                        asset  quantity, 
+                        string memo )
+{
+    issue_token( to, quantity, memo );
+}
 
+void consortium::transfer( name   from,
+                           name   to,
+                           asset  quantity,
+                           string memo )
+{
+    transfer_token( from, to, quantity, memo );
+}
 
-    stats statstable( _self, sym.name() );
-    auto existing = statstable.find( sym.name() );
-    eosio_assert( existing == statstable.end(), "token with symbol already exists" );
+void consortium::burn( name  from,
+                       asset quantity )
+{
+    burn_token( from, quantity );
+}
 
-    statstable.emplace( _self, [&]( auto& s ) {
-       s.supply.symbol = maximum_supply.symbol;
-       s.max_supply    = maximum_supply;
-       s.issuer        = issuer;
+void consortium::setrole( name account,
+                          uint8_t role )
+{
+    require_auth( _self );
+    eosio_assert( role == storage_role, "invalid role" );
+    eosio_assert( is_account( account ), "account does not exist" );
+
+    members table( _self, _self.value );
+    auto it = table.find( account.value );
+    if ( it == table.end() ) {
+        table.emplace( _self, [&]( auto& m ) {
+            m.account = account;
+            m.roles   = role;
+        });
+    } else {
+        table.modify( it, same_payer, [&]( auto& m ) {
+            m.roles |= role;
+        });
+    }
+}
+
+void consortium::clearrole( name account,
+                            uint8_t role )
+{
+    require_auth( _self );
+    eosio_assert( role == storage_role, "invalid role" );
+
+    members table( _self, _self.value );
+    const auto& m = table.get( account.value, "account holds no role" );
+    if ( ( m.roles & ~role ) == 0 ) {
+        table.erase( m );
+    } else {
+        table.modify( m, same_payer, [&]( auto& row ) {
+            row.roles &= ~role;
+        });
+    }
+}
+
+void consortium::depositslvr( name producer,
+                              name storage,
+                              name coupler,
+                              uint64_t quantity )
+{
+    require_auth( storage );
+    eosio_assert( has_role( storage, storage_role ), "storage account does not hold the storage role" );
+    eosio_assert( is_account( producer ), "producer account does not exist" );
+    eosio_assert( is_account( coupler ), "coupler account does not exist" );
+    eosio_assert( quantity > 0, "must deposit positive quantity" );
+
+    silver items( _self, _self.value );
+    items.emplace( storage, [&]( auto& i ) {
+        i.id       = items.available_primary_key();
+        i.producer = producer;
+        i.storage  = storage;
+        i.coupler  = coupler;
+        i.owner    = producer;
+        i.quantity = quantity;
+        i.stage    = deposited;
+        i.updated  = now();
     });
 }
 
-void token::issue( account_name to, 
-				   asset quantity, 
-				   string memo )
+void consortium::validateslvr( name coupler,
+                               uint64_t id,
+                               uint64_t quantity )
 {
-    auto sym = quantity.symbol;
-    eosio_assert( sym.is_valid(), "invalid symbol name" );
-    eosio_assert( memo.size() <= 256, "memo has more than 256 bytes" );
+    require_auth( coupler );
+
+    silver items( _self, _self.value );
+    const auto& item = items.get( id, "silver item does not exist" );
+    eosio_assert( item.coupler == coupler, "silver item belongs to another coupler" );
+    eosio_assert( item.stage == deposited, "silver item is not awaiting validation" );
+    eosio_assert( quantity > 0 && quantity <= item.quantity, "validated quantity exceeds deposit" );
+
+    items.modify( item, same_payer, [&]( auto& i ) {
+        i.quantity = quantity;
+        i.stage    = validated;
+        i.updated  = now();
+    });
+}
+
+void consortium::tokenizeslvr( name coupler,
+                               uint64_t id,
+                               symbol sym )
+{
+    require_auth( coupler );
+
+    silver items( _self, _self.value );
+    const auto& item = items.get( id, "silver item does not exist" );
+    eosio_assert( item.coupler == coupler, "silver item belongs to another coupler" );
+    eosio_assert( item.stage == validated || item.stage == mint_failed,
+                  "silver item is not awaiting tokenization" );
 
-    auto sym_name = sym.name();
-    stats statstable( _self, sym_name );
-    auto existing = statstable.find( sym_name );
-    eosio_assert( existing != statstable.end(), "token with symbol does not exist, create token before issue" );
-    const auto& st = *existing;
+    asset rights( item.quantity, sym );
+    mint_rights( item.producer, rights );
 
-    require_auth( st.issuer );
-    eosio_assert( quantity.is_valid(), "invalid quantity" );
-    eosio_assert( quantity.amount > 0, "must issue positive quantity" );
+    items.modify( item, same_payer, [&]( auto& i ) {
+        i.rights  = rights;
+        i.stage   = tokenized;
+        i.updated = now();
+    });
+}
+
+void consortium::redeemslvr( name owner,
+                             uint64_t id )
+{
+    require_auth( owner );
+
+    silver items( _self, _self.value );
+    const auto& item = items.get( id, "silver item does not exist" );
+    eosio_assert( item.stage == tokenized, "silver item is not redeemable" );
 
-    eosio_assert( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
-    eosio_assert( quantity.amount <= st.max_supply.amount - st.supply.amount, "quantity exceeds available supply");
+    retire_rights( owner, item.rights );
 
-    statstable.modify( st, 0, [&]( auto& s ) {
-       s.supply += quantity;
+    items.modify( item, same_payer, [&]( auto& i ) {
+        i.owner   = owner;
+        i.stage   = redeeming;
+        i.updated = now();
     });
+}
+
+void consortium::releaseslvr( name storage,
+                              uint64_t id )
+{
+    require_auth( storage );
 
-    add_balance( st.issuer, quantity, st.issuer );
+    silver items( _self, _self.value );
+    const auto& item = items.get( id, "silver item does not exist" );
+    eosio_assert( item.storage == storage, "silver item is held by another storage" );
+    eosio_assert( item.stage == redeeming, "silver item is not being redeemed" );
 
-    if( to != st.issuer ) {
-       SEND_INLINE_ACTION( *this, transfer, {st.issuer,N(active)}, {st.issuer, to, quantity, memo} );
-    }
+    items.erase( item );
 }
 
-void token::transfer( account_name from,
-                      account_name to,
-                      asset        quantity,
-                      string       memo )
+void consortium::acceptnext( uint32_t max_items )
 {
-    eosio_assert( from != to, "cannot transfer to self" );
-    require_auth( from );
-    eosio_assert( is_account( to ), "to account does not exist");
-    auto sym = quantity.symbol.name();
-    stats statstable( _self, sym );
-    const auto& st = statstable.get( sym );
+    require_auth( _self );
+
+    advance_stage( deposited, max_items, [&]( auto& idx, auto it ) {
+        idx.modify( it, same_payer, [&]( auto& i ) {
+            i.stage   = validated;
+            i.updated = now();
+        });
+    });
+}
+
+void consortium::tokenizenext( symbol sym,
+                               uint32_t max_items )
+{
+    require_auth( _self );
+    eosio_assert( sym.is_valid(), "invalid symbol name" );
 
-    require_recipient( from );
-    require_recipient( to );
+    // the symbol is the same for every item, so a bad one fails the whole batch here
+    stats statstable( _self, sym.code().raw() );
+    const auto& st = statstable.get( sym.code().raw(),
+                                     "token with symbol does not exist, create token before tokenizing" );
+    eosio_assert( sym == st.supply.symbol, "symbol precision mismatch" );
+    uint64_t available = st.max_supply.amount - st.supply.amount;
 
-    eosio_assert( quantity.is_valid(), "invalid quantity" );
-    eosio_assert( quantity.amount > 0, "must transfer positive quantity" );
-    eosio_assert( quantity.symbol == st.supply.symbol, "symbol precision mismatch" );
-    eosio_assert( memo.size() <= 256, "memo has more than 256 bytes" );
+    advance_stage( validated, max_items, [&]( auto& idx, auto it ) {
+        if ( it->quantity > available ) {
+            print( "item ", it->id, " exceeds available supply; " );
+            idx.modify( it, same_payer, [&]( auto& i ) {
+                i.stage   = mint_failed;
+                i.updated = now();
+            });
+            return;
+        }
 
+        asset rights( it->quantity, sym );
+        mint_rights( it->producer, rights );
+        available -= it->quantity;
 
-    sub_balance( from, quantity );
-    add_balance( to, quantity, from );
+        idx.modify( it, same_payer, [&]( auto& i ) {
+            i.rights  = rights;
+            i.stage   = tokenized;
+            i.updated = now();
+        });
+    });
+}
+
+void consortium::redeemnext( uint32_t max_items )
+{
+    require_auth( _self );
+
+    advance_stage( redeeming, max_items, [&]( auto& idx, auto it ) {
+        idx.erase( it );
+    });
+}
+
+bool consortium::has_role( name account,
+                           role r )
+{
+    members table( _self, _self.value );
+    auto it = table.find( account.value );
+    return it != table.end() && ( it->roles & r );
 }
 
-void token::sub_balance( account_name owner, asset value ) {
-   accounts from_acnts( _self, owner );
+void consortium::mint_rights( name  to,
+                              asset rights )
+{
+    eosio_assert( rights.is_valid(), "invalid rights" );
+    eosio_assert( rights.amount > 0, "must tokenize positive rights" );
 
-   const auto& from = from_acnts.get( value.symbol.name(), "no balance object found" );
-   eosio_assert( from.balance.amount >= value.amount, "overdrawn balance" );
+    stats statstable( _self, rights.symbol.code().raw() );
+    const auto& st = statstable.get( rights.symbol.code().raw(),
+                                     "token with symbol does not exist, create token before tokenizing" );
+    eosio_assert( rights.symbol == st.supply.symbol, "symbol precision mismatch" );
+    eosio_assert( rights.amount <= st.max_supply.amount - st.supply.amount, "rights exceed available supply" );
 
+    statstable.modify( st, same_payer, [&]( auto& s ) {
+        s.supply += rights;
+    });
 
-   if( from.balance.amount == value.amount ) {
-      from_acnts.erase( from );
-   } else {
-      from_acnts.modify( from, owner, [&]( auto& a ) {
-          a.balance -= value;
-      });
-   }
+    add_balance( to, rights, _self );
 }
 
-void token::add_balance( account_name owner, asset value, account_name ram_payer )
+void consortium::retire_rights( name  owner,
+                                asset rights )
 {
-   accounts to_acnts( _self, owner );
-   auto to = to_acnts.find( value.symbol.name() );
-   if( to == to_acnts.end() ) {
-      to_acnts.emplace( ram_payer, [&]( auto& a ){
-        a.balance = value;
-      });
-   } else {
-      to_acnts.modify( to, 0, [&]( auto& a ) {
-        a.balance += value;
-      });
-   }
+    stats statstable( _self, rights.symbol.code().raw() );
+    const auto& st = statstable.get( rights.symbol.code().raw(), "token with the symbol doesn't exist" );
+
+    statstable.modify( st, same_payer, [&]( auto& s ) {
+        s.supply -= rights;
+    });
+
+    sub_balance( owner, rights );
 }
-	
+
 }; // namespace ampr
 
-EOSIO_ABI( ampr::token, (create)(issue)(transfer) )
+EOSIO_DISPATCH( ampr::consortium, (create)(issue)(transfer)(burn)(setrole)(clearrole)
+                                   (depositslvr)(validateslvr)(tokenizeslvr)(redeemslvr)(releaseslvr)
+                                   (acceptnext)(tokenizenext)(redeemnext) )
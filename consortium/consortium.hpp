@@ -5,102 +5,184 @@
 
 #include <string>
 
-// eos namespaces
-using namespace eosio::asset;
-using namespace eosio::multi_index;
-using namespace eosio::require_auth;
+#include "../common/token_core.hpp"
+
+using namespace eosio;
 
 namespace ampr {
     
     using std::string;
+    using ampersand::token_core;
+    using ampersand::token_policy;
 
-    class consortium : public contract {
+    class [[eosio::contract("consortium")]] consortium : public token_core<consortium, token_policy> {
     public:
-        consortium( account_name self ):contract(self){}
+        using token_core::token_core;
+
+        [[eosio::action]]
+        void setrole( name account,
+                      uint8_t role );
+
+        [[eosio::action]]
+        void clearrole( name account,
+                        uint8_t role );
+
+        [[eosio::action]]
+        void depositslvr( name producer,
+                          name storage,
+                          name coupler,
+                          uint64_t quantity );
 
         [[eosio::action]]
-        void deposit_silver( account_name producer, 
-							 account_name storage,
-							 account_name coupler,
+        void validateslvr( name coupler,
+                           uint64_t id,
                            uint64_t quantity );
-                       
+
         [[eosio::action]]
-		void validate_silver( 
+        void tokenizeslvr( name coupler,
+                           uint64_t id,
+                           symbol sym );
 
         [[eosio::action]]
-        void tokenize_silver( account_name coupler,
-                              asset rights,
-                              uint64_t quantity ); 
+        void redeemslvr( name owner,
+                         uint64_t id );
 
         [[eosio::action]]
-        void create_token( account_name issuer,
-                      asset maximum_supply );
+        void releaseslvr( name storage,
+                          uint64_t id );
 
         [[eosio::action]]
-        void issue_token( account_name to, 
-                     asset quantity, 
-                     string memo );
+        void acceptnext( uint32_t max_items );
 
         [[eosio::action]]
-        void transfer_token( account_name from,
-                        account_name to,
-                        asset        quantity,
-                        string       memo );
+        void tokenizenext( symbol sym,
+                           uint32_t max_items );
 
         [[eosio::action]]
-        void burn( account_name from,
-                   asset quantity );
+        void redeemnext( uint32_t max_items );
+
+        [[eosio::action]]
+        void create( name issuer,
+                     asset maximum_supply );
 
         [[eosio::action]]
-        void redeem_silver( account_name owner );
+        void issue( name to, 
+                    asset quantity, 
+                    string memo );
 
-        inline asset get_supply( symbol_name sym )const;
-         
-        inline asset get_balance( account_name owner, 
-                                   symbol_name sym )const;
+        [[eosio::action]]
+        void transfer( name from,
+                       name to,
+                       asset        quantity,
+                       string       memo );
+
+        [[eosio::action]]
+        void burn( name from,
+                   asset quantity );
 
     private:
+        friend class token_core<consortium, token_policy>;
+
         struct [[eosio::table]] account {
             asset balance;
 
-            uint64_t primary_key()const { return balance.symbol.name(); }
+            uint64_t primary_key()const { return balance.symbol.code().raw(); }
         };
 
         struct [[eosio::table]] currency_stats {
             asset supply;
             asset max_supply;
-            account_name issuer;
+            name issuer;
+
+            uint64_t primary_key()const { return supply.symbol.code().raw(); }
+        };
+
+        /// roles a member account holds, as bits of member::roles
+        enum role : uint8_t {
+            storage_role = 1
+        };
+
+        struct [[eosio::table]] member {
+            name account;
+            uint8_t roles;
+
+            uint64_t primary_key()const { return account.value; }
+        };
 
-            uint64_t primary_key()const { return supply.symbol.name(); }
+        /**
+         * silver moves deposited -> validated -> tokenized -> redeeming, and its row is
+         * erased when the storage releases it, or the operator releases it in a batch.
+         * A batch parks an item it cannot mint rights for at mint_failed, so it does not
+         * hold up the queue; its coupler can tokenize it once supply is available.
+         */
+        enum stage : uint8_t {
+            deposited,
+            validated,
+            tokenized,
+            redeeming,
+            mint_failed
         };
 
-        typedef eosio::multi_index<N(accounts), account> accounts;
-        typedef eosio::multi_index<N(stat), currency_stats> stats;
+        struct [[eosio::table]] silver_item {
+            uint64_t id;
+            name producer;
+            name storage;
+            name coupler;
+            name owner;
+            uint64_t quantity;
+            asset rights;
+            uint8_t stage;
+            uint32_t updated;
+
+            uint64_t primary_key()const { return id; }
+            /// items of a stage, oldest first
+            uint64_t by_stage()const { return (uint64_t(stage) << 32) | updated; }
+        };
 
-        void sub_balance( account_name owner, asset value );
-        void add_balance( account_name owner, asset value, account_name ram_payer );
+        typedef eosio::multi_index<"accounts"_n, account> accounts;
+        typedef eosio::multi_index<"stat"_n, currency_stats> stats;
+        typedef eosio::multi_index<"members"_n, member> members;
+        typedef eosio::multi_index<"silver"_n, silver_item,
+            indexed_by<"bystage"_n, const_mem_fun<silver_item, uint64_t, &silver_item::by_stage>>
+        > silver;
+
+        bool has_role( name account, role r );
+        void mint_rights( name to, asset rights );
+        void retire_rights( name owner, asset rights );
+
+        /**
+         * Applies advance( index, iterator ) to up to max_items of the oldest items at
+         * stage from, each of which must leave the stage.  Returns the number advanced.
+         */
+        template<typename Advance>
+        uint32_t advance_stage( uint8_t from, uint32_t max_items, Advance&& advance )
+        {
+            eosio_assert( max_items > 0, "max_items must be positive" );
+
+            silver items( _self, _self.value );
+            auto idx = items.get_index<"bystage"_n>();
+
+            uint32_t count = 0;
+            auto it = idx.lower_bound( uint64_t(from) << 32 );
+            while ( count < max_items && it != idx.end() && it->stage == from ) {
+                auto next = std::next( it );
+                advance( idx, it );
+                it = next;
+                ++count;
+            }
+
+            bool pending = it != idx.end() && it->stage == from;
+            print( count, " items advanced", pending ? ", more pending" : "" );
+            return count;
+        }
 
     public:
         struct transfer_args {
-            account_name from;
-            account_name to;
+            name from;
+            name to;
             asset quantity;
             string memo;
         };
     };
 
-    asset consortium::get_supply( symbol_name sym )const
-    {
-        stats statstable( _self, sym );
-        const auto& st = statstable.get( sym );
-        return st.supply;
-    }
-
-    asset consortium::get_balance( account_name owner, symbol_name sym )const
-    {
-        accounts accountstable( _self, owner );
-        const auto& ac = accountstable.get( sym );
-        return ac.balance;
-    }
-
 } // namespace ampr
@@ -10,65 +10,20 @@ void drtoken::create( name issuer, asset new_supply,
                       bool transfer_locked )
 {
     require_auth( SLVRTOKEN_CONTRACT_ACCNAME );
-    
-    auto sym = new_supply.symbol;
-    eosio_assert( sym.is_valid(), "invalid symbol name ");
-    eosio_assert( new_supply.is_valid(), "invalid supply" );
-    eosio_assert( new_supply.amount > 0, "max-supply must be positive" );
-    stats statstable( _code, sym.raw() );
-
-    auto iterator = statstable.find( sym.raw() );
-
-    // Token is added for the first time
-    if ( iterator == statstable.end() ){	
-        statstable.emplace( _self, [&](auto& token_stats_record) {
-            token_stats_record.supply.symbol = new_supply.symbol;
-            token_stats_record.total_supply = new_supply;
-            token_stats_record.issuer = issuer;
-            token_stats_record.transfer_locked = transfer_locked;
-        } );
-    // Token Already exists, reissuing with new supply
-    } else {
-        statstable.modify(iterator, same_payer, [&](auto& token_stats_record) {
-            token_stats_record.total_supply += new_supply;
-            token_stats_record.issuer = issuer;
-            token_stats_record.transfer_locked = transfer_locked;
-        } );
-    }
+
+    // Token is added for the first time, or already exists and is reissued with new supply
+    create_token( new_supply, [&](auto& token_stats_record, bool created) {
+        if ( created ) {
+            require_migrated( new_supply.symbol );
+        }
+        token_stats_record.issuer = issuer;
+        token_stats_record.transfer_locked = transfer_locked;
+    } );
 }
 
 void drtoken::issue( name to, asset quantity, string memo )
 {
-    auto sym = quantity.symbol;
-    eosio_assert( sym.is_valid(), "invalid symbol name" );
-    eosio_assert( memo.size() <= 256, "memo has more than 256 bytes" );
-
-    stats statstable( _code, sym.raw() );
-
-    auto iterator = statstable.find( sym.raw() );
-    eosio_assert( iterator != statstable.end(),
-                  "token with symbol does not exist, create token before issue" );
-
-    require_auth( iterator->issuer );
-
-    eosio_assert( quantity.is_valid(), "invalid quantity" );
-    eosio_assert( quantity.amount > 0, "must issue positive quantity" );
-    eosio_assert( quantity.symbol == iterator->supply.symbol, "symbol precision mismatch" );
-    eosio_assert( quantity.amount <= iterator->total_supply.amount - iterator->supply.amount,
-                  "quantity exceeds available supply ");
-
-    statstable.modify( iterator, same_payer, [&](auto& token_stats_record) {
-        token_stats_record.supply += quantity;
-    } );
-
-    add_balance( iterator->issuer, quantity, iterator->issuer );
-
-    if( to != iterator->issuer ) {
-        SEND_INLINE_ACTION( *this, 
-                            transfer, 
-                            {iterator->issuer, name("active")},
-                            {iterator->issuer, to, quantity, memo} );
-    }
+    issue_token( to, quantity, memo );
 }
 
 void drtoken::lock( asset lock )
@@ -110,35 +65,7 @@ void drtoken::unlock( asset unlock )
 void drtoken::transfer( name from, name to,
                         asset quantity, string memo )
 {
-    eosio_assert( from != to, "cannot transfer to self" );
-
-    require_auth( from );
-
-    eosio_assert( is_account(to), "to account does not exist" );
-
-    auto sym = quantity.symbol;
-    stats statstable( _code, sym.raw() );
-
-    eosio_assert( statstable.find(quantity.symbol.raw()) != statstable.end(),
-                  "token with the symbol doesn't exist" );
-
-    const auto& token_stats_record = statstable.get( sym.raw() );
-
-    if ( token_stats_record.transfer_locked == true ) {
-        require_auth( token_stats_record.issuer );
-    }
-
-    require_recipient(from);
-    require_recipient(to);
-
-    eosio_assert( quantity.is_valid(), "invalid quantity" );
-    eosio_assert( quantity.amount > 0, "must transfer positive quantity" );
-    eosio_assert( quantity.symbol == token_stats_record.supply.symbol,
-                  "symbol precision mismatch" );
-    eosio_assert( memo.size() <= 256, "memo has more than 256 bytes" );
-
-    sub_balance( from, quantity );
-    add_balance( to, quantity, from ); 
+    transfer_token( from, to, quantity, memo );
 }
 
 void drtoken::drcredit( name to, asset quantity )
@@ -148,47 +75,48 @@ void drtoken::drcredit( name to, asset quantity )
     asset drquantity = asset( quantity.amount, 
                               symbol(DR_TOKEN_NAME, DR_TOKEN_PRECISION) );
 
-    SEND_INLINE_ACTION( *this, 
-                        issue, 
-                        {SLVRTOKEN_CONTRACT_ACCNAME, name("active")},
-                        {to, drquantity, "redemption credit"} );
+    inline_action(
+        permission_level{SLVRTOKEN_CONTRACT_ACCNAME, name("active")},
+        get_self(), name("issue"),
+        to, drquantity, string("redemption credit")
+    ).send();
 }
 
-void drtoken::sub_balance( name owner, asset value )
+void drtoken::setnotify( name account, bool allow, std::vector<symbol_code> symbols )
 {
-    accounts from_acnts( _self, owner.value );
+    set_notify_filter( account, allow, symbols );
+}
+
+void drtoken::clrnotify( name account )
+{
+    clear_notify_filter( account );
+}
 
-    const auto& from = from_acnts.get( value.symbol.raw(),
-                                       "no balance object found" );
+/// moves the legacy stats row of sym into the compact stats table
+void drtoken::migrate( symbol sym )
+{
+    require_auth( get_self() );
 
-    eosio_assert( from.balance.amount >= value.amount, "overdrawn balance" );
+    legacy_stats old_stats( _self, sym.raw() );
+    const auto& old = old_stats.get( sym.raw(), "no legacy stats row for the symbol" );
 
-    if( from.balance.amount == value.amount ) {
-       from_acnts.erase( from );
-    } else {
-        from_acnts.modify( from, owner, [&](auto& a) {
-            a.balance -= value;
-        } );
-   }
+    stats statstable( _self, sym.raw() );
+    statstable.emplace( _self, [&](auto& token_stats_record) {
+        token_stats_record.supply = old.supply;
+        token_stats_record.total_supply = old.total_supply;
+        token_stats_record.issuer = old.issuer;
+        token_stats_record.transfer_locked = old.transfer_locked;
+    } );
+    old_stats.erase( old );
 }
 
-void drtoken::add_balance( name owner, asset value, name ram_payer )
+void drtoken::require_migrated( symbol sym )
 {
-    accounts to_acnts( _self, owner.value );
-
-    auto to = to_acnts.find( value.symbol.raw() );
-
-    if( to == to_acnts.end() ) {
-       to_acnts.emplace( ram_payer, [&](auto& a){
-            a.balance = value;
-        } );
-    } else {
-        to_acnts.modify( to, same_payer, [&](auto& a) {
-            a.balance += value;
-        } );
-    }
+    legacy_stats old_stats( _self, sym.raw() );
+    eosio_assert( old_stats.find( sym.raw() ) == old_stats.end(),
+                  "legacy stats row remains, run migrate first" );
 }
 
 } /// namespace ampersand
 
-EOSIO_DISPATCH(ampersand::drtoken, (create)(issue)(lock)(unlock)(transfer)(drcredit))
+EOSIO_DISPATCH(ampersand::drtoken, (create)(issue)(lock)(unlock)(transfer)(drcredit)(setnotify)(clrnotify)(migrate))
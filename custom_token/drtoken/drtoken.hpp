@@ -9,16 +9,34 @@
 
 #include <string>
 
+#include "../../common/compact_serialize.hpp"
+#include "../../common/inline_action.hpp"
+#include "../../common/token_core.hpp"
+
 using namespace eosio;
 
 namespace ampersand {
 
     using std::string;
 
-    CONTRACT drtoken : public eosio::contract {
+    struct drtoken_policy : token_policy {
+        static constexpr bool transfer_lock = true;
+        static constexpr bool reissue = true;
+        static constexpr bool notify_filter = true;
+
+        static uint64_t key( const symbol& sym ) { return sym.raw(); }
+
+        template<typename Stats>
+        static asset& max_supply( Stats& st ) { return st.total_supply; }
+
+        template<typename Stats>
+        static const asset& max_supply( const Stats& st ) { return st.total_supply; }
+    };
+
+    CONTRACT drtoken : public token_core<drtoken, drtoken_policy> {
 
     public:
-	using contract::contract;
+        using token_core::token_core;
 
         const name SLVRTOKEN_CONTRACT_ACCNAME = name("ampervstoken");
         const string DR_TOKEN_NAME = "ANDS";
@@ -38,17 +56,19 @@ namespace ampersand {
 
         ACTION drcredit( name to, asset quantity ); 
 
-        inline asset get_supply( symbol sym )const;
+        ACTION setnotify( name account, bool allow, std::vector<symbol_code> symbols );
 
-        inline asset get_balance( name owner, symbol sym )const;
+        ACTION clrnotify( name account );
 
-    private:
+        ACTION migrate( symbol sym );
 
+        // the tables are public so host tools can read them through these types
         TABLE account {
             asset balance;
 
             uint64_t primary_key()const { return balance.symbol.raw(); }
 
+            // fixed size: a row paid by its holder must not grow when others credit it
             EOSLIB_SERIALIZE( account, (balance) )
         };
 
@@ -60,16 +80,33 @@ namespace ampersand {
 
             uint64_t primary_key()const { return supply.symbol.raw(); }
 
-            EOSLIB_SERIALIZE( currency_stats, (supply)(total_supply)(issuer)(transfer_locked) )
+            COMPACT_SERIALIZE( currency_stats, compact::assets( supply, total_supply ), issuer,
+                               compact::flags( transfer_locked ) )
+        };
+
+        /**
+         * layout of the stats rows before the compact one, which lives in a new table.
+         * migrate moves a token's row over; until it has, that token's actions fail as
+         * if it did not exist, and create refuses to add a new row for it.
+         */
+        TABLE currency_stats_v1 {
+            asset supply;
+            asset total_supply;
+            name issuer;
+            bool transfer_locked;
+
+            uint64_t primary_key()const { return supply.symbol.raw(); }
+
+            EOSLIB_SERIALIZE( currency_stats_v1, (supply)(total_supply)(issuer)(transfer_locked) )
         };
 
         typedef eosio::multi_index<"accounts"_n, account> accounts;
-        typedef eosio::multi_index<"stats"_n, currency_stats> stats;
+        typedef eosio::multi_index<"supplies"_n, currency_stats> stats;
+        typedef eosio::multi_index<"stats"_n, currency_stats_v1> legacy_stats;
 
-        void sub_balance( name owner, asset value );
-        void add_balance( name owner, asset value, name ram_payer );
+        friend class token_core<drtoken, drtoken_policy>;
 
-    public:
+        void require_migrated( symbol sym );
 
         struct transfer_args {
             name from;
@@ -80,19 +117,5 @@ namespace ampersand {
 
     };
 
-    asset drtoken::get_supply( symbol sym )const
-    {
-        stats statstable( _code, sym.raw() );
-        const auto& st = statstable.get( sym.raw() );
-         return st.supply;
-    }
-
-    asset drtoken::get_balance( name owner, symbol sym )const
-    {
-        accounts accountstable( _code, owner.value );
-        const auto& ac = accountstable.get( sym.raw() );
-        return ac.balance;
-    }
-
 } /// namespace ampersand
 
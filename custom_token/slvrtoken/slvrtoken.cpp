@@ -12,6 +12,7 @@ ACTION slvrtoken::issueopen( asset issue, name issuer, uint64_t round )
 
     auto it = _issues.find( round );
     if ( it==_issues.end()) {
+        require_migrated( issue.symbol );
         _issues.emplace( _code, [&](auto& issue_stats_record) {
             issue_stats_record.round = round;
             issue_stats_record.supply.symbol = issue.symbol;
@@ -50,10 +51,6 @@ ACTION slvrtoken::create( name issuer, asset new_supply,
 {
     require_auth( _code );
 
-    auto sym = new_supply.symbol;
-    eosio_assert( sym.is_valid(), "invalid symbol name " );
-    eosio_assert( new_supply.is_valid(), "invalid supply" );
-    eosio_assert( new_supply.amount > 0, "new_supply must be positive" );
     eosio_assert( slvr_per_token_mg > 0, "slvr_per_token_mg must be positive" );
 
     auto issues_it = _issues.find( issue_round );
@@ -62,27 +59,15 @@ ACTION slvrtoken::create( name issuer, asset new_supply,
     eosio_assert( new_supply.symbol == issues_it->supply.symbol, "symbol precision mismatch");
     eosio_assert( issuer == issues_it->issuer, "issuer mismatch");
 
-    stats statstable( _code, sym.raw() );
-
-    auto iterator = statstable.find( sym.raw() );
-
-    // Token is added for the first time
-    if ( iterator == statstable.end() ){	
-        statstable.emplace( _code, [&](auto& token_stats_record) {
-            token_stats_record.supply.symbol = new_supply.symbol;
-            token_stats_record.total_supply = new_supply;
+    // Token is added for the first time, or already exists and is reissued with new supply
+    create_token( new_supply, [&](auto& token_stats_record, bool created) {
+        if ( created ) {
+            require_migrated( new_supply.symbol );
             token_stats_record.issuer = issuer;
             token_stats_record.contract_locked = contract_locked;
             token_stats_record.slvr_per_token_mg = slvr_per_token_mg;
-        } );
-    // Token Already exists, reissuing with new supply
-    } else {
-        eosio_assert( issuer == issues_it->issuer, "issuer mismatch");
-
-        statstable.modify( iterator, same_payer, [&](auto& token_stats_record) {
-            token_stats_record.total_supply += new_supply;
-        } );
-    }
+        }
+    } );
 
     _issues.modify( issues_it, same_payer, [&](auto& issue_token_stats_record) {
             issue_token_stats_record.total_supply += new_supply;
@@ -95,56 +80,28 @@ ACTION slvrtoken::create( name issuer, asset new_supply,
     asset drquantity = asset( new_supply.amount, 
                               symbol(DR_TOKEN_NAME, DR_TOKEN_PRECISION) );
 
-    action(
+    inline_action(
         ///permission_level{name(DRTOKEN_CONTRACT_ACCNAME), name("active")},
         permission_level{get_self(), name("active")},
         name(DRTOKEN_CONTRACT_ACCNAME), name("create"),
-        std::make_tuple(get_self(), drquantity, true)
+        get_self(), drquantity, true
     ).send();
 }
 
 ACTION slvrtoken::issue( name to, asset quantity, string memo, uint64_t issue_round )
 {
-    auto sym = quantity.symbol;
-    eosio_assert( sym.is_valid(), "invalid symbol name" );
-    eosio_assert( memo.size() <= 256, "memo has more than 256 bytes" );
-    
-    stats statstable( _code, sym.raw() );
-
-    auto iterator = statstable.find( sym.raw() );
-    eosio_assert( iterator != statstable.end(),
-                  "token with symbol does not exist, create token before issue" );
-
     auto issues_it = _issues.find( issue_round );
     eosio_assert( issues_it != _issues.end(), "issue round isn't existing at all");
     eosio_assert( issues_it->open_status == true, "issue is closed, open issue before issuing tokens" );
 
     require_auth( issues_it->issuer ); 
 
-    eosio_assert( quantity.is_valid(), "invalid quantity" );
-    eosio_assert( quantity.amount > 0, "must issue positive quantity" );
-    eosio_assert( quantity.symbol == iterator->supply.symbol,
-                  "symbol precision mismatch");
-    eosio_assert( quantity.amount <= iterator->total_supply.amount - iterator->supply.amount,
-                  "quantity exceeds available supply");
-
-    statstable.modify( iterator, same_payer, [&](auto& token_stats_record) {
-        token_stats_record.supply += quantity;
-    } );
+    issue_token( to, quantity, memo );
 
     _issues.modify( issues_it, same_payer, [&](auto& issue_token_stats_record) {
         issue_token_stats_record.supply += quantity;
     } );
 
-    add_balance( iterator->issuer, quantity, iterator->issuer );   
-
-    if(to != iterator->issuer) {
-        SEND_INLINE_ACTION( *this, 
-                            transfer, 
-                            {iterator->issuer, name("active")},
-                            {iterator->issuer, to, quantity, memo} );
-    }
-
     uint64_t customer_key;
     bool found = false;
     for ( auto& customer : _customers ) {
@@ -160,14 +117,14 @@ ACTION slvrtoken::issue( name to, asset quantity, string memo, uint64_t issue_ro
             customer_record.key = _customers.available_primary_key();
             customer_record.account_name = to;        
             customer_record.issue_round = issue_round;        
-            customer_record.issue_balance = quantity;        
+            customer_record.issue_balance = quantity.amount;        
         } );
     } else {
         auto cust_it = _customers.find( customer_key );
         eosio_assert( cust_it != _customers.end(), "invalid customer id");
 
         _customers.modify( cust_it, same_payer, [&](auto& customer_record) {
-            customer_record.issue_balance += quantity;
+            customer_record.issue_balance += quantity.amount;
         } );
     }
 }
@@ -286,36 +243,7 @@ ACTION slvrtoken::redeemunlock( asset unlock ,uint64_t issue_round )
 ACTION slvrtoken::transfer( name from, name to,
                             asset quantity, string memo )
 {
-    eosio_assert( from != to, "cannot transfer to self" );
-
-    require_auth( from );
-
-    eosio_assert( is_account(to), "to account does not exist" );
-
-    auto symbol = quantity.symbol;
-    stats statstable( _code, symbol.raw() );
-
-    eosio_assert( statstable.find( symbol.raw()) != statstable.end(), 
-                  "token with the symbol doesn't exist");
-
-    require_recipient(from);
-    require_recipient(to);
-
-    const auto& token_stats_record = statstable.get( symbol.raw() );
- 
-    eosio_assert( token_stats_record.contract_locked == false, "contract is locked");
-    eosio_assert( quantity.is_valid(), "invalid quantity" );
-    eosio_assert( quantity.amount > 0, "must transfer positive quantity" );
-    eosio_assert( quantity.symbol == token_stats_record.supply.symbol,
-                  "symbol precision mismatch" );
-    eosio_assert( memo.size() <= 256, "memo has more than 256 bytes" );
-
-    int64_t locked_balance = get_transfer_locked_issues_balance( from );
-
-    sub_balance( from, quantity, locked_balance );
-    add_balance( to, quantity, from );
-
-    transfer_update_issue_customer_tables( from, to, quantity );
+    transfer_token( from, to, quantity, memo );
 }
 
 ACTION slvrtoken::redeem( name owner, asset quantity )
@@ -333,82 +261,135 @@ ACTION slvrtoken::redeem( name owner, asset quantity )
     eosio_assert( token_stats_record.contract_locked == false, "contract is locked");
 
     // burn the slvr tokens
-    SEND_INLINE_ACTION( *this, 
-                        burn, 
-                        {owner, name("active")},
-                        {owner, quantity} );
+    inline_action(
+        permission_level{owner, name("active")},
+        get_self(), name("burn"),
+        owner, quantity
+    ).send();
 
     // transfer quantity size DRTokens to owner's account
-    action(
+    inline_action(
         permission_level{get_self(), name("active")},
         name(DRTOKEN_CONTRACT_ACCNAME), name("drcredit"),
-        std::make_tuple(owner, quantity)
+        owner, quantity
     ).send();
 }
 
 ACTION slvrtoken::burn( name owner, asset quantity )
 {
-    require_auth( owner );
+    burn_token( owner, quantity );
+}
 
-    auto symbol = quantity.symbol;
-    stats statstable( _code, symbol.raw() );
+ACTION slvrtoken::setnotify( name account, bool allow, std::vector<symbol_code> symbols )
+{
+    set_notify_filter( account, allow, symbols );
+}
 
-    eosio_assert( statstable.find(quantity.symbol.raw()) != statstable.end(),
-                  "token with the symbol doesn't exist");
+ACTION slvrtoken::clrnotify( name account )
+{
+    clear_notify_filter( account );
+}
 
-    const auto& token_stats_record = statstable.get(symbol.raw());
+/**
+ * Moves up to max_rows rows of the legacy customers, issues and stats tables into
+ * the compact lots, rounds and supplies tables, in that order.  A token's stats row
+ * moves last, so an action that finds it in the compact table runs on migrated data
+ * without looking at the legacy tables; one that does not fails as if the token did
+ * not exist.  Only issueopen and create, which add compact rows, check the legacy
+ * tables, and only when they add one.
+ */
+ACTION slvrtoken::migrate( uint32_t max_rows )
+{
+    require_auth( _code );
+    eosio_assert( max_rows > 0, "max_rows must be positive" );
 
-    require_recipient(owner);
+    legacy_customers old_customers( get_self(), _code.value );
+    legacy_issues old_issues( get_self(), _code.value );
 
-    eosio_assert( quantity.is_valid(), "invalid quantity" );
-    eosio_assert( quantity.amount > 0, "must burn positive quantity" );
-    eosio_assert( quantity.symbol == token_stats_record.supply.symbol, 
-                  "symbol precision mismatch");
-    
-    statstable.modify( token_stats_record, same_payer, [&](auto& tsr) {
-        tsr.supply -= quantity;
-        tsr.total_supply -= quantity;
-    } );
+    uint32_t rows = 0;
+    auto cust_it = old_customers.begin();
+    while ( cust_it != old_customers.end() && rows < max_rows ) {
+        _customers.emplace( _code, [&](auto& customer_record) {
+            customer_record.key = cust_it->key;
+            customer_record.account_name = cust_it->account_name;
+            customer_record.issue_round = cust_it->issue_round;
+            customer_record.issue_balance = cust_it->issue_balance.amount;
+        } );
+        cust_it = old_customers.erase( cust_it );
+        ++rows;
+    }
 
-    int64_t locked_balance = get_redeem_locked_issues_balance( owner );
+    auto issue_it = old_issues.begin();
+    while ( cust_it == old_customers.end() && issue_it != old_issues.end() && rows < max_rows ) {
+        _issues.emplace( _code, [&](auto& issue_stats_record) {
+            issue_stats_record.round = issue_it->round;
+            issue_stats_record.supply = issue_it->supply;
+            issue_stats_record.total_supply = issue_it->total_supply;
+            issue_stats_record.issuer = issue_it->issuer;
+            issue_stats_record.slvr_per_token_mg = issue_it->slvr_per_token_mg;
+            issue_stats_record.transfer_locked = issue_it->transfer_locked;
+            issue_stats_record.redeem_locked = issue_it->redeem_locked;
+            issue_stats_record.open_status = issue_it->open_status;
+        } );
+        issue_it = old_issues.erase( issue_it );
+        ++rows;
+    }
 
-    sub_balance( owner, quantity, locked_balance );
+    // every token has a round, so the rounds name every legacy stats row
+    bool complete = cust_it == old_customers.end() && issue_it == old_issues.end();
+    if ( complete ) {
+        symbol checked;
+        for ( auto round_it = _issues.begin(); round_it != _issues.end(); ++round_it ) {
+            if ( round_it->supply.symbol == checked ) {
+                continue;
+            }
+            checked = round_it->supply.symbol;
+            if ( rows == max_rows ) {
+                complete = false;
+                break;
+            }
+            if ( migrate_stats( round_it->supply.symbol ) ) {
+                ++rows;
+            }
+        }
+    }
 
-    redeem_update_issue_customer_tables( owner, quantity );
+    print( "Migrated ", rows, " rows. " );
+    if ( complete ) {
+        print( "Migration complete." );
+    } else {
+        print( "Rows remain to be migrated." );
+    }
 }
 
-void slvrtoken::sub_balance( name owner, asset value, int64_t locked_balance )
+/// asserts that no legacy rows remain that a new compact row for sym could clash with
+void slvrtoken::require_migrated( symbol sym )
 {
-    accounts from_acnts( _code, owner.value );
-
-    const auto& from = from_acnts.get( value.symbol.raw(), "no balance object found" );
+    legacy_issues old_issues( get_self(), _code.value );
+    eosio_assert( old_issues.begin() == old_issues.end(), "legacy rows remain, run migrate first" );
 
-    eosio_assert( from.balance.amount - locked_balance >= value.amount, "overdrawn balance or transfer/redeem locked tokens"); 
-
-    if( from.balance.amount == value.amount ) {
-       from_acnts.erase( from );
-    } else {
-        from_acnts.modify( from, owner, [&](auto& a) {
-            a.balance -= value;
-        } );
-   }
+    legacy_stats old_stats( _code, sym.raw() );
+    eosio_assert( old_stats.find( sym.raw() ) == old_stats.end(), "legacy rows remain, run migrate first" );
 }
 
-void slvrtoken::add_balance( name owner, asset value, name ram_payer )
+bool slvrtoken::migrate_stats( symbol sym )
 {
-    accounts to_acnts( _code, owner.value );
-
-    auto to = to_acnts.find( value.symbol.raw() );
-
-    if( to == to_acnts.end() ) {
-       to_acnts.emplace( ram_payer, [&](auto& a){
-            a.balance = value;
-        } );
-    } else {
-        to_acnts.modify( to, same_payer, [&](auto& a) {
-            a.balance += value;
-        } );
+    legacy_stats old_stats( _code, sym.raw() );
+    auto it = old_stats.find( sym.raw() );
+    if ( it == old_stats.end() ) {
+        return false;
     }
+
+    stats statstable( _code, sym.raw() );
+    statstable.emplace( _code, [&](auto& token_stats_record) {
+        token_stats_record.supply = it->supply;
+        token_stats_record.total_supply = it->total_supply;
+        token_stats_record.issuer = it->issuer;
+        token_stats_record.slvr_per_token_mg = it->slvr_per_token_mg;
+        token_stats_record.contract_locked = it->contract_locked;
+    } );
+    old_stats.erase( it );
+    return true;
 }
 
 void slvrtoken::purge_data( name owner )
@@ -459,7 +440,7 @@ int64_t slvrtoken::get_transfer_locked_issues_balance( name owner )
     for ( auto& key : locked_customer_keys ) {
         auto it = _customers.find(key);
         eosio_assert( it != _customers.end(), "invalid customer key" );
-        locked_issues_balance += it->issue_balance.amount;
+        locked_issues_balance += it->issue_balance;
     }
 
     purge_data( owner );
@@ -489,7 +470,7 @@ int64_t slvrtoken::get_redeem_locked_issues_balance( name owner )
     for ( auto& key : locked_customer_keys ) {
         auto it = _customers.find(key);
         eosio_assert( it != _customers.end(), "invalid customer key" );
-        locked_issues_balance += it->issue_balance.amount;
+        locked_issues_balance += it->issue_balance;
     }
 
     purge_data( owner );
@@ -527,14 +508,14 @@ void slvrtoken::transfer_update_issue_customer_tables( name from, name to, asset
         ++index;
         uint64_t curr_issue_round = it->issue_round;
 
-        if ( value.amount >= it->issue_balance.amount ) {
-            updated_amount = it->issue_balance.amount;
-            value.amount -= it->issue_balance.amount;
+        if ( value.amount >= it->issue_balance ) {
+            updated_amount = it->issue_balance;
+            value.amount -= it->issue_balance;
             _customers.erase(it);
         } else {   //if ( value.amount < it->issue_balance ) 
             updated_amount = value.amount;
             _customers.modify( it, _code, [&](auto& customer) {
-                customer.issue_balance.amount -= value.amount;
+                customer.issue_balance -= value.amount;
                 value.amount = 0;
             } );
         }
@@ -553,15 +534,14 @@ void slvrtoken::transfer_update_issue_customer_tables( name from, name to, asset
         if ( to_cust_find_flag == true ) {
             auto cust_it = _customers.find( to_cust_key );
             _customers.modify( cust_it, same_payer, [&](auto& customer_record) {
-                customer_record.issue_balance.amount += updated_amount;
+                customer_record.issue_balance += updated_amount;
             } );
         } else {
             _customers.emplace( _code, [&](auto& customer_record) {
                 customer_record.key = _customers.available_primary_key();
                 customer_record.account_name = to;        
                 customer_record.issue_round = curr_issue_round;        
-                customer_record.issue_balance.amount = updated_amount;        
-                customer_record.issue_balance.symbol= value.symbol;        
+                customer_record.issue_balance = updated_amount;        
             } );
         }
 
@@ -596,18 +576,18 @@ void slvrtoken::redeem_update_issue_customer_tables( name from, asset value )
         ++index;
         
         auto issues_it = _issues.find(it->issue_round);
-        if ( value.amount >= it->issue_balance.amount ) {
-            value.amount -= it->issue_balance.amount;
+        if ( value.amount >= it->issue_balance ) {
+            value.amount -= it->issue_balance;
 
             _issues.modify( issues_it, _code, [&](auto& issue ) {
-                issue.supply.amount -= it->issue_balance.amount;
-                issue.total_supply.amount -= it->issue_balance.amount;
+                issue.supply.amount -= it->issue_balance;
+                issue.total_supply.amount -= it->issue_balance;
             } );
 
             _customers.erase(it);
         } else {   //if ( value.amount < it->issue_balance ) 
             _customers.modify( it, _code, [&](auto& customer) {
-                customer.issue_balance.amount -= value.amount;
+                customer.issue_balance -= value.amount;
 
                 _issues.modify( issues_it, _code, [&](auto& issue ) {
                     issue.supply.amount -= value.amount ;
@@ -624,5 +604,5 @@ void slvrtoken::redeem_update_issue_customer_tables( name from, asset value )
 } /// namespace ampersand
 
 EOSIO_DISPATCH(ampersand::slvrtoken, 
-                (issueopen)(issueclose)(create)(issue)(lock)(unlock) (redeemlock)(redeemunlock)(redeem)(transfer)(burn)(tokenlock)(tokenunlock))
+                (issueopen)(issueclose)(create)(issue)(lock)(unlock) (redeemlock)(redeemunlock)(redeem)(transfer)(burn)(tokenlock)(tokenunlock)(setnotify)(clrnotify)(migrate))
                
@@ -9,24 +9,42 @@
 
 #include <string>
 
+#include "../../common/compact_serialize.hpp"
+#include "../../common/inline_action.hpp"
+#include "../../common/token_core.hpp"
+
 using namespace eosio;
 
 namespace ampersand {
 
     using std::string;
 
-    CONTRACT slvrtoken : public eosio::contract {
+    struct slvrtoken_policy : token_policy {
+        static constexpr bool contract_lock = true;
+        static constexpr bool issue_lots = true;
+        static constexpr bool reissue = true;
+        static constexpr bool issuer_auth = false;   // issue checks the round's issuer
+        static constexpr bool notify_filter = true;
 
-    public:
-	using contract::contract;
+        static uint64_t key( const symbol& sym ) { return sym.raw(); }
+
+        template<typename Stats>
+        static asset& max_supply( Stats& st ) { return st.total_supply; }
+
+        template<typename Stats>
+        static const asset& max_supply( const Stats& st ) { return st.total_supply; }
+    };
+
+    CONTRACT slvrtoken : public token_core<slvrtoken, slvrtoken_policy> {
 
+    public:
         const name SLVRTOKEN_CONTRACT_ACCNAME = name("ampervstoken");
         const name DRTOKEN_CONTRACT_ACCNAME = name("amperdrtoken");
         const string DR_TOKEN_NAME = "ANDS";
         const uint8_t DR_TOKEN_PRECISION = 4;
 
         slvrtoken(eosio::name receiver, eosio::name code, eosio::datastream<const char*> ds ): 
-              eosio::contract(receiver, code, ds),  _issues(receiver, code.value), _customers(receiver, code.value)
+              token_core(receiver, code, ds),  _issues(receiver, code.value), _customers(receiver, code.value)
         {}
 
         ACTION issueopen( asset issue, name issuer, uint64_t round );
@@ -57,17 +75,19 @@ namespace ampersand {
 
         ACTION burn( name owner, asset quantity );
 
-        inline asset get_supply( symbol sym )const;
+        ACTION setnotify( name account, bool allow, std::vector<symbol_code> symbols );
 
-        inline asset get_balance( name owner, symbol sym )const;
+        ACTION clrnotify( name account );
 
-    private:
+        ACTION migrate( uint32_t max_rows );
 
+        // the tables are public so host tools can seed and read them through these types
         TABLE account {
             asset balance;
 
             uint64_t primary_key()const { return balance.symbol.raw(); }
 
+            // fixed size: a row paid by its holder must not grow when others credit it
             EOSLIB_SERIALIZE( account, (balance) )
         };
 
@@ -80,8 +100,8 @@ namespace ampersand {
 
             uint64_t primary_key()const { return supply.symbol.raw(); }
 
-            EOSLIB_SERIALIZE( currency_stats, (supply)(total_supply)(issuer)
-                               (slvr_per_token_mg)(contract_locked) )
+            COMPACT_SERIALIZE( currency_stats, compact::assets( supply, total_supply ), issuer,
+                               compact::varint( slvr_per_token_mg ), compact::flags( contract_locked ) )
         };
 
         TABLE issuestats {
@@ -96,34 +116,86 @@ namespace ampersand {
 
             uint64_t primary_key()const { return round; }
 
-            EOSLIB_SERIALIZE( issuestats, (round)(supply)(total_supply)(issuer)(slvr_per_token_mg)
-                                     (transfer_locked)(redeem_locked)(open_status) )
+            COMPACT_SERIALIZE( issuestats, compact::varint( round ), compact::assets( supply, total_supply ),
+                               issuer, compact::varint( slvr_per_token_mg ),
+                               compact::flags( transfer_locked, redeem_locked, open_status ) )
         };
 
         TABLE custinfo {
+            uint64_t key;
+            name account_name;
+            uint64_t issue_round;
+            int64_t issue_balance; // in the symbol of the issue round
+            uint64_t primary_key() const { return key; }
+            COMPACT_SERIALIZE( custinfo, compact::varint( key ), account_name, compact::varint( issue_round ),
+                               compact::varint( issue_balance ) )
+       };
+
+        /**
+         * layouts of the stats, issues and customers rows before the compact ones,
+         * which live in new tables.  migrate moves the rows over, stats rows last; until
+         * it has moved a token's stats row, that token's actions fail.
+         */
+        TABLE currency_stats_v1 {
+            asset supply;
+            asset total_supply;
+            name issuer;
+            uint16_t slvr_per_token_mg;
+            bool contract_locked;
+
+            uint64_t primary_key()const { return supply.symbol.raw(); }
+
+            EOSLIB_SERIALIZE( currency_stats_v1, (supply)(total_supply)(issuer)
+                               (slvr_per_token_mg)(contract_locked) )
+        };
+
+        TABLE issuestats_v1 {
+            uint64_t round;
+            asset supply;
+            asset total_supply;
+            name issuer;
+            uint16_t slvr_per_token_mg;
+            bool transfer_locked;
+            bool redeem_locked;
+            bool open_status;
+
+            uint64_t primary_key()const { return round; }
+
+            EOSLIB_SERIALIZE( issuestats_v1, (round)(supply)(total_supply)(issuer)(slvr_per_token_mg)
+                                     (transfer_locked)(redeem_locked)(open_status) )
+        };
+
+        TABLE custinfo_v1 {
             uint64_t key;
             name account_name;
             uint64_t issue_round;
             asset issue_balance;
             uint64_t primary_key() const { return key; }
-            EOSLIB_SERIALIZE( custinfo, (key)(account_name)(issue_round)(issue_balance) )
+            EOSLIB_SERIALIZE( custinfo_v1, (key)(account_name)(issue_round)(issue_balance) )
        };
 
         typedef eosio::multi_index<"accounts"_n, account> accounts;
-        typedef eosio::multi_index<"stats"_n, currency_stats> stats;
-        typedef eosio::multi_index<"issues"_n, issuestats> issues;
-        typedef eosio::multi_index<"customers"_n, custinfo> customers;
+        typedef eosio::multi_index<"supplies"_n, currency_stats> stats;
+        typedef eosio::multi_index<"rounds"_n, issuestats> issues;
+        typedef eosio::multi_index<"lots"_n, custinfo> customers;
+
+        typedef eosio::multi_index<"stats"_n, currency_stats_v1> legacy_stats;
+        typedef eosio::multi_index<"issues"_n, issuestats_v1> legacy_issues;
+        typedef eosio::multi_index<"customers"_n, custinfo_v1> legacy_customers;
+
+    private:
+        friend class token_core<slvrtoken, slvrtoken_policy>;
 
         issues _issues;
         customers _customers;
 
-        void sub_balance( name owner, asset value, int64_t locked_balance );
-        void add_balance( name owner, asset value, name ram_payer );
         int64_t get_transfer_locked_issues_balance( name owner );
         int64_t get_redeem_locked_issues_balance( name owner );
         void transfer_update_issue_customer_tables( name from, name to, asset value );
         void redeem_update_issue_customer_tables( name from, asset value );
         void purge_data( name owner );
+        void require_migrated( symbol sym );
+        bool migrate_stats( symbol sym );
             
     public:
 
@@ -136,18 +208,4 @@ namespace ampersand {
 
     };
 
-    asset slvrtoken::get_supply( symbol sym )const
-    {
-        stats statstable( _code, sym.raw() );
-        const auto& st = statstable.get( sym.raw() );
-         return st.supply;
-    }
-
-    asset slvrtoken::get_balance( name owner, symbol sym )const
-    {
-        accounts accountstable( _code, owner.value );
-        const auto& ac = accountstable.get( sym.raw() );
-        return ac.balance;
-    }
-
 } /// namespace ampersand
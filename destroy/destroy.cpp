@@ -3,7 +3,7 @@
  *  @copyright defined in eos/LICENSE.txt
  */
 
-#include "token_ram_recovery.hpp"
+#include "destroy.hpp"
 
 namespace eosio {
 
@@ -31,6 +31,110 @@ void token::destroyacc( string symbol, account_name acc)
     acctable.erase( row );
 }
 
+void token::queueaccs( string symbol, vector<account_name> accs )
+{
+    require_auth( _self );
+
+    symbol_type sym = string_to_symbol(0, symbol.c_str());
+    auto sym_name = sym.name();
+
+    pending queue( _self, sym_name );
+    uint64_t added = 0;
+    for ( auto acc : accs ) {
+        if ( queue.find( acc ) == queue.end() ) {
+            queue.emplace( _self, [&]( auto& p ) {
+                p.account = acc;
+            });
+            ++added;
+        }
+    }
+
+    cleanups cleanuptable( _self, _self );
+    auto state = cleanuptable.find( sym_name );
+    if ( state == cleanuptable.end() ) {
+        state = cleanuptable.emplace( _self, [&]( auto& s ) {
+            s.symbol_name = sym_name;
+            s.queued = added;
+            s.visited = 0;
+            s.erased = 0;
+        });
+    } else {
+        cleanuptable.modify( state, 0, [&]( auto& s ) {
+            s.queued += added;
+        });
+    }
+
+    print( "queued ", added, " accounts, ", state->queued - state->visited, " pending" );
+}
+
+/**
+ * erases up to max_rows accounts rows for the symbol.  with a list, the first
+ * max_rows listed accounts are visited and the caller resubmits the rest; with an
+ * empty list, accounts queued by queueaccs are visited and removed from the queue.
+ */
+void token::destroyaccs( string symbol, vector<account_name> accs, uint32_t max_rows )
+{
+    require_auth( _self );
+    eosio_assert( max_rows > 0, "max_rows must be positive" );
+
+    symbol_type sym = string_to_symbol(0, symbol.c_str());
+    auto sym_name = sym.name();
+
+    uint64_t visited = 0;
+    uint64_t erased = 0;
+
+    if ( !accs.empty() ) {
+        for ( ; visited < accs.size() && visited < max_rows; ++visited ) {
+            if ( destroy_balance( sym_name, accs[visited] ) ) {
+                ++erased;
+            }
+        }
+
+        print( "erased ", erased, " of ", visited, " accounts, ", accs.size() - visited, " not visited" );
+        return;
+    }
+
+    pending queue( _self, sym_name );
+    auto it = queue.begin();
+    for ( ; it != queue.end() && visited < max_rows; ++visited ) {
+        if ( destroy_balance( sym_name, it->account ) ) {
+            ++erased;
+        }
+        it = queue.erase( it );
+    }
+
+    cleanups cleanuptable( _self, _self );
+    auto state = cleanuptable.find( sym_name );
+    eosio_assert( state != cleanuptable.end(), "no accounts queued for provided symbol" );
+
+    if ( it == queue.end() ) {
+        print( "erased ", erased, " of ", visited, " accounts, cleanup complete: ",
+               state->erased + erased, " of ", state->queued, " queued accounts had balances" );
+        cleanuptable.erase( state );
+        return;
+    }
+
+    cleanuptable.modify( state, 0, [&]( auto& s ) {
+        s.visited += visited;
+        s.erased += erased;
+    });
+
+    print( "erased ", erased, " of ", visited, " accounts, ",
+           state->visited, " of ", state->queued, " queued accounts visited" );
+}
+
+bool token::destroy_balance( uint64_t sym_name, account_name acc )
+{
+    accounts acctable( _self, acc );
+    auto row = acctable.find( sym_name );
+    if ( row == acctable.end() ) {
+        return false;
+    }
+
+    acctable.erase( row );
+    return true;
+}
+
 } /// namespace eosio
 
-EOSIO_ABI( eosio::token, (destroytoken)(destroyacc) )
+EOSIO_ABI( eosio::token, (destroytoken)(destroyacc)(queueaccs)(destroyaccs) )
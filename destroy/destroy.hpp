@@ -4,6 +4,7 @@
 #include <eosiolib/eosio.hpp>
 
 #include <string>
+#include <vector>
 
 namespace eosiosystem {
    class system_contract;
@@ -12,6 +13,7 @@ namespace eosiosystem {
 namespace eosio {
 
    using std::string;
+   using std::vector;
 
    class token : public contract {
       public:
@@ -23,6 +25,12 @@ namespace eosio {
          //@abi action
          void destroyacc( string symbol, account_name acc );
 
+         //@abi action
+         void queueaccs( string symbol, vector<account_name> accs );
+
+         //@abi action
+         void destroyaccs( string symbol, vector<account_name> accs, uint32_t max_rows );
+
       private:
          //@abi table accounts i64
          struct account {
@@ -40,8 +48,35 @@ namespace eosio {
             uint64_t primary_key()const { return supply.symbol.name(); }
          };
 
+         /**
+          * account queued for balance removal, scoped by symbol name.  the table is
+          * the cursor destroyaccs resumes from when it is not given a list.
+          */
+         //@abi table pending i64
+         struct pending_account {
+            account_name   account;
+
+            uint64_t primary_key()const { return account; }
+         };
+
+         /**
+          * progress of a queued cleanup, one row per symbol name
+          */
+         //@abi table cleanup i64
+         struct cleanup_state {
+            uint64_t       symbol_name;
+            uint64_t       queued;
+            uint64_t       visited;
+            uint64_t       erased;
+
+            uint64_t primary_key()const { return symbol_name; }
+         };
+
          typedef eosio::multi_index<N(accounts), account> accounts;
          typedef eosio::multi_index<N(stat), token_stats> stats;
+         typedef eosio::multi_index<N(pending), pending_account> pending;
+         typedef eosio::multi_index<N(cleanup), cleanup_state> cleanups;
+
+         bool destroy_balance( uint64_t sym_name, account_name acc );
    };
 } /// namespace eosio
-
@@ -0,0 +1,37 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/system.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+uint32_t read_action_data( void* msg, uint32_t len );
+
+uint32_t action_data_size( void );
+
+void require_recipient( capi_name name );
+
+void require_auth( capi_name name );
+
+void require_auth2( capi_name name, capi_name permission );
+
+bool has_auth( capi_name name );
+
+bool is_account( capi_name name );
+
+void send_inline( char* serialized_action, size_t size );
+
+void send_context_free_inline( char* serialized_action, size_t size );
+
+uint64_t publication_time( void );
+
+capi_name current_receiver( void );
+
+#ifdef __cplusplus
+}
+#endif
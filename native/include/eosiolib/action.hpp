@@ -0,0 +1,142 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/action.h>
+#include <eosiolib/serialize.hpp>
+#include <eosiolib/system.hpp>
+
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+   template<typename T>
+   T unpack_action_data() {
+      std::vector<char> buffer( action_data_size() );
+      if( buffer.size() )
+         read_action_data( buffer.data(), buffer.size() );
+      return unpack<T>( buffer.data(), buffer.size() );
+   }
+
+   inline void require_recipient( name notify_account ) {
+      ::require_recipient( notify_account.value );
+   }
+
+   template<typename... Accounts>
+   void require_recipient( name notify_account, Accounts... remaining_accounts ) {
+      ::require_recipient( notify_account.value );
+      require_recipient( remaining_accounts... );
+   }
+
+   inline void require_auth( name n ) {
+      ::require_auth( n.value );
+   }
+
+   inline bool has_auth( name n ) {
+      return ::has_auth( n.value );
+   }
+
+   inline bool is_account( name n ) {
+      return ::is_account( n.value );
+   }
+
+   inline name current_receiver() {
+      return name{ ::current_receiver() };
+   }
+
+   struct permission_level {
+      permission_level( name a, name p ) : actor(a), permission(p) {}
+
+      /// legacy account_name and permission_name values
+      permission_level( uint64_t a, uint64_t p ) : actor(a), permission(p) {}
+
+      permission_level() {}
+
+      name actor;
+      name permission;
+
+      friend constexpr bool operator == ( const permission_level& a, const permission_level& b ) {
+         return a.actor == b.actor && a.permission == b.permission;
+      }
+
+      EOSLIB_SERIALIZE( permission_level, (actor)(permission) )
+   };
+
+   inline void require_auth( const permission_level& level ) {
+      ::require_auth2( level.actor.value, level.permission.value );
+   }
+
+   struct action {
+      eosio::name account;
+      eosio::name name;
+      std::vector<permission_level> authorization;
+      std::vector<char> data;
+
+      action() = default;
+
+      template<typename T>
+      action( const permission_level& auth, eosio::name a, eosio::name n, T&& value )
+         : account(a), name(n), authorization(1, auth), data( pack( std::forward<T>(value) ) ) {}
+
+      template<typename T>
+      action( std::vector<permission_level> auths, eosio::name a, eosio::name n, T&& value )
+         : account(a), name(n), authorization( std::move(auths) ), data( pack( std::forward<T>(value) ) ) {}
+
+      /// legacy account_name and action_name values
+      template<typename T>
+      action( const permission_level& auth, uint64_t a, uint64_t n, T&& value )
+         : account(a), name(n), authorization(1, auth), data( pack( std::forward<T>(value) ) ) {}
+
+      template<typename T>
+      action( std::vector<permission_level> auths, uint64_t a, uint64_t n, T&& value )
+         : account(a), name(n), authorization( std::move(auths) ), data( pack( std::forward<T>(value) ) ) {}
+
+      void send()const {
+         auto serialize = pack( *this );
+         ::send_inline( serialize.data(), serialize.size() );
+      }
+
+      void send_context_free()const {
+         eosio_assert( authorization.size() == 0, "context free actions cannot have authorizations" );
+         auto serialize = pack( *this );
+         ::send_context_free_inline( serialize.data(), serialize.size() );
+      }
+
+      template<typename T>
+      T data_as() {
+         return unpack<T>( data.data(), data.size() );
+      }
+
+      EOSLIB_SERIALIZE( action, (account)(name)(authorization)(data) )
+   };
+
+   template<typename, uint64_t>
+   struct inline_dispatcher;
+
+   template<typename T, uint64_t Name, typename... Ts>
+   struct inline_dispatcher<void(T::*)(Ts...), Name> {
+      static void call( eosio::name code, const permission_level& perm, std::tuple<Ts...> args ) {
+         action( perm, code, eosio::name(Name), std::move(args) ).send();
+      }
+
+      static void call( eosio::name code, std::vector<permission_level> perms, std::tuple<Ts...> args ) {
+         action( std::move(perms), code, eosio::name(Name), std::move(args) ).send();
+      }
+   };
+
+} /// namespace eosio
+
+#define INLINE_ACTION_SENDER3( CONTRACT_ACCOUNT, FUNCTION_NAME, ACTION_NAME ) \
+   ::eosio::inline_dispatcher<decltype(&CONTRACT_ACCOUNT::FUNCTION_NAME), ACTION_NAME>::call
+
+#define INLINE_ACTION_SENDER2( CONTRACT_CLASS, NAME ) \
+   INLINE_ACTION_SENDER3( CONTRACT_CLASS, NAME, ::eosio::string_to_name(#NAME) )
+
+#define INLINE_ACTION_SENDER( CONTRACT_CLASS, NAME ) INLINE_ACTION_SENDER2( CONTRACT_CLASS, NAME )
+
+#define SEND_INLINE_ACTION( CONTRACT, NAME, ... ) \
+   INLINE_ACTION_SENDER( std::decay_t<decltype(CONTRACT)>, NAME )( (CONTRACT).get_self(), __VA_ARGS__ );
@@ -0,0 +1,149 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/serialize.hpp>
+#include <eosiolib/print.hpp>
+#include <eosiolib/symbol.hpp>
+
+#include <string>
+
+namespace eosio {
+
+   struct asset {
+      int64_t amount = 0;
+
+      eosio::symbol symbol;
+
+      static constexpr int64_t max_amount = (1LL << 62) - 1;
+
+      asset() {}
+
+      asset( int64_t a, eosio::symbol s ) : amount(a), symbol{s} {
+         eosio_assert( is_amount_within_range(), "magnitude of asset amount must be less than 2^62" );
+         eosio_assert( symbol.is_valid(), "invalid symbol name" );
+      }
+
+      bool is_amount_within_range()const { return -max_amount <= amount && amount <= max_amount; }
+
+      bool is_valid()const { return is_amount_within_range() && symbol.is_valid(); }
+
+      void set_amount( int64_t a ) {
+         amount = a;
+         eosio_assert( is_amount_within_range(), "magnitude of asset amount must be less than 2^62" );
+      }
+
+      asset operator-()const {
+         asset r = *this;
+         r.amount = -r.amount;
+         return r;
+      }
+
+      asset& operator-=( const asset& a ) {
+         eosio_assert( a.symbol == symbol, "attempt to subtract asset with different symbol" );
+         amount -= a.amount;
+         eosio_assert( -max_amount <= amount, "subtraction underflow" );
+         eosio_assert( amount <= max_amount, "subtraction overflow" );
+         return *this;
+      }
+
+      asset& operator+=( const asset& a ) {
+         eosio_assert( a.symbol == symbol, "attempt to add asset with different symbol" );
+         amount += a.amount;
+         eosio_assert( -max_amount <= amount, "addition underflow" );
+         eosio_assert( amount <= max_amount, "addition overflow" );
+         return *this;
+      }
+
+      inline friend asset operator+( const asset& a, const asset& b ) {
+         asset result = a;
+         result += b;
+         return result;
+      }
+
+      inline friend asset operator-( const asset& a, const asset& b ) {
+         asset result = a;
+         result -= b;
+         return result;
+      }
+
+      asset& operator*=( int64_t a ) {
+         int128_t tmp = (int128_t)amount * (int128_t)a;
+         eosio_assert( tmp <= max_amount, "multiplication overflow" );
+         eosio_assert( tmp >= -max_amount, "multiplication underflow" );
+         amount = (int64_t)tmp;
+         return *this;
+      }
+
+      friend asset operator*( const asset& a, int64_t b ) {
+         asset result = a;
+         result *= b;
+         return result;
+      }
+
+      friend asset operator*( int64_t b, const asset& a ) {
+         asset result = a;
+         result *= b;
+         return result;
+      }
+
+      asset& operator/=( int64_t a ) {
+         eosio_assert( a != 0, "divide by zero" );
+         eosio_assert( !(amount == std::numeric_limits<int64_t>::min() && a == -1), "signed division overflow" );
+         amount /= a;
+         return *this;
+      }
+
+      friend asset operator/( const asset& a, int64_t b ) {
+         asset result = a;
+         result /= b;
+         return result;
+      }
+
+      friend int64_t operator/( const asset& a, const asset& b ) {
+         eosio_assert( b.amount != 0, "divide by zero" );
+         eosio_assert( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" );
+         return a.amount / b.amount;
+      }
+
+      friend bool operator==( const asset& a, const asset& b ) {
+         eosio_assert( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" );
+         return a.amount == b.amount;
+      }
+
+      friend bool operator!=( const asset& a, const asset& b ) { return !( a == b ); }
+
+      friend bool operator<( const asset& a, const asset& b ) {
+         eosio_assert( a.symbol == b.symbol, "comparison of assets with different symbols is not allowed" );
+         return a.amount < b.amount;
+      }
+
+      friend bool operator<=( const asset& a, const asset& b ) { return !( b < a ); }
+      friend bool operator>( const asset& a, const asset& b ) { return b < a; }
+      friend bool operator>=( const asset& a, const asset& b ) { return !( a < b ); }
+
+      std::string to_string()const {
+         int64_t p = (int64_t)symbol.precision();
+         int64_t p10 = 1;
+         for( int64_t i = 0; i < p; ++i )
+            p10 *= 10;
+         bool negative = amount < 0;
+         uint64_t a = negative ? -(uint64_t)amount : (uint64_t)amount;
+         std::string result = std::to_string( a / p10 );
+         if( p > 0 ) {
+            std::string fraction = std::to_string( a % p10 );
+            result += "." + std::string( p - fraction.size(), '0' ) + fraction;
+         }
+         return ( negative ? "-" : "" ) + result + " " + symbol.code().to_string();
+      }
+
+      void print()const {
+         prints( to_string().c_str() );
+      }
+
+      EOSLIB_SERIALIZE( asset, (amount)(symbol) )
+   };
+
+} /// namespace eosio
@@ -0,0 +1,442 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/system.h>
+#include <eosiolib/varint.hpp>
+#include <eosiolib/name.hpp>
+#include <eosiolib/symbol.hpp>
+
+#include <array>
+#include <cstring>
+#include <map>
+#include <optional>
+#include <set>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+namespace eosio {
+
+   /**
+    * Reads and writes packed values in a fixed buffer.  datastream<size_t> only
+    * counts the bytes that would be written.
+    */
+   template<typename T>
+   class datastream {
+   public:
+      datastream( T start, size_t s ) : _start(start), _pos(start), _end(start + s) {}
+
+      void skip( size_t s ) { _pos += s; }
+
+      bool read( char* d, size_t s ) {
+         eosio_assert( size_t(_end - _pos) >= s, "read" );
+         memcpy( d, _pos, s );
+         _pos += s;
+         return true;
+      }
+
+      bool write( const char* d, size_t s ) {
+         eosio_assert( size_t(_end - _pos) >= s, "write" );
+         memcpy( (void*)_pos, d, s );
+         _pos += s;
+         return true;
+      }
+
+      bool put( char c ) {
+         eosio_assert( _pos < _end, "put" );
+         *_pos = c;
+         ++_pos;
+         return true;
+      }
+
+      bool get( unsigned char& c ) { return get( *(char*)&c ); }
+
+      bool get( char& c ) {
+         eosio_assert( _pos < _end, "get" );
+         c = *_pos;
+         ++_pos;
+         return true;
+      }
+
+      T pos()const { return _pos; }
+      bool valid()const { return _pos <= _end && _pos >= _start; }
+      bool seekp( size_t p ) { _pos = _start + p; return _pos <= _end; }
+      size_t tellp()const { return size_t(_pos - _start); }
+      size_t remaining()const { return _end - _pos; }
+
+   private:
+      T _start;
+      T _pos;
+      T _end;
+   };
+
+   template<>
+   class datastream<size_t> {
+   public:
+      datastream( size_t init_size = 0 ) : _size(init_size) {}
+
+      bool skip( size_t s ) { _size += s; return true; }
+      bool write( const char*, size_t s ) { _size += s; return true; }
+      bool put( char ) { ++_size; return true; }
+      bool valid()const { return true; }
+      bool seekp( size_t p ) { _size = p; return true; }
+      size_t tellp()const { return _size; }
+      size_t remaining()const { return 0; }
+
+   private:
+      size_t _size;
+   };
+
+   namespace _datastream_detail {
+
+      template<typename T>
+      constexpr bool is_pod_value = std::is_arithmetic_v<T> || std::is_enum_v<T>
+                                    || std::is_same_v<T, uint128_t> || std::is_same_v<T, int128_t>;
+
+      /// set by EOSLIB_SERIALIZE, so reflected aggregates and explicit layouts never compete
+      template<typename T, typename = void>
+      struct has_serialize : std::false_type {};
+
+      template<typename T>
+      struct has_serialize<T, std::void_t<typename T::eoslib_serialize_tag>> : std::true_type {};
+
+      struct any_field {
+         template<typename Type>
+         constexpr operator Type&()const noexcept;
+      };
+
+      template<typename T, typename Seq, typename = void>
+      struct is_brace_constructible : std::false_type {};
+
+      template<typename T, size_t... I>
+      struct is_brace_constructible<T, std::index_sequence<I...>,
+                                    std::void_t<decltype( T{ (void(I), any_field{})... } )>> : std::true_type {};
+
+      template<typename T, size_t N = 32>
+      constexpr size_t field_count() {
+         if constexpr( N == 0 )
+            return 0;
+         else if constexpr( is_brace_constructible<T, std::make_index_sequence<N>>::value )
+            return N;
+         else
+            return field_count<T, N - 1>();
+      }
+
+      /**
+       * Calls f on each field of an aggregate, in declaration order.  Stands in for
+       * the reflection CDT uses for tables declared without EOSLIB_SERIALIZE.
+       */
+      template<typename T, typename F>
+      void for_each_field( T& t, F&& f ) {
+         constexpr size_t n = field_count<std::remove_const_t<T>>();
+         static_assert( n > 0, "type has no fields to serialize" );
+         if constexpr( n == 1 ) { auto& [f0] = t; f(f0); }
+         else if constexpr( n == 2 ) { auto& [f0, f1] = t; f(f0), f(f1); }
+         else if constexpr( n == 3 ) { auto& [f0, f1, f2] = t; f(f0), f(f1), f(f2); }
+         else if constexpr( n == 4 ) { auto& [f0, f1, f2, f3] = t; f(f0), f(f1), f(f2), f(f3); }
+         else if constexpr( n == 5 ) { auto& [f0, f1, f2, f3, f4] = t; f(f0), f(f1), f(f2), f(f3), f(f4); }
+         else if constexpr( n == 6 ) { auto& [f0, f1, f2, f3, f4, f5] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5); }
+         else if constexpr( n == 7 ) { auto& [f0, f1, f2, f3, f4, f5, f6] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6); }
+         else if constexpr( n == 8 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7); }
+         else if constexpr( n == 9 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8); }
+         else if constexpr( n == 10 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9); }
+         else if constexpr( n == 11 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10); }
+         else if constexpr( n == 12 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11); }
+         else if constexpr( n == 13 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12); }
+         else if constexpr( n == 14 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13); }
+         else if constexpr( n == 15 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14); }
+         else if constexpr( n == 16 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15); }
+         else if constexpr( n == 17 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16); }
+         else if constexpr( n == 18 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17); }
+         else if constexpr( n == 19 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18); }
+         else if constexpr( n == 20 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19); }
+         else if constexpr( n == 21 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20); }
+         else if constexpr( n == 22 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21); }
+         else if constexpr( n == 23 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21), f(f22); }
+         else if constexpr( n == 24 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21), f(f22), f(f23); }
+         else if constexpr( n == 25 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21), f(f22), f(f23), f(f24); }
+         else if constexpr( n == 26 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21), f(f22), f(f23), f(f24), f(f25); }
+         else if constexpr( n == 27 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21), f(f22), f(f23), f(f24), f(f25), f(f26); }
+         else if constexpr( n == 28 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21), f(f22), f(f23), f(f24), f(f25), f(f26), f(f27); }
+         else if constexpr( n == 29 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21), f(f22), f(f23), f(f24), f(f25), f(f26), f(f27), f(f28); }
+         else if constexpr( n == 30 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21), f(f22), f(f23), f(f24), f(f25), f(f26), f(f27), f(f28), f(f29); }
+         else if constexpr( n == 31 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21), f(f22), f(f23), f(f24), f(f25), f(f26), f(f27), f(f28), f(f29), f(f30); }
+         else if constexpr( n == 32 ) { auto& [f0, f1, f2, f3, f4, f5, f6, f7, f8, f9, f10, f11, f12, f13, f14, f15, f16, f17, f18, f19, f20, f21, f22, f23, f24, f25, f26, f27, f28, f29, f30, f31] = t; f(f0), f(f1), f(f2), f(f3), f(f4), f(f5), f(f6), f(f7), f(f8), f(f9), f(f10), f(f11), f(f12), f(f13), f(f14), f(f15), f(f16), f(f17), f(f18), f(f19), f(f20), f(f21), f(f22), f(f23), f(f24), f(f25), f(f26), f(f27), f(f28), f(f29), f(f30), f(f31); }
+         else static_assert( n <= 32, "too many fields to serialize" );
+      }
+
+      template<typename T>
+      constexpr bool is_reflected = std::is_class_v<T> && std::is_aggregate_v<T> && !has_serialize<T>::value;
+
+   } /// namespace _datastream_detail
+
+   template<typename DataStream, typename T,
+            std::enable_if_t<_datastream_detail::is_pod_value<T>>* = nullptr>
+   DataStream& operator << ( DataStream& ds, const T& v ) {
+      ds.write( (const char*)&v, sizeof(T) );
+      return ds;
+   }
+
+   template<typename DataStream, typename T,
+            std::enable_if_t<_datastream_detail::is_pod_value<T>>* = nullptr>
+   DataStream& operator >> ( DataStream& ds, T& v ) {
+      ds.read( (char*)&v, sizeof(T) );
+      return ds;
+   }
+
+   template<typename DataStream>
+   DataStream& operator << ( DataStream& ds, const name& v ) { return ds << v.value; }
+
+   template<typename DataStream>
+   DataStream& operator >> ( DataStream& ds, name& v ) { return ds >> v.value; }
+
+   template<typename DataStream>
+   DataStream& operator << ( DataStream& ds, const symbol_code& v ) { return ds << v.raw(); }
+
+   template<typename DataStream>
+   DataStream& operator >> ( DataStream& ds, symbol_code& v ) {
+      uint64_t raw = 0;
+      ds >> raw;
+      v = symbol_code(raw);
+      return ds;
+   }
+
+   template<typename DataStream>
+   DataStream& operator << ( DataStream& ds, const symbol& v ) { return ds << v.raw(); }
+
+   template<typename DataStream>
+   DataStream& operator >> ( DataStream& ds, symbol& v ) {
+      uint64_t raw = 0;
+      ds >> raw;
+      v = symbol(raw);
+      return ds;
+   }
+
+   template<typename DataStream>
+   DataStream& operator << ( DataStream& ds, const std::string& v ) {
+      ds << unsigned_int( v.size() );
+      if( v.size() )
+         ds.write( v.data(), v.size() );
+      return ds;
+   }
+
+   template<typename DataStream>
+   DataStream& operator >> ( DataStream& ds, std::string& v ) {
+      unsigned_int s;
+      ds >> s;
+      v.resize( s.value );
+      if( s.value )
+         ds.read( &v[0], s.value );
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator << ( DataStream& ds, const std::vector<T>& v ) {
+      ds << unsigned_int( v.size() );
+      if constexpr( _datastream_detail::is_pod_value<T> && !std::is_same_v<T, bool> ) {
+         if( v.size() )
+            ds.write( (const char*)v.data(), v.size() * sizeof(T) );
+      } else {
+         for( const auto& i : v )
+            ds << i;
+      }
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator >> ( DataStream& ds, std::vector<T>& v ) {
+      unsigned_int s;
+      ds >> s;
+      v.resize( s.value );
+      if constexpr( _datastream_detail::is_pod_value<T> && !std::is_same_v<T, bool> ) {
+         if( s.value )
+            ds.read( (char*)v.data(), v.size() * sizeof(T) );
+      } else {
+         for( auto& i : v )
+            ds >> i;
+      }
+      return ds;
+   }
+
+   template<typename DataStream, typename T, size_t N>
+   DataStream& operator << ( DataStream& ds, const std::array<T, N>& v ) {
+      for( const auto& i : v )
+         ds << i;
+      return ds;
+   }
+
+   template<typename DataStream, typename T, size_t N>
+   DataStream& operator >> ( DataStream& ds, std::array<T, N>& v ) {
+      for( auto& i : v )
+         ds >> i;
+      return ds;
+   }
+
+   template<typename DataStream, typename K, typename V>
+   DataStream& operator << ( DataStream& ds, const std::pair<K, V>& v ) {
+      return ds << v.first << v.second;
+   }
+
+   template<typename DataStream, typename K, typename V>
+   DataStream& operator >> ( DataStream& ds, std::pair<K, V>& v ) {
+      return ds >> v.first >> v.second;
+   }
+
+   template<typename DataStream, typename K, typename V>
+   DataStream& operator << ( DataStream& ds, const std::map<K, V>& m ) {
+      ds << unsigned_int( m.size() );
+      for( const auto& i : m )
+         ds << i.first << i.second;
+      return ds;
+   }
+
+   template<typename DataStream, typename K, typename V>
+   DataStream& operator >> ( DataStream& ds, std::map<K, V>& m ) {
+      m.clear();
+      unsigned_int s;
+      ds >> s;
+      for( uint32_t i = 0; i < s.value; ++i ) {
+         K k; V v;
+         ds >> k >> v;
+         m.emplace( std::move(k), std::move(v) );
+      }
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator << ( DataStream& ds, const std::set<T>& s ) {
+      ds << unsigned_int( s.size() );
+      for( const auto& i : s )
+         ds << i;
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator >> ( DataStream& ds, std::set<T>& s ) {
+      s.clear();
+      unsigned_int n;
+      ds >> n;
+      for( uint32_t i = 0; i < n.value; ++i ) {
+         T v;
+         ds >> v;
+         s.emplace( std::move(v) );
+      }
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator << ( DataStream& ds, const std::optional<T>& v ) {
+      char valid = v.has_value();
+      ds << valid;
+      if( valid )
+         ds << *v;
+      return ds;
+   }
+
+   template<typename DataStream, typename T>
+   DataStream& operator >> ( DataStream& ds, std::optional<T>& v ) {
+      char valid = 0;
+      ds >> valid;
+      if( valid ) {
+         T val;
+         ds >> val;
+         v = std::move(val);
+      } else {
+         v.reset();
+      }
+      return ds;
+   }
+
+   template<typename DataStream, typename... Ts>
+   DataStream& operator << ( DataStream& ds, const std::variant<Ts...>& v ) {
+      ds << unsigned_int( v.index() );
+      std::visit( [&ds]( const auto& val ) { ds << val; }, v );
+      return ds;
+   }
+
+   template<size_t I, typename DataStream, typename... Ts>
+   void _unpack_variant( DataStream& ds, std::variant<Ts...>& v, size_t index ) {
+      if constexpr( I < sizeof...(Ts) ) {
+         if( index == I ) {
+            std::variant_alternative_t<I, std::variant<Ts...>> val;
+            ds >> val;
+            v.template emplace<I>( std::move(val) );
+         } else {
+            _unpack_variant<I + 1>( ds, v, index );
+         }
+      } else {
+         eosio_assert( false, "invalid variant index" );
+      }
+   }
+
+   template<typename DataStream, typename... Ts>
+   DataStream& operator >> ( DataStream& ds, std::variant<Ts...>& v ) {
+      unsigned_int index;
+      ds >> index;
+      _unpack_variant<0>( ds, v, index.value );
+      return ds;
+   }
+
+   template<typename DataStream, typename... Ts>
+   DataStream& operator << ( DataStream& ds, const std::tuple<Ts...>& t ) {
+      std::apply( [&ds]( const auto&... v ) { ( (ds << v), ... ); }, t );
+      return ds;
+   }
+
+   template<typename DataStream, typename... Ts>
+   DataStream& operator >> ( DataStream& ds, std::tuple<Ts...>& t ) {
+      std::apply( [&ds]( auto&... v ) { ( (ds >> v), ... ); }, t );
+      return ds;
+   }
+
+   template<typename DataStream, typename T,
+            std::enable_if_t<_datastream_detail::is_reflected<T>>* = nullptr>
+   DataStream& operator << ( DataStream& ds, const T& v ) {
+      _datastream_detail::for_each_field( v, [&ds]( const auto& f ) { ds << f; } );
+      return ds;
+   }
+
+   template<typename DataStream, typename T,
+            std::enable_if_t<_datastream_detail::is_reflected<T>>* = nullptr>
+   DataStream& operator >> ( DataStream& ds, T& v ) {
+      _datastream_detail::for_each_field( v, [&ds]( auto& f ) { ds >> f; } );
+      return ds;
+   }
+
+   template<typename T>
+   size_t pack_size( const T& value ) {
+      datastream<size_t> ps;
+      ps << value;
+      return ps.tellp();
+   }
+
+   template<typename T>
+   std::vector<char> pack( const T& value ) {
+      std::vector<char> result;
+      result.resize( pack_size( value ) );
+
+      datastream<char*> ds( result.data(), result.size() );
+      ds << value;
+      return result;
+   }
+
+   template<typename T>
+   T unpack( const char* buffer, size_t len ) {
+      T result;
+      datastream<const char*> ds( buffer, len );
+      ds >> result;
+      return result;
+   }
+
+   template<typename T>
+   T unpack( const std::vector<char>& bytes ) {
+      return unpack<T>( bytes.data(), bytes.size() );
+   }
+
+} /// namespace eosio
@@ -0,0 +1,48 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Database intrinsics.  Iterators are small integers valid for the current action;
+ *  end iterators are negative, and every other negative value is invalid.
+ */
+#pragma once
+
+#include <eosiolib/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int32_t db_store_i64( uint64_t scope, capi_name table, capi_name payer, uint64_t id, const void* data, uint32_t len );
+void db_update_i64( int32_t iterator, capi_name payer, const void* data, uint32_t len );
+void db_remove_i64( int32_t iterator );
+int32_t db_get_i64( int32_t iterator, void* data, uint32_t len );
+int32_t db_next_i64( int32_t iterator, uint64_t* primary );
+int32_t db_previous_i64( int32_t iterator, uint64_t* primary );
+int32_t db_find_i64( capi_name code, uint64_t scope, capi_name table, uint64_t id );
+int32_t db_lowerbound_i64( capi_name code, uint64_t scope, capi_name table, uint64_t id );
+int32_t db_upperbound_i64( capi_name code, uint64_t scope, capi_name table, uint64_t id );
+int32_t db_end_i64( capi_name code, uint64_t scope, capi_name table );
+
+#define NATIVE_DB_SECONDARY_DECL( IDX, TYPE ) \
+int32_t db_##IDX##_store( uint64_t scope, capi_name table, capi_name payer, uint64_t id, const TYPE* secondary ); \
+void db_##IDX##_update( int32_t iterator, capi_name payer, const TYPE* secondary ); \
+void db_##IDX##_remove( int32_t iterator ); \
+int32_t db_##IDX##_next( int32_t iterator, uint64_t* primary ); \
+int32_t db_##IDX##_previous( int32_t iterator, uint64_t* primary ); \
+int32_t db_##IDX##_find_primary( capi_name code, uint64_t scope, capi_name table, TYPE* secondary, uint64_t primary ); \
+int32_t db_##IDX##_find_secondary( capi_name code, uint64_t scope, capi_name table, const TYPE* secondary, uint64_t* primary ); \
+int32_t db_##IDX##_lowerbound( capi_name code, uint64_t scope, capi_name table, TYPE* secondary, uint64_t* primary ); \
+int32_t db_##IDX##_upperbound( capi_name code, uint64_t scope, capi_name table, TYPE* secondary, uint64_t* primary ); \
+int32_t db_##IDX##_end( capi_name code, uint64_t scope, capi_name table );
+
+NATIVE_DB_SECONDARY_DECL( idx64, uint64_t )
+NATIVE_DB_SECONDARY_DECL( idx128, uint128_t )
+NATIVE_DB_SECONDARY_DECL( idx_double, double )
+NATIVE_DB_SECONDARY_DECL( idx_long_double, long double )
+
+#undef NATIVE_DB_SECONDARY_DECL
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,137 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  On the host every contract is linked into one executable, so EOSIO_DISPATCH and
+ *  EOSIO_ABI register the contract's apply function under the contract's type name
+ *  rather than defining a global apply.  native::chain::set_code binds it to an account.
+ *  Compiled to wasm (see native/wasm) they define and export apply, as eosio-cpp does.
+ */
+#pragma once
+
+#include <eosiolib/action.hpp>
+#include <eosiolib/contract.hpp>
+#include <eosiolib/serialize.hpp>
+
+#include <tuple>
+#include <type_traits>
+#include <vector>
+
+namespace eosio {
+
+   typedef void (*apply_function)( uint64_t receiver, uint64_t code, uint64_t action );
+
+   /// defined by the host chain
+   void register_contract( const char* type_name, apply_function apply );
+
+   struct native_registration {
+      native_registration( const char* type_name, apply_function apply ) {
+         register_contract( type_name, apply );
+      }
+   };
+
+   template<typename... Args>
+   std::tuple<std::decay_t<Args>...> read_action_arguments( std::vector<char>& buffer ) {
+      buffer.resize( action_data_size() );
+      if( buffer.size() )
+         read_action_data( buffer.data(), buffer.size() );
+
+      std::tuple<std::decay_t<Args>...> args;
+      datastream<const char*> ds( buffer.data(), buffer.size() );
+      ds >> args;
+      return args;
+   }
+
+   template<typename T, typename... Args>
+   bool execute_action( name self, name code, void (T::*func)(Args...) ) {
+      std::vector<char> buffer;
+      auto args = read_action_arguments<Args...>( buffer );
+
+      datastream<const char*> ds( buffer.data(), buffer.size() );
+      ds.skip( pack_size( args ) );
+      T inst( self, code, ds );
+      std::apply( [&]( auto&... a ) { (inst.*func)( a... ); }, args );
+      return true;
+   }
+
+   /// legacy dispatch onto an already constructed contract
+   template<typename T, typename Q, typename... Args>
+   bool execute_action( T* obj, void (Q::*func)(Args...) ) {
+      std::vector<char> buffer;
+      auto args = read_action_arguments<Args...>( buffer );
+
+      std::apply( [&]( auto&... a ) { (obj->*func)( a... ); }, args );
+      return true;
+   }
+
+} /// namespace eosio
+
+#define EOSIO_DISPATCH_CAT( A, B ) EOSIO_DISPATCH_CAT_I( A, B )
+#define EOSIO_DISPATCH_CAT_I( A, B ) A ## B
+
+#define EOSIO_DISPATCH_CASE_A( ACTION ) \
+   case ::eosio::string_to_name( #ACTION ): \
+      ::eosio::execute_action( ::eosio::name(receiver), ::eosio::name(code), &native_contract_type::ACTION ); \
+      break; \
+   EOSIO_DISPATCH_CASE_B
+#define EOSIO_DISPATCH_CASE_B( ACTION ) \
+   case ::eosio::string_to_name( #ACTION ): \
+      ::eosio::execute_action( ::eosio::name(receiver), ::eosio::name(code), &native_contract_type::ACTION ); \
+      break; \
+   EOSIO_DISPATCH_CASE_A
+#define EOSIO_DISPATCH_CASE_A_END
+#define EOSIO_DISPATCH_CASE_B_END
+
+#define EOSIO_ABI_CASE_A( ACTION ) \
+   case ::eosio::string_to_name( #ACTION ): \
+      ::eosio::execute_action( &thiscontract, &native_contract_type::ACTION ); \
+      break; \
+   EOSIO_ABI_CASE_B
+#define EOSIO_ABI_CASE_B( ACTION ) \
+   case ::eosio::string_to_name( #ACTION ): \
+      ::eosio::execute_action( &thiscontract, &native_contract_type::ACTION ); \
+      break; \
+   EOSIO_ABI_CASE_A
+#define EOSIO_ABI_CASE_A_END
+#define EOSIO_ABI_CASE_B_END
+
+#ifdef __wasm__
+#define EOSIO_APPLY_BEGIN( TYPE ) \
+extern "C" { \
+   void __wasm_call_ctors(); \
+   __attribute__((export_name("apply"))) \
+   void apply( uint64_t receiver, uint64_t code, uint64_t action ) { \
+      __wasm_call_ctors();
+#define EOSIO_APPLY_END( TYPE ) \
+   } \
+}
+#else
+#define EOSIO_APPLY_BEGIN( TYPE ) \
+namespace { \
+   void native_apply( uint64_t receiver, uint64_t code, uint64_t action ) {
+#define EOSIO_APPLY_END( TYPE ) \
+   } \
+   const ::eosio::native_registration native_registration_instance( #TYPE, &native_apply ); \
+}
+#endif
+
+#define EOSIO_DISPATCH( TYPE, MEMBERS ) \
+EOSIO_APPLY_BEGIN( TYPE ) \
+      typedef TYPE native_contract_type; \
+      if( code == receiver ) { \
+         switch( action ) { \
+            EOSIO_DISPATCH_CAT( EOSIO_DISPATCH_CASE_A MEMBERS, _END ) \
+         } \
+      } \
+EOSIO_APPLY_END( TYPE )
+
+#define EOSIO_ABI( TYPE, MEMBERS ) \
+EOSIO_APPLY_BEGIN( TYPE ) \
+      typedef TYPE native_contract_type; \
+      if( code == receiver ) { \
+         TYPE thiscontract( receiver ); \
+         switch( action ) { \
+            EOSIO_DISPATCH_CAT( EOSIO_ABI_CASE_A MEMBERS, _END ) \
+         } \
+      } \
+EOSIO_APPLY_END( TYPE )
@@ -0,0 +1,31 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host build of eosiolib.  Serves both the CDT interface (name, "x"_n, CONTRACT,
+ *  EOSIO_DISPATCH) and the legacy one (account_name, N(), EOSIO_ABI) so every
+ *  contract in the repository builds unchanged.  See native/README.md.
+ */
+#pragma once
+
+#include <eosiolib/action.hpp>
+#include <eosiolib/contract.hpp>
+#include <eosiolib/dispatcher.hpp>
+#include <eosiolib/multi_index.hpp>
+#include <eosiolib/name.hpp>
+#include <eosiolib/print.hpp>
+#include <eosiolib/serialize.hpp>
+#include <eosiolib/symbol.hpp>
+#include <eosiolib/system.hpp>
+
+#ifndef CONTRACT
+#define CONTRACT class [[eosio::contract]]
+#endif
+
+#ifndef ACTION
+#define ACTION [[eosio::action]] void
+#endif
+
+#ifndef TABLE
+#define TABLE struct [[eosio::table]]
+#endif
@@ -0,0 +1,695 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  multi_index over the db intrinsics, following the CDT implementation: rows are
+ *  packed into the primary table, each secondary index lives in its own table, and
+ *  every instance caches the objects it has loaded.  The cache is indexed by primary
+ *  key and by db iterator rather than scanned.
+ */
+#pragma once
+
+#include <eosiolib/action.h>
+#include <eosiolib/db.h>
+#include <eosiolib/name.hpp>
+#include <eosiolib/serialize.hpp>
+
+#include <algorithm>
+#include <iterator>
+#include <limits>
+#include <memory>
+#include <tuple>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace eosio {
+
+   /// payer argument to modify that keeps the row's current payer
+   constexpr name same_payer{};
+
+   template<uint64_t IndexName, typename Extractor>
+   struct indexed_by {
+      static constexpr uint64_t index_name = IndexName;
+      typedef Extractor secondary_extractor_type;
+   };
+
+   template<class Class, typename Type, Type (Class::*PtrToMemberFunction)()const>
+   struct const_mem_fun {
+      typedef typename std::remove_reference<Type>::type result_type;
+
+      Type operator()( const Class& x )const {
+         return (x.*PtrToMemberFunction)();
+      }
+   };
+
+   namespace _multi_index_detail {
+
+      template<typename T>
+      struct secondary_key_traits {
+         static constexpr T true_lowest() { return std::numeric_limits<T>::lowest(); }
+      };
+
+      template<>
+      struct secondary_key_traits<uint128_t> {
+         static constexpr uint128_t true_lowest() { return 0; }
+      };
+
+      template<typename T>
+      struct secondary_index_db_functions;
+
+#define WRAP_SECONDARY_SIMPLE_TYPE( IDX, TYPE ) \
+      template<> \
+      struct secondary_index_db_functions<TYPE> { \
+         static int32_t db_idx_next( int32_t iterator, uint64_t* primary ) { return db_##IDX##_next( iterator, primary ); } \
+         static int32_t db_idx_previous( int32_t iterator, uint64_t* primary ) { return db_##IDX##_previous( iterator, primary ); } \
+         static void db_idx_remove( int32_t iterator ) { db_##IDX##_remove( iterator ); } \
+         static int32_t db_idx_end( uint64_t code, uint64_t scope, uint64_t table ) { return db_##IDX##_end( code, scope, table ); } \
+         static int32_t db_idx_store( uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const TYPE& secondary ) { \
+            return db_##IDX##_store( scope, table, payer, id, &secondary ); \
+         } \
+         static void db_idx_update( int32_t iterator, uint64_t payer, const TYPE& secondary ) { \
+            db_##IDX##_update( iterator, payer, &secondary ); \
+         } \
+         static int32_t db_idx_find_primary( uint64_t code, uint64_t scope, uint64_t table, uint64_t primary, TYPE& secondary ) { \
+            return db_##IDX##_find_primary( code, scope, table, &secondary, primary ); \
+         } \
+         static int32_t db_idx_find_secondary( uint64_t code, uint64_t scope, uint64_t table, const TYPE& secondary, uint64_t& primary ) { \
+            return db_##IDX##_find_secondary( code, scope, table, &secondary, &primary ); \
+         } \
+         static int32_t db_idx_lowerbound( uint64_t code, uint64_t scope, uint64_t table, TYPE& secondary, uint64_t& primary ) { \
+            return db_##IDX##_lowerbound( code, scope, table, &secondary, &primary ); \
+         } \
+         static int32_t db_idx_upperbound( uint64_t code, uint64_t scope, uint64_t table, TYPE& secondary, uint64_t& primary ) { \
+            return db_##IDX##_upperbound( code, scope, table, &secondary, &primary ); \
+         } \
+      };
+
+      WRAP_SECONDARY_SIMPLE_TYPE( idx64, uint64_t )
+      WRAP_SECONDARY_SIMPLE_TYPE( idx128, uint128_t )
+      WRAP_SECONDARY_SIMPLE_TYPE( idx_double, double )
+      WRAP_SECONDARY_SIMPLE_TYPE( idx_long_double, long double )
+
+#undef WRAP_SECONDARY_SIMPLE_TYPE
+
+   } /// namespace _multi_index_detail
+
+   template<uint64_t TableName, typename T, typename... Indices>
+   class multi_index {
+   private:
+      static_assert( sizeof...(Indices) <= 16, "multi_index only supports a maximum of 16 secondary indices" );
+
+      static_assert( (TableName & 0x000000000000000FULL) == 0,
+                     "multi_index does not support table names with a length greater than 12" );
+
+      static constexpr size_t index_count = sizeof...(Indices);
+
+      enum next_primary_key_tags : uint64_t {
+         no_available_primary_key = static_cast<uint64_t>(-2),
+         unset_next_primary_key = static_cast<uint64_t>(-1)
+      };
+
+      struct item : public T {
+         template<typename Constructor>
+         item( const multi_index* idx, Constructor&& c ) : __idx(idx) {
+            c( *this );
+         }
+
+         const multi_index* __idx;
+         int32_t __primary_itr;
+         int32_t __iters[index_count > 0 ? index_count : 1];
+      };
+
+      template<size_t Number>
+      using index_definition = std::tuple_element_t<Number, std::tuple<Indices...>>;
+
+      template<size_t Number>
+      using extractor = typename index_definition<Number>::secondary_extractor_type;
+
+      template<size_t Number>
+      using secondary_key = std::decay_t<decltype( extractor<Number>()( std::declval<const T&>() ) )>;
+
+      template<size_t Number>
+      using db_functions = _multi_index_detail::secondary_index_db_functions<secondary_key<Number>>;
+
+      template<size_t Number>
+      static constexpr uint64_t index_table_name() {
+         return (TableName & 0xFFFFFFFFFFFFFFF0ULL) | (Number & 0x000000000000000FULL);
+      }
+
+      template<uint64_t IndexName>
+      static constexpr size_t index_position() {
+         constexpr uint64_t names[] = { Indices::index_name..., 0 };
+         for( size_t i = 0; i < index_count; ++i ) {
+            if( names[i] == IndexName )
+               return i;
+         }
+         return index_count;
+      }
+
+      template<typename F, size_t... I>
+      static void for_each_index( F&& f, std::index_sequence<I...> ) {
+         ( f( std::integral_constant<size_t, I>{} ), ... );
+      }
+
+      template<typename F>
+      static void for_each_index( F&& f ) {
+         for_each_index( std::forward<F>(f), std::make_index_sequence<index_count>{} );
+      }
+
+      name _code;
+      uint64_t _scope;
+
+      mutable uint64_t _next_primary_key;
+
+      mutable std::unordered_map<uint64_t, std::unique_ptr<item>> _items_by_key;
+      mutable std::unordered_map<int32_t, item*> _items_by_itr;
+
+   public:
+      template<uint64_t IndexName, typename Extractor, size_t Number>
+      struct index {
+      public:
+         typedef Extractor secondary_extractor_type;
+         typedef secondary_key<Number> secondary_key_type;
+         typedef db_functions<Number> db;
+
+         static constexpr uint64_t name() { return index_table_name<Number>(); }
+         static constexpr uint64_t number() { return Number; }
+
+         static auto extract_secondary_key( const T& obj ) { return secondary_extractor_type()( obj ); }
+
+         struct const_iterator {
+         public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = const T;
+            using difference_type = ptrdiff_t;
+            using pointer = const T*;
+            using reference = const T&;
+
+            friend bool operator == ( const const_iterator& a, const const_iterator& b ) {
+               return a._item == b._item;
+            }
+            friend bool operator != ( const const_iterator& a, const const_iterator& b ) {
+               return a._item != b._item;
+            }
+
+            const T& operator*()const { return *static_cast<const T*>(_item); }
+            const T* operator->()const { return static_cast<const T*>(_item); }
+
+            const_iterator operator++(int) {
+               const_iterator result(*this);
+               ++(*this);
+               return result;
+            }
+
+            const_iterator operator--(int) {
+               const_iterator result(*this);
+               --(*this);
+               return result;
+            }
+
+            const_iterator& operator++() {
+               eosio_assert( _item != nullptr, "cannot increment end iterator" );
+
+               _idx->locate( *_item );
+
+               uint64_t next_pk = 0;
+               auto next_itr = db::db_idx_next( _item->__iters[Number], &next_pk );
+               if( next_itr < 0 ) {
+                  _item = nullptr;
+                  return *this;
+               }
+
+               _item = &_idx->_multidx->item_by_primary( next_pk );
+               const_cast<item*>(_item)->__iters[Number] = next_itr;
+               return *this;
+            }
+
+            const_iterator& operator--() {
+               uint64_t prev_pk = 0;
+               int32_t prev_itr = -1;
+
+               if( !_item ) {
+                  auto ei = db::db_idx_end( _idx->get_code().value, _idx->get_scope(), name() );
+                  eosio_assert( ei != -1, "cannot decrement end iterator when the index is empty" );
+                  prev_itr = db::db_idx_previous( ei, &prev_pk );
+                  eosio_assert( prev_itr >= 0, "cannot decrement end iterator when the index is empty" );
+               } else {
+                  _idx->locate( *_item );
+                  prev_itr = db::db_idx_previous( _item->__iters[Number], &prev_pk );
+                  eosio_assert( prev_itr >= 0, "cannot decrement iterator at beginning of index" );
+               }
+
+               _item = &_idx->_multidx->item_by_primary( prev_pk );
+               const_cast<item*>(_item)->__iters[Number] = prev_itr;
+               return *this;
+            }
+
+            const_iterator() : _idx(nullptr), _item(nullptr) {}
+
+         private:
+            friend struct index;
+
+            const_iterator( const index* idx, const item* i = nullptr ) : _idx(idx), _item(i) {}
+
+            const index* _idx;
+            const item* _item;
+         };
+
+         typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+         const_iterator cbegin()const {
+            return lower_bound( _multi_index_detail::secondary_key_traits<secondary_key_type>::true_lowest() );
+         }
+         const_iterator begin()const { return cbegin(); }
+
+         const_iterator cend()const { return const_iterator( this ); }
+         const_iterator end()const { return cend(); }
+
+         const_reverse_iterator crbegin()const { return std::make_reverse_iterator( cend() ); }
+         const_reverse_iterator rbegin()const { return crbegin(); }
+
+         const_reverse_iterator crend()const { return std::make_reverse_iterator( cbegin() ); }
+         const_reverse_iterator rend()const { return crend(); }
+
+         const_iterator find( const secondary_key_type& secondary )const {
+            auto lb = lower_bound( secondary );
+            auto e = cend();
+            if( lb == e ) return e;
+
+            if( secondary != extract_secondary_key( *lb ) )
+               return e;
+            return lb;
+         }
+
+         const_iterator require_find( const secondary_key_type& secondary,
+                                      const char* error_msg = "unable to find secondary key" )const {
+            auto itr = find( secondary );
+            eosio_assert( itr != cend(), error_msg );
+            return itr;
+         }
+
+         const T& get( const secondary_key_type& secondary,
+                       const char* error_msg = "unable to find secondary key" )const {
+            return *require_find( secondary, error_msg );
+         }
+
+         const_iterator lower_bound( const secondary_key_type& secondary )const {
+            uint64_t primary = 0;
+            secondary_key_type secondary_copy( secondary );
+            auto itr = db::db_idx_lowerbound( get_code().value, get_scope(), name(), secondary_copy, primary );
+            if( itr < 0 ) return cend();
+
+            auto& mi = _multidx->item_by_primary( primary );
+            mi.__iters[Number] = itr;
+            return {this, &mi};
+         }
+
+         const_iterator upper_bound( const secondary_key_type& secondary )const {
+            uint64_t primary = 0;
+            secondary_key_type secondary_copy( secondary );
+            auto itr = db::db_idx_upperbound( get_code().value, get_scope(), name(), secondary_copy, primary );
+            if( itr < 0 ) return cend();
+
+            auto& mi = _multidx->item_by_primary( primary );
+            mi.__iters[Number] = itr;
+            return {this, &mi};
+         }
+
+         const_iterator iterator_to( const T& obj ) {
+            const auto& objitem = static_cast<const item&>(obj);
+            eosio_assert( objitem.__idx == _multidx, "object passed to iterator_to is not in multi_index" );
+            locate( objitem );
+            return {this, &objitem};
+         }
+
+         template<typename Lambda>
+         void modify( const_iterator itr, eosio::name payer, Lambda&& updater ) {
+            eosio_assert( itr != cend(), "cannot pass end iterator to modify" );
+            _multidx->modify( *itr, payer, std::forward<Lambda>(updater) );
+         }
+
+         template<typename Lambda>
+         void modify( const_iterator itr, uint64_t payer, Lambda&& updater ) {
+            modify( itr, eosio::name(payer), std::forward<Lambda>(updater) );
+         }
+
+         const_iterator erase( const_iterator itr ) {
+            eosio_assert( itr != cend(), "cannot pass end iterator to erase" );
+
+            const auto& obj = *itr;
+            ++itr;
+
+            _multidx->erase( obj );
+            return itr;
+         }
+
+         eosio::name get_code()const { return _multidx->get_code(); }
+         uint64_t get_scope()const { return _multidx->get_scope(); }
+
+      private:
+         friend class multi_index;
+
+         index( const multi_index* midx ) : _multidx( const_cast<multi_index*>(midx) ) {}
+
+         /// finds the object's entry in this index when it was loaded through another
+         void locate( const item& obj )const {
+            if( obj.__iters[Number] == -1 ) {
+               secondary_key_type temp_secondary_key;
+               const_cast<item&>(obj).__iters[Number] =
+                  db::db_idx_find_primary( get_code().value, get_scope(), name(), obj.primary_key(), temp_secondary_key );
+            }
+         }
+
+         multi_index* _multidx;
+      };
+
+      struct const_iterator {
+      public:
+         using iterator_category = std::bidirectional_iterator_tag;
+         using value_type = const T;
+         using difference_type = ptrdiff_t;
+         using pointer = const T*;
+         using reference = const T&;
+
+         friend bool operator == ( const const_iterator& a, const const_iterator& b ) {
+            return a._item == b._item;
+         }
+         friend bool operator != ( const const_iterator& a, const const_iterator& b ) {
+            return a._item != b._item;
+         }
+
+         const T& operator*()const { return *static_cast<const T*>(_item); }
+         const T* operator->()const { return static_cast<const T*>(_item); }
+
+         const_iterator operator++(int) {
+            const_iterator result(*this);
+            ++(*this);
+            return result;
+         }
+
+         const_iterator operator--(int) {
+            const_iterator result(*this);
+            --(*this);
+            return result;
+         }
+
+         const_iterator& operator++() {
+            eosio_assert( _item != nullptr, "cannot increment end iterator" );
+
+            uint64_t next_pk;
+            auto next_itr = db_next_i64( _item->__primary_itr, &next_pk );
+            if( next_itr < 0 )
+               _item = nullptr;
+            else
+               _item = &_multidx->load_object_by_primary_iterator( next_itr );
+            return *this;
+         }
+
+         const_iterator& operator--() {
+            uint64_t prev_pk;
+            int32_t prev_itr = -1;
+
+            if( !_item ) {
+               auto ei = db_end_i64( _multidx->get_code().value, _multidx->get_scope(), TableName );
+               eosio_assert( ei != -1, "cannot decrement end iterator when the table is empty" );
+               prev_itr = db_previous_i64( ei, &prev_pk );
+               eosio_assert( prev_itr >= 0, "cannot decrement end iterator when the table is empty" );
+            } else {
+               prev_itr = db_previous_i64( _item->__primary_itr, &prev_pk );
+               eosio_assert( prev_itr >= 0, "cannot decrement iterator at beginning of table" );
+            }
+
+            _item = &_multidx->load_object_by_primary_iterator( prev_itr );
+            return *this;
+         }
+
+         const_iterator() : _multidx(nullptr), _item(nullptr) {}
+
+      private:
+         friend class multi_index;
+
+         const_iterator( const multi_index* mi, const item* i = nullptr ) : _multidx(mi), _item(i) {}
+
+         const multi_index* _multidx;
+         const item* _item;
+      };
+
+      typedef std::reverse_iterator<const_iterator> const_reverse_iterator;
+
+   private:
+      item& load_object_by_primary_iterator( int32_t itr )const {
+         auto cached = _items_by_itr.find( itr );
+         if( cached != _items_by_itr.end() )
+            return *cached->second;
+
+         auto size = db_get_i64( itr, nullptr, 0 );
+         eosio_assert( size >= 0, "error reading iterator" );
+
+         std::vector<char> buffer( size );
+         db_get_i64( itr, buffer.data(), size );
+
+         datastream<const char*> ds( buffer.data(), buffer.size() );
+
+         auto itm = std::make_unique<item>( this, [&]( auto& i ) {
+            T& val = static_cast<T&>(i);
+            ds >> val;
+         } );
+
+         itm->__primary_itr = itr;
+         for( size_t i = 0; i < index_count; ++i )
+            itm->__iters[i] = -1;
+
+         return cache( std::move(itm) );
+      }
+
+      item& item_by_primary( uint64_t primary )const {
+         auto itr = find( primary );
+         eosio_assert( itr != cend(), "secondary index entry has no primary row" );
+         return const_cast<item&>( static_cast<const item&>( *itr ) );
+      }
+
+      item& cache( std::unique_ptr<item> itm )const {
+         item& ref = *itm;
+         _items_by_itr[ref.__primary_itr] = &ref;
+         _items_by_key[ref.primary_key()] = std::move(itm);
+         return ref;
+      }
+
+      void update_next_primary_key( uint64_t pk )const {
+         if( pk >= _next_primary_key )
+            _next_primary_key = (pk >= no_available_primary_key) ? no_available_primary_key : (pk + 1);
+      }
+
+      static std::vector<char> pack_object( const T& obj ) {
+         return pack( obj );
+      }
+
+   public:
+      multi_index( name code, uint64_t scope )
+         : _code(code), _scope(scope), _next_primary_key(unset_next_primary_key) {}
+
+      multi_index( const multi_index& ) = delete;
+      multi_index& operator=( const multi_index& ) = delete;
+
+      name get_code()const { return _code; }
+      uint64_t get_scope()const { return _scope; }
+
+      const_iterator cbegin()const { return lower_bound( std::numeric_limits<uint64_t>::lowest() ); }
+      const_iterator begin()const { return cbegin(); }
+
+      const_iterator cend()const { return const_iterator( this ); }
+      const_iterator end()const { return cend(); }
+
+      const_reverse_iterator crbegin()const { return std::make_reverse_iterator( cend() ); }
+      const_reverse_iterator rbegin()const { return crbegin(); }
+
+      const_reverse_iterator crend()const { return std::make_reverse_iterator( cbegin() ); }
+      const_reverse_iterator rend()const { return crend(); }
+
+      const_iterator lower_bound( uint64_t primary )const {
+         auto itr = db_lowerbound_i64( _code.value, _scope, TableName, primary );
+         if( itr < 0 ) return end();
+         return {this, &load_object_by_primary_iterator( itr )};
+      }
+
+      const_iterator upper_bound( uint64_t primary )const {
+         auto itr = db_upperbound_i64( _code.value, _scope, TableName, primary );
+         if( itr < 0 ) return end();
+         return {this, &load_object_by_primary_iterator( itr )};
+      }
+
+      uint64_t available_primary_key()const {
+         if( _next_primary_key == unset_next_primary_key ) {
+            if( begin() == end() ) {
+               _next_primary_key = 0;
+            } else {
+               auto itr = --end();
+               auto pk = itr->primary_key();
+               _next_primary_key = (pk >= no_available_primary_key) ? no_available_primary_key : (pk + 1);
+            }
+         }
+
+         eosio_assert( _next_primary_key < no_available_primary_key,
+                       "next primary key in table is at autoincrement limit" );
+         return _next_primary_key;
+      }
+
+      template<uint64_t IndexName>
+      auto get_index()const {
+         constexpr size_t number = index_position<IndexName>();
+         static_assert( number < index_count, "name provided is not the name of any secondary index within multi_index" );
+         return index<IndexName, extractor<number>, number>( this );
+      }
+
+      const_iterator iterator_to( const T& obj )const {
+         const auto& objitem = static_cast<const item&>(obj);
+         eosio_assert( objitem.__idx == this, "object passed to iterator_to is not in multi_index" );
+         return {this, &objitem};
+      }
+
+      template<typename Lambda>
+      const_iterator emplace( name payer, Lambda&& constructor ) {
+         eosio_assert( _code.value == current_receiver(), "cannot create objects in table of another contract" );
+
+         auto itm = std::make_unique<item>( this, [&]( auto& i ) {
+            T& obj = static_cast<T&>(i);
+            constructor( obj );
+
+            auto buffer = pack_object( obj );
+            auto pk = obj.primary_key();
+
+            i.__primary_itr = db_store_i64( _scope, TableName, payer.value, pk, buffer.data(), buffer.size() );
+            update_next_primary_key( pk );
+
+            for_each_index( [&]( auto n ) {
+               constexpr size_t number = decltype(n)::value;
+               i.__iters[number] = db_functions<number>::db_idx_store( _scope, index_table_name<number>(), payer.value, pk,
+                                                                      extractor<number>()( obj ) );
+            } );
+         } );
+
+         return {this, &cache( std::move(itm) )};
+      }
+
+      template<typename Lambda>
+      const_iterator emplace( uint64_t payer, Lambda&& constructor ) {
+         return emplace( name(payer), std::forward<Lambda>(constructor) );
+      }
+
+      template<typename Lambda>
+      void modify( const_iterator itr, name payer, Lambda&& updater ) {
+         eosio_assert( itr != end(), "cannot pass end iterator to modify" );
+         modify( *itr, payer, std::forward<Lambda>(updater) );
+      }
+
+      template<typename Lambda>
+      void modify( const_iterator itr, uint64_t payer, Lambda&& updater ) {
+         modify( itr, name(payer), std::forward<Lambda>(updater) );
+      }
+
+      template<typename Lambda>
+      void modify( const T& obj, uint64_t payer, Lambda&& updater ) {
+         modify( obj, name(payer), std::forward<Lambda>(updater) );
+      }
+
+      template<typename Lambda>
+      void modify( const T& obj, name payer, Lambda&& updater ) {
+         const auto& objitem = static_cast<const item&>(obj);
+         eosio_assert( objitem.__idx == this, "object passed to modify is not in multi_index" );
+         auto& mutableitem = const_cast<item&>(objitem);
+         eosio_assert( _code.value == current_receiver(), "cannot modify objects in table of another contract" );
+
+         auto secondary_keys = std::make_tuple( typename Indices::secondary_extractor_type()( obj )... );
+
+         auto pk = obj.primary_key();
+
+         auto& mutableobj = const_cast<T&>(obj);
+         updater( mutableobj );
+
+         eosio_assert( pk == obj.primary_key(), "updater cannot change primary key when modifying an object" );
+
+         auto buffer = pack_object( obj );
+         db_update_i64( objitem.__primary_itr, payer.value, buffer.data(), buffer.size() );
+
+         update_next_primary_key( pk );
+
+         for_each_index( [&]( auto n ) {
+            constexpr size_t number = decltype(n)::value;
+            auto secondary = extractor<number>()( obj );
+            if( secondary != std::get<number>( secondary_keys ) ) {
+               auto indexitr = mutableitem.__iters[number];
+               if( indexitr < 0 ) {
+                  secondary_key<number> temp_secondary_key;
+                  indexitr = mutableitem.__iters[number] =
+                     db_functions<number>::db_idx_find_primary( _code.value, _scope, index_table_name<number>(), pk,
+                                                                temp_secondary_key );
+               }
+               db_functions<number>::db_idx_update( indexitr, payer.value, secondary );
+            }
+         } );
+      }
+
+      const T& get( uint64_t primary, const char* error_msg = "unable to find key" )const {
+         auto result = find( primary );
+         eosio_assert( result != cend(), error_msg );
+         return *result;
+      }
+
+      const_iterator find( uint64_t primary )const {
+         auto cached = _items_by_key.find( primary );
+         if( cached != _items_by_key.end() )
+            return {this, cached->second.get()};
+
+         auto itr = db_find_i64( _code.value, _scope, TableName, primary );
+         if( itr < 0 ) return end();
+
+         return {this, &load_object_by_primary_iterator( itr )};
+      }
+
+      const_iterator require_find( uint64_t primary, const char* error_msg = "unable to find key" )const {
+         auto itr = find( primary );
+         eosio_assert( itr != cend(), error_msg );
+         return itr;
+      }
+
+      const_iterator erase( const_iterator itr ) {
+         eosio_assert( itr != end(), "cannot pass end iterator to erase" );
+
+         const auto& obj = *itr;
+         ++itr;
+
+         erase( obj );
+
+         return itr;
+      }
+
+      void erase( const T& obj ) {
+         const auto& objitem = static_cast<const item&>(obj);
+         eosio_assert( objitem.__idx == this, "object passed to erase is not in multi_index" );
+         eosio_assert( _code.value == current_receiver(), "cannot erase objects in table of another contract" );
+
+         auto pk = objitem.primary_key();
+         auto cached = _items_by_key.find( pk );
+         eosio_assert( cached != _items_by_key.end(), "attempt to remove object that was not in multi_index" );
+
+         db_remove_i64( objitem.__primary_itr );
+
+         for_each_index( [&]( auto n ) {
+            constexpr size_t number = decltype(n)::value;
+            auto i = objitem.__iters[number];
+            if( i < 0 ) {
+               secondary_key<number> secondary;
+               i = db_functions<number>::db_idx_find_primary( _code.value, _scope, index_table_name<number>(), pk, secondary );
+            }
+            if( i >= 0 )
+               db_functions<number>::db_idx_remove( i );
+         } );
+
+         _items_by_itr.erase( objitem.__primary_itr );
+         _items_by_key.erase( cached );
+      }
+   };
+
+} /// namespace eosio
@@ -0,0 +1,105 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/types.h>
+
+#include <string>
+#include <string_view>
+
+namespace eosio {
+
+   /**
+    * Converts a base32 account name string to its 64 bit value.  Invalid characters
+    * map to zero, as in the legacy N() macro.
+    */
+   constexpr uint64_t string_to_name( std::string_view str ) {
+      auto char_to_value = []( char c ) -> uint64_t {
+         if( c == '.' )
+            return 0;
+         if( c >= '1' && c <= '5' )
+            return (c - '1') + 1;
+         if( c >= 'a' && c <= 'z' )
+            return (c - 'a') + 6;
+         return 0;
+      };
+
+      uint64_t value = 0;
+      int i = 0;
+      for( ; i < (int)str.size() && i < 12; ++i ) {
+         value <<= 5;
+         value |= char_to_value( str[i] );
+      }
+      value <<= ( 4 + 5*(12 - i) );
+      if( str.size() == 13 ) {
+         uint64_t v = char_to_value( str[12] );
+         value |= v & 0x0F;
+      }
+      return value;
+   }
+
+   /**
+    * Account, action, permission and table names.  Besides the CDT interface, a name
+    * converts implicitly to its 64 bit value so the legacy account_name contracts and
+    * the name contracts build against the same headers.
+    */
+   struct name {
+      constexpr name() : value(0) {}
+
+      constexpr explicit name( uint64_t v ) : value(v) {}
+
+      constexpr explicit name( std::string_view str ) : value( string_to_name(str) ) {}
+
+      constexpr operator uint64_t()const { return value; }
+
+      constexpr uint64_t raw()const { return value; }
+
+      constexpr uint8_t length()const {
+         constexpr uint64_t mask = 0xF800000000000000ull;
+         if( value == 0 )
+            return 0;
+         uint8_t l = 0;
+         uint8_t i = 0;
+         for( auto v = value; i < 13; ++i, v <<= 5 ) {
+            if( (v & mask) > 0 ) {
+               l = i;
+            }
+         }
+         return l + 1;
+      }
+
+      std::string to_string()const {
+         static const char* charmap = ".12345abcdefghijklmnopqrstuvwxyz";
+         std::string str( 13, '.' );
+         uint64_t tmp = value;
+         for( uint32_t i = 0; i <= 12; ++i ) {
+            char c = charmap[tmp & (i == 0 ? 0x0f : 0x1f)];
+            str[12-i] = c;
+            tmp >>= (i == 0 ? 4 : 5);
+         }
+         auto end = str.find_last_not_of('.');
+         str.resize( end == std::string::npos ? 0 : end + 1 );
+         return str;
+      }
+
+      friend constexpr bool operator == ( const name& a, const name& b ) { return a.value == b.value; }
+      friend constexpr bool operator != ( const name& a, const name& b ) { return a.value != b.value; }
+      friend constexpr bool operator <  ( const name& a, const name& b ) { return a.value <  b.value; }
+
+      friend constexpr bool operator == ( const name& a, uint64_t b ) { return a.value == b; }
+      friend constexpr bool operator != ( const name& a, uint64_t b ) { return a.value != b; }
+      friend constexpr bool operator == ( uint64_t a, const name& b ) { return a == b.value; }
+      friend constexpr bool operator != ( uint64_t a, const name& b ) { return a != b.value; }
+
+      uint64_t value;
+   };
+
+} /// namespace eosio
+
+constexpr eosio::name operator""_n( const char* str, size_t len ) {
+   return eosio::name( std::string_view( str, len ) );
+}
+
+#define N(X) ::eosio::string_to_name(#X)
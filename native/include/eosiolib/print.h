@@ -0,0 +1,35 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void prints( const char* cstr );
+
+void prints_l( const char* cstr, uint32_t len );
+
+void printi( int64_t value );
+
+void printui( uint64_t value );
+
+void printi128( const int128_t* value );
+
+void printui128( const uint128_t* value );
+
+void printsf( float value );
+
+void printdf( double value );
+
+void printn( uint64_t name );
+
+void printhex( const void* data, uint32_t datalen );
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,66 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/print.h>
+#include <eosiolib/name.hpp>
+#include <eosiolib/symbol.hpp>
+
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+namespace eosio {
+
+   inline void print( const char* ptr ) { prints( ptr ); }
+
+   inline void print( const std::string& s ) { prints_l( s.c_str(), s.size() ); }
+
+   inline void print( std::string_view s ) { prints_l( s.data(), s.size() ); }
+
+   inline void print( char c ) { prints_l( &c, 1 ); }
+
+   inline void print( bool b ) { prints( b ? "true" : "false" ); }
+
+   inline void print( int128_t num ) { printi128( &num ); }
+
+   inline void print( uint128_t num ) { printui128( &num ); }
+
+   inline void print( float num ) { printsf( num ); }
+
+   inline void print( double num ) { printdf( num ); }
+
+   inline void print( name n ) { printn( n.value ); }
+
+   inline void print( symbol_code sc ) { print( sc.to_string() ); }
+
+   inline void print( symbol s ) { print( s.to_string() ); }
+
+   template<typename T, std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, char>
+                                         && !std::is_same_v<T, bool>>* = nullptr>
+   void print( T num ) {
+      if constexpr( std::is_signed_v<T> )
+         printi( num );
+      else
+         printui( num );
+   }
+
+   template<typename T, std::enable_if_t<std::is_enum_v<T>>* = nullptr>
+   void print( T e ) { printi( (int64_t)e ); }
+
+   template<typename T, std::enable_if_t<std::is_class_v<T>>* = nullptr,
+            typename = decltype( std::declval<const T&>().print() )>
+   void print( const T& t ) { t.print(); }
+
+   template<typename Arg, typename Arg2, typename... Args>
+   void print( Arg&& a, Arg2&& b, Args&&... args ) {
+      print( std::forward<Arg>(a) );
+      print( std::forward<Arg2>(b), std::forward<Args>(args)... );
+   }
+
+   inline void printl( const char* ptr, size_t len ) { prints_l( ptr, len ); }
+
+} /// namespace eosio
@@ -0,0 +1,48 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/datastream.hpp>
+
+/*
+ * EOSLIB_SERIALIZE( TYPE, (a)(b)(c) ) walks the member sequence with a pair of macros
+ * that expand each other, so no preprocessor library is needed.
+ */
+#define EOSLIB_SERIALIZE_CAT( A, B ) EOSLIB_SERIALIZE_CAT_I( A, B )
+#define EOSLIB_SERIALIZE_CAT_I( A, B ) A ## B
+
+#define EOSLIB_SERIALIZE_OUT_A( MEMBER ) << t.MEMBER EOSLIB_SERIALIZE_OUT_B
+#define EOSLIB_SERIALIZE_OUT_B( MEMBER ) << t.MEMBER EOSLIB_SERIALIZE_OUT_A
+#define EOSLIB_SERIALIZE_OUT_A_END
+#define EOSLIB_SERIALIZE_OUT_B_END
+
+#define EOSLIB_SERIALIZE_IN_A( MEMBER ) >> t.MEMBER EOSLIB_SERIALIZE_IN_B
+#define EOSLIB_SERIALIZE_IN_B( MEMBER ) >> t.MEMBER EOSLIB_SERIALIZE_IN_A
+#define EOSLIB_SERIALIZE_IN_A_END
+#define EOSLIB_SERIALIZE_IN_B_END
+
+#define EOSLIB_SERIALIZE( TYPE, MEMBERS ) \
+   typedef void eoslib_serialize_tag; \
+   template<typename DataStream> \
+   friend DataStream& operator << ( DataStream& ds, const TYPE& t ) { \
+      return ds EOSLIB_SERIALIZE_CAT( EOSLIB_SERIALIZE_OUT_A MEMBERS, _END ); \
+   } \
+   template<typename DataStream> \
+   friend DataStream& operator >> ( DataStream& ds, TYPE& t ) { \
+      return ds EOSLIB_SERIALIZE_CAT( EOSLIB_SERIALIZE_IN_A MEMBERS, _END ); \
+   }
+
+#define EOSLIB_SERIALIZE_DERIVED( TYPE, BASE, MEMBERS ) \
+   typedef void eoslib_serialize_tag; \
+   template<typename DataStream> \
+   friend DataStream& operator << ( DataStream& ds, const TYPE& t ) { \
+      ds << static_cast<const BASE&>(t); \
+      return ds EOSLIB_SERIALIZE_CAT( EOSLIB_SERIALIZE_OUT_A MEMBERS, _END ); \
+   } \
+   template<typename DataStream> \
+   friend DataStream& operator >> ( DataStream& ds, TYPE& t ) { \
+      ds >> static_cast<BASE&>(t); \
+      return ds EOSLIB_SERIALIZE_CAT( EOSLIB_SERIALIZE_IN_A MEMBERS, _END ); \
+   }
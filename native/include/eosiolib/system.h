@@ -0,0 +1,29 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void eosio_assert( uint32_t test, const char* msg );
+
+void eosio_assert_message( uint32_t test, const char* msg, uint32_t msg_len );
+
+void eosio_assert_code( uint32_t test, uint64_t code );
+
+[[noreturn]] void eosio_exit( int32_t code );
+
+/// microseconds since the epoch
+uint64_t current_time( void );
+
+/// seconds since the epoch
+uint32_t now( void );
+
+#ifdef __cplusplus
+}
+#endif
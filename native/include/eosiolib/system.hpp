@@ -0,0 +1,32 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/system.h>
+
+#include <string>
+
+namespace eosio {
+
+   inline void check( bool pred, const char* msg ) {
+      if( !pred )
+         eosio_assert( false, msg );
+   }
+
+   inline void check( bool pred, const std::string& msg ) {
+      if( !pred )
+         eosio_assert( false, msg.c_str() );
+   }
+
+   inline void check( bool pred, uint64_t code ) {
+      if( !pred )
+         eosio_assert_code( false, code );
+   }
+
+   [[noreturn]] inline void eosio_exit( int32_t code ) {
+      ::eosio_exit( code );
+   }
+
+} /// namespace eosio
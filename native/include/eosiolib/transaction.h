@@ -0,0 +1,28 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void send_deferred( const uint128_t* sender_id, capi_name payer, const char* serialized_transaction, size_t size,
+                    uint32_t replace_existing );
+
+int cancel_deferred( const uint128_t* sender_id );
+
+size_t transaction_size( void );
+
+int tapos_block_num( void );
+
+int tapos_block_prefix( void );
+
+uint32_t expiration( void );
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,56 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#pragma once
+
+#include <eosiolib/action.hpp>
+#include <eosiolib/transaction.h>
+
+#include <vector>
+
+namespace eosio {
+
+   class transaction_header {
+   public:
+      transaction_header( uint32_t exp = now() + 60 )
+         : expiration(exp) {}
+
+      uint32_t expiration;
+      uint16_t ref_block_num = 0;
+      uint32_t ref_block_prefix = 0;
+      unsigned_int max_net_usage_words = 0UL;
+      uint8_t max_cpu_usage_ms = 0UL;
+      unsigned_int delay_sec = 0UL;
+
+      EOSLIB_SERIALIZE( transaction_header, (expiration)(ref_block_num)(ref_block_prefix)(max_net_usage_words)(max_cpu_usage_ms)(delay_sec) )
+   };
+
+   struct extension {
+      uint16_t type = 0;
+      std::vector<char> data;
+
+      EOSLIB_SERIALIZE( extension, (type)(data) )
+   };
+
+   class transaction : public transaction_header {
+   public:
+      transaction( uint32_t exp = now() + 60 ) : transaction_header( exp ) {}
+
+      void send( const uint128_t& sender_id, name payer, bool replace_existing = false )const {
+         auto serialize = pack( *this );
+         send_deferred( &sender_id, payer.value, serialize.data(), serialize.size(), replace_existing );
+      }
+
+      std::vector<action> context_free_actions;
+      std::vector<action> actions;
+      std::vector<extension> transaction_extensions;
+
+      EOSLIB_SERIALIZE_DERIVED( transaction, transaction_header, (context_free_actions)(actions)(transaction_extensions) )
+   };
+
+   inline int cancel_deferred( const uint128_t& sender_id ) {
+      return ::cancel_deferred( &sender_id );
+   }
+
+} /// namespace eosio
@@ -0,0 +1,31 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Host build of the eosiolib C types.  See native/README.md.
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef unsigned __int128 uint128_t;
+typedef __int128 int128_t;
+
+typedef uint64_t capi_name;
+typedef uint64_t account_name;
+typedef uint64_t permission_name;
+typedef uint64_t table_name;
+typedef uint64_t scope_name;
+typedef uint64_t action_name;
+typedef uint64_t symbol_name;
+
+struct capi_checksum256 { uint8_t hash[32]; };
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,276 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  In-memory chain that runs contracts compiled for the host.  It implements the
+ *  eosiolib intrinsics the contracts call (database, authorization, notification,
+ *  inline and deferred actions, console), bills RAM to row payers the way nodeos
+ *  does, and rolls back every change made by a failed transaction.
+ *
+ *  Contracts register themselves through EOSIO_DISPATCH or EOSIO_ABI under their
+ *  type name, e.g. "ampersand::slvrtoken", and set_code binds one to an account.
+ *  Compiled wasm modules run through set_apply with native::wasm_apply.
+ *
+ *  Several chains can share one database, each with its own accounts, contracts,
+ *  clock and transaction state, to run transactions on several threads.
+ */
+#pragma once
+
+#include <eosiolib/action.hpp>
+#include <eosiolib/name.hpp>
+#include <eosiolib/serialize.hpp>
+
+#include <array>
+#include <cstdint>
+#include <functional>
+#include <map>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace native {
+
+   using eosio::name;
+
+   /// thrown by eosio_assert; aborts the transaction
+   struct assertion_failure : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   /// billable RAM per database object, from the chain's config
+   namespace billable_size {
+      constexpr int64_t table = 108;
+      constexpr int64_t row = 108;
+      constexpr int64_t idx64 = 128;
+      constexpr int64_t idx128 = 136;
+      constexpr int64_t idx_double = 128;
+      constexpr int64_t idx_long_double = 136;
+   }
+
+   struct row {
+      uint64_t payer = 0;
+      std::vector<char> data;
+   };
+
+   struct table_id {
+      uint64_t code;
+      uint64_t scope;
+      uint64_t table;
+
+      friend bool operator < ( const table_id& a, const table_id& b ) {
+         return std::tie( a.code, a.scope, a.table ) < std::tie( b.code, b.scope, b.table );
+      }
+      friend bool operator == ( const table_id& a, const table_id& b ) {
+         return a.code == b.code && a.scope == b.scope && a.table == b.table;
+      }
+   };
+
+   /// a contract table in one scope
+   struct table {
+      table_id id;
+      uint64_t payer = 0;
+      std::map<uint64_t, row> rows;
+   };
+
+   /// one secondary index of a table in one scope, ordered by (secondary, primary)
+   template<typename K>
+   struct secondary_table {
+      table_id id;
+      uint64_t payer = 0;
+      std::map<std::pair<K, uint64_t>, uint64_t> entries;
+      std::unordered_map<uint64_t, K> by_primary;
+   };
+
+   /// the RAM that the rows or index entries of a table in one scope bill to one payer
+   struct ram_charge {
+      table_id id;
+      bool secondary;      ///< index entries rather than rows; id.table carries the index number
+      uint64_t payer;
+      uint64_t objects;    ///< rows or index entries
+      int64_t bytes;       ///< including the table object, for the payer of the table
+   };
+
+   /// the kinds of db_* intrinsic call, as counted per table by the NATIVE_DB_STATS build
+   enum class db_op : uint8_t {
+      find,          ///< db_find_i64, db_idx*_find_secondary
+      find_primary,  ///< db_idx*_find_primary
+      lowerbound,
+      upperbound,
+      end,
+      next,
+      previous,
+      get,           ///< db_get_i64
+      store,         ///< emplace
+      update,        ///< modify
+      remove,        ///< erase
+      count
+   };
+
+   const char* db_op_name( db_op op );
+
+   /// a table across its scopes; secondary indices are counted apart from the rows
+   struct db_table {
+      uint64_t code;
+      uint64_t table;      ///< for a secondary index, the table name with the index number in the low 4 bits
+      bool secondary;
+
+      friend bool operator < ( const db_table& a, const db_table& b ) {
+         return std::tie( a.code, a.table, a.secondary ) < std::tie( b.code, b.table, b.secondary );
+      }
+
+      /// code:table, or code:table[n] for secondary index n
+      std::string to_string()const;
+   };
+
+   typedef std::array<uint64_t, size_t(db_op::count)> db_op_counts;
+   typedef std::map<db_table, db_op_counts> db_stats;
+
+   struct action_data {
+      name account;
+      name action;
+      std::vector<eosio::permission_level> authorization;
+      std::vector<char> data;
+
+      EOSLIB_SERIALIZE( action_data, (account)(action)(authorization)(data) )
+   };
+
+   struct transaction_result {
+      bool succeeded = true;
+      std::string error;
+      std::string console;
+      /// actions executed, including notifications and inline actions
+      uint32_t actions = 0;
+   };
+
+   class chain {
+   public:
+      /// the tables and secondary indices of a chain, which other chains can share
+      struct database;
+
+      chain();
+
+      /**
+       * A chain over an existing database, e.g. another chain's shared_database().  Its
+       * accounts, contracts, clock, RAM and db_* counts are its own.  Transactions of
+       * chains sharing a database may run at the same time on different threads only
+       * if they touch different scopes; the database only guards its table maps.  Create
+       * the chains before their threads start.
+       */
+      explicit chain( std::shared_ptr<database> db );
+      ~chain();
+
+      chain( const chain& ) = delete;
+      chain& operator=( const chain& ) = delete;
+
+      /// the chain whose intrinsics the calling thread's contracts use
+      static chain& active();
+
+      void create_account( name account );
+      bool is_account( name account )const;
+
+      /// binds the contract registered under type_name to the account, creating it if needed
+      void set_code( name account, const std::string& type_name );
+
+      /// binds an apply function to the account, creating it if needed, e.g. a wasm module's
+      void set_apply( name account, std::function<void( uint64_t, uint64_t, uint64_t )> apply );
+
+      transaction_result push_transaction( const std::vector<action_data>& actions );
+
+      transaction_result push_action( name account, name action,
+                                      std::vector<eosio::permission_level> authorization,
+                                      std::vector<char> data );
+
+      template<typename... Args>
+      transaction_result push_action( name account, name action, name actor, Args&&... args ) {
+         return push_action( account, action, { {actor, name("active")} },
+                             eosio::pack( std::make_tuple( std::forward<Args>(args)... ) ) );
+      }
+
+      /// runs the deferred transactions whose delay has passed, returns how many ran
+      uint32_t run_deferred();
+
+      /**
+       * Runs fn with the database access of the receiver's contract, as if in one of its
+       * actions authorized by receiver@active, e.g. to seed or inspect its tables through
+       * the contract's own types.  The changes are kept unless fn throws.
+       */
+      void run_as( name receiver, const std::function<void()>& fn );
+
+      /**
+       * Calls fn once for each row changed by a committed transaction or run_as, with
+       * the row as it now stands or nullptr if it was removed, e.g. to keep an index or
+       * a journal in step with the tables.  Changes that are rolled back are not seen.
+       */
+      void set_row_observer( std::function<void( const table&, uint64_t primary, const row* )> fn );
+
+      /**
+       * Writes a row as it stood in a saved state, or removes it if r is null, outside
+       * any transaction and without authorization checks.  RAM is billed as for a
+       * contract's write.  For restoring a chain from a journal or a snapshot.
+       */
+      void load_row( const table_id& id, uint64_t primary, const row* r );
+
+      /// microseconds since the epoch, as returned by current_time
+      uint64_t time()const { return _time; }
+      void set_time( uint64_t microseconds ) { _time = microseconds; }
+      void advance_time( uint64_t microseconds ) { _time += microseconds; }
+
+      /// echo contract output to stdout as well as returning it with each result
+      void set_console_echo( bool echo ) { _echo = echo; }
+      bool console_echo()const { return _echo; }
+
+      /// RAM billed to each payer, in bytes, by this chain's transactions
+      const std::unordered_map<uint64_t, int64_t>& ram_usage()const { return _ram; }
+      int64_t ram_usage( name payer )const;
+
+      const std::map<table_id, table>& tables()const;
+      const std::shared_ptr<database>& shared_database()const { return _db; }
+
+      /// RAM billed for table data, by table, scope and payer; sums to the database part of ram_usage
+      /// over the chains sharing the database
+      std::vector<ram_charge> ram_charges()const;
+      const table* find_table( name code, uint64_t scope, name table_name )const;
+
+#ifdef NATIVE_DB_STATS
+      /// number of db_* intrinsic calls made so far
+      uint64_t db_calls()const { return _db_calls; }
+#endif
+
+      /**
+       * db_* calls made so far by kind and table.  Only counted when eosio_native is
+       * built with NATIVE_DB_STATS, which also prints each action's counts to its console
+       * when the action ends; otherwise empty.
+       */
+      const native::db_stats& db_stats()const { return _db_stats; }
+      void reset_db_stats() { _db_stats.clear(); }
+
+      /// maximum depth of nested inline actions, as configured on the chain
+      void set_max_inline_depth( uint32_t depth ) { _max_inline_depth = depth; }
+
+      struct impl;
+
+      /// state behind the intrinsics
+      impl& state() { return *_impl; }
+
+   private:
+      friend struct impl;
+
+      std::shared_ptr<database> _db;
+      std::unique_ptr<impl> _impl;
+
+      std::unordered_map<uint64_t, int64_t> _ram;
+      uint64_t _time;
+#ifdef NATIVE_DB_STATS
+      uint64_t _db_calls = 0;
+#endif
+      native::db_stats _db_stats;
+      bool _echo = false;
+      uint32_t _max_inline_depth = 4;
+   };
+
+} /// namespace native
@@ -0,0 +1,74 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  A WebAssembly (MVP) interpreter for running compiled contracts on the in-memory
+ *  chain.  The eosio imports a module uses are served by the same intrinsics as the
+ *  host-built contracts, with pointers translated into the module's linear memory.
+ *
+ *  Modules are decoded once into a compact instruction form with resolved branch
+ *  targets.  Decoding checks the structure, indices and operand stack heights of
+ *  the code, but not operand types; the modules are trusted build outputs.
+ */
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace native {
+
+   /// a module that cannot be decoded, or imports what the host does not provide
+   struct wasm_error : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   /// a trap while running a module; fails the transaction
+   struct wasm_trap : std::runtime_error {
+      using std::runtime_error::runtime_error;
+   };
+
+   /// counters of the code run through one wasm_apply
+   struct wasm_stats {
+      uint64_t calls = 0;           ///< apply calls
+      uint64_t instructions = 0;    ///< executed instructions; block, loop and end are not counted
+      uint64_t host_calls = 0;
+      uint64_t instantiate_ns = 0;  ///< total time spent creating instances
+   };
+
+   class wasm_module {
+   public:
+      /// decodes a module; throws wasm_error if it is malformed or uses features beyond the MVP
+      explicit wasm_module( const std::vector<uint8_t>& code );
+      ~wasm_module();
+
+      wasm_module( const wasm_module& ) = delete;
+      wasm_module& operator=( const wasm_module& ) = delete;
+
+      size_t code_size()const;                  ///< bytes of the module
+      uint32_t function_count()const;           ///< defined functions, imports excluded
+      uint64_t instruction_count()const;        ///< decoded instructions over all functions
+      std::vector<std::string> imports()const;  ///< imported functions, as module.name
+
+      struct impl;
+      const impl& state()const { return *_impl; }
+
+   private:
+      std::unique_ptr<const impl> _impl;
+   };
+
+   /**
+    * An apply function for chain::set_apply that runs the module's exported apply.
+    * Each call runs in a fresh instance, as in nodeos.  Throws wasm_error if the module
+    * imports a function the host does not provide, or with another signature.
+    */
+   std::function<void( uint64_t, uint64_t, uint64_t )>
+   wasm_apply( std::shared_ptr<const wasm_module> module, std::shared_ptr<wasm_stats> stats = nullptr );
+
+   /// reads a .wasm file; throws wasm_error if it cannot be read
+   std::vector<uint8_t> read_wasm_file( const std::string& path );
+
+} /// namespace native
@@ -0,0 +1,1260 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <native/chain.hpp>
+
+#include <eosiolib/action.h>
+#include <eosiolib/db.h>
+#include <eosiolib/dispatcher.hpp>
+#include <eosiolib/print.h>
+#include <eosiolib/system.h>
+#include <eosiolib/transaction.h>
+#include <eosiolib/transaction.hpp>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <mutex>
+#include <shared_mutex>
+
+namespace native {
+
+   namespace {
+
+      thread_local chain* active_chain = nullptr;
+
+      std::unordered_map<std::string, eosio::apply_function>& registry() {
+         static std::unordered_map<std::string, eosio::apply_function> contracts;
+         return contracts;
+      }
+
+      /// thrown by eosio_exit; ends the action without failing it
+      struct exit_request {};
+
+      /// makes a chain the active one for the calling thread while in scope
+      struct activation {
+         chain* previous;
+         explicit activation( chain* c ) : previous( active_chain ) { active_chain = c; }
+         ~activation() { active_chain = previous; }
+      };
+
+      [[noreturn]] void fail( const std::string& msg ) {
+         throw assertion_failure( msg );
+      }
+
+      void check( bool pred, const char* msg ) {
+         if( !pred )
+            fail( msg );
+      }
+
+      /**
+       * Maps the integer iterators handed to contracts onto table positions.  End
+       * iterators are -2 - (index of the table), as in nodeos.
+       */
+      template<typename Table, typename Iterator>
+      class iterator_cache {
+      public:
+         int32_t end_of( Table& t ) {
+            auto found = _end_index.find( &t );
+            if( found != _end_index.end() )
+               return -( found->second + 2 );
+
+            int32_t index = _end_tables.size();
+            _end_tables.push_back( &t );
+            _end_index.emplace( &t, index );
+            return -( index + 2 );
+         }
+
+         Table& table_of_end( int32_t ei ) {
+            check( ei < -1, "not an end iterator" );
+            size_t index = -( ei + 2 );
+            check( index < _end_tables.size(), "an invariant was broken, table should be in cache" );
+            return *_end_tables[index];
+         }
+
+         int32_t add( Table& t, Iterator it ) {
+            auto found = _by_object.find( &*it );
+            if( found != _by_object.end() )
+               return found->second;
+
+            end_of( t );
+            int32_t index = _entries.size();
+            _entries.push_back( { &t, it, true } );
+            _by_object.emplace( &*it, index );
+            return index;
+         }
+
+         struct entry {
+            Table* t;
+            Iterator it;
+            bool valid;
+         };
+
+         entry& get( int32_t i ) {
+            check( i >= 0, "invalid iterator" );
+            check( size_t(i) < _entries.size(), "iterator out of range" );
+            check( _entries[i].valid, "dereference of deleted object" );
+            return _entries[i];
+         }
+
+         void remove( int32_t i ) {
+            auto& e = get( i );
+            _by_object.erase( &*e.it );
+            e.valid = false;
+         }
+
+         void replace( int32_t i, Iterator it ) {
+            auto& e = get( i );
+            _by_object.erase( &*e.it );
+            e.it = it;
+            _by_object.emplace( &*it, i );
+         }
+
+      private:
+         std::vector<Table*> _end_tables;
+         std::unordered_map<const Table*, int32_t> _end_index;
+         std::vector<entry> _entries;
+         std::unordered_map<const void*, int32_t> _by_object;
+      };
+
+      template<typename K>
+      using secondary_cache = iterator_cache<secondary_table<K>,
+                                             typename std::map<std::pair<K, uint64_t>, uint64_t>::iterator>;
+
+      typedef iterator_cache<table, std::map<uint64_t, row>::iterator> primary_cache;
+
+      template<typename K>
+      struct secondary_billing;
+
+      template<> struct secondary_billing<uint64_t> { static constexpr int64_t value = billable_size::idx64; };
+      template<> struct secondary_billing<uint128_t> { static constexpr int64_t value = billable_size::idx128; };
+      template<> struct secondary_billing<double> { static constexpr int64_t value = billable_size::idx_double; };
+      template<> struct secondary_billing<long double> { static constexpr int64_t value = billable_size::idx_long_double; };
+
+      struct deferred_transaction {
+         uint64_t sender;
+         uint128_t sender_id;
+         uint64_t payer;
+         uint64_t execute_after;
+         std::vector<action_data> actions;
+      };
+
+   } /// anonymous namespace
+
+   /// execution state of one receiver running one action
+   struct apply_context {
+      uint64_t receiver;
+      const action_data& act;
+      std::vector<uint64_t>& receivers;
+      std::vector<action_data>& inlines;
+      bool notification;
+
+      primary_cache primary{};
+      secondary_cache<uint64_t> idx64{};
+      secondary_cache<uint128_t> idx128{};
+      secondary_cache<double> idx_double{};
+      secondary_cache<long double> idx_long_double{};
+
+      template<typename K> secondary_cache<K>& secondary();
+
+#ifdef NATIVE_DB_STATS
+      db_stats db_ops{};
+#endif
+   };
+
+   template<> secondary_cache<uint64_t>& apply_context::secondary<uint64_t>() { return idx64; }
+   template<> secondary_cache<uint128_t>& apply_context::secondary<uint128_t>() { return idx128; }
+   template<> secondary_cache<double>& apply_context::secondary<double>() { return idx_double; }
+   template<> secondary_cache<long double>& apply_context::secondary<long double>() { return idx_long_double; }
+
+   /**
+    * Tables are never removed from the maps, so references to them stay valid.  Once
+    * shared, finding a table takes the lock shared and adding one takes it exclusive;
+    * the rows are left to the callers, which run on different scopes.
+    */
+   struct chain::database {
+      std::map<table_id, table> tables;
+      std::map<table_id, secondary_table<uint64_t>> idx64;
+      std::map<table_id, secondary_table<uint128_t>> idx128;
+      std::map<table_id, secondary_table<double>> idx_double;
+      std::map<table_id, secondary_table<long double>> idx_long_double;
+
+      std::shared_mutex mutex;
+      bool shared = false;
+
+      template<typename K> std::map<table_id, secondary_table<K>>& secondaries();
+
+      template<typename Map>
+      typename Map::mapped_type* find( Map& m, const table_id& id ) {
+         std::shared_lock<std::shared_mutex> lock( mutex, std::defer_lock );
+         if( shared )
+            lock.lock();
+         auto found = m.find( id );
+         return found == m.end() ? nullptr : &found->second;
+      }
+
+      template<typename Map>
+      typename Map::mapped_type& get( Map& m, const table_id& id ) {
+         std::unique_lock<std::shared_mutex> lock( mutex, std::defer_lock );
+         if( shared )
+            lock.lock();
+         auto& t = m[id];
+         t.id = id;
+         return t;
+      }
+   };
+
+   template<> std::map<table_id, secondary_table<uint64_t>>& chain::database::secondaries<uint64_t>() { return idx64; }
+   template<> std::map<table_id, secondary_table<uint128_t>>& chain::database::secondaries<uint128_t>() { return idx128; }
+   template<> std::map<table_id, secondary_table<double>>& chain::database::secondaries<double>() { return idx_double; }
+   template<> std::map<table_id, secondary_table<long double>>& chain::database::secondaries<long double>() { return idx_long_double; }
+
+   struct chain::impl {
+      chain& c;
+
+      std::unordered_set<uint64_t> accounts;
+      std::unordered_map<uint64_t, std::function<void( uint64_t, uint64_t, uint64_t )>> codes;
+
+      std::vector<apply_context*> contexts;
+      std::vector<std::function<void()>> undo;
+      std::string console;
+      uint32_t executed = 0;
+
+      /// rows written since the last commit, kept only while there is a row observer
+      std::function<void( const table&, uint64_t, const row* )> row_observer;
+      std::vector<std::pair<table*, uint64_t>> touched;
+
+      std::vector<deferred_transaction> deferred;
+
+      explicit impl( chain& ch ) : c(ch) {}
+
+      /// counts one db_* intrinsic call by kind and table; compiled out without NATIVE_DB_STATS
+      void count_db_call( db_op op, const table_id& id, bool secondary ) {
+#ifdef NATIVE_DB_STATS
+         ++c._db_calls;
+         ++context().db_ops[{ id.code, id.table, secondary }][size_t(op)];
+#else
+         (void)op; (void)id; (void)secondary;
+#endif
+      }
+
+      void print( const std::string& s ) {
+         console += s;
+         if( c._echo )
+            fwrite( s.data(), 1, s.size(), stdout );
+      }
+
+      apply_context& context() {
+         check( !contexts.empty(), "no action is executing" );
+         return *contexts.back();
+      }
+
+      // ---- RAM ---------------------------------------------------------------
+
+      void bill( uint64_t payer, int64_t delta ) {
+         c._ram[payer] += delta;
+      }
+
+      /// nodeos only lets an action increase the RAM of accounts that authorized it
+      void check_billing( uint64_t payer, int64_t delta ) {
+         if( delta <= 0 || contexts.empty() )
+            return;
+         auto& ctx = context();
+         if( payer == ctx.receiver )
+            return;
+         check( !ctx.notification, "cannot charge RAM to other accounts during notify" );
+         for( const auto& level : ctx.act.authorization ) {
+            if( level.actor.value == payer )
+               return;
+         }
+         fail( "unauthorized RAM usage increase: missing authority of " + name(payer).to_string() );
+      }
+
+      // ---- primary rows ------------------------------------------------------
+
+      table* find_table( uint64_t code, uint64_t scope, uint64_t t ) {
+         return c._db->find( c._db->tables, {code, scope, t} );
+      }
+
+      table& get_table( uint64_t code, uint64_t scope, uint64_t t ) {
+         return c._db->get( c._db->tables, {code, scope, t} );
+      }
+
+      std::map<uint64_t, row>::iterator insert_row( table& t, uint64_t pk, uint64_t payer, std::vector<char> data ) {
+         if( t.rows.empty() ) {
+            t.payer = payer;
+            bill( payer, billable_size::table );
+         }
+         bill( payer, billable_size::row + data.size() );
+
+         auto it = t.rows.emplace( pk, row{payer, std::move(data)} ).first;
+         undo.push_back( [this, &t, pk]() { erase_row( t, pk ); } );
+         touch( t, pk );
+         return it;
+      }
+
+      void erase_row( table& t, uint64_t pk ) {
+         auto it = t.rows.find( pk );
+         row old = std::move( it->second );
+         t.rows.erase( it );
+
+         bill( old.payer, -( billable_size::row + (int64_t)old.data.size() ) );
+         if( t.rows.empty() )
+            bill( t.payer, -billable_size::table );
+
+         undo.push_back( [this, &t, pk, old]() mutable { insert_row( t, pk, old.payer, std::move(old.data) ); } );
+         touch( t, pk );
+      }
+
+      void replace_row( table& t, uint64_t pk, uint64_t payer, std::vector<char> data ) {
+         auto it = t.rows.find( pk );
+         row old = std::move( it->second );
+         bill( old.payer, -( billable_size::row + (int64_t)old.data.size() ) );
+         bill( payer, billable_size::row + data.size() );
+         it->second = row{payer, std::move(data)};
+
+         undo.push_back( [this, &t, pk, old]() mutable { replace_row( t, pk, old.payer, std::move(old.data) ); } );
+         touch( t, pk );
+      }
+
+      void touch( table& t, uint64_t pk ) {
+         if( row_observer )
+            touched.emplace_back( &t, pk );
+      }
+
+      /// reports the rows written since the last commit, each once, to the row observer
+      void commit_rows() {
+         if( !row_observer )
+            return;
+         std::sort( touched.begin(), touched.end() );
+         touched.erase( std::unique( touched.begin(), touched.end() ), touched.end() );
+         auto rows = std::move( touched );
+         touched.clear();
+         for( const auto& [t, pk] : rows ) {
+            auto it = t->rows.find( pk );
+            row_observer( *t, pk, it == t->rows.end() ? nullptr : &it->second );
+         }
+      }
+
+      // ---- secondary entries -------------------------------------------------
+
+      template<typename K>
+      secondary_table<K>* find_secondary_table( uint64_t code, uint64_t scope, uint64_t t ) {
+         return c._db->find( c._db->secondaries<K>(), {code, scope, t} );
+      }
+
+      template<typename K>
+      secondary_table<K>& get_secondary_table( const table_id& id ) {
+         return c._db->get( c._db->secondaries<K>(), id );
+      }
+
+      template<typename K>
+      typename std::map<std::pair<K, uint64_t>, uint64_t>::iterator
+      insert_secondary( secondary_table<K>& t, uint64_t pk, K key, uint64_t payer ) {
+         if( t.entries.empty() ) {
+            t.payer = payer;
+            bill( payer, billable_size::table );
+         }
+         bill( payer, secondary_billing<K>::value );
+
+         auto it = t.entries.emplace( std::make_pair( key, pk ), payer ).first;
+         t.by_primary[pk] = key;
+         undo.push_back( [this, &t, pk]() { erase_secondary( t, pk ); } );
+         return it;
+      }
+
+      template<typename K>
+      void erase_secondary( secondary_table<K>& t, uint64_t pk ) {
+         auto key = t.by_primary.at( pk );
+         auto it = t.entries.find( std::make_pair( key, pk ) );
+         uint64_t payer = it->second;
+         t.entries.erase( it );
+         t.by_primary.erase( pk );
+
+         bill( payer, -secondary_billing<K>::value );
+         if( t.entries.empty() )
+            bill( t.payer, -billable_size::table );
+
+         undo.push_back( [this, &t, pk, key, payer]() { insert_secondary( t, pk, key, payer ); } );
+      }
+
+      // ---- execution ---------------------------------------------------------
+
+#ifdef NATIVE_DB_STATS
+      /// prints the db_* calls of an action per table to its console and adds them to the chain's totals
+      void report_db_stats( const apply_context& ctx ) {
+         if( ctx.db_ops.empty() )
+            return;
+
+         std::string out = "db " + name(ctx.receiver).to_string() + " " + ctx.act.account.to_string()
+                         + "::" + ctx.act.action.to_string() + ":";
+         for( const auto& [tbl, counts] : ctx.db_ops ) {
+            auto& total = c._db_stats[tbl];
+            out += " " + tbl.to_string() + "(";
+            const char* separator = "";
+            for( size_t op = 0; op < counts.size(); ++op ) {
+               if( counts[op] == 0 )
+                  continue;
+               total[op] += counts[op];
+               out += separator;
+               out += db_op_name( db_op(op) );
+               out += "=" + std::to_string( counts[op] );
+               separator = " ";
+            }
+            out += ")";
+         }
+         print( out + "\n" );
+      }
+#endif
+
+      void check_inline_authorization( const apply_context& ctx, const action_data& act ) {
+         check( accounts.count( act.account.value ), "inline action's code account does not exist" );
+         for( const auto& level : act.authorization ) {
+            if( level.actor.value == ctx.receiver )
+               continue;
+            bool authorized = false;
+            for( const auto& parent : ctx.act.authorization ) {
+               if( parent.actor == level.actor ) {
+                  authorized = true;
+                  break;
+               }
+            }
+            check( authorized, ( "inline action authorization " + level.actor.to_string() + "@"
+                                 + level.permission.to_string() + " is not satisfied" ).c_str() );
+         }
+      }
+
+      void execute( const action_data& act, uint32_t depth ) {
+         check( depth <= c._max_inline_depth, "max inline action depth per transaction reached" );
+         check( accounts.count( act.account.value ), "action's code account does not exist" );
+
+         std::vector<uint64_t> receivers{ act.account.value };
+         std::vector<action_data> inlines;
+
+         for( size_t i = 0; i < receivers.size(); ++i ) {
+            apply_context ctx{ receivers[i], act, receivers, inlines, i > 0 };
+
+            struct context_guard {
+               std::vector<apply_context*>& contexts;
+               ~context_guard() { contexts.pop_back(); }
+            };
+            contexts.push_back( &ctx );
+            context_guard guard{ contexts };
+
+            ++executed;
+            auto code = codes.find( ctx.receiver );
+            if( code != codes.end() && code->second ) {
+               try {
+                  code->second( ctx.receiver, act.account.value, act.action.value );
+               } catch( const exit_request& ) {
+               }
+            }
+#ifdef NATIVE_DB_STATS
+            report_db_stats( ctx );
+#endif
+         }
+
+         for( const auto& inline_action : inlines )
+            execute( inline_action, depth + 1 );
+      }
+
+      void rollback() {
+         while( !undo.empty() ) {
+            auto op = std::move( undo.back() );
+            undo.pop_back();
+
+            // reverting pushes its own inverse, which is not wanted here
+            auto depth = undo.size();
+            op();
+            undo.resize( depth );
+         }         touched.clear();
+      }
+   };
+
+   // ---- db stats -------------------------------------------------------------
+
+   const char* db_op_name( db_op op ) {
+      static const char* names[] = { "find", "find_primary", "lowerbound", "upperbound", "end",
+                                     "next", "previous", "get", "store", "update", "remove" };
+      static_assert( sizeof(names) / sizeof(names[0]) == size_t(db_op::count), "a db_op has no name" );
+      return names[size_t(op)];
+   }
+
+   std::string db_table::to_string()const {
+      std::string s = name(code).to_string() + ":";
+      if( !secondary )
+         return s + name(table).to_string();
+      return s + name( table & ~uint64_t(0x0f) ).to_string() + "[" + std::to_string( table & 0x0f ) + "]";
+   }
+
+   // ---- chain ----------------------------------------------------------------
+
+   chain::chain() : chain( std::make_shared<database>() ) {}
+
+   chain::chain( std::shared_ptr<database> db )
+      : _db( std::move(db) ),
+        _impl( std::make_unique<impl>( *this ) ),
+        _time( 1546300800ull * 1000000 ) // 2019-01-01
+   {
+      if( _db.use_count() > 1 ) {
+         std::unique_lock<std::shared_mutex> lock( _db->mutex );
+         _db->shared = true;
+      }
+      if( !active_chain )
+         active_chain = this;
+   }
+
+   chain::~chain() {
+      if( active_chain == this )
+         active_chain = nullptr;
+   }
+
+   chain& chain::active() {
+      check( active_chain != nullptr, "no active chain" );
+      return *active_chain;
+   }
+
+   void chain::create_account( name account ) {
+      _impl->accounts.insert( account.value );
+   }
+
+   bool chain::is_account( name account )const {
+      return _impl->accounts.count( account.value ) > 0;
+   }
+
+   void chain::set_code( name account, const std::string& type_name ) {
+      auto found = registry().find( type_name );
+      if( found == registry().end() )
+         throw std::invalid_argument( "no contract registered as " + type_name );
+
+      create_account( account );
+      _impl->codes[account.value] = found->second;
+   }
+
+   void chain::set_apply( name account, std::function<void( uint64_t, uint64_t, uint64_t )> apply ) {
+      create_account( account );
+      _impl->codes[account.value] = std::move(apply);
+   }
+
+   int64_t chain::ram_usage( name payer )const {
+      auto found = _ram.find( payer.value );
+      return found == _ram.end() ? 0 : found->second;
+   }
+
+   const std::map<table_id, table>& chain::tables()const {
+      return _db->tables;
+   }
+
+   const table* chain::find_table( name code, uint64_t scope, name table_name )const {
+      return _db->find( _db->tables, {code.value, scope, table_name.value} );
+   }
+
+   namespace {
+
+      /// adds the charges of one table's objects, given each object's payer and size
+      template<typename Objects, typename Charge>
+      void add_charges( std::vector<ram_charge>& out, const table_id& id, bool secondary, uint64_t table_payer,
+                        const Objects& objects, Charge&& charge ) {
+         if( objects.empty() )
+            return;
+
+         std::map<uint64_t, ram_charge> by_payer;
+         by_payer[table_payer] = ram_charge{ id, secondary, table_payer, 0, billable_size::table };
+         for( const auto& o : objects ) {
+            auto [payer, bytes] = charge( o );
+            auto& c = by_payer.emplace( payer, ram_charge{ id, secondary, payer, 0, 0 } ).first->second;
+            ++c.objects;
+            c.bytes += bytes;
+         }
+         for( auto& entry : by_payer )
+            out.push_back( entry.second );
+      }
+
+      template<typename K>
+      void add_secondary_charges( std::vector<ram_charge>& out, const std::map<table_id, secondary_table<K>>& tables ) {
+         for( const auto& [id, t] : tables ) {
+            add_charges( out, id, true, t.payer, t.entries, []( const auto& e ) {
+               return std::make_pair( e.second, secondary_billing<K>::value );
+            } );
+         }
+      }
+
+   } /// anonymous namespace
+
+   std::vector<ram_charge> chain::ram_charges()const {
+      std::vector<ram_charge> out;
+      for( const auto& [id, t] : _db->tables ) {
+         add_charges( out, id, false, t.payer, t.rows, []( const auto& r ) {
+            return std::make_pair( r.second.payer, billable_size::row + int64_t( r.second.data.size() ) );
+         } );
+      }
+      add_secondary_charges( out, _db->idx64 );
+      add_secondary_charges( out, _db->idx128 );
+      add_secondary_charges( out, _db->idx_double );
+      add_secondary_charges( out, _db->idx_long_double );
+      return out;
+   }
+
+   transaction_result chain::push_transaction( const std::vector<action_data>& actions ) {
+      activation activate( this );
+
+      transaction_result result;
+      _impl->undo.clear();
+      _impl->console.clear();
+      _impl->executed = 0;
+
+      try {
+         for( const auto& act : actions ) {
+            for( const auto& level : act.authorization )
+               check( is_account( level.actor ), "authorizing actor does not exist" );
+            _impl->execute( act, 0 );
+         }
+      } catch( const std::exception& e ) {
+         _impl->contexts.clear();
+         _impl->rollback();
+         result.succeeded = false;
+         result.error = e.what();
+      }
+
+      _impl->undo.clear();
+      _impl->commit_rows();
+      result.console = std::move( _impl->console );
+      result.actions = _impl->executed;
+      return result;
+   }
+
+   transaction_result chain::push_action( name account, name action,
+                                          std::vector<eosio::permission_level> authorization,
+                                          std::vector<char> data ) {
+      return push_transaction( { action_data{ account, action, std::move(authorization), std::move(data) } } );
+   }
+
+   void chain::run_as( name receiver, const std::function<void()>& fn ) {
+      activation activate( this );
+      check( _impl->contexts.empty(), "run_as cannot be called from an action" );
+      check( is_account( receiver ), "receiver account does not exist" );
+
+      action_data act{ receiver, name(), { {receiver, name("active")} }, {} };
+      std::vector<uint64_t> receivers{ receiver.value };
+      std::vector<action_data> inlines;
+      apply_context ctx{ receiver.value, act, receivers, inlines, false };
+
+      _impl->undo.clear();
+      _impl->contexts.push_back( &ctx );
+      try {
+         fn();
+         check( inlines.empty() && receivers.size() == 1, "run_as cannot send actions or notifications" );
+      } catch( ... ) {
+         _impl->contexts.clear();
+         _impl->rollback();
+         throw;
+      }
+      _impl->contexts.pop_back();
+      _impl->undo.clear();
+      _impl->commit_rows();
+   }
+
+   void chain::set_row_observer( std::function<void( const table&, uint64_t, const row* )> fn ) {
+      _impl->row_observer = std::move(fn);
+      _impl->touched.clear();
+   }
+
+   void chain::load_row( const table_id& id, uint64_t primary, const row* r ) {
+      check( _impl->contexts.empty(), "load_row cannot be called from an action" );
+      auto& t = _impl->get_table( id.code, id.scope, id.table );
+      bool found = t.rows.count( primary );
+      if( !r ) {
+         if( found )
+            _impl->erase_row( t, primary );
+      }
+      else if( found ) {
+         _impl->replace_row( t, primary, r->payer, r->data );
+      }
+      else {
+         _impl->insert_row( t, primary, r->payer, r->data );
+      }
+      _impl->undo.clear();
+      _impl->touched.clear();
+   }
+
+   uint32_t chain::run_deferred() {
+      uint32_t ran = 0;
+      for( ;; ) {
+         auto& pending = _impl->deferred;
+         auto due = std::find_if( pending.begin(), pending.end(), [&]( const deferred_transaction& trx ) {
+            return trx.execute_after <= _time;
+         } );
+         if( due == pending.end() )
+            break;
+
+         auto actions = std::move( due->actions );
+         pending.erase( due );
+         push_transaction( actions );
+         ++ran;
+      }
+      return ran;
+   }
+
+} /// namespace native
+
+namespace eosio {
+
+   void register_contract( const char* type_name, apply_function apply ) {
+      native::registry()[type_name] = apply;
+   }
+
+} /// namespace eosio
+
+// ---- intrinsics -------------------------------------------------------------
+
+using native::apply_context;
+using native::check;
+
+namespace {
+
+   native::chain::impl& state() {
+      return native::chain::active().state();
+   }
+
+   apply_context& context() {
+      return state().context();
+   }
+
+   void count_db_call( native::db_op op, const native::table_id& id, bool secondary = false ) {
+      state().count_db_call( op, id, secondary );
+   }
+
+   void require_write( const native::table_id& id ) {
+      check( id.code == context().receiver, "db access violation" );
+   }
+
+   template<typename K>
+   int32_t idx_store( uint64_t scope, uint64_t table, uint64_t payer, uint64_t id, const K* secondary ) {
+      auto& s = state();
+      auto& ctx = context();
+      native::table_id tid{ ctx.receiver, scope, table };
+      count_db_call( native::db_op::store, tid, true );
+      check( payer != 0, "must specify a valid account to pay for new record" );
+      check( s.accounts.count( payer ), "payer of new record does not exist" );
+      s.check_billing( payer, native::secondary_billing<K>::value );
+
+      auto& t = s.get_secondary_table<K>( tid );
+      check( !t.by_primary.count( id ), "secondary index already has an entry for this primary key" );
+
+      auto it = s.insert_secondary( t, id, *secondary, payer );
+      return ctx.secondary<K>().add( t, it );
+   }
+
+   template<typename K>
+   void idx_update( int32_t iterator, uint64_t payer, const K* secondary ) {
+      auto& s = state();
+      auto& cache = context().secondary<K>();
+      auto& e = cache.get( iterator );
+      count_db_call( native::db_op::update, e.t->id, true );
+      require_write( e.t->id );
+
+      uint64_t pk = e.it->first.second;
+      uint64_t old_payer = e.it->second;
+      if( payer == 0 )
+         payer = old_payer;
+      if( payer != old_payer )
+         s.check_billing( payer, native::secondary_billing<K>::value );
+
+      s.erase_secondary( *e.t, pk );
+      auto it = s.insert_secondary( *e.t, pk, *secondary, payer );
+      cache.replace( iterator, it );
+   }
+
+   template<typename K>
+   void idx_remove( int32_t iterator ) {
+      auto& s = state();
+      auto& cache = context().secondary<K>();
+      auto e = cache.get( iterator );
+      count_db_call( native::db_op::remove, e.t->id, true );
+      require_write( e.t->id );
+
+      cache.remove( iterator );
+      s.erase_secondary( *e.t, e.it->first.second );
+   }
+
+   template<typename K>
+   int32_t idx_next( int32_t iterator, uint64_t* primary ) {
+      auto& cache = context().secondary<K>();
+      if( iterator < -1 ) {
+         count_db_call( native::db_op::next, cache.table_of_end( iterator ).id, true );
+         return -1;
+      }
+      auto& e = cache.get( iterator );
+      count_db_call( native::db_op::next, e.t->id, true );
+      auto it = std::next( e.it );
+      if( it == e.t->entries.end() )
+         return cache.end_of( *e.t );
+      *primary = it->first.second;
+      return cache.add( *e.t, it );
+   }
+
+   template<typename K>
+   int32_t idx_previous( int32_t iterator, uint64_t* primary ) {
+      auto& cache = context().secondary<K>();
+      if( iterator < -1 ) {
+         auto& t = cache.table_of_end( iterator );
+         count_db_call( native::db_op::previous, t.id, true );
+         if( t.entries.empty() )
+            return -1;
+         auto it = std::prev( t.entries.end() );
+         *primary = it->first.second;
+         return cache.add( t, it );
+      }
+
+      auto& e = cache.get( iterator );
+      count_db_call( native::db_op::previous, e.t->id, true );
+      if( e.it == e.t->entries.begin() )
+         return -1;
+      auto it = std::prev( e.it );
+      *primary = it->first.second;
+      return cache.add( *e.t, it );
+   }
+
+   template<typename K>
+   int32_t idx_find_primary( uint64_t code, uint64_t scope, uint64_t table, K* secondary, uint64_t primary ) {
+      count_db_call( native::db_op::find_primary, { code, scope, table }, true );
+      auto* t = state().find_secondary_table<K>( code, scope, table );
+      if( !t ) return -1;
+
+      auto& cache = context().secondary<K>();
+      auto found = t->by_primary.find( primary );
+      if( found == t->by_primary.end() )
+         return cache.end_of( *t );
+
+      *secondary = found->second;
+      return cache.add( *t, t->entries.find( std::make_pair( found->second, primary ) ) );
+   }
+
+   template<typename K>
+   int32_t idx_find_secondary( uint64_t code, uint64_t scope, uint64_t table, const K* secondary, uint64_t* primary ) {
+      count_db_call( native::db_op::find, { code, scope, table }, true );
+      auto* t = state().find_secondary_table<K>( code, scope, table );
+      if( !t ) return -1;
+
+      auto& cache = context().secondary<K>();
+      auto it = t->entries.lower_bound( std::make_pair( *secondary, uint64_t(0) ) );
+      if( it == t->entries.end() || it->first.first != *secondary )
+         return cache.end_of( *t );
+
+      *primary = it->first.second;
+      return cache.add( *t, it );
+   }
+
+   template<typename K>
+   int32_t idx_bound( uint64_t code, uint64_t scope, uint64_t table, K* secondary, uint64_t* primary, bool upper ) {
+      count_db_call( upper ? native::db_op::upperbound : native::db_op::lowerbound, { code, scope, table }, true );
+      auto* t = state().find_secondary_table<K>( code, scope, table );
+      if( !t ) return -1;
+
+      auto& cache = context().secondary<K>();
+      auto it = upper ? t->entries.upper_bound( std::make_pair( *secondary, std::numeric_limits<uint64_t>::max() ) )
+                      : t->entries.lower_bound( std::make_pair( *secondary, uint64_t(0) ) );
+      if( it == t->entries.end() )
+         return cache.end_of( *t );
+
+      *secondary = it->first.first;
+      *primary = it->first.second;
+      return cache.add( *t, it );
+   }
+
+   template<typename K>
+   int32_t idx_end( uint64_t code, uint64_t scope, uint64_t table ) {
+      count_db_call( native::db_op::end, { code, scope, table }, true );
+      auto* t = state().find_secondary_table<K>( code, scope, table );
+      if( !t ) return -1;
+      return context().secondary<K>().end_of( *t );
+   }
+
+   void print_string( const std::string& s ) {
+      state().print( s );
+   }
+
+} /// anonymous namespace
+
+extern "C" {
+
+   // ---- system ---------------------------------------------------------------
+
+   void eosio_assert( uint32_t test, const char* msg ) {
+      if( !test )
+         throw native::assertion_failure( std::string( "assertion failure with message: " ) + msg );
+   }
+
+   void eosio_assert_message( uint32_t test, const char* msg, uint32_t msg_len ) {
+      if( !test )
+         throw native::assertion_failure( "assertion failure with message: " + std::string( msg, msg_len ) );
+   }
+
+   void eosio_assert_code( uint32_t test, uint64_t code ) {
+      if( !test )
+         throw native::assertion_failure( "assertion failure with error code: " + std::to_string( code ) );
+   }
+
+   void eosio_exit( int32_t ) {
+      throw native::exit_request{};
+   }
+
+   uint64_t current_time( void ) {
+      return native::chain::active().time();
+   }
+
+   uint32_t now( void ) {
+      return native::chain::active().time() / 1000000;
+   }
+
+   // ---- action ---------------------------------------------------------------
+
+   uint32_t read_action_data( void* msg, uint32_t len ) {
+      const auto& data = context().act.data;
+      if( len == 0 )
+         return data.size();
+      auto copy = std::min<size_t>( len, data.size() );
+      memcpy( msg, data.data(), copy );
+      return copy;
+   }
+
+   uint32_t action_data_size( void ) {
+      return context().act.data.size();
+   }
+
+   void require_recipient( capi_name recipient ) {
+      auto& ctx = context();
+      check( state().accounts.count( recipient ), "recipient account does not exist" );
+      if( std::find( ctx.receivers.begin(), ctx.receivers.end(), recipient ) == ctx.receivers.end() )
+         ctx.receivers.push_back( recipient );
+   }
+
+   bool has_auth( capi_name account ) {
+      for( const auto& level : context().act.authorization ) {
+         if( level.actor.value == account )
+            return true;
+      }
+      return false;
+   }
+
+   void require_auth( capi_name account ) {
+      if( !has_auth( account ) )
+         native::fail( "missing authority of " + eosio::name(account).to_string() );
+   }
+
+   void require_auth2( capi_name account, capi_name permission ) {
+      for( const auto& level : context().act.authorization ) {
+         if( level.actor.value == account && level.permission.value == permission )
+            return;
+      }
+      native::fail( "missing authority of " + eosio::name(account).to_string() + "/"
+                    + eosio::name(permission).to_string() );
+   }
+
+   bool is_account( capi_name account ) {
+      return state().accounts.count( account ) > 0;
+   }
+
+   void send_inline( char* serialized_action, size_t size ) {
+      auto& ctx = context();
+      auto act = eosio::unpack<native::action_data>( serialized_action, size );
+      state().check_inline_authorization( ctx, act );
+      ctx.inlines.push_back( std::move(act) );
+   }
+
+   void send_context_free_inline( char* serialized_action, size_t size ) {
+      auto& ctx = context();
+      auto act = eosio::unpack<native::action_data>( serialized_action, size );
+      check( act.authorization.empty(), "context free actions cannot have authorizations" );
+      ctx.inlines.push_back( std::move(act) );
+   }
+
+   uint64_t publication_time( void ) {
+      return native::chain::active().time();
+   }
+
+   capi_name current_receiver( void ) {
+      return context().receiver;
+   }
+
+   // ---- transaction ----------------------------------------------------------
+
+   void send_deferred( const uint128_t* sender_id, capi_name payer, const char* serialized_transaction, size_t size,
+                       uint32_t replace_existing ) {
+      auto& s = state();
+      auto& ctx = context();
+      auto trx = eosio::unpack<eosio::transaction>( serialized_transaction, size );
+
+      native::deferred_transaction d;
+      d.sender = ctx.receiver;
+      d.sender_id = *sender_id;
+      d.payer = payer;
+      d.execute_after = native::chain::active().time() + uint64_t( trx.delay_sec.value ) * 1000000;
+      for( const auto& a : trx.actions )
+         d.actions.push_back( native::action_data{ a.account, a.name, a.authorization, a.data } );
+
+      auto existing = std::find_if( s.deferred.begin(), s.deferred.end(), [&]( const native::deferred_transaction& t ) {
+         return t.sender == d.sender && t.sender_id == d.sender_id;
+      } );
+      if( existing != s.deferred.end() ) {
+         check( replace_existing, "deferred transaction with the same sender_id and payer already exists" );
+         auto previous = *existing;
+         *existing = d;
+         s.undo.push_back( [&s, previous]() {
+            for( auto& t : s.deferred ) {
+               if( t.sender == previous.sender && t.sender_id == previous.sender_id )
+                  t = previous;
+            }
+         } );
+      } else {
+         s.deferred.push_back( d );
+         s.undo.push_back( [&s, sender = d.sender, id = d.sender_id]() {
+            s.deferred.erase( std::remove_if( s.deferred.begin(), s.deferred.end(), [&]( const native::deferred_transaction& t ) {
+               return t.sender == sender && t.sender_id == id;
+            } ), s.deferred.end() );
+         } );
+      }
+   }
+
+   int cancel_deferred( const uint128_t* sender_id ) {
+      auto& s = state();
+      auto sender = context().receiver;
+      auto existing = std::find_if( s.deferred.begin(), s.deferred.end(), [&]( const native::deferred_transaction& t ) {
+         return t.sender == sender && t.sender_id == *sender_id;
+      } );
+      if( existing == s.deferred.end() )
+         return 0;
+
+      auto previous = *existing;
+      s.deferred.erase( existing );
+      s.undo.push_back( [&s, previous]() { s.deferred.push_back( previous ); } );
+      return 1;
+   }
+
+   size_t transaction_size( void ) { return 0; }
+   int tapos_block_num( void ) { return 0; }
+   int tapos_block_prefix( void ) { return 0; }
+   uint32_t expiration( void ) { return now() + 60; }
+
+   // ---- print ----------------------------------------------------------------
+
+   void prints( const char* cstr ) { print_string( cstr ); }
+
+   void prints_l( const char* cstr, uint32_t len ) { print_string( std::string( cstr, len ) ); }
+
+   void printi( int64_t value ) { print_string( std::to_string( value ) ); }
+
+   void printui( uint64_t value ) { print_string( std::to_string( value ) ); }
+
+   void printi128( const int128_t* value ) {
+      bool negative = *value < 0;
+      uint128_t v = negative ? -(uint128_t)*value : (uint128_t)*value;
+      if( negative )
+         print_string( "-" );
+      printui128( &v );
+   }
+
+   void printui128( const uint128_t* value ) {
+      uint128_t v = *value;
+      std::string digits;
+      do {
+         digits.insert( digits.begin(), char( '0' + int( v % 10 ) ) );
+         v /= 10;
+      } while( v > 0 );
+      print_string( digits );
+   }
+
+   void printsf( float value ) { print_string( std::to_string( value ) ); }
+
+   void printdf( double value ) { print_string( std::to_string( value ) ); }
+
+   void printn( uint64_t n ) { print_string( eosio::name(n).to_string() ); }
+
+   void printhex( const void* data, uint32_t datalen ) {
+      static const char* digits = "0123456789abcdef";
+      std::string out;
+      out.reserve( datalen * 2 );
+      for( uint32_t i = 0; i < datalen; ++i ) {
+         auto b = ((const uint8_t*)data)[i];
+         out += digits[b >> 4];
+         out += digits[b & 0x0f];
+      }
+      print_string( out );
+   }
+
+   // ---- database -------------------------------------------------------------
+
+   int32_t db_store_i64( uint64_t scope, capi_name table, capi_name payer, uint64_t id, const void* data, uint32_t len ) {
+      auto& s = state();
+      auto& ctx = context();
+      count_db_call( native::db_op::store, { ctx.receiver, scope, table } );
+      check( payer != 0, "must specify a valid account to pay for new record" );
+      check( s.accounts.count( payer ), "payer of new record does not exist" );
+      s.check_billing( payer, native::billable_size::row + len );
+
+      auto& t = s.get_table( ctx.receiver, scope, table );
+      check( !t.rows.count( id ), "could not insert object, most likely a uniqueness constraint was violated" );
+
+      auto it = s.insert_row( t, id, payer, std::vector<char>( (const char*)data, (const char*)data + len ) );
+      return ctx.primary.add( t, it );
+   }
+
+   void db_update_i64( int32_t iterator, capi_name payer, const void* data, uint32_t len ) {
+      auto& s = state();
+      auto& e = context().primary.get( iterator );
+      count_db_call( native::db_op::update, e.t->id );
+      require_write( e.t->id );
+
+      const auto& old = e.it->second;
+      if( payer == 0 )
+         payer = old.payer;
+      int64_t delta = payer == old.payer ? int64_t(len) - int64_t(old.data.size())
+                                         : native::billable_size::row + len;
+      s.check_billing( payer, delta );
+
+      s.replace_row( *e.t, e.it->first, payer, std::vector<char>( (const char*)data, (const char*)data + len ) );
+   }
+
+   void db_remove_i64( int32_t iterator ) {
+      auto& s = state();
+      auto& cache = context().primary;
+      auto e = cache.get( iterator );
+      count_db_call( native::db_op::remove, e.t->id );
+      require_write( e.t->id );
+
+      cache.remove( iterator );
+      s.erase_row( *e.t, e.it->first );
+   }
+
+   int32_t db_get_i64( int32_t iterator, void* data, uint32_t len ) {
+      auto& e = context().primary.get( iterator );
+      count_db_call( native::db_op::get, e.t->id );
+      const auto& r = e.it->second;
+      if( len == 0 )
+         return r.data.size();
+      auto copy = std::min<size_t>( len, r.data.size() );
+      memcpy( data, r.data.data(), copy );
+      return copy;
+   }
+
+   int32_t db_next_i64( int32_t iterator, uint64_t* primary ) {
+      auto& cache = context().primary;
+      if( iterator < -1 ) {
+         count_db_call( native::db_op::next, cache.table_of_end( iterator ).id );
+         return -1;
+      }
+      auto& e = cache.get( iterator );
+      count_db_call( native::db_op::next, e.t->id );
+      auto it = std::next( e.it );
+      if( it == e.t->rows.end() )
+         return cache.end_of( *e.t );
+      *primary = it->first;
+      return cache.add( *e.t, it );
+   }
+
+   int32_t db_previous_i64( int32_t iterator, uint64_t* primary ) {
+      auto& cache = context().primary;
+      if( iterator < -1 ) {
+         auto& t = cache.table_of_end( iterator );
+         count_db_call( native::db_op::previous, t.id );
+         if( t.rows.empty() )
+            return -1;
+         auto it = std::prev( t.rows.end() );
+         *primary = it->first;
+         return cache.add( t, it );
+      }
+
+      auto& e = cache.get( iterator );
+      count_db_call( native::db_op::previous, e.t->id );
+      if( e.it == e.t->rows.begin() )
+         return -1;
+      auto it = std::prev( e.it );
+      *primary = it->first;
+      return cache.add( *e.t, it );
+   }
+
+   int32_t db_find_i64( capi_name code, uint64_t scope, capi_name table, uint64_t id ) {
+      count_db_call( native::db_op::find, { code, scope, table } );
+      auto* t = state().find_table( code, scope, table );
+      if( !t ) return -1;
+
+      auto& cache = context().primary;
+      auto it = t->rows.find( id );
+      if( it == t->rows.end() )
+         return cache.end_of( *t );
+      return cache.add( *t, it );
+   }
+
+   int32_t db_lowerbound_i64( capi_name code, uint64_t scope, capi_name table, uint64_t id ) {
+      count_db_call( native::db_op::lowerbound, { code, scope, table } );
+      auto* t = state().find_table( code, scope, table );
+      if( !t ) return -1;
+
+      auto& cache = context().primary;
+      auto it = t->rows.lower_bound( id );
+      if( it == t->rows.end() )
+         return cache.end_of( *t );
+      return cache.add( *t, it );
+   }
+
+   int32_t db_upperbound_i64( capi_name code, uint64_t scope, capi_name table, uint64_t id ) {
+      count_db_call( native::db_op::upperbound, { code, scope, table } );
+      auto* t = state().find_table( code, scope, table );
+      if( !t ) return -1;
+
+      auto& cache = context().primary;
+      auto it = t->rows.upper_bound( id );
+      if( it == t->rows.end() )
+         return cache.end_of( *t );
+      return cache.add( *t, it );
+   }
+
+   int32_t db_end_i64( capi_name code, uint64_t scope, capi_name table ) {
+      count_db_call( native::db_op::end, { code, scope, table } );
+      auto* t = state().find_table( code, scope, table );
+      if( !t ) return -1;
+      return context().primary.end_of( *t );
+   }
+
+#define NATIVE_DB_SECONDARY_IMPL( IDX, TYPE ) \
+   int32_t db_##IDX##_store( uint64_t scope, capi_name table, capi_name payer, uint64_t id, const TYPE* secondary ) { \
+      return idx_store<TYPE>( scope, table, payer, id, secondary ); \
+   } \
+   void db_##IDX##_update( int32_t iterator, capi_name payer, const TYPE* secondary ) { \
+      idx_update<TYPE>( iterator, payer, secondary ); \
+   } \
+   void db_##IDX##_remove( int32_t iterator ) { \
+      idx_remove<TYPE>( iterator ); \
+   } \
+   int32_t db_##IDX##_next( int32_t iterator, uint64_t* primary ) { \
+      return idx_next<TYPE>( iterator, primary ); \
+   } \
+   int32_t db_##IDX##_previous( int32_t iterator, uint64_t* primary ) { \
+      return idx_previous<TYPE>( iterator, primary ); \
+   } \
+   int32_t db_##IDX##_find_primary( capi_name code, uint64_t scope, capi_name table, TYPE* secondary, uint64_t primary ) { \
+      return idx_find_primary<TYPE>( code, scope, table, secondary, primary ); \
+   } \
+   int32_t db_##IDX##_find_secondary( capi_name code, uint64_t scope, capi_name table, const TYPE* secondary, uint64_t* primary ) { \
+      return idx_find_secondary<TYPE>( code, scope, table, secondary, primary ); \
+   } \
+   int32_t db_##IDX##_lowerbound( capi_name code, uint64_t scope, capi_name table, TYPE* secondary, uint64_t* primary ) { \
+      return idx_bound<TYPE>( code, scope, table, secondary, primary, false ); \
+   } \
+   int32_t db_##IDX##_upperbound( capi_name code, uint64_t scope, capi_name table, TYPE* secondary, uint64_t* primary ) { \
+      return idx_bound<TYPE>( code, scope, table, secondary, primary, true ); \
+   } \
+   int32_t db_##IDX##_end( capi_name code, uint64_t scope, capi_name table ) { \
+      return idx_end<TYPE>( code, scope, table ); \
+   }
+
+   NATIVE_DB_SECONDARY_IMPL( idx64, uint64_t )
+   NATIVE_DB_SECONDARY_IMPL( idx128, uint128_t )
+   NATIVE_DB_SECONDARY_IMPL( idx_double, double )
+   NATIVE_DB_SECONDARY_IMPL( idx_long_double, long double )
+
+#undef NATIVE_DB_SECONDARY_IMPL
+
+} /// extern "C"
@@ -0,0 +1,1477 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ */
+#include <native/wasm.hpp>
+
+#include <eosiolib/action.h>
+#include <eosiolib/db.h>
+#include <eosiolib/print.h>
+#include <eosiolib/system.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <unordered_map>
+
+namespace native {
+
+   namespace {
+
+      enum valtype : uint8_t { i32 = 0x7f, i64 = 0x7e, f32 = 0x7d, f64 = 0x7c };
+
+      constexpr uint64_t page_size = 64 * 1024;
+      constexpr uint32_t max_pages = 528;           // 33 MiB, nodeos' max_wasm_pages
+      constexpr uint32_t max_call_depth = 250;
+      constexpr size_t stack_slots = 1 << 18;
+
+      struct func_type {
+         std::vector<uint8_t> params;
+         std::vector<uint8_t> results;
+
+         bool operator==( const func_type& o )const { return params == o.params && results == o.results; }
+         bool operator!=( const func_type& o )const { return !( *this == o ); }
+
+         /// the result type then the parameter types, one letter each: v none, i i32, l i64, f f32, d f64
+         std::string signature()const {
+            auto letter = []( uint8_t t ) { return t == i32 ? 'i' : t == i64 ? 'l' : t == f32 ? 'f' : 'd'; };
+            std::string s( 1, results.empty() ? 'v' : letter( results[0] ) );
+            for( auto p : params )
+               s += letter(p);
+            return s;
+         }
+      };
+
+      // Decoded instructions keep the wasm opcode, except for the control flow below,
+      // whose targets are instruction indices.  block, loop and end leave nothing.
+      enum : uint16_t {
+         op_br = 0x100,    // a: target, b: arity << 32 | operand stack height at the target
+         op_br_if,
+         op_br_table,      // a: first entry in function::targets, b: entries, the last is the default
+         op_if,            // a: where to go if the condition is false
+         op_jump,          // a: target, ends the then branch of an if
+         op_return
+      };
+
+      struct insn {
+         uint16_t op;
+         uint32_t a;
+         uint64_t b;
+      };
+
+      struct branch_target {
+         uint32_t pc;
+         uint32_t arity;
+         uint32_t height;
+      };
+
+      struct function {
+         uint32_t type;
+         uint32_t params;
+         uint32_t results;
+         uint32_t locals;         ///< including the parameters
+         uint32_t max_height = 0; ///< of the operand stack
+         std::vector<insn> code;
+         std::vector<branch_target> targets;
+      };
+
+      struct import {
+         std::string module;
+         std::string field;
+         uint32_t type;
+      };
+
+      struct global {
+         uint8_t type;
+         bool mut;
+         uint64_t init;
+      };
+
+      template<typename T>
+      struct segment {
+         uint32_t offset;
+         std::vector<T> init;
+      };
+
+      uint64_t elapsed_ns( std::chrono::steady_clock::time_point since ) {
+         return std::chrono::duration_cast<std::chrono::nanoseconds>( std::chrono::steady_clock::now() - since ).count();
+      }
+
+   } /// anonymous namespace
+
+   struct wasm_module::impl {
+      size_t size = 0;
+      std::vector<func_type> types;
+      std::vector<uint32_t> type_ids;   ///< first index of an equal type, for call_indirect
+      std::vector<import> imports;
+      std::vector<function> functions;
+      std::vector<global> globals;
+      bool has_memory = false;
+      uint32_t memory_pages = 0;
+      uint32_t memory_max = max_pages;
+      bool has_table = false;
+      uint32_t table_size = 0;
+      std::vector<segment<uint32_t>> elements;
+      std::vector<segment<uint8_t>> data;
+      int64_t start = -1;
+      int64_t apply = -1;
+      uint64_t instructions = 0;
+
+      uint32_t function_total()const { return imports.size() + functions.size(); }
+
+      uint32_t type_index( uint32_t func )const {
+         return func < imports.size() ? imports[func].type : functions[func - imports.size()].type;
+      }
+
+      const func_type& type_of( uint32_t func )const { return types[ type_index( func ) ]; }
+   };
+
+   namespace {
+
+      [[noreturn]] void malformed( const std::string& msg ) {
+         throw wasm_error( "malformed wasm module: " + msg );
+      }
+
+      [[noreturn]] void trap( const std::string& msg ) {
+         throw wasm_trap( "wasm trap: " + msg );
+      }
+
+      class reader {
+      public:
+         reader( const uint8_t* pos, const uint8_t* end ) : _pos(pos), _end(end) {}
+
+         bool done()const { return _pos == _end; }
+         const uint8_t* pos()const { return _pos; }
+
+         uint8_t byte() {
+            if( _pos == _end )
+               malformed( "unexpected end" );
+            return *_pos++;
+         }
+
+         const uint8_t* bytes( uint64_t n ) {
+            if( uint64_t( _end - _pos ) < n )
+               malformed( "unexpected end" );
+            auto p = _pos;
+            _pos += n;
+            return p;
+         }
+
+         uint32_t u32() {
+            uint64_t v = 0;
+            for( int shift = 0; shift < 35; shift += 7 ) {
+               uint8_t b = byte();
+               v |= uint64_t( b & 0x7f ) << shift;
+               if( !( b & 0x80 ) ) {
+                  if( v > std::numeric_limits<uint32_t>::max() )
+                     malformed( "integer too large" );
+                  return uint32_t(v);
+               }
+            }
+            malformed( "integer representation too long" );
+         }
+
+         int64_t sleb( int bits ) {
+            int64_t v = 0;
+            int shift = 0;
+            uint8_t b;
+            do {
+               if( shift >= ( bits + 6 ) / 7 * 7 )
+                  malformed( "integer representation too long" );
+               b = byte();
+               v |= int64_t( uint64_t( b & 0x7f ) << shift );
+               shift += 7;
+            } while( b & 0x80 );
+            if( shift < 64 && ( b & 0x40 ) )
+               v |= int64_t( ~uint64_t(0) << shift );
+            return v;
+         }
+
+         std::string name() {
+            uint32_t n = u32();
+            auto p = bytes(n);
+            return std::string( reinterpret_cast<const char*>(p), n );
+         }
+
+         reader sub( uint32_t n ) {
+            auto p = bytes(n);
+            return reader( p, p + n );
+         }
+
+      private:
+         const uint8_t* _pos;
+         const uint8_t* _end;
+      };
+
+      uint8_t value_type( reader& r ) {
+         uint8_t t = r.byte();
+         if( t != i32 && t != i64 && t != f32 && t != f64 )
+            malformed( "unknown value type" );
+         return t;
+      }
+
+      void limits( reader& r, uint32_t& min, uint32_t* max ) {
+         uint8_t flags = r.byte();
+         if( flags > 1 )
+            malformed( "unknown limits" );
+         min = r.u32();
+         uint32_t m = flags ? r.u32() : std::numeric_limits<uint32_t>::max();
+         if( max )
+            *max = m;
+      }
+
+      /// a constant expression: one const or global.get of an earlier global, then end
+      uint64_t init_expr( reader& r, const wasm_module::impl& m ) {
+         uint64_t v;
+         switch( r.byte() ) {
+         case 0x41: v = uint32_t( r.sleb(32) ); break;
+         case 0x42: v = uint64_t( r.sleb(64) ); break;
+         case 0x43: { uint32_t f; std::memcpy( &f, r.bytes(4), 4 ); v = f; break; }
+         case 0x44: std::memcpy( &v, r.bytes(8), 8 ); break;
+         case 0x23: {
+            uint32_t g = r.u32();
+            if( g >= m.globals.size() )
+               malformed( "unknown global in constant expression" );
+            v = m.globals[g].init;
+            break;
+         }
+         default:
+            malformed( "unsupported constant expression" );
+         }
+         if( r.byte() != 0x0b )
+            malformed( "constant expression not terminated" );
+         return v;
+      }
+
+      /// decodes a function body, resolving branch targets and tracking the operand stack height
+      void compile( const wasm_module::impl& m, function& f, reader r ) {
+         const auto& ft = m.types[f.type];
+         f.params = ft.params.size();
+         f.results = ft.results.size();
+         uint64_t locals = f.params;
+         for( uint32_t groups = r.u32(); groups > 0; --groups ) {
+            locals += r.u32();
+            value_type(r);
+            if( locals > 50000 )
+               malformed( "too many locals" );
+         }
+         f.locals = locals;
+
+         enum kind_t : uint8_t { block, loop, if_, else_, func };
+         struct fixup {
+            bool target;     ///< an entry of f.targets, else an instruction
+            uint32_t index;
+         };
+         struct frame {
+            kind_t kind;
+            uint32_t height;
+            uint32_t arity;
+            uint32_t start;
+            bool unreachable = false;
+            std::vector<fixup> fixups;
+         };
+
+         std::vector<frame> frames;
+         frames.push_back( { func, 0, f.results, 0, false, {} } );
+         uint32_t height = 0;
+
+         auto push = [&]( uint32_t n ) {
+            height += n;
+            f.max_height = std::max( f.max_height, height );
+         };
+         auto pop = [&]( uint32_t n ) {
+            const auto& top = frames.back();
+            for( ; n > 0; --n ) {
+               if( height > top.height )
+                  --height;
+               else if( !top.unreachable )
+                  malformed( "operand stack underflow" );
+            }
+         };
+         auto emit = [&]( uint16_t op, uint32_t a = 0, uint64_t b = 0 ) {
+            f.code.push_back( insn{ op, a, b } );
+         };
+         auto unreachable = [&] {
+            height = frames.back().height;
+            frames.back().unreachable = true;
+         };
+         // targets a branch to the enclosing label depth; forward branches are patched at its end
+         auto label = [&]( uint32_t depth, fixup at ) {
+            if( depth >= frames.size() )
+               malformed( "unknown label" );
+            auto& target = frames[frames.size() - 1 - depth];
+            if( target.kind == loop )
+               return branch_target{ target.start, 0, target.height };
+            target.fixups.push_back( at );
+            return branch_target{ 0, target.arity, target.height };
+         };
+         auto pack = []( const branch_target& t ) { return uint64_t( t.arity ) << 32 | t.height; };
+         auto memarg = [&] {
+            if( !m.has_memory )
+               malformed( "memory access without a memory" );
+            r.u32();
+            return uint64_t( r.u32() );
+         };
+
+
+         while( !frames.empty() ) {
+            uint8_t op = r.byte();
+            switch( op ) {
+            case 0x00:  // unreachable
+               emit( op );
+               unreachable();
+               break;
+            case 0x01:  // nop
+               break;
+            case 0x02:  // block
+            case 0x03:  // loop
+            case 0x04: {  // if
+               uint8_t bt = r.byte();
+               uint32_t arity = 0;
+               if( bt != 0x40 ) {
+                  if( bt != i32 && bt != i64 && bt != f32 && bt != f64 )
+                     malformed( "unsupported block type" );
+                  arity = 1;
+               }
+               if( op == 0x04 ) {
+                  pop(1);
+                  emit( op_if );
+               }
+               frame fr{ op == 0x02 ? block : op == 0x03 ? loop : if_, height, arity, uint32_t( f.code.size() ), false, {} };
+               if( op == 0x04 )
+                  fr.start = f.code.size() - 1;   // the op_if, patched at else or end
+               frames.push_back( std::move(fr) );
+               break;
+            }
+            case 0x05: {  // else
+               auto& fr = frames.back();
+               if( fr.kind != if_ )
+                  malformed( "else without if" );
+               fr.fixups.push_back( { false, uint32_t( f.code.size() ) } );
+               emit( op_jump );
+               f.code[fr.start].a = f.code.size();
+               fr.kind = else_;
+               fr.unreachable = false;
+               height = fr.height;
+               break;
+            }
+            case 0x0b: {  // end
+               auto fr = std::move( frames.back() );
+               frames.pop_back();
+               uint32_t end = f.code.size();
+               if( fr.kind == if_ )
+                  f.code[fr.start].a = end;
+               for( const auto& fix : fr.fixups ) {
+                  if( fix.target )
+                     f.targets[fix.index].pc = end;
+                  else
+                     f.code[fix.index].a = end;
+               }
+               height = fr.height;
+               push( fr.arity );
+               if( fr.kind == func )
+                  emit( op_return );
+               break;
+            }
+            case 0x0c: {  // br
+               uint32_t at = f.code.size();
+               auto t = label( r.u32(), { false, at } );
+               emit( op_br, t.pc, pack(t) );
+               unreachable();
+               break;
+            }
+            case 0x0d: {  // br_if
+               pop(1);
+               uint32_t at = f.code.size();
+               auto t = label( r.u32(), { false, at } );
+               emit( op_br_if, t.pc, pack(t) );
+               break;
+            }
+            case 0x0e: {  // br_table
+               pop(1);
+               uint32_t first = f.targets.size();
+               uint32_t count = r.u32() + 1;
+               if( count > 65536 )
+                  malformed( "br_table too large" );
+               for( uint32_t i = 0; i < count; ++i ) {
+                  uint32_t index = f.targets.size();
+                  f.targets.push_back( branch_target{} );
+                  f.targets[index] = label( r.u32(), { true, index } );
+               }
+               emit( op_br_table, first, count );
+               unreachable();
+               break;
+            }
+            case 0x0f:  // return
+               emit( op_return );
+               unreachable();
+               break;
+            case 0x10: {  // call
+               uint32_t callee = r.u32();
+               if( callee >= m.function_total() )
+                  malformed( "unknown function" );
+               const auto& t = m.type_of( callee );
+               pop( t.params.size() );
+               push( t.results.size() );
+               emit( op, callee, uint64_t( t.params.size() ) << 32 | t.results.size() );
+               break;
+            }
+            case 0x11: {  // call_indirect
+               uint32_t type = r.u32();
+               if( type >= m.types.size() )
+                  malformed( "unknown type" );
+               if( r.byte() != 0 || !m.has_table )
+                  malformed( "call_indirect without a table" );
+               const auto& t = m.types[type];
+               pop( 1 + t.params.size() );
+               push( t.results.size() );
+               emit( op, type, uint64_t( t.params.size() ) << 32 | t.results.size() );
+               break;
+            }
+            case 0x1a:  // drop
+               pop(1);
+               emit( op );
+               break;
+            case 0x1b:  // select
+               pop(3);
+               push(1);
+               emit( op );
+               break;
+            case 0x20:  // local.get
+            case 0x21:  // local.set
+            case 0x22: {  // local.tee
+               uint32_t index = r.u32();
+               if( index >= f.locals )
+                  malformed( "unknown local" );
+               if( op != 0x22 )
+                  op == 0x20 ? push(1) : pop(1);
+               emit( op, index );
+               break;
+            }
+            case 0x23:  // global.get
+            case 0x24: {  // global.set
+               uint32_t index = r.u32();
+               if( index >= m.globals.size() )
+                  malformed( "unknown global" );
+               if( op == 0x24 && !m.globals[index].mut )
+                  malformed( "global is immutable" );
+               op == 0x23 ? push(1) : pop(1);
+               emit( op, index );
+               break;
+            }
+            case 0x3f:  // memory.size
+            case 0x40:  // memory.grow
+               if( r.byte() != 0 || !m.has_memory )
+                  malformed( "memory instruction without a memory" );
+               if( op == 0x3f )
+                  push(1);
+               emit( op );
+               break;
+            case 0x41:
+               push(1);
+               emit( op, 0, uint32_t( r.sleb(32) ) );
+               break;
+            case 0x42:
+               push(1);
+               emit( op, 0, uint64_t( r.sleb(64) ) );
+               break;
+            case 0x43: {
+               uint32_t bits;
+               std::memcpy( &bits, r.bytes(4), 4 );
+               push(1);
+               emit( op, 0, bits );
+               break;
+            }
+            case 0x44: {
+               uint64_t bits;
+               std::memcpy( &bits, r.bytes(8), 8 );
+               push(1);
+               emit( op, 0, bits );
+               break;
+            }
+            default:
+               if( op >= 0x28 && op <= 0x35 ) {         // loads
+                  uint64_t offset = memarg();
+                  emit( op, 0, offset );
+               }
+               else if( op >= 0x36 && op <= 0x3e ) {    // stores
+                  uint64_t offset = memarg();
+                  pop(2);
+                  emit( op, 0, offset );
+               }
+               else if( op == 0x45 || op == 0x50 || ( op >= 0x67 && op <= 0x69 ) || ( op >= 0x79 && op <= 0x7b )
+                        || ( op >= 0x8b && op <= 0x91 ) || ( op >= 0x99 && op <= 0x9f ) || ( op >= 0xa7 && op <= 0xc4 ) ) {
+                  emit( op );                            // unary and conversions
+               }
+               else if( ( op >= 0x46 && op <= 0x66 ) || ( op >= 0x6a && op <= 0x78 ) || ( op >= 0x7c && op <= 0x8a )
+                        || ( op >= 0x92 && op <= 0x98 ) || ( op >= 0xa0 && op <= 0xa6 ) ) {
+                  pop(2);                                // binary and comparisons
+                  push(1);
+                  emit( op );
+               }
+               else {
+                  char buf[64];
+                  std::snprintf( buf, sizeof(buf), "unsupported opcode 0x%02x", op );
+                  malformed( buf );
+               }
+            }
+         }
+         if( !r.done() )
+            malformed( "function body continues past its end" );
+      }
+
+      void decode( wasm_module::impl& m, const std::vector<uint8_t>& code ) {
+         static const uint8_t header[8] = { 0, 'a', 's', 'm', 1, 0, 0, 0 };
+         if( code.size() < 8 || std::memcmp( code.data(), header, 8 ) != 0 )
+            malformed( "not a version 1 wasm module" );
+         m.size = code.size();
+
+         std::vector<uint32_t> function_types;
+         reader r( code.data() + 8, code.data() + code.size() );
+         while( !r.done() ) {
+            uint8_t id = r.byte();
+            reader s = r.sub( r.u32() );
+            switch( id ) {
+            case 0:   // custom
+               continue;
+            case 1:   // type
+               for( uint32_t n = s.u32(); n > 0; --n ) {
+                  if( s.byte() != 0x60 )
+                     malformed( "bad function type" );
+                  func_type t;
+                  for( uint32_t p = s.u32(); p > 0; --p )
+                     t.params.push_back( value_type(s) );
+                  for( uint32_t p = s.u32(); p > 0; --p )
+                     t.results.push_back( value_type(s) );
+                  if( t.results.size() > 1 )
+                     malformed( "multiple results" );
+                  m.type_ids.push_back( std::find( m.types.begin(), m.types.end(), t ) - m.types.begin() );
+                  m.types.push_back( std::move(t) );
+               }
+               break;
+            case 2:   // import
+               for( uint32_t n = s.u32(); n > 0; --n ) {
+                  import imp{ s.name(), s.name(), 0 };
+                  if( s.byte() != 0 )
+                     malformed( "only functions can be imported: " + imp.module + "." + imp.field );
+                  imp.type = s.u32();
+                  if( imp.type >= m.types.size() )
+                     malformed( "unknown type" );
+                  m.imports.push_back( std::move(imp) );
+               }
+               break;
+            case 3:   // function
+               for( uint32_t n = s.u32(); n > 0; --n ) {
+                  uint32_t type = s.u32();
+                  if( type >= m.types.size() )
+                     malformed( "unknown type" );
+                  function_types.push_back( type );
+               }
+               break;
+            case 4: { // table
+               if( s.u32() != 1 || s.byte() != 0x70 )
+                  malformed( "one funcref table expected" );
+               limits( s, m.table_size, nullptr );
+               if( m.table_size > 1 << 20 )
+                  malformed( "table too large" );
+               m.has_table = true;
+               break;
+            }
+            case 5:   // memory
+               if( s.u32() != 1 )
+                  malformed( "one memory expected" );
+               limits( s, m.memory_pages, &m.memory_max );
+               m.memory_max = std::min( m.memory_max, max_pages );
+               if( m.memory_pages > m.memory_max )
+                  malformed( "initial memory exceeds the maximum" );
+               m.has_memory = true;
+               break;
+            case 6:   // global
+               for( uint32_t n = s.u32(); n > 0; --n ) {
+                  global g;
+                  g.type = value_type(s);
+                  g.mut = s.byte() != 0;
+                  g.init = init_expr( s, m );
+                  m.globals.push_back( g );
+               }
+               break;
+            case 7:   // export
+               for( uint32_t n = s.u32(); n > 0; --n ) {
+                  auto name = s.name();
+                  uint8_t kind = s.byte();
+                  uint32_t index = s.u32();
+                  if( kind == 0 && name == "apply" )
+                     m.apply = index;
+               }
+               break;
+            case 8:   // start
+               m.start = s.u32();
+               break;
+            case 9:   // element
+               for( uint32_t n = s.u32(); n > 0; --n ) {
+                  if( s.u32() != 0 )
+                     malformed( "unsupported element segment" );
+                  segment<uint32_t> seg{ uint32_t( init_expr( s, m ) ), {} };
+                  for( uint32_t k = s.u32(); k > 0; --k )
+                     seg.init.push_back( s.u32() );
+                  m.elements.push_back( std::move(seg) );
+               }
+               break;
+            case 10:  // code
+               if( s.u32() != function_types.size() )
+                  malformed( "function and code section sizes differ" );
+               m.functions.resize( function_types.size() );
+               for( size_t i = 0; i < function_types.size(); ++i )
+                  m.functions[i].type = function_types[i];
+               for( auto& f : m.functions ) {
+                  compile( m, f, s.sub( s.u32() ) );
+                  m.instructions += f.code.size();
+               }
+               break;
+            case 11:  // data
+               for( uint32_t n = s.u32(); n > 0; --n ) {
+                  if( s.u32() != 0 || !m.has_memory )
+                     malformed( "data segment without a memory" );
+                  segment<uint8_t> seg{ uint32_t( init_expr( s, m ) ), {} };
+                  uint32_t size = s.u32();
+                  auto p = s.bytes( size );
+                  seg.init.assign( p, p + size );
+                  m.data.push_back( std::move(seg) );
+               }
+               break;
+            default:
+               malformed( "unknown section " + std::to_string( id ) );
+            }
+            if( !s.done() )
+               malformed( "section " + std::to_string( id ) + " has trailing bytes" );
+         }
+
+         if( m.functions.size() != function_types.size() )
+            malformed( "function bodies missing" );
+         for( const auto& e : m.elements ) {
+            for( auto f : e.init ) {
+               if( f >= m.function_total() )
+                  malformed( "unknown function in element segment" );
+            }
+         }
+         if( m.start >= int64_t( m.function_total() ) )
+            malformed( "unknown start function" );
+         if( m.apply < 0 || m.apply >= int64_t( m.function_total() )
+             || m.type_of( m.apply ) != func_type{ { i64, i64, i64 }, {} } )
+            malformed( "no apply(i64, i64, i64) export" );
+      }
+
+   } /// anonymous namespace
+
+   wasm_module::wasm_module( const std::vector<uint8_t>& code ) {
+      auto m = std::make_unique<impl>();
+      decode( *m, code );
+      _impl = std::move(m);
+   }
+
+   wasm_module::~wasm_module() = default;
+
+   size_t wasm_module::code_size()const { return _impl->size; }
+
+   uint32_t wasm_module::function_count()const { return _impl->functions.size(); }
+
+   uint64_t wasm_module::instruction_count()const { return _impl->instructions; }
+
+   std::vector<std::string> wasm_module::imports()const {
+      std::vector<std::string> names;
+      for( const auto& imp : _impl->imports )
+         names.push_back( imp.module + "." + imp.field );
+      return names;
+   }
+
+   // ---- execution ------------------------------------------------------------
+
+   namespace {
+
+      class instance;
+
+      /// a host function reads its arguments from args and leaves its result in args[0]
+      typedef void (*host_function)( instance& in, uint64_t* args );
+
+      float as_f32( uint64_t v ) {
+         uint32_t b = uint32_t(v);
+         float f;
+         std::memcpy( &f, &b, 4 );
+         return f;
+      }
+
+      double as_f64( uint64_t v ) {
+         double d;
+         std::memcpy( &d, &v, 8 );
+         return d;
+      }
+
+      uint64_t bits( float f ) {
+         uint32_t b;
+         std::memcpy( &b, &f, 4 );
+         return b;
+      }
+
+      uint64_t bits( double d ) {
+         uint64_t b;
+         std::memcpy( &b, &d, 8 );
+         return b;
+      }
+
+      template<typename F>
+      F wasm_min( F a, F b ) {
+         if( std::isnan(a) || std::isnan(b) )
+            return std::numeric_limits<F>::quiet_NaN();
+         if( a == b )
+            return std::signbit(a) ? a : b;
+         return a < b ? a : b;
+      }
+
+      template<typename F>
+      F wasm_max( F a, F b ) {
+         if( std::isnan(a) || std::isnan(b) )
+            return std::numeric_limits<F>::quiet_NaN();
+         if( a == b )
+            return std::signbit(a) ? b : a;
+         return a > b ? a : b;
+      }
+
+      /// float to integer, trapping on NaN and out of range values
+      template<typename I, typename F>
+      I truncate( F x ) {
+         if( std::isnan(x) )
+            trap( "invalid conversion to integer" );
+         F t = std::trunc(x);
+         constexpr int bits = std::numeric_limits<I>::digits;
+         F low = std::is_signed<I>::value ? -std::ldexp( F(1), bits ) : F(0);
+         if( t < low || t >= std::ldexp( F(1), bits ) )
+            trap( "integer overflow" );
+         return I(t);
+      }
+
+      template<typename T>
+      T rotl( T v, uint64_t n ) {
+         constexpr unsigned width = sizeof(T) * 8;
+         n &= width - 1;
+         return n ? T( v << n | v >> ( width - n ) ) : v;
+      }
+
+      template<typename T>
+      T rotr( T v, uint64_t n ) {
+         constexpr unsigned width = sizeof(T) * 8;
+         n &= width - 1;
+         return n ? T( v >> n | v << ( width - n ) ) : v;
+      }
+
+      class instance {
+      public:
+         /// a fresh instance: zeroed memory with the data segments, initial globals and table
+         instance( const wasm_module::impl& m, const std::vector<host_function>& hosts, std::vector<uint64_t>& stack )
+            : _m(m), _hosts(hosts), _stack( stack.data() ), _stack_end( stack.data() + stack.size() ),
+              _memory( m.memory_pages * page_size ), _table( m.table_size, -1 )
+         {
+            _globals.reserve( m.globals.size() );
+            for( const auto& g : m.globals )
+               _globals.push_back( g.init );
+            for( const auto& e : m.elements ) {
+               if( uint64_t( e.offset ) + e.init.size() > _table.size() )
+                  trap( "element segment does not fit the table" );
+               std::copy( e.init.begin(), e.init.end(), _table.begin() + e.offset );
+            }
+            for( const auto& d : m.data ) {
+               if( uint64_t( d.offset ) + d.init.size() > _memory.size() )
+                  trap( "data segment does not fit the memory" );
+               std::copy( d.init.begin(), d.init.end(), _memory.begin() + d.offset );
+            }
+         }
+
+         void apply( uint64_t receiver, uint64_t code, uint64_t action ) {
+            if( _m.start >= 0 )
+               call( _m.start, _stack, 0 );
+            _stack[0] = receiver;
+            _stack[1] = code;
+            _stack[2] = action;
+            call( _m.apply, _stack, 0 );
+         }
+
+         /// linear memory [addr, addr + len), trapping when out of bounds
+         uint8_t* memory( uint64_t addr, uint64_t len ) {
+            if( addr + len > _memory.size() )
+               trap( "memory access out of bounds" );
+            return _memory.data() + addr;
+         }
+
+         char* chars( uint64_t addr, uint64_t len ) { return reinterpret_cast<char*>( memory( addr, len ) ); }
+
+         /// a nul terminated string in linear memory
+         const char* cstr( uint64_t addr ) {
+            auto p = memory( addr, 0 );
+            if( !std::memchr( p, 0, _memory.size() - addr ) )
+               trap( "unterminated string" );
+            return reinterpret_cast<const char*>(p);
+         }
+
+         template<typename T>
+         T load( uint64_t addr ) {
+            T v;
+            std::memcpy( &v, memory( addr, sizeof(T) ), sizeof(T) );
+            return v;
+         }
+
+         template<typename T>
+         void store( uint64_t addr, T v ) {
+            std::memcpy( memory( addr, sizeof(T) ), &v, sizeof(T) );
+         }
+
+         uint64_t instructions = 0;
+         uint64_t host_calls = 0;
+
+      private:
+         void call( uint32_t func, uint64_t* fp, uint32_t depth ) {
+            if( func < _m.imports.size() ) {
+               ++host_calls;
+               _hosts[func]( *this, fp );
+               return;
+            }
+            run( _m.functions[func - _m.imports.size()], fp, depth );
+         }
+
+         void run( const function& f, uint64_t* fp, uint32_t depth );
+
+         const wasm_module::impl& _m;
+         const std::vector<host_function>& _hosts;
+         uint64_t* _stack;
+         uint64_t* _stack_end;
+         std::vector<uint8_t> _memory;
+         std::vector<uint64_t> _globals;
+         std::vector<int64_t> _table;
+      };
+
+// operands are popped into a and b, the result replaces them
+#define BINARY( IN, OUT, EXPR ) { auto b = IN( sp[-1] ); auto a = IN( sp[-2] ); (void)a; (void)b; --sp; sp[-1] = OUT( EXPR ); break; }
+#define UNARY( IN, OUT, EXPR ) { auto a = IN( sp[-1] ); sp[-1] = OUT( EXPR ); break; }
+#define LOAD( T, OUT ) { sp[-1] = OUT( load<T>( uint64_t( uint32_t( sp[-1] ) ) + i.b ) ); break; }
+#define STORE( T ) { store<T>( uint64_t( uint32_t( sp[-2] ) ) + i.b, T( sp[-1] ) ); sp -= 2; break; }
+
+      inline uint32_t u32( uint64_t v ) { return uint32_t(v); }
+      inline int32_t s32( uint64_t v ) { return int32_t( uint32_t(v) ); }
+      inline uint64_t u64( uint64_t v ) { return v; }
+      inline int64_t s64( uint64_t v ) { return int64_t(v); }
+      inline uint64_t r32( uint32_t v ) { return v; }
+      inline uint64_t r64( uint64_t v ) { return v; }
+      inline uint64_t rf( float v ) { return bits(v); }
+      inline uint64_t rd( double v ) { return bits(v); }
+
+      void instance::run( const function& f, uint64_t* fp, uint32_t depth ) {
+         if( depth >= max_call_depth )
+            trap( "call depth exceeded" );
+         uint64_t* base = fp + f.locals;
+         if( base + f.max_height + 1 > _stack_end )
+            trap( "stack overflow" );
+         std::fill( fp + f.params, base, 0 );
+
+         const insn* code = f.code.data();
+         const insn* pc = code;
+         uint64_t* sp = base;
+         auto branch = [&]( uint32_t target, uint32_t arity, uint32_t height ) {
+            uint64_t* to = base + height;
+            if( arity )
+               *to++ = sp[-1];
+            sp = to;
+            pc = code + target;
+         };
+
+         for( ;; ) {
+            const insn& i = *pc++;
+            ++instructions;
+            switch( i.op ) {
+            case 0x00: trap( "unreachable executed" );
+            case op_br:
+               branch( i.a, i.b >> 32, uint32_t( i.b ) );
+               break;
+            case op_br_if:
+               if( uint32_t( *--sp ) )
+                  branch( i.a, i.b >> 32, uint32_t( i.b ) );
+               break;
+            case op_br_table: {
+               uint64_t index = std::min<uint64_t>( uint32_t( *--sp ), i.b - 1 );
+               const auto& t = f.targets[i.a + index];
+               branch( t.pc, t.arity, t.height );
+               break;
+            }
+            case op_if:
+               if( !uint32_t( *--sp ) )
+                  pc = code + i.a;
+               break;
+            case op_jump:
+               pc = code + i.a;
+               break;
+            case op_return:
+               if( f.results )
+                  fp[0] = sp[-1];
+               return;
+            case 0x10: {  // call
+               uint64_t* args = sp - ( i.b >> 32 );
+               call( i.a, args, depth + 1 );
+               sp = args + uint32_t( i.b );
+               break;
+            }
+            case 0x11: {  // call_indirect
+               uint32_t element = uint32_t( *--sp );
+               if( element >= _table.size() || _table[element] < 0 )
+                  trap( "undefined table element" );
+               uint32_t callee = _table[element];
+               if( _m.type_ids[ _m.type_index( callee ) ] != _m.type_ids[i.a] )
+                  trap( "indirect call signature mismatch" );
+               uint64_t* args = sp - ( i.b >> 32 );
+               call( callee, args, depth + 1 );
+               sp = args + uint32_t( i.b );
+               break;
+            }
+            case 0x1a: --sp; break;
+            case 0x1b: {  // select
+               uint32_t c = uint32_t( sp[-1] );
+               sp -= 2;
+               if( !c )
+                  sp[-1] = sp[0];
+               break;
+            }
+            case 0x20: *sp++ = fp[i.a]; break;
+            case 0x21: fp[i.a] = *--sp; break;
+            case 0x22: fp[i.a] = sp[-1]; break;
+            case 0x23: *sp++ = _globals[i.a]; break;
+            case 0x24: _globals[i.a] = *--sp; break;
+
+            case 0x28: LOAD( uint32_t, r32 )
+            case 0x29: LOAD( uint64_t, r64 )
+            case 0x2a: LOAD( uint32_t, r32 )
+            case 0x2b: LOAD( uint64_t, r64 )
+            case 0x2c: LOAD( int8_t, r32 )
+            case 0x2d: LOAD( uint8_t, r32 )
+            case 0x2e: LOAD( int16_t, r32 )
+            case 0x2f: LOAD( uint16_t, r32 )
+            case 0x30: LOAD( int8_t, r64 )
+            case 0x31: LOAD( uint8_t, r64 )
+            case 0x32: LOAD( int16_t, r64 )
+            case 0x33: LOAD( uint16_t, r64 )
+            case 0x34: LOAD( int32_t, r64 )
+            case 0x35: LOAD( uint32_t, r64 )
+            case 0x36: STORE( uint32_t )
+            case 0x37: STORE( uint64_t )
+            case 0x38: STORE( uint32_t )
+            case 0x39: STORE( uint64_t )
+            case 0x3a: STORE( uint8_t )
+            case 0x3b: STORE( uint16_t )
+            case 0x3c: STORE( uint8_t )
+            case 0x3d: STORE( uint16_t )
+            case 0x3e: STORE( uint32_t )
+            case 0x3f: *sp++ = _memory.size() / page_size; break;
+            case 0x40: {  // memory.grow
+               uint64_t pages = _memory.size() / page_size;
+               uint64_t more = uint32_t( sp[-1] );
+               if( pages + more > _m.memory_max ) {
+                  sp[-1] = uint32_t(-1);
+               }
+               else {
+                  _memory.resize( ( pages + more ) * page_size );
+                  sp[-1] = pages;
+               }
+               break;
+            }
+            case 0x41:
+            case 0x42:
+            case 0x43:
+            case 0x44: *sp++ = i.b; break;
+
+            case 0x45: UNARY( u32, r32, a == 0 )
+            case 0x46: BINARY( u32, r32, a == b )
+            case 0x47: BINARY( u32, r32, a != b )
+            case 0x48: BINARY( s32, r32, a < b )
+            case 0x49: BINARY( u32, r32, a < b )
+            case 0x4a: BINARY( s32, r32, a > b )
+            case 0x4b: BINARY( u32, r32, a > b )
+            case 0x4c: BINARY( s32, r32, a <= b )
+            case 0x4d: BINARY( u32, r32, a <= b )
+            case 0x4e: BINARY( s32, r32, a >= b )
+            case 0x4f: BINARY( u32, r32, a >= b )
+            case 0x50: UNARY( u64, r32, a == 0 )
+            case 0x51: BINARY( u64, r32, a == b )
+            case 0x52: BINARY( u64, r32, a != b )
+            case 0x53: BINARY( s64, r32, a < b )
+            case 0x54: BINARY( u64, r32, a < b )
+            case 0x55: BINARY( s64, r32, a > b )
+            case 0x56: BINARY( u64, r32, a > b )
+            case 0x57: BINARY( s64, r32, a <= b )
+            case 0x58: BINARY( u64, r32, a <= b )
+            case 0x59: BINARY( s64, r32, a >= b )
+            case 0x5a: BINARY( u64, r32, a >= b )
+            case 0x5b: BINARY( as_f32, r32, a == b )
+            case 0x5c: BINARY( as_f32, r32, a != b )
+            case 0x5d: BINARY( as_f32, r32, a < b )
+            case 0x5e: BINARY( as_f32, r32, a > b )
+            case 0x5f: BINARY( as_f32, r32, a <= b )
+            case 0x60: BINARY( as_f32, r32, a >= b )
+            case 0x61: BINARY( as_f64, r32, a == b )
+            case 0x62: BINARY( as_f64, r32, a != b )
+            case 0x63: BINARY( as_f64, r32, a < b )
+            case 0x64: BINARY( as_f64, r32, a > b )
+            case 0x65: BINARY( as_f64, r32, a <= b )
+            case 0x66: BINARY( as_f64, r32, a >= b )
+
+            case 0x67: UNARY( u32, r32, a ? __builtin_clz(a) : 32 )
+            case 0x68: UNARY( u32, r32, a ? __builtin_ctz(a) : 32 )
+            case 0x69: UNARY( u32, r32, __builtin_popcount(a) )
+            case 0x6a: BINARY( u32, r32, a + b )
+            case 0x6b: BINARY( u32, r32, a - b )
+            case 0x6c: BINARY( u32, r32, a * b )
+            case 0x6d: {  // i32.div_s
+               int32_t b = s32( sp[-1] ), a = s32( sp[-2] );
+               if( b == 0 )
+                  trap( "integer divide by zero" );
+               if( a == std::numeric_limits<int32_t>::min() && b == -1 )
+                  trap( "integer overflow" );
+               --sp;
+               sp[-1] = uint32_t( a / b );
+               break;
+            }
+            case 0x6e: {  // i32.div_u
+               if( u32( sp[-1] ) == 0 )
+                  trap( "integer divide by zero" );
+               BINARY( u32, r32, a / b )
+            }
+            case 0x6f: {  // i32.rem_s
+               int32_t b = s32( sp[-1] ), a = s32( sp[-2] );
+               if( b == 0 )
+                  trap( "integer divide by zero" );
+               --sp;
+               sp[-1] = uint32_t( b == -1 ? 0 : a % b );
+               break;
+            }
+            case 0x70: {  // i32.rem_u
+               if( u32( sp[-1] ) == 0 )
+                  trap( "integer divide by zero" );
+               BINARY( u32, r32, a % b )
+            }
+            case 0x71: BINARY( u32, r32, a & b )
+            case 0x72: BINARY( u32, r32, a | b )
+            case 0x73: BINARY( u32, r32, a ^ b )
+            case 0x74: BINARY( u32, r32, a << ( b & 31 ) )
+            case 0x75: BINARY( u32, r32, uint32_t( s32(a) >> ( b & 31 ) ) )
+            case 0x76: BINARY( u32, r32, a >> ( b & 31 ) )
+            case 0x77: BINARY( u32, r32, rotl( a, b ) )
+            case 0x78: BINARY( u32, r32, rotr( a, b ) )
+
+            case 0x79: UNARY( u64, r64, a ? __builtin_clzll(a) : 64 )
+            case 0x7a: UNARY( u64, r64, a ? __builtin_ctzll(a) : 64 )
+            case 0x7b: UNARY( u64, r64, __builtin_popcountll(a) )
+            case 0x7c: BINARY( u64, r64, a + b )
+            case 0x7d: BINARY( u64, r64, a - b )
+            case 0x7e: BINARY( u64, r64, a * b )
+            case 0x7f: {  // i64.div_s
+               int64_t b = s64( sp[-1] ), a = s64( sp[-2] );
+               if( b == 0 )
+                  trap( "integer divide by zero" );
+               if( a == std::numeric_limits<int64_t>::min() && b == -1 )
+                  trap( "integer overflow" );
+               --sp;
+               sp[-1] = uint64_t( a / b );
+               break;
+            }
+            case 0x80: {  // i64.div_u
+               if( sp[-1] == 0 )
+                  trap( "integer divide by zero" );
+               BINARY( u64, r64, a / b )
+            }
+            case 0x81: {  // i64.rem_s
+               int64_t b = s64( sp[-1] ), a = s64( sp[-2] );
+               if( b == 0 )
+                  trap( "integer divide by zero" );
+               --sp;
+               sp[-1] = uint64_t( b == -1 ? 0 : a % b );
+               break;
+            }
+            case 0x82: {  // i64.rem_u
+               if( sp[-1] == 0 )
+                  trap( "integer divide by zero" );
+               BINARY( u64, r64, a % b )
+            }
+            case 0x83: BINARY( u64, r64, a & b )
+            case 0x84: BINARY( u64, r64, a | b )
+            case 0x85: BINARY( u64, r64, a ^ b )
+            case 0x86: BINARY( u64, r64, a << ( b & 63 ) )
+            case 0x87: BINARY( u64, r64, uint64_t( s64(a) >> ( b & 63 ) ) )
+            case 0x88: BINARY( u64, r64, a >> ( b & 63 ) )
+            case 0x89: BINARY( u64, r64, rotl( a, b ) )
+            case 0x8a: BINARY( u64, r64, rotr( a, b ) )
+
+            case 0x8b: UNARY( u64, r64, a & 0x7fffffffu )
+            case 0x8c: UNARY( u64, r64, ( a ^ 0x80000000u ) & 0xffffffffu )
+            case 0x8d: UNARY( as_f32, rf, std::ceil(a) )
+            case 0x8e: UNARY( as_f32, rf, std::floor(a) )
+            case 0x8f: UNARY( as_f32, rf, std::trunc(a) )
+            case 0x90: UNARY( as_f32, rf, std::nearbyint(a) )
+            case 0x91: UNARY( as_f32, rf, std::sqrt(a) )
+            case 0x92: BINARY( as_f32, rf, a + b )
+            case 0x93: BINARY( as_f32, rf, a - b )
+            case 0x94: BINARY( as_f32, rf, a * b )
+            case 0x95: BINARY( as_f32, rf, a / b )
+            case 0x96: BINARY( as_f32, rf, wasm_min( a, b ) )
+            case 0x97: BINARY( as_f32, rf, wasm_max( a, b ) )
+            case 0x98: BINARY( as_f32, rf, std::copysign( a, b ) )
+            case 0x99: UNARY( u64, r64, a & 0x7fffffffffffffffull )
+            case 0x9a: UNARY( u64, r64, a ^ 0x8000000000000000ull )
+            case 0x9b: UNARY( as_f64, rd, std::ceil(a) )
+            case 0x9c: UNARY( as_f64, rd, std::floor(a) )
+            case 0x9d: UNARY( as_f64, rd, std::trunc(a) )
+            case 0x9e: UNARY( as_f64, rd, std::nearbyint(a) )
+            case 0x9f: UNARY( as_f64, rd, std::sqrt(a) )
+            case 0xa0: BINARY( as_f64, rd, a + b )
+            case 0xa1: BINARY( as_f64, rd, a - b )
+            case 0xa2: BINARY( as_f64, rd, a * b )
+            case 0xa3: BINARY( as_f64, rd, a / b )
+            case 0xa4: BINARY( as_f64, rd, wasm_min( a, b ) )
+            case 0xa5: BINARY( as_f64, rd, wasm_max( a, b ) )
+            case 0xa6: BINARY( as_f64, rd, std::copysign( a, b ) )
+
+            case 0xa7: UNARY( u64, r32, uint32_t(a) )
+            case 0xa8: UNARY( as_f32, r32, uint32_t( truncate<int32_t>(a) ) )
+            case 0xa9: UNARY( as_f32, r32, truncate<uint32_t>(a) )
+            case 0xaa: UNARY( as_f64, r32, uint32_t( truncate<int32_t>(a) ) )
+            case 0xab: UNARY( as_f64, r32, truncate<uint32_t>(a) )
+            case 0xac: UNARY( s32, r64, uint64_t( int64_t(a) ) )
+            case 0xad: UNARY( u32, r64, a )
+            case 0xae: UNARY( as_f32, r64, uint64_t( truncate<int64_t>(a) ) )
+            case 0xaf: UNARY( as_f32, r64, truncate<uint64_t>(a) )
+            case 0xb0: UNARY( as_f64, r64, uint64_t( truncate<int64_t>(a) ) )
+            case 0xb1: UNARY( as_f64, r64, truncate<uint64_t>(a) )
+            case 0xb2: UNARY( s32, rf, float(a) )
+            case 0xb3: UNARY( u32, rf, float(a) )
+            case 0xb4: UNARY( s64, rf, float(a) )
+            case 0xb5: UNARY( u64, rf, float(a) )
+            case 0xb6: UNARY( as_f64, rf, float(a) )
+            case 0xb7: UNARY( s32, rd, double(a) )
+            case 0xb8: UNARY( u32, rd, double(a) )
+            case 0xb9: UNARY( s64, rd, double(a) )
+            case 0xba: UNARY( u64, rd, double(a) )
+            case 0xbb: UNARY( as_f32, rd, double(a) )
+            case 0xbc:      // reinterpretations keep the bits
+            case 0xbd:
+            case 0xbe:
+            case 0xbf: break;
+            case 0xc0: UNARY( u32, r32, uint32_t( int32_t( int8_t(a) ) ) )
+            case 0xc1: UNARY( u32, r32, uint32_t( int32_t( int16_t(a) ) ) )
+            case 0xc2: UNARY( u64, r64, uint64_t( int64_t( int8_t(a) ) ) )
+            case 0xc3: UNARY( u64, r64, uint64_t( int64_t( int16_t(a) ) ) )
+            case 0xc4: UNARY( u64, r64, uint64_t( int64_t( int32_t(a) ) ) )
+            default:
+               trap( "bad instruction" );
+            }
+         }
+      }
+
+#undef BINARY
+#undef UNARY
+#undef LOAD
+#undef STORE
+
+   } /// anonymous namespace
+
+   // ---- host functions ---------------------------------------------------------
+
+   namespace {
+
+#if defined(__SIZEOF_FLOAT128__)
+      typedef __float128 float128;
+#else
+      typedef long double float128;
+      static_assert( std::numeric_limits<long double>::digits == 113, "no quad precision type" );
+#endif
+
+      // compiler-rt's long double helpers take a float128 as two i64 halves and return one through a pointer
+      float128 quad( uint64_t low, uint64_t high ) {
+         uint64_t w[2] = { low, high };
+         float128 q;
+         std::memcpy( &q, w, 16 );
+         return q;
+      }
+
+      void store_quad( instance& in, uint64_t addr, float128 q ) {
+         std::memcpy( in.memory( addr, 16 ), &q, 16 );
+      }
+
+      /// -1, 0 or 1 as a wasm i32, or unordered if either is NaN
+      uint64_t compare_quad( const uint64_t* a, int32_t unordered ) {
+         float128 x = quad( a[0], a[1] ), y = quad( a[2], a[3] );
+         int32_t r = x != x || y != y ? unordered : x < y ? -1 : x > y ? 1 : 0;
+         return uint32_t(r);
+      }
+
+      template<typename I>
+      I quad_to_int( float128 q ) {
+         if( q != q )
+            return 0;
+         if( q <= float128( std::numeric_limits<I>::min() ) )
+            return std::numeric_limits<I>::min();
+         if( q >= float128( std::numeric_limits<I>::max() ) )
+            return std::numeric_limits<I>::max();
+         return I(q);
+      }
+
+      /// db_next_i64 and db_previous_i64 write the primary key through a pointer
+      template<int32_t (*Step)( int32_t, uint64_t* )>
+      void db_step( instance& in, uint64_t* a ) {
+         uint64_t primary = in.load<uint64_t>( uint32_t( a[1] ) );
+         int32_t r = Step( int32_t( a[0] ), &primary );
+         in.store<uint64_t>( uint32_t( a[1] ), primary );
+         a[0] = uint32_t(r);
+      }
+
+      template<typename T>
+      T load_value( instance& in, uint64_t addr ) {
+         return in.load<T>( uint32_t(addr) );
+      }
+
+      struct host_entry {
+         const char* signature;
+         host_function fn;
+      };
+
+      [[noreturn]] void privileged( const char* fn ) {
+         ::eosio_assert( false, ( std::string(fn) + " is only available to privileged accounts" ).c_str() );
+         throw wasm_trap( fn );
+      }
+
+      const std::unordered_map<std::string, host_entry>& host_functions() {
+         static const std::unordered_map<std::string, host_entry> functions = {
+            // system
+            { "eosio_assert", { "vii", []( instance& in, uint64_t* a ) {
+               if( !uint32_t( a[0] ) )
+                  ::eosio_assert( false, in.cstr( uint32_t( a[1] ) ) );
+            } } },
+            { "eosio_assert_message", { "viii", []( instance& in, uint64_t* a ) {
+               if( !uint32_t( a[0] ) )
+                  ::eosio_assert_message( false, in.chars( uint32_t( a[1] ), uint32_t( a[2] ) ), uint32_t( a[2] ) );
+            } } },
+            { "eosio_assert_code", { "vil", []( instance&, uint64_t* a ) {
+               ::eosio_assert_code( uint32_t( a[0] ), a[1] );
+            } } },
+            { "eosio_exit", { "vi", []( instance&, uint64_t* a ) { ::eosio_exit( int32_t( a[0] ) ); } } },
+            { "abort", { "v", []( instance&, uint64_t* ) { trap( "abort() called" ); } } },
+            { "current_time", { "l", []( instance&, uint64_t* a ) { a[0] = ::current_time(); } } },
+            { "set_blockchain_parameters_packed", { "vii", []( instance&, uint64_t* ) {
+               privileged( "set_blockchain_parameters_packed" );
+            } } },
+            { "get_blockchain_parameters_packed", { "iii", []( instance&, uint64_t* ) {
+               privileged( "get_blockchain_parameters_packed" );
+            } } },
+
+            // action
+            { "read_action_data", { "iii", []( instance& in, uint64_t* a ) {
+               uint32_t len = uint32_t( a[1] );
+               a[0] = ::read_action_data( len ? in.memory( uint32_t( a[0] ), len ) : nullptr, len );
+            } } },
+            { "action_data_size", { "i", []( instance&, uint64_t* a ) { a[0] = ::action_data_size(); } } },
+            { "require_recipient", { "vl", []( instance&, uint64_t* a ) { ::require_recipient( a[0] ); } } },
+            { "require_auth", { "vl", []( instance&, uint64_t* a ) { ::require_auth( a[0] ); } } },
+            { "require_auth2", { "vll", []( instance&, uint64_t* a ) { ::require_auth2( a[0], a[1] ); } } },
+            { "has_auth", { "il", []( instance&, uint64_t* a ) { a[0] = ::has_auth( a[0] ); } } },
+            { "is_account", { "il", []( instance&, uint64_t* a ) { a[0] = ::is_account( a[0] ); } } },
+            { "current_receiver", { "l", []( instance&, uint64_t* a ) { a[0] = ::current_receiver(); } } },
+            { "publication_time", { "l", []( instance&, uint64_t* a ) { a[0] = ::publication_time(); } } },
+            { "send_inline", { "vii", []( instance& in, uint64_t* a ) {
+               ::send_inline( in.chars( uint32_t( a[0] ), uint32_t( a[1] ) ), uint32_t( a[1] ) );
+            } } },
+            { "send_context_free_inline", { "vii", []( instance& in, uint64_t* a ) {
+               ::send_context_free_inline( in.chars( uint32_t( a[0] ), uint32_t( a[1] ) ), uint32_t( a[1] ) );
+            } } },
+
+            // print
+            { "prints", { "vi", []( instance& in, uint64_t* a ) { ::prints( in.cstr( uint32_t( a[0] ) ) ); } } },
+            { "prints_l", { "vii", []( instance& in, uint64_t* a ) {
+               ::prints_l( in.chars( uint32_t( a[0] ), uint32_t( a[1] ) ), uint32_t( a[1] ) );
+            } } },
+            { "printi", { "vl", []( instance&, uint64_t* a ) { ::printi( int64_t( a[0] ) ); } } },
+            { "printui", { "vl", []( instance&, uint64_t* a ) { ::printui( a[0] ); } } },
+            { "printi128", { "vi", []( instance& in, uint64_t* a ) {
+               int128_t v = load_value<int128_t>( in, a[0] );
+               ::printi128( &v );
+            } } },
+            { "printui128", { "vi", []( instance& in, uint64_t* a ) {
+               uint128_t v = load_value<uint128_t>( in, a[0] );
+               ::printui128( &v );
+            } } },
+            { "printsf", { "vf", []( instance&, uint64_t* a ) { ::printsf( as_f32( a[0] ) ); } } },
+            { "printdf", { "vd", []( instance&, uint64_t* a ) { ::printdf( as_f64( a[0] ) ); } } },
+            { "printn", { "vl", []( instance&, uint64_t* a ) { ::printn( a[0] ); } } },
+            { "printhex", { "vii", []( instance& in, uint64_t* a ) {
+               ::printhex( in.memory( uint32_t( a[0] ), uint32_t( a[1] ) ), uint32_t( a[1] ) );
+            } } },
+
+            // database
+            { "db_store_i64", { "illllii", []( instance& in, uint64_t* a ) {
+               a[0] = uint32_t( ::db_store_i64( a[0], a[1], a[2], a[3], in.memory( uint32_t( a[4] ), uint32_t( a[5] ) ),
+                                                uint32_t( a[5] ) ) );
+            } } },
+            { "db_update_i64", { "vilii", []( instance& in, uint64_t* a ) {
+               ::db_update_i64( int32_t( a[0] ), a[1], in.memory( uint32_t( a[2] ), uint32_t( a[3] ) ), uint32_t( a[3] ) );
+            } } },
+            { "db_remove_i64", { "vi", []( instance&, uint64_t* a ) { ::db_remove_i64( int32_t( a[0] ) ); } } },
+            { "db_get_i64", { "iiii", []( instance& in, uint64_t* a ) {
+               uint32_t len = uint32_t( a[2] );
+               a[0] = uint32_t( ::db_get_i64( int32_t( a[0] ), len ? in.memory( uint32_t( a[1] ), len ) : nullptr, len ) );
+            } } },
+            { "db_next_i64", { "iii", db_step<::db_next_i64> } },
+            { "db_previous_i64", { "iii", db_step<::db_previous_i64> } },
+            { "db_find_i64", { "illll", []( instance&, uint64_t* a ) {
+               a[0] = uint32_t( ::db_find_i64( a[0], a[1], a[2], a[3] ) );
+            } } },
+            { "db_lowerbound_i64", { "illll", []( instance&, uint64_t* a ) {
+               a[0] = uint32_t( ::db_lowerbound_i64( a[0], a[1], a[2], a[3] ) );
+            } } },
+            { "db_upperbound_i64", { "illll", []( instance&, uint64_t* a ) {
+               a[0] = uint32_t( ::db_upperbound_i64( a[0], a[1], a[2], a[3] ) );
+            } } },
+            { "db_end_i64", { "illl", []( instance&, uint64_t* a ) {
+               a[0] = uint32_t( ::db_end_i64( a[0], a[1], a[2] ) );
+            } } },
+
+            // libc, served by the host as in nodeos
+            { "memcpy", { "iiii", []( instance& in, uint64_t* a ) {
+               uint32_t dst = a[0], src = a[1], n = a[2];
+               ::eosio_assert( ( dst > src ? dst - src : src - dst ) >= n, "overlapping memory in memcpy" );
+               std::memcpy( in.memory( dst, n ), in.memory( src, n ), n );
+            } } },
+            { "memmove", { "iiii", []( instance& in, uint64_t* a ) {
+               uint32_t n = a[2];
+               std::memmove( in.memory( uint32_t( a[0] ), n ), in.memory( uint32_t( a[1] ), n ), n );
+            } } },
+            { "memset", { "iiii", []( instance& in, uint64_t* a ) {
+               uint32_t n = a[2];
+               std::memset( in.memory( uint32_t( a[0] ), n ), int( a[1] & 0xff ), n );
+            } } },
+            { "memcmp", { "iiii", []( instance& in, uint64_t* a ) {
+               uint32_t n = a[2];
+               int r = std::memcmp( in.memory( uint32_t( a[0] ), n ), in.memory( uint32_t( a[1] ), n ), n );
+               a[0] = uint32_t( r < 0 ? -1 : r > 0 ? 1 : 0 );
+            } } },
+
+            // long double arithmetic
+            { "__addtf3", { "villll", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), quad( a[1], a[2] ) + quad( a[3], a[4] ) );
+            } } },
+            { "__subtf3", { "villll", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), quad( a[1], a[2] ) - quad( a[3], a[4] ) );
+            } } },
+            { "__multf3", { "villll", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), quad( a[1], a[2] ) * quad( a[3], a[4] ) );
+            } } },
+            { "__divtf3", { "villll", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), quad( a[1], a[2] ) / quad( a[3], a[4] ) );
+            } } },
+            { "__negtf2", { "vill", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), -quad( a[1], a[2] ) );
+            } } },
+            { "__eqtf2", { "illll", []( instance&, uint64_t* a ) { a[0] = compare_quad( a, 1 ); } } },
+            { "__netf2", { "illll", []( instance&, uint64_t* a ) { a[0] = compare_quad( a, 1 ); } } },
+            { "__letf2", { "illll", []( instance&, uint64_t* a ) { a[0] = compare_quad( a, 1 ); } } },
+            { "__lttf2", { "illll", []( instance&, uint64_t* a ) { a[0] = compare_quad( a, 1 ); } } },
+            { "__cmptf2", { "illll", []( instance&, uint64_t* a ) { a[0] = compare_quad( a, 1 ); } } },
+            { "__getf2", { "illll", []( instance&, uint64_t* a ) { a[0] = compare_quad( a, -1 ); } } },
+            { "__gttf2", { "illll", []( instance&, uint64_t* a ) { a[0] = compare_quad( a, -1 ); } } },
+            { "__unordtf2", { "illll", []( instance&, uint64_t* a ) {
+               float128 x = quad( a[0], a[1] ), y = quad( a[2], a[3] );
+               a[0] = x != x || y != y;
+            } } },
+            { "__fixtfsi", { "ill", []( instance&, uint64_t* a ) {
+               a[0] = uint32_t( quad_to_int<int32_t>( quad( a[0], a[1] ) ) );
+            } } },
+            { "__fixunstfsi", { "ill", []( instance&, uint64_t* a ) {
+               a[0] = quad_to_int<uint32_t>( quad( a[0], a[1] ) );
+            } } },
+            { "__fixtfdi", { "lll", []( instance&, uint64_t* a ) {
+               a[0] = uint64_t( quad_to_int<int64_t>( quad( a[0], a[1] ) ) );
+            } } },
+            { "__fixunstfdi", { "lll", []( instance&, uint64_t* a ) {
+               a[0] = quad_to_int<uint64_t>( quad( a[0], a[1] ) );
+            } } },
+            { "__floatsitf", { "vii", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), float128( int32_t( a[1] ) ) );
+            } } },
+            { "__floatunsitf", { "vii", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), float128( uint32_t( a[1] ) ) );
+            } } },
+            { "__floatditf", { "vil", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), float128( int64_t( a[1] ) ) );
+            } } },
+            { "__floatunditf", { "vil", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), float128( a[1] ) );
+            } } },
+            { "__extenddftf2", { "vid", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), float128( as_f64( a[1] ) ) );
+            } } },
+            { "__extendsftf2", { "vif", []( instance& in, uint64_t* a ) {
+               store_quad( in, uint32_t( a[0] ), float128( as_f32( a[1] ) ) );
+            } } },
+            { "__trunctfdf2", { "dll", []( instance&, uint64_t* a ) { a[0] = bits( double( quad( a[0], a[1] ) ) ); } } },
+            { "__trunctfsf2", { "fll", []( instance&, uint64_t* a ) { a[0] = bits( float( quad( a[0], a[1] ) ) ); } } },
+         };
+         return functions;
+      }
+
+   } /// anonymous namespace
+
+   std::function<void( uint64_t, uint64_t, uint64_t )>
+   wasm_apply( std::shared_ptr<const wasm_module> module, std::shared_ptr<wasm_stats> stats ) {
+      const auto& m = module->state();
+      std::vector<host_function> hosts;
+      for( const auto& imp : m.imports ) {
+         auto found = host_functions().find( imp.field );
+         if( imp.module != "env" || found == host_functions().end() )
+            throw wasm_error( "unresolvable import " + imp.module + "." + imp.field );
+         auto signature = m.types[imp.type].signature();
+         if( signature != found->second.signature )
+            throw wasm_error( "import " + imp.field + " has signature " + signature + ", expected "
+                              + found->second.signature );
+         hosts.push_back( found->second.fn );
+      }
+      if( !stats )
+         stats = std::make_shared<wasm_stats>();
+
+      return [module, hosts = std::move(hosts), stats]( uint64_t receiver, uint64_t code, uint64_t action ) {
+         // the operand stacks of all frames; applies do not nest, inline actions run after
+         static thread_local std::vector<uint64_t> stack( stack_slots );
+
+         auto begin = std::chrono::steady_clock::now();
+         instance in( module->state(), hosts, stack );
+         stats->instantiate_ns += elapsed_ns( begin );
+         ++stats->calls;
+
+         struct tally {
+            instance& in;
+            wasm_stats& stats;
+            ~tally() {
+               stats.instructions += in.instructions;
+               stats.host_calls += in.host_calls;
+            }
+         } counted{ in, *stats };
+         in.apply( receiver, code, action );
+      };
+   }
+
+   std::vector<uint8_t> read_wasm_file( const std::string& path ) {
+      std::FILE* f = std::fopen( path.c_str(), "rb" );
+      if( !f )
+         throw wasm_error( "cannot open " + path );
+      std::vector<uint8_t> code;
+      uint8_t buf[1 << 16];
+      size_t n;
+      while( ( n = std::fread( buf, 1, sizeof(buf), f ) ) > 0 )
+         code.insert( code.end(), buf, buf + n );
+      std::fclose( f );
+      return code;
+   }
+
+} /// namespace native
@@ -0,0 +1,13 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  libstdc++ declares its string and stream instantiations extern, to be found in
+ *  libstdc++.so.  A contract links no C++ library, so instantiate them in place.
+ */
+#pragma once
+
+#include_next <bits/c++config.h>
+
+#undef _GLIBCXX_EXTERN_TEMPLATE
+#define _GLIBCXX_EXTERN_TEMPLATE 0
@@ -0,0 +1,11 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  Contracts are single threaded: use libstdc++'s no-op thread layer rather than
+ *  the host's pthreads, whose headers do not build for wasm32.
+ */
+#pragma once
+
+#define _GLIBCXX_GCC_GTHR_H
+#include <bits/gthr-single.h>
@@ -0,0 +1,7 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  glibc's headers pick their stub list by word size; wasm32 has none of its own.
+ */
+#pragma once
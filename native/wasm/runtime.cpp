@@ -0,0 +1,109 @@
+/**
+ *  @file
+ *  @copyright defined in eos/LICENSE.txt
+ *
+ *  The little C and C++ runtime a contract needs once compiled to wasm: a heap for
+ *  operator new, the libstdc++ error paths, which abort the action since contracts
+ *  build without exceptions, and the hash table sizing multi_index's caches use.  memcpy, memmove, memset and memcmp are
+ *  imported from the chain, as with eosio-cpp.
+ */
+#include <eosiolib/system.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <unordered_map>
+#include <utility>
+
+extern "C" unsigned char __heap_base;
+
+namespace {
+
+   /// each action runs in a fresh instance, so the heap only grows
+   uintptr_t heap_top = 0;
+
+   void* allocate( size_t size, size_t align = 16 ) {
+      if( heap_top == 0 )
+         heap_top = reinterpret_cast<uintptr_t>( &__heap_base );
+      uintptr_t p = ( heap_top + align - 1 ) & ~uintptr_t( align - 1 );
+      uintptr_t end = p + size;
+      eosio_assert( end >= p, "allocation size overflow" );
+      uintptr_t limit = __builtin_wasm_memory_size( 0 ) * 65536;
+      if( end > limit ) {
+         uintptr_t pages = ( end - limit + 65535 ) / 65536;
+         eosio_assert( __builtin_wasm_memory_grow( 0, pages ) != size_t(-1), "failed to allocate pages" );
+      }
+      heap_top = end;
+      return reinterpret_cast<void*>( p );
+   }
+
+}
+
+extern "C" {
+
+   void* malloc( size_t size ) { return allocate( size ); }
+
+   void* calloc( size_t count, size_t size ) {
+      eosio_assert( size == 0 || count <= size_t(-1) / size, "allocation size overflow" );
+      return __builtin_memset( allocate( count * size ), 0, count * size );
+   }
+
+   void free( void* ) {}
+
+   void abort() { eosio_assert( false, "abort" ); __builtin_unreachable(); }
+
+   size_t strlen( const char* s ) {
+      const char* e = s;
+      while( *e ) ++e;
+      return size_t( e - s );
+   }
+
+}
+
+void* operator new( size_t size ) { return allocate( size ); }
+void* operator new[]( size_t size ) { return allocate( size ); }
+void* operator new( size_t size, std::align_val_t align ) { return allocate( size, size_t(align) ); }
+void* operator new[]( size_t size, std::align_val_t align ) { return allocate( size, size_t(align) ); }
+void operator delete( void* ) noexcept {}
+void operator delete[]( void* ) noexcept {}
+void operator delete( void*, size_t ) noexcept {}
+void operator delete[]( void*, size_t ) noexcept {}
+void operator delete( void*, std::align_val_t ) noexcept {}
+void operator delete[]( void*, std::align_val_t ) noexcept {}
+void operator delete( void*, size_t, std::align_val_t ) noexcept {}
+void operator delete[]( void*, size_t, std::align_val_t ) noexcept {}
+
+namespace std {
+
+   void __throw_bad_alloc() { eosio_assert( false, "bad alloc" ); __builtin_unreachable(); }
+   void __throw_bad_array_new_length() { eosio_assert( false, "bad array new length" ); __builtin_unreachable(); }
+   void __throw_length_error( const char* what ) { eosio_assert( false, what ); __builtin_unreachable(); }
+   void __throw_logic_error( const char* what ) { eosio_assert( false, what ); __builtin_unreachable(); }
+   void __throw_out_of_range( const char* what ) { eosio_assert( false, what ); __builtin_unreachable(); }
+   void __throw_out_of_range_fmt( const char* what, ... ) { eosio_assert( false, what ); __builtin_unreachable(); }
+   void __throw_invalid_argument( const char* what ) { eosio_assert( false, what ); __builtin_unreachable(); }
+
+}
+
+namespace std::__detail {
+
+   /// odd bucket counts, growing by doubling; any count spreads the keys well enough
+   size_t _Prime_rehash_policy::_M_next_bkt( size_t n ) const {
+      size_t buckets = 1;
+      while( buckets < n )
+         buckets = buckets * 2 + 1;
+      _M_next_resize = size_t( buckets * _M_max_load_factor );
+      return buckets;
+   }
+
+   pair<bool, size_t> _Prime_rehash_policy::_M_need_rehash( size_t buckets, size_t elements, size_t inserts ) const {
+      if( elements + inserts <= _M_next_resize )
+         return { false, 0 };
+      size_t needed = size_t( ( elements + inserts ) / _M_max_load_factor ) + 1;
+      if( needed > buckets )
+         return { true, _M_next_bkt( needed > buckets * 2 ? needed : buckets * 2 ) };
+      _M_next_resize = size_t( buckets * _M_max_load_factor );
+      return { false, 0 };
+   }
+
+}
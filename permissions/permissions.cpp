@@ -1,5 +1,8 @@
 #include "permissions.hpp"
 #include "eosiolib/action.hpp"
+#include "../common/inline_action.hpp"
+
+#include <algorithm>
 
 namespace ampr {
 
@@ -7,6 +10,23 @@ namespace ampr {
         eosio::print(has_auth(account));
     }
 
+    /**
+     * prints a bitmap, as hex bytes, with bit i (lowest bit first) set if accounts[i]
+     * authorized this action
+     */
+    void permissions::hasauths(std::vector<account_name> accounts) {
+        std::vector<uint8_t> bitmap((accounts.size() + 7) / 8);
+        for (size_t i = 0; i < accounts.size(); ++i) {
+            if (has_auth(accounts[i])) {
+                bitmap[i / 8] |= uint8_t(1) << (i % 8);
+            }
+        }
+
+        if (!bitmap.empty()) {
+            printhex(bitmap.data(), bitmap.size());
+        }
+    }
+
     void permissions::reqauth(account_name account) {
         require_auth(account);
     }
@@ -28,20 +48,35 @@ namespace ampr {
         eosio::print(name{permission});
     }
 
+    /// asserts that at least threshold distinct accounts authorized this action
+    void permissions::reqthreshold(std::vector<account_name> accounts, uint32_t threshold) {
+        std::sort(accounts.begin(), accounts.end());
+        accounts.erase(std::unique(accounts.begin(), accounts.end()), accounts.end());
+        eosio_assert(threshold > 0 && threshold <= accounts.size(), "invalid threshold");
+
+        uint32_t authorized = 0;
+        for (auto account : accounts) {
+            if (has_auth(account) && ++authorized == threshold) {
+                return;
+            }
+        }
+        eosio_assert(false, "threshold of authorizations not met");
+    }
+
     void permissions::send(account_name sent, permission_name p_sent, account_name req) {
-        action(permission_level{sent, p_sent},
-               N(test), N(reqauth),
-               std::make_tuple(req)
+        ampersand::inline_action(permission_level{sent, p_sent},
+               name{N(test)}, name{N(reqauth)},
+               req
         ).send();
     }
 
     void permissions::send2(account_name sent, permission_name p_sent, account_name req, permission_name p_req) {
-        action(permission_level{sent, p_sent},
-               N(test), N(reqauth2),
-               std::make_tuple(req, p_req)
+        ampersand::inline_action(permission_level{sent, p_sent},
+               name{N(test)}, name{N(reqauth2)},
+               req, p_req
         ).send();
     }
 }
 
-EOSIO_ABI(ampr::permissions, (hasauth)(reqauth)(reqauth2)(send)(send2))
+EOSIO_ABI(ampr::permissions, (hasauth)(hasauths)(reqauth)(reqauth2)(reqthreshold)(send)(send2))
 
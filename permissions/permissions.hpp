@@ -2,6 +2,8 @@
 
 #include <eosiolib/eosio.hpp>
 
+#include <vector>
+
 using namespace eosio;
 
 namespace ampr {
@@ -13,9 +15,15 @@ namespace ampr {
         [[eosio::action]]
 		void hasauth(account_name account);
 
+        [[eosio::action]]
+        void hasauths(std::vector<account_name> accounts);
+
         [[eosio::action]]
         void reqauth(account_name account);
 
+        [[eosio::action]]
+        void reqthreshold(std::vector<account_name> accounts, uint32_t threshold);
+
         [[eosio::action]]
         void reqauth2(account_name account, permission_name permission);
 
@@ -15,80 +15,62 @@ using std::string;
 //using namespace eosio::multi_index;
 //using namespace eosio::require_auth;
 
+#include "../common/token_core.hpp"
+
 using namespace eosio;
 
 namespace ampr {
-	class token : public contract {
+	using ampersand::token_core;
+	using ampersand::token_policy;
+
+	class [[eosio::contract("token")]] token : public token_core<token, token_policy> {
 		public:
-			token( account_name self ):contract( self ){}
+			using token_core::token_core;
 	
 			// @abi action
 			[[eosio::action]]
-			void create( account_name issuer,
+			void create( name issuer,
 					     asset maximum_supply );
 
 			// @abi action
 			[[eosio::action]]
-			void issue( account_name to,
+			void issue( name to,
 					    asset quantity,
 						string memo );
 
 			// @abi action
 			[[eosio::action]]
-			void transfer ( account_name from,
-							account_name to,
+			void transfer ( name from,
+							name to,
 							asset quantity,
 							string memo );
-
-			// @abi action
-			inline asset get_supply( symbol_name sym ) const;
-
-			// @abi action
-			inline asset get_balance( account_name owner,
-									  symbol_name sym ) const;	
 				
 		private: 
+			friend class token_core<token, token_policy>;
+
 			struct [[eosio::table]] account {
 				asset balance;
 
-				uint64_t primary_key() const { return balance.symbol.name(); }
+				uint64_t primary_key() const { return balance.symbol.code().raw(); }
 			};
 	
 			struct  [[eosio::table]] currency_stats {
 				asset supply;
 				asset max_supply;
-				account_name issuer;
+				name issuer;
 				
-				uint64_t primary_key() const { return supply.symbol.name(); }		
+				uint64_t primary_key() const { return supply.symbol.code().raw(); }		
 			};
 
-			typedef multi_index<N(accounts), account> accounts;
-			typedef multi_index<N(stats), currency_stats> stats;
-
-			void sub_balance(account_name owner, asset value );
-
-        	void add_balance(account_name owner, asset value,
-                         account_name ram_payer);
-
+			typedef multi_index<"accounts"_n, account> accounts;
+			typedef multi_index<"stats"_n, currency_stats> stats;
 
 		public:
 			struct transfer_args {
-				account_name from;
-				account_name to;
+				name from;
+				name to;
 				asset quantity;
 				string memo;
 			};
 	};
-
-	asset token::get_supply( symbol_name sym ) const{
-		stats statstable( _self, sym );
-		const auto& st = statstable.get( sym );
-		return st.supply;
-	}
-
-	asset token::get_balance( account_name owner, symbol_name sym ) const{
-		accounts accounts_table( owner, sym );
-		const auto& at = accounts_table.get( sym );
-		return at.balance;
-	}
 } // namespace ampr
@@ -6,82 +6,69 @@
 
 #include <string>
 
-using namespace eosio;
+#include "../common/token_core.hpp"
 
-/*
-namespace eosiosystem {
-   class system_contract;
-}
-*/
+using namespace eosio;
 
 namespace ampr {
 
    using std::string;
+   using ampersand::token_core;
 
-   class token : public contract {
+   struct token_policy : ampersand::token_policy {
+      static constexpr bool notify_filter = true;
+   };
+
+   class [[eosio::contract("token")]] token : public token_core<token, token_policy> {
       public:
-         token( account_name self ):contract(self){}
+         using token_core::token_core;
+
+		 [[eosio::action]]
+         void create( name   issuer,
+                      asset  maximum_supply);
+
+		 [[eosio::action]]
+         void issue( name to, asset quantity, string memo );
 
 		 [[eosio::action]]
-         void create( account_name issuer,
-                      asset        maximum_supply);
+         void transfer( name   from,
+                        name   to,
+                        asset  quantity,
+                        string memo );
 
 		 [[eosio::action]]
-         void issue( account_name to, asset quantity, string memo );
+         void setnotify( name account, bool allow, std::vector<symbol_code> symbols );
 
 		 [[eosio::action]]
-         void transfer( account_name from,
-                        account_name to,
-                        asset        quantity,
-                        string       memo );
-      
-      
-         inline asset get_supply( symbol_name sym )const;
-         
-         inline asset get_balance( account_name owner, symbol_name sym )const;
+         void clrnotify( name account );
 
       private:
+         friend class token_core<token, token_policy>;
+
          struct [[eosio::table]] account {
             asset    balance;
 
-            uint64_t primary_key()const { return balance.symbol.name(); }
+            uint64_t primary_key()const { return balance.symbol.code().raw(); }
          };
 
          struct [[eosio::table]] currency_stats {
             asset          supply;
             asset          max_supply;
-            account_name   issuer;
+            name           issuer;
 
-            uint64_t primary_key()const { return supply.symbol.name(); }
+            uint64_t primary_key()const { return supply.symbol.code().raw(); }
          };
 
-         typedef eosio::multi_index<N(accounts), account> accounts;
-         typedef eosio::multi_index<N(stat), currency_stats> stats;
-
-         void sub_balance( account_name owner, asset value );
-         void add_balance( account_name owner, asset value, account_name ram_payer );
+         typedef eosio::multi_index<"accounts"_n, account> accounts;
+         typedef eosio::multi_index<"stat"_n, currency_stats> stats;
 
       public:
          struct transfer_args {
-            account_name  from;
-            account_name  to;
+            name          from;
+            name          to;
             asset         quantity;
             string        memo;
          };
    };
 
-   asset token::get_supply( symbol_name sym )const
-   {
-      stats statstable( _self, sym );
-      const auto& st = statstable.get( sym );
-      return st.supply;
-   }
-
-   asset token::get_balance( account_name owner, symbol_name sym )const
-   {
-      accounts accountstable( _self, owner );
-      const auto& ac = accountstable.get( sym );
-      return ac.balance;
-   }
-
-} /// namespace eosio
+} /// namespace ampr